@@ -118,6 +118,40 @@ def plot_distance_distribution(distances: np.ndarray, output_filename: str, data
     # plt.show()
 
 
+def plot_histogram_csv(csv_path: str, output_filename: str, dataset_name: str):
+    """
+    绘制原生工具 distance_histogram 输出的直方图 CSV (bin_lower,bin_upper,count,density)。
+    溢出分箱 (bin_upper 为 inf) 只在统计文本中显示。
+
+    Args:
+        csv_path (str): distance_histogram 生成的 CSV 文件。
+        output_filename (str): 保存图像的文件名。
+        dataset_name (str): 数据集的名称，用于图表标题。
+    """
+    if not os.path.exists(csv_path):
+        raise FileNotFoundError(f"Error: histogram CSV '{csv_path}' not found")
+    table = np.genfromtxt(csv_path, delimiter=',', names=True)
+    finite = np.isfinite(table['bin_upper'])
+    lower, upper = table['bin_lower'][finite], table['bin_upper'][finite]
+    counts = table['count']
+    total = counts.sum()
+
+    sns.set_theme(style="whitegrid")
+    plt.figure(figsize=(12, 7))
+    plt.bar(lower, table['density'][finite], width=upper - lower, align='edge', color='skyblue', edgecolor='white')
+    plt.title(f'Distribution of Pairwise Distances in "{dataset_name}" Dataset', fontsize=16)
+    plt.xlabel('Euclidean Distance', fontsize=12)
+    plt.ylabel('Density', fontsize=12)
+
+    stats_text = (f'Samples: {int(total)}\n'
+                  f'Beyond {upper[-1]:.2f}: {int(counts[~finite].sum())}')
+    plt.text(0.95, 0.95, stats_text, transform=plt.gca().transAxes, fontsize=10,
+             verticalalignment='top', horizontalalignment='right', bbox=dict(boxstyle='round,pad=0.5', fc='wheat', alpha=0.5))
+
+    plt.savefig(output_filename, dpi=300, bbox_inches='tight')
+    print(f"Plot saved successfully to '{output_filename}'")
+
+
 if __name__ == "__main__":
     parser = argparse.ArgumentParser(
         description="Analyze and plot the distribution of pairwise distances in a high-dimensional dataset.",
@@ -138,9 +172,19 @@ if __name__ == "__main__":
                         default="distance_distribution.png",
                         help="Filename for the output plot.")
 
+    parser.add_argument("--histogram-csv",
+                        type=str,
+                        default=None,
+                        help="Plot a CSV written by the native distance_histogram tool instead of sampling in Python.")
+
     args = parser.parse_args()
 
     try:
+        dataset_name = os.path.basename(os.path.normpath(args.dataset_dir)) # 从路径中获取数据集名称
+        if args.histogram_csv:
+            plot_histogram_csv(args.histogram_csv, args.output, dataset_name)
+            exit(0)
+
         # 1. 加载数据
         vector_data = load_nodes(args.dataset_dir)
 
@@ -148,7 +192,6 @@ if __name__ == "__main__":
         distances = sample_distances(vector_data, args.samples)
 
         # 3. 绘图
-        dataset_name = os.path.basename(args.dataset_dir) # 从路径中获取数据集名称
         plot_distance_distribution(distances, args.output, dataset_name)
 
     except (FileNotFoundError, ValueError) as e:
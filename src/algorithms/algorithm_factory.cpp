@@ -0,0 +1,76 @@
+#include "algorithm_factory.h"
+#include "brute_force_algorithm.h"
+#include "cascade_pruning.h"
+#include "kmeans_triangle_pruning.h"
+#include "multi_pivot_triangle_pruning.h"
+#include "reordered_algorithm.h"
+
+namespace {
+
+// 拆分 "<base>@<order>"；没有后缀时 order 为 None 且 reordered 为 false
+bool split_order_suffix(const std::string& name, std::string& base, PointOrder& order, bool& reordered) {
+    const size_t at = name.find('@');
+    reordered = at != std::string::npos;
+    base = name.substr(0, at);
+    order = PointOrder::None;
+    return !reordered || parse_point_order(name.substr(at + 1), order);
+}
+
+std::unique_ptr<PruningAlgorithm> make_base_algorithm(const std::string& name, int k, int max_iterations,
+                                                      uint64_t seed) {
+    if (name == "brute") return std::make_unique<BruteForceAlgorithm>();
+    if (name == "kmeans") return std::make_unique<KMeansTrianglePruning>(k, max_iterations, seed);
+    if (name == "multipivot") return std::make_unique<MultiPivotTrianglePruning>(k, max_iterations, seed);
+    if (name == "multipivot-u8") {
+        return std::make_unique<MultiPivotTrianglePruning>(k, max_iterations, seed, PivotTableEncoding::UInt8);
+    }
+    if (name == "multipivot-ff") {
+        return std::make_unique<MultiPivotTrianglePruning>(k, max_iterations, seed, PivotTableEncoding::Float64,
+                                                           PivotSelection::FarthestFirst);
+    }
+    if (name == "cascade") return std::make_unique<CascadePruning>(k, max_iterations, seed);
+    return nullptr;
+}
+
+} // namespace
+
+std::unique_ptr<PruningAlgorithm> make_algorithm(const std::string& name, int k, int max_iterations, uint64_t seed) {
+    std::string base;
+    PointOrder order;
+    bool reordered;
+    if (!split_order_suffix(name, base, order, reordered)) return nullptr;
+    auto algorithm = make_base_algorithm(base, k, max_iterations, seed);
+    if (algorithm == nullptr || !reordered) return algorithm;
+    return std::make_unique<ReorderedAlgorithm>(std::move(algorithm), order, k > 0 ? k : 256, seed);
+}
+
+std::string algorithm_index_file(const std::string& name, int k) {
+    std::string base;
+    PointOrder order;
+    bool reordered;
+    if (!split_order_suffix(name, base, order, reordered)) return "";
+    std::string prefix;
+    if (base == "kmeans") prefix = "single_pivot";
+    if (base == "multipivot") prefix = "multi_pivot";
+    if (base == "multipivot-u8") prefix = "multi_pivot_u8";
+    if (base == "multipivot-ff") prefix = "multi_pivot_ff";
+    if (base == "cascade") prefix = "cascade";
+    if (prefix.empty()) return "";
+    if (reordered) prefix += std::string("_") + point_order_name(order);
+    return prefix + "_k" + std::to_string(k) + ".idx";
+}
+
+bool algorithm_uses_k(const std::string& name) {
+    std::string base;
+    PointOrder order;
+    bool reordered;
+    split_order_suffix(name, base, order, reordered);
+    // brute@cluster 用 k 作为重排时的聚类数
+    return base != "brute" || order == PointOrder::Cluster;
+}
+
+const std::vector<std::string>& algorithm_names() {
+    static const std::vector<std::string> names = {"brute", "kmeans", "multipivot", "multipivot-u8", "multipivot-ff",
+                                                       "cascade"};
+    return names;
+}
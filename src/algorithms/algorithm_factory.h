@@ -0,0 +1,29 @@
+#pragma once
+#include "pruning_algorithm.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 按名称创建剪枝算法，供基准测试、调参等命令行工具使用。
+// 支持的名称：
+//   brute            暴力计算 (带提前退出)，忽略 k
+//   kmeans           单 pivot (k-means) 三角不等式剪枝
+//   multipivot       多 pivot，float64 距离表
+//   multipivot-u8    多 pivot，8 位量化距离表
+//   multipivot-ff    多 pivot，最远优先选取 pivot
+//   cascade          级联剪枝：单中心界、最近 pivot 的界、全部 pivot 的界，顺序随负载自适应
+// 任一名称后加 @cluster / @morton / @none 表示先按该顺序重排点再构建 (ReorderedAlgorithm)，
+// 如 kmeans@cluster；查询仍使用原始下标。未知名称返回 nullptr
+std::unique_ptr<PruningAlgorithm> make_algorithm(const std::string& name, int k, int max_iterations = 20,
+                                                 uint64_t seed = 42);
+
+// 索引缓存文件名 (与 pruning_experiment 的命名一致，如 single_pivot_k500.idx)；
+// 不需要索引的算法返回空串
+std::string algorithm_index_file(const std::string& name, int k);
+
+// 该算法是否使用参数 k (参数网格中不使用 k 的算法只运行一次)
+bool algorithm_uses_k(const std::string& name);
+
+// 全部支持的基础算法名称 (不含重排后缀)
+const std::vector<std::string>& algorithm_names();
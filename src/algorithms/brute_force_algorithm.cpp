@@ -1,18 +1,110 @@
 #include "brute_force_algorithm.h"
 #include "../core/distance.h"
+#include "../core/index_file.h"
+#include "../core/prefetch.h"
+#include <limits>
 
 void BruteForceAlgorithm::build(const Dataset& dataset) {
     // 无需构建任何东西，但需要保存数据集指针
     dataset_ = &dataset;
+    reset_update_counts(dataset.size());
+}
+
+void BruteForceAlgorithm::insert_point(int id) {
+    // 范围查询直接扫描整个数据集，新点自然包含在内
+    (void)id;
+    ++inserted_since_build_;
+}
+
+namespace {
+constexpr uint32_t kIndexTag = make_index_tag("BRUT");
+}
+
+bool BruteForceAlgorithm::save(const std::string& path) const {
+    return IndexFileWriter(kIndexTag, *dataset_).write(path);
+}
+
+bool BruteForceAlgorithm::load(const std::string& path, const Dataset& dataset) {
+    IndexFileReader reader;
+    if (!reader.open(path, kIndexTag, dataset)) {
+        return false;
+    }
+    dataset_ = &dataset;
+    reset_update_counts(dataset.size());
+    return true;
 }
 
 bool BruteForceAlgorithm::query_distance_exceeds(int p_idx, int q_idx, double r) {
-    // 暴力算法总是进行“完整”计算
-    full_calculations_count_++;
+    // 暴力算法没有上下界，除了可选的量化预过滤之外总是进行“完整”计算
+    int decision = prefilter_decide(p_idx, q_idx, r);
+    if (decision >= 0) {
+        return decision == 1;
+    }
+    stats_.add_full_calculations(1);
     
-    const auto& p = dataset_->get_point(p_idx);
-    const auto& q = dataset_->get_point(q_idx);
+    const PointView p = dataset_->get_point(p_idx);
+    const PointView q = dataset_->get_point(q_idx);
+    record_full_calculation(p, q, r, true);
 
     // 使用我们最高效的“完整”计算方法
-    return is_distance_exceeding_early_exit(p, q, r);
-}
\ No newline at end of file
+    return full_calculation_exceeds(*dataset_, p_idx, q_idx, r, true);
+}
+
+void BruteForceAlgorithm::query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) {
+    // 没有界可以检查，所有点对都要完整计算；提前预取后面点对的数据以隐藏访存延迟
+    if (prefilter_ != nullptr) {
+        // 有预过滤时改为两阶段：只对预过滤判定不了的点对做完整计算
+        std::vector<uint32_t>& undecided = batch_scratch();
+        undecided.resize(count);
+        for (size_t i = 0; i < count; ++i) undecided[i] = static_cast<uint32_t>(i);
+        compute_undecided_batch(*dataset_, pairs, undecided, r, results);
+        return;
+    }
+    stats_.add_full_calculations(static_cast<long long>(count));
+    for (size_t i = 0; i < count; ++i) {
+        if (i + kPrefetchDistance < count) {
+            const QueryPair& ahead = pairs[i + kPrefetchDistance];
+            if (compact_ != nullptr) {
+                prefetch_bytes(compact_->row_data(ahead.p_idx), compact_->row_bytes());
+                prefetch_bytes(compact_->row_data(ahead.q_idx), compact_->row_bytes());
+            } else {
+                prefetch_point(dataset_->get_point(ahead.p_idx));
+                prefetch_point(dataset_->get_point(ahead.q_idx));
+            }
+        }
+        record_full_calculation(dataset_->get_point(pairs[i].p_idx), dataset_->get_point(pairs[i].q_idx), r, true);
+        results[i] = full_calculation_exceeds(*dataset_, pairs[i].p_idx, pairs[i].q_idx, r, true) ? 1 : 0;
+    }
+}
+
+size_t BruteForceAlgorithm::query_radius_bucket(int p_idx, int q_idx, const std::vector<double>& radii) {
+    // 没有界：下界 0、上界无穷，直接做一次提前退出的计算
+    return radius_bucket_from_bounds(*dataset_, p_idx, q_idx, 0.0,
+                                     std::numeric_limits<double>::infinity(), radii);
+}
+
+void BruteForceAlgorithm::range_query(int p_idx, double r, std::vector<int>& results) {
+    scan_range(dataset_->get_point(p_idx), p_idx, r, results);
+}
+
+void BruteForceAlgorithm::range_query(PointView query, double r, std::vector<int>& results) {
+    scan_range(query, -1, r, results);
+}
+
+void BruteForceAlgorithm::scan_range(PointView query, int exclude_idx, double r, std::vector<int>& results) {
+    results.clear();
+    const int n = static_cast<int>(dataset_->size());
+    const QuantizedPrefilter::Code* code = exclude_idx >= 0 ? nullptr : prefilter_code(query);
+    const CompactPoints::Query* compact_query = exclude_idx >= 0 ? nullptr : compact_code(query);
+    long long full_calcs = 0;
+    for (int x = 0; x < n; ++x) {
+        if (x == exclude_idx || dataset_->is_erased(x)) continue;
+        int decision = prefilter_decide_range(exclude_idx, code, x, r);
+        if (decision < 0) {
+            ++full_calcs;
+            decision = range_calculation_exceeds(*dataset_, query, exclude_idx, compact_query, x, r) ? 1 : 0;
+        }
+        if (decision == 0) results.push_back(x);
+    }
+    stats_.add_full_calculations(full_calcs);
+}
@@ -7,10 +7,22 @@ public:
 
     // build 方法是空的，因为暴力搜索不需要预处理
     void build(const Dataset& dataset) override;
+    // 没有索引数据，文件中只记录数据集指纹
+    bool save(const std::string& path) const override;
+    bool load(const std::string& path, const Dataset& dataset) override;
+
+    void insert_point(int id) override;
 
     // query 方法总是执行完整的距离计算
     bool query_distance_exceeds(int p_idx, int q_idx, double r) override;
+    void query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) override;
+    size_t query_radius_bucket(int p_idx, int q_idx, const std::vector<double>& radii) override;
+    // 范围查询：与全部 n 个点逐一做完整计算
+    void range_query(int p_idx, double r, std::vector<int>& results) override;
+    void range_query(PointView query, double r, std::vector<int>& results) override;
 
 private:
+    void scan_range(PointView query, int exclude_idx, double r, std::vector<int>& results);
+
     const Dataset* dataset_ = nullptr;
 };
\ No newline at end of file
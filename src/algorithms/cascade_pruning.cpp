@@ -0,0 +1,641 @@
+#include "cascade_pruning.h"
+#include "../core/cycle_clock.h"
+#include "../core/distance.h"
+#include "../core/index_file.h"
+#include "../core/kmeans.h"
+#include "../core/prefetch.h"
+#include "../core/work_stealing.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+const char* cascade_stage_name(CascadeStage stage) {
+    switch (stage) {
+        case CascadeStage::Cluster: return "cluster";
+        case CascadeStage::NearPivots: return "near-pivots";
+        case CascadeStage::AllPivots: return "all-pivots";
+        case CascadeStage::Exact: return "exact";
+    }
+    return "unknown";
+}
+
+namespace {
+constexpr uint32_t kIndexTag = make_index_tag("CASC");
+enum SectionId : uint32_t {
+    kSectionParams = 1,     // int64: k, max_iterations, seed, near_pivots
+    kSectionPivots = 2,     // double: k 行 pivots (对齐行格式)
+    kSectionPivotPairs = 3, // double: k*k
+    kSectionTable = 4,      // 距离表，占用 4~6 三个节号
+};
+
+// 每个线程的点对计数器，决定哪些点对被抽样
+uint32_t& pair_counter() {
+    thread_local uint32_t counter = 0;
+    return counter;
+}
+} // namespace
+
+CascadePruning::CascadePruning(int k, int max_iterations, uint64_t seed, int near_pivots)
+    : k_(k), max_iterations_(max_iterations), seed_(seed), near_(std::clamp(near_pivots, 1, std::max(k, 1))) {}
+
+bool CascadePruning::sample_pair() {
+    return (++pair_counter() & kSampleMask) == 0;
+}
+
+size_t CascadePruning::take_batch_samples(size_t count) {
+    uint32_t& counter = pair_counter();
+    const size_t first = (kSampleMask + 1 - ((counter + 1) & kSampleMask)) & kSampleMask;
+    counter += static_cast<uint32_t>(count);
+    return first;
+}
+
+bool CascadePruning::explore_batch() {
+    // 每个线程的第一批就计时，尽早有代价数据
+    thread_local uint32_t counter = 0;
+    return (counter++ & kExploreMask) == 0;
+}
+
+size_t CascadePruning::thread_slot() {
+    static std::atomic<size_t> next_id{0};
+    thread_local const size_t slot = next_id.fetch_add(1, std::memory_order_relaxed) % QueryStats::kMaxSlots;
+    return slot;
+}
+
+uint32_t CascadePruning::encode_plan(const CascadeStage* stages, size_t count) {
+    uint32_t plan = static_cast<uint32_t>(count);
+    for (size_t i = 0; i < count; ++i) plan |= static_cast<uint32_t>(stages[i]) << (2 + 2 * i);
+    return plan;
+}
+
+void CascadePruning::build(const Dataset& dataset) {
+    dataset_ = &dataset;
+    std::cout << "Building index with Cascade Pruning (k=" << k_ << ", near pivots=" << near_ << ")..." << std::endl;
+    KMeansOptions options;
+    options.k = k_;
+    options.max_iterations = max_iterations_;
+    options.seed = seed_;
+    pivots_ = run_kmeans(dataset, options).centroids;
+
+    table_.build(dataset.size(), static_cast<size_t>(k_), PivotTableEncoding::Float64, [&](size_t i, double* out) {
+        const PointView point = dataset.get_point(static_cast<int>(i));
+        for (int j = 0; j < k_; ++j) out[j] = euclidean_distance(point, pivots_.get_point(j));
+    });
+    pivot_pair_dists_.assign(static_cast<size_t>(k_) * k_, 0.0);
+    parallel_for_work_stealing(static_cast<size_t>(k_), hardware_thread_count(), 4, [&](size_t begin, size_t end, int) {
+        for (size_t a = begin; a < end; ++a) {
+            for (size_t b = 0; b < static_cast<size_t>(k_); ++b) {
+                if (a == b) continue;
+                pivot_pair_dists_[a * k_ + b] = euclidean_distance(pivots_.get_point(static_cast<int>(a)),
+                                                                   pivots_.get_point(static_cast<int>(b)));
+            }
+        }
+    });
+    build_derived();
+    std::cout << "Build finished (" << table_.memory_bytes() / (1024.0 * 1024.0) << " MB distance table)." << std::endl;
+}
+
+bool CascadePruning::save(const std::string& path) const {
+    const std::vector<int64_t> params = {k_, max_iterations_, static_cast<int64_t>(seed_), near_};
+    IndexFileWriter writer(kIndexTag, *dataset_);
+    writer.add_vector(kSectionParams, params);
+    writer.add_points(kSectionPivots, pivots_);
+    writer.add_vector(kSectionPivotPairs, pivot_pair_dists_);
+    table_.add_sections(writer, kSectionTable);
+    return writer.write(path);
+}
+
+bool CascadePruning::load(const std::string& path, const Dataset& dataset) {
+    IndexFileReader reader;
+    if (!reader.open(path, kIndexTag, dataset)) {
+        return false;
+    }
+    std::vector<int64_t> params;
+    if (!reader.read_vector(kSectionParams, params, 4) || params[0] != k_ || params[3] != near_) {
+        std::cerr << "Error: Index file " << path << " was built with different parameters (k or near pivots)."
+                  << std::endl;
+        return false;
+    }
+    if (!reader.read_points(kSectionPivots, dataset.dimensions(), pivots_) || pivots_.size() != static_cast<size_t>(k_) ||
+        !reader.read_vector(kSectionPivotPairs, pivot_pair_dists_, static_cast<size_t>(k_) * k_) ||
+        !table_.read_sections(reader, kSectionTable, dataset.size(), static_cast<size_t>(k_),
+                              PivotTableEncoding::Float64)) {
+        std::cerr << "Error: Index file " << path << " is missing sections or has unexpected sizes." << std::endl;
+        return false;
+    }
+    dataset_ = &dataset;
+    build_derived();
+    return true;
+}
+
+void CascadePruning::fill_near_pivots(size_t row) {
+    const double* dists = pivot_dists(static_cast<int>(row));
+    thread_local std::vector<int> order;
+    order.resize(static_cast<size_t>(k_));
+    std::iota(order.begin(), order.end(), 0);
+    std::partial_sort(order.begin(), order.begin() + near_, order.end(), [&](int a, int b) {
+        return dists[a] != dists[b] ? dists[a] < dists[b] : a < b;
+    });
+    for (int i = 0; i < near_; ++i) {
+        near_ids_[row * near_ + i] = order[i];
+        near_dists_[row * near_ + i] = dists[order[i]];
+    }
+    point_cluster_[row] = order[0];
+    point_cluster_dist_[row] = dists[order[0]];
+}
+
+void CascadePruning::build_derived() {
+    const size_t n = table_.rows();
+    const size_t k = static_cast<size_t>(k_);
+    near_ids_.resize(n * near_);
+    near_dists_.resize(n * near_);
+    point_cluster_.resize(n);
+    point_cluster_dist_.resize(n);
+    parallel_for_work_stealing(n, hardware_thread_count(), 256, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; ++i) fill_near_pivots(i);
+    });
+
+    // 每个点归入最近的 pivot 所在的簇，簇内按到中心的距离排序
+    cluster_offsets_.assign(k + 1, 0);
+    for (size_t i = 0; i < n; ++i) cluster_offsets_[point_cluster_[i] + 1]++;
+    for (size_t c = 0; c < k; ++c) cluster_offsets_[c + 1] += cluster_offsets_[c];
+    cluster_members_.resize(n);
+    std::vector<size_t> cursor(cluster_offsets_.begin(), cluster_offsets_.end() - 1);
+    for (size_t i = 0; i < n; ++i) cluster_members_[cursor[point_cluster_[i]]++] = static_cast<int>(i);
+    cluster_member_dists_.resize(n);
+    cluster_radius_.assign(k, 0.0);
+    pending_members_.assign(k, {});
+    parallel_for_work_stealing(k, hardware_thread_count(), 4, [&](size_t begin, size_t end, int) {
+        for (size_t c = begin; c < end; ++c) {
+            auto first = cluster_members_.begin() + cluster_offsets_[c];
+            auto last = cluster_members_.begin() + cluster_offsets_[c + 1];
+            std::sort(first, last, [&](int a, int b) {
+                const double da = point_cluster_dist_[a];
+                const double db = point_cluster_dist_[b];
+                return da != db ? da < db : a < b;
+            });
+            for (size_t i = cluster_offsets_[c]; i < cluster_offsets_[c + 1]; ++i) {
+                cluster_member_dists_[i] = point_cluster_dist_[cluster_members_[i]];
+            }
+            if (first != last) cluster_radius_[c] = cluster_member_dists_[cluster_offsets_[c + 1] - 1];
+        }
+    });
+    reset_update_counts(n);
+
+    // 新的索引从头采样
+    plan_.store(kFullPlan, std::memory_order_relaxed);
+    for (Slot& slot : slots_) {
+        clear_samples(slot);
+        slot.radius.store(-1.0, std::memory_order_relaxed);
+    }
+    reset_stats();
+}
+
+void CascadePruning::insert_point(int id) {
+    const PointView point = dataset_->get_point(id);
+    std::vector<double>& dists = pivot_distance_scratch();
+    dists.resize(static_cast<size_t>(k_));
+    for (int j = 0; j < k_; ++j) dists[j] = euclidean_distance(point, pivots_.get_point(j));
+    table_.append_row(dists.data());
+    near_ids_.resize(near_ids_.size() + near_);
+    near_dists_.resize(near_dists_.size() + near_);
+    point_cluster_.push_back(0);
+    point_cluster_dist_.push_back(0.0);
+    fill_near_pivots(static_cast<size_t>(id));
+    const int c = point_cluster_[id];
+    pending_members_[c].push_back(id);
+    cluster_radius_[c] = std::max(cluster_radius_[c], point_cluster_dist_[id]);
+    ++inserted_since_build_;
+}
+
+IndexFootprint CascadePruning::index_footprint() const {
+    IndexFootprint footprint;
+    footprint.fixed_bytes = pivots_.size() * pivots_.stride() * sizeof(double) +
+                            pivot_pair_dists_.size() * sizeof(double) + cluster_offsets_.size() * sizeof(size_t) +
+                            cluster_radius_.size() * sizeof(double);
+    // 距离表的一行及其 scale / slack，最近 pivot 列表，所属簇，簇内成员表
+    footprint.per_point_bytes = table_.row_bytes() + 2 * sizeof(double) +
+                                static_cast<size_t>(near_) * (sizeof(int) + sizeof(double)) +
+                                2 * (sizeof(int) + sizeof(double));
+    return footprint;
+}
+
+int CascadePruning::decide_bound(CascadeStage stage, int p_idx, int q_idx, double r) const {
+    const size_t p = static_cast<size_t>(p_idx) * near_;
+    const size_t q = static_cast<size_t>(q_idx) * near_;
+    switch (stage) {
+        case CascadeStage::Cluster: {
+            const double dist_pivots = pivot_pair_dists_[static_cast<size_t>(point_cluster_[p_idx]) * k_ + point_cluster_[q_idx]];
+            const double dist_p = point_cluster_dist_[p_idx];
+            const double dist_q = point_cluster_dist_[q_idx];
+            if (dist_pivots - dist_p - dist_q > r) return 1;
+            if (dist_pivots + dist_p + dist_q <= r) return 0;
+            return -1;
+        }
+        case CascadeStage::NearPivots: {
+            // 离 p (或 q) 近的 pivot 给出最紧的上界，同时也常常给出足够的下界
+            const double* p_row = pivot_dists(p_idx);
+            const double* q_row = pivot_dists(q_idx);
+            double lower = 0.0;
+            double upper = std::numeric_limits<double>::infinity();
+            for (int i = 0; i < near_; ++i) {
+                const double dp = near_dists_[p + i];
+                const double dq = q_row[near_ids_[p + i]];
+                lower = std::max(lower, std::abs(dp - dq));
+                upper = std::min(upper, dp + dq);
+                const double dq2 = near_dists_[q + i];
+                const double dp2 = p_row[near_ids_[q + i]];
+                lower = std::max(lower, std::abs(dp2 - dq2));
+                upper = std::min(upper, dp2 + dq2);
+            }
+            if (lower > r) return 1;
+            if (upper <= r) return 0;
+            return -1;
+        }
+        case CascadeStage::AllPivots:
+            return table_.decide(static_cast<size_t>(p_idx), static_cast<size_t>(q_idx), r);
+        case CascadeStage::Exact:
+            break;
+    }
+    return -1;
+}
+
+bool CascadePruning::exact_exceeds(int p_idx, int q_idx, double r) {
+    const int decision = prefilter_decide(p_idx, q_idx, r);
+    if (decision >= 0) return decision == 1;
+    stats_.add_full_calculations(1);
+    record_full_calculation(dataset_->get_point(p_idx), dataset_->get_point(q_idx), r, true);
+    return full_calculation_exceeds(*dataset_, p_idx, q_idx, r, true);
+}
+
+int CascadePruning::sample_bounds(Slot& slot, int p_idx, int q_idx, double r) {
+    if (slot.radius.load(std::memory_order_relaxed) != r) {
+        clear_samples(slot);
+        slot.radius.store(r, std::memory_order_relaxed);
+    }
+    int decision = -1;
+    unsigned decided = 0;
+    for (size_t s = 0; s < kBoundStages && decision < 0; ++s) {
+        decision = decide_bound(static_cast<CascadeStage>(s), p_idx, q_idx, r);
+        // 界逐级收紧，后面的阶段也一定能判定，不必再执行
+        if (decision >= 0) decided = (1u << kBoundStages) - (1u << s);
+    }
+    slot.decided_sets[decided].fetch_add(1, std::memory_order_relaxed);
+    if (decision >= 0) count_bound_decisions(decision, 1 - decision);
+    const long long samples = slot.samples.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (samples >= kSampleWindow) age_samples(slot);
+    // 刚开始采样 (或半径刚改变) 时更早地重新选择
+    if (samples % kReplanInterval == 0 || (samples >= 8 && (samples & (samples - 1)) == 0)) replan();
+    return decision;
+}
+
+void CascadePruning::clear_samples(Slot& slot) {
+    for (size_t s = 0; s < kStages; ++s) {
+        slot.ticks[s].store(0, std::memory_order_relaxed);
+        slot.timed[s].store(0, std::memory_order_relaxed);
+    }
+    for (auto& count : slot.decided_sets) count.store(0, std::memory_order_relaxed);
+    slot.samples.store(0, std::memory_order_relaxed);
+}
+
+void CascadePruning::age_samples(Slot& slot) {
+    auto halve = [](std::atomic<long long>& value) {
+        value.store(value.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+    };
+    for (size_t s = 0; s < kStages; ++s) {
+        halve(slot.ticks[s]);
+        halve(slot.timed[s]);
+    }
+    for (auto& count : slot.decided_sets) halve(count);
+    halve(slot.samples);
+}
+
+void CascadePruning::replan() {
+    long long samples = 0;
+    std::array<double, kStages> ticks{};
+    std::array<double, kStages> timed{};
+    std::array<double, 1u << kBoundStages> sets{};
+    for (const Slot& slot : slots_) {
+        samples += slot.samples.load(std::memory_order_relaxed);
+        for (size_t s = 0; s < kStages; ++s) {
+            ticks[s] += static_cast<double>(slot.ticks[s].load(std::memory_order_relaxed));
+            timed[s] += static_cast<double>(slot.timed[s].load(std::memory_order_relaxed));
+        }
+        for (size_t m = 0; m < sets.size(); ++m) sets[m] += static_cast<double>(slot.decided_sets[m].load(std::memory_order_relaxed));
+    }
+    // 还没有计时数据时保持原来的顺序
+    const size_t exact = static_cast<size_t>(CascadeStage::Exact);
+    if (samples == 0 || timed[exact] == 0) return;
+
+    std::array<double, kStages> cost{};
+    for (size_t s = 0; s < kStages; ++s) cost[s] = ticks[s] / timed[s];
+    // 已执行的阶段集合为 executed 时，还需要继续检查的点对比例
+    auto reach = [&](unsigned executed) {
+        double count = 0.0;
+        for (unsigned m = 0; m < sets.size(); ++m) {
+            if ((m & executed) == 0) count += sets[m];
+        }
+        return count / static_cast<double>(samples);
+    };
+
+    // 枚举所有上下界阶段的有序子集 (含空集)，按期望代价选择
+    CascadeStage best[kBoundStages];
+    size_t best_count = 0;
+    double best_cost = std::numeric_limits<double>::infinity();
+    CascadeStage sequence[kBoundStages];
+    auto search = [&](auto&& self, size_t length, unsigned executed, double cost_so_far) -> void {
+        const double total = cost_so_far + reach(executed) * cost[exact];
+        if (total < best_cost) {
+            best_cost = total;
+            best_count = length;
+            std::copy(sequence, sequence + length, best);
+        }
+        if (length == kBoundStages) return;
+        for (size_t s = 0; s < kBoundStages; ++s) {
+            if ((executed & (1u << s)) != 0) continue;
+            sequence[length] = static_cast<CascadeStage>(s);
+            self(self, length + 1, executed | (1u << s), cost_so_far + reach(executed) * cost[s]);
+        }
+    };
+    search(search, 0, 0, 0.0);
+    plan_.store(encode_plan(best, best_count), std::memory_order_relaxed);
+}
+
+bool CascadePruning::query_distance_exceeds(int p_idx, int q_idx, double r) {
+    Slot& slot = slots_[thread_slot()];
+    if (sample_pair()) {
+        // 记下抽样的点对，攒够一组就用它们计时各阶段的代价
+        const long long index = slot.samples.load(std::memory_order_relaxed) % static_cast<long long>(kRecentPairs);
+        slot.recent[static_cast<size_t>(index)].store(
+            (static_cast<uint64_t>(static_cast<uint32_t>(p_idx)) << 32) | static_cast<uint32_t>(q_idx),
+            std::memory_order_relaxed);
+        if (index == static_cast<long long>(kRecentPairs) - 1) {
+            thread_local std::vector<QueryPair> recent;
+            recent.resize(kRecentPairs);
+            for (size_t i = 0; i < kRecentPairs; ++i) {
+                const uint64_t packed = slot.recent[i].load(std::memory_order_relaxed);
+                recent[i] = {static_cast<int>(packed >> 32), static_cast<int>(packed & 0xffffffffu)};
+            }
+            explore_costs(slot, recent.data(), recent.size(), r);
+        }
+        const int decision = sample_bounds(slot, p_idx, q_idx, r);
+        if (decision >= 0) return decision == 1;
+        return exact_exceeds(p_idx, q_idx, r);
+    }
+    const uint32_t plan = plan_.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < (plan & 3u); ++i) {
+        const auto stage = static_cast<CascadeStage>((plan >> (2 + 2 * i)) & 3u);
+        slot.attempts[static_cast<size_t>(stage)].fetch_add(1, std::memory_order_relaxed);
+        const int decision = decide_bound(stage, p_idx, q_idx, r);
+        if (decision >= 0) {
+            slot.decisions[static_cast<size_t>(stage)].fetch_add(1, std::memory_order_relaxed);
+            count_bound_decisions(decision, 1 - decision);
+            return decision == 1;
+        }
+    }
+    const size_t exact = static_cast<size_t>(CascadeStage::Exact);
+    slot.attempts[exact].fetch_add(1, std::memory_order_relaxed);
+    slot.decisions[exact].fetch_add(1, std::memory_order_relaxed);
+    return exact_exceeds(p_idx, q_idx, r);
+}
+
+void CascadePruning::prefetch_stage(CascadeStage stage, const QueryPair& pair) const {
+    const size_t p = static_cast<size_t>(pair.p_idx) * near_;
+    const size_t q = static_cast<size_t>(pair.q_idx) * near_;
+    switch (stage) {
+        case CascadeStage::Cluster:
+            // 每个点只有 12 字节，不预取 (同 KMeansTrianglePruning)
+            break;
+        case CascadeStage::NearPivots:
+            prefetch_bytes(near_ids_.data() + p, near_ * sizeof(int));
+            prefetch_bytes(near_ids_.data() + q, near_ * sizeof(int));
+            prefetch_bytes(near_dists_.data() + p, near_ * sizeof(double));
+            prefetch_bytes(near_dists_.data() + q, near_ * sizeof(double));
+            break;
+        case CascadeStage::AllPivots:
+            prefetch_bytes(table_.row_data(pair.p_idx), table_.row_bytes());
+            prefetch_bytes(table_.row_data(pair.q_idx), table_.row_bytes());
+            break;
+        case CascadeStage::Exact:
+            if (compact_ != nullptr) {
+                prefetch_bytes(compact_->row_data(pair.p_idx), compact_->row_bytes());
+                prefetch_bytes(compact_->row_data(pair.q_idx), compact_->row_bytes());
+            } else {
+                prefetch_point(dataset_->get_point(pair.p_idx));
+                prefetch_point(dataset_->get_point(pair.q_idx));
+            }
+            break;
+    }
+}
+
+void CascadePruning::query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) {
+    Slot& slot = slots_[thread_slot()];
+    const uint32_t plan = plan_.load(std::memory_order_relaxed);
+    const uint32_t stages = plan & 3u;
+    std::vector<uint32_t>& pending = batch_scratch();
+    pending.clear();
+    thread_local std::vector<uint32_t> sampled_pending;
+    sampled_pending.clear();
+    long long exceeding = 0;
+    long long decided = 0;
+    auto record_pass = [&](CascadeStage stage, size_t input, size_t kept) {
+        const size_t s = static_cast<size_t>(stage);
+        decided += static_cast<long long>(input - kept);
+        slot.attempts[s].fetch_add(static_cast<long long>(input), std::memory_order_relaxed);
+        slot.decisions[s].fetch_add(static_cast<long long>(input - kept), std::memory_order_relaxed);
+    };
+    if (explore_batch()) explore_costs(slot, pairs, std::min(count, kExploreSpan), r);
+
+    // 第一遍顺序处理整批：执行第一个阶段 (没有上下界阶段时只收集点对)；
+    // 抽样的点对单独执行上下界阶段 (不计时)，判定不了的留给完整计算
+    const auto first_stage = static_cast<CascadeStage>((plan >> 2) & 3u);
+    size_t next_sample = take_batch_samples(count);
+    size_t sampled = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (i == next_sample) {
+            next_sample += kSampleMask + 1;
+            ++sampled;
+            const int decision = sample_bounds(slot, pairs[i].p_idx, pairs[i].q_idx, r);
+            if (decision >= 0) {
+                results[i] = static_cast<uint8_t>(decision);
+            } else {
+                sampled_pending.push_back(static_cast<uint32_t>(i));
+            }
+            continue;
+        }
+        if (stages == 0) {
+            pending.push_back(static_cast<uint32_t>(i));
+            continue;
+        }
+        if (i + kPrefetchDistance < count) prefetch_stage(first_stage, pairs[i + kPrefetchDistance]);
+        const int decision = decide_bound(first_stage, pairs[i].p_idx, pairs[i].q_idx, r);
+        if (decision >= 0) {
+            results[i] = static_cast<uint8_t>(decision);
+            exceeding += decision;
+        } else {
+            pending.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    if (stages > 0) record_pass(first_stage, count - sampled, pending.size());
+
+    // 之后的阶段整遍处理剩余点对，判定不了的原地压缩到前面
+    for (uint32_t j = 1; j < stages; ++j) {
+        const auto stage = static_cast<CascadeStage>((plan >> (2 + 2 * j)) & 3u);
+        const size_t input = pending.size();
+        size_t kept = 0;
+        for (size_t i = 0; i < input; ++i) {
+            if (i + kPrefetchDistance < input) prefetch_stage(stage, pairs[pending[i + kPrefetchDistance]]);
+            const QueryPair& pair = pairs[pending[i]];
+            const int decision = decide_bound(stage, pair.p_idx, pair.q_idx, r);
+            if (decision >= 0) {
+                results[pending[i]] = static_cast<uint8_t>(decision);
+                exceeding += decision;
+            } else {
+                pending[kept++] = pending[i];
+            }
+        }
+        pending.resize(kept);
+        record_pass(stage, input, kept);
+    }
+    count_bound_decisions(exceeding, decided - exceeding);
+
+    // 最后集中对剩余点对做完整计算
+    const size_t exact = static_cast<size_t>(CascadeStage::Exact);
+    const size_t exact_attempts = pending.size();
+    slot.attempts[exact].fetch_add(static_cast<long long>(exact_attempts), std::memory_order_relaxed);
+    slot.decisions[exact].fetch_add(static_cast<long long>(exact_attempts), std::memory_order_relaxed);
+    pending.insert(pending.end(), sampled_pending.begin(), sampled_pending.end());
+    compute_undecided_batch(*dataset_, pairs, pending, r, results);
+}
+
+void CascadePruning::explore_costs(Slot& slot, const QueryPair* pairs, size_t count, double r) {
+    // 结果写入线程局部变量，避免整遍计算被优化掉
+    thread_local size_t sink = 0;
+    for (size_t s = 0; s < kStages; ++s) {
+        const auto stage = static_cast<CascadeStage>(s);
+        const uint64_t start = CycleClock::now();
+        for (size_t i = 0; i < count; ++i) {
+            if (i + kPrefetchDistance < count) prefetch_stage(stage, pairs[i + kPrefetchDistance]);
+            const int p_idx = pairs[i].p_idx;
+            const int q_idx = pairs[i].q_idx;
+            sink += stage == CascadeStage::Exact ? full_calculation_exceeds(*dataset_, p_idx, q_idx, r, false)
+                                                 : static_cast<size_t>(decide_bound(stage, p_idx, q_idx, r) + 1);
+        }
+        slot.ticks[s].fetch_add(static_cast<long long>(CycleClock::now() - start), std::memory_order_relaxed);
+        slot.timed[s].fetch_add(static_cast<long long>(count), std::memory_order_relaxed);
+    }
+}
+
+size_t CascadePruning::query_radius_bucket(int p_idx, int q_idx, const std::vector<double>& radii) {
+    // 全部 pivot 的界蕴含前两个阶段的界
+    double lower = 0.0;
+    double upper = 0.0;
+    table_.bounds(static_cast<size_t>(p_idx), static_cast<size_t>(q_idx), lower, upper);
+    return radius_bucket_from_bounds(*dataset_, p_idx, q_idx, lower, upper, radii);
+}
+
+void CascadePruning::range_query(int p_idx, double r, std::vector<int>& results) {
+    range_query_impl(dataset_->get_point(p_idx), p_idx, r, results);
+}
+
+void CascadePruning::range_query(PointView query, double r, std::vector<int>& results) {
+    range_query_impl(query, -1, r, results);
+}
+
+void CascadePruning::range_query_impl(PointView query, int exclude_idx, double r, std::vector<int>& results) {
+    results.clear();
+    // 数据集中的点直接使用距离表中的一行，其它查询点现算到全部 pivot 的距离
+    const double* query_dists = nullptr;
+    if (exclude_idx >= 0) {
+        query_dists = pivot_dists(exclude_idx);
+    } else {
+        std::vector<double>& dists = pivot_distance_scratch();
+        dists.resize(static_cast<size_t>(k_));
+        for (int j = 0; j < k_; ++j) dists[j] = euclidean_distance(query, pivots_.get_point(j));
+        query_dists = dists.data();
+    }
+    const QuantizedPrefilter::Code* code = exclude_idx >= 0 ? nullptr : prefilter_code(query);
+    const CompactPoints::Query* compact_query = exclude_idx >= 0 ? nullptr : compact_code(query);
+    const double* dists = cluster_member_dists_.data();
+    long long full_calcs = 0;
+    for (int c = 0; c < k_; ++c) {
+        const double dist_to_pivot = query_dists[c];
+        if (dist_to_pivot - cluster_radius_[c] > r) continue;
+
+        auto visit = [&](int x, double dist_x) {
+            if (x == exclude_idx || dataset_->is_erased(x)) return;
+            if (dist_x + dist_to_pivot <= r) {
+                results.push_back(x);
+                return;
+            }
+            int decision = table_.decide_query(query_dists, static_cast<size_t>(x), r);
+            if (decision < 0) decision = prefilter_decide_range(exclude_idx, code, x, r);
+            if (decision < 0) {
+                ++full_calcs;
+                decision = range_calculation_exceeds(*dataset_, query, exclude_idx, compact_query, x, r) ? 1 : 0;
+            }
+            if (decision == 0) results.push_back(x);
+        };
+
+        const size_t end = cluster_offsets_[c + 1];
+        size_t i = static_cast<size_t>(std::lower_bound(dists + cluster_offsets_[c], dists + end, dist_to_pivot - r) - dists);
+        for (; i < end && dists[i] <= dist_to_pivot + r; ++i) visit(cluster_members_[i], dists[i]);
+        for (int x : pending_members_[c]) {
+            const double dist_x = point_cluster_dist_[x];
+            if (std::abs(dist_x - dist_to_pivot) <= r) visit(x, dist_x);
+        }
+    }
+    stats_.add_full_calculations(full_calcs);
+}
+
+void CascadePruning::reset_stats() {
+    PruningAlgorithm::reset_stats();
+    for (Slot& slot : slots_) {
+        for (size_t s = 0; s < kStages; ++s) {
+            slot.attempts[s].store(0, std::memory_order_relaxed);
+            slot.decisions[s].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+std::vector<CascadeStageStats> CascadePruning::stage_stats() const {
+    std::vector<CascadeStageStats> stats(kStages);
+    long long samples = 0;
+    std::array<long long, kStages> ticks{};
+    std::array<long long, kStages> timed{};
+    for (const Slot& slot : slots_) {
+        samples += slot.samples.load(std::memory_order_relaxed);
+        for (size_t s = 0; s < kStages; ++s) {
+            stats[s].attempts += slot.attempts[s].load(std::memory_order_relaxed);
+            stats[s].decisions += slot.decisions[s].load(std::memory_order_relaxed);
+            ticks[s] += slot.ticks[s].load(std::memory_order_relaxed);
+            timed[s] += slot.timed[s].load(std::memory_order_relaxed);
+        }
+        for (unsigned m = 0; m < slot.decided_sets.size(); ++m) {
+            const long long count = slot.decided_sets[m].load(std::memory_order_relaxed);
+            for (size_t s = 0; s < kBoundStages; ++s) {
+                if ((m & (1u << s)) != 0) stats[s].sampled_hit_rate += static_cast<double>(count);
+            }
+        }
+    }
+    const double ns_per_tick = CycleClock::ns_per_tick();
+    for (size_t s = 0; s < kStages; ++s) {
+        stats[s].stage = static_cast<CascadeStage>(s);
+        if (s < kBoundStages) {
+            stats[s].sampled_hit_rate = samples > 0 ? stats[s].sampled_hit_rate / static_cast<double>(samples) : 0.0;
+        } else {
+            stats[s].sampled_hit_rate = 1.0;
+        }
+        if (timed[s] > 0) stats[s].mean_ns = static_cast<double>(ticks[s]) / static_cast<double>(timed[s]) * ns_per_tick;
+    }
+    return stats;
+}
+
+std::vector<CascadeStage> CascadePruning::stage_order() const {
+    const uint32_t plan = plan_.load(std::memory_order_relaxed);
+    std::vector<CascadeStage> order;
+    for (uint32_t i = 0; i < (plan & 3u); ++i) order.push_back(static_cast<CascadeStage>((plan >> (2 + 2 * i)) & 3u));
+    order.push_back(CascadeStage::Exact);
+    return order;
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include "pivot_distance_table.h"
+#include "pruning_algorithm.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 级联剪枝的各个阶段。前三个是上下界检查 (任一阶段判定即结束)，最后总是完整计算
+enum class CascadeStage : uint8_t {
+    Cluster = 0,    // O(1) 单中心界：d(c_p, c_q) -/+ d(p, c_p) -/+ d(q, c_q) (同 KMeansTrianglePruning)
+    NearPivots = 1, // 只扫描离 p、离 q 最近的若干个 pivot 的 |d(p,v) - d(q,v)| 与 d(p,v) + d(q,v)
+    AllPivots = 2,  // 扫描全部 k 个 pivot (同 MultiPivotTrianglePruning)
+    Exact = 3,      // 量化预过滤 (若设置) 与提前退出的完整计算
+};
+const char* cascade_stage_name(CascadeStage stage);
+
+// 一个阶段的统计
+struct CascadeStageStats {
+    CascadeStage stage;
+    long long attempts = 0;        // 执行次数 (不含采样)
+    long long decisions = 0;       // 其中判定成功的次数
+    // 以下两项是选择顺序的依据，只反映最近的查询 (见 CascadePruning)，reset_stats 不清除
+    double sampled_hit_rate = 0.0; // 采样点对中单独执行时能判定的比例 (Exact 恒为 1)
+    double mean_ns = 0.0;          // 整遍执行时每个点对的平均耗时
+};
+
+// 级联剪枝：以 k-means 中心作为 pivot，同时持有单中心的 O(1) 界和全部 pivot 的距离表，
+// 按代价从低到高依次检查，任一阶段判定就结束，都判定不了才做完整计算。
+//
+// 三个上下界阶段的界逐级收紧 (AllPivots 的界蕴含前两者)，因此顺序只影响代价，不影响结果。
+//  - 命中率：每 1024 个点对抽样一个，依次执行上下界阶段直到判定，记录哪些阶段能判定
+//  - 代价：定期取一段点对 (批量查询取批的开头，逐个查询取最近抽样的点对)，每个阶段 (含完整计算)
+//    带预取地对它们各整遍执行一次并计时，得到流水线满载时每个点对的代价。
+//    不逐次计时单个阶段：几十个周期的计时受乱序执行影响，且不在当前顺序中的阶段数据不在缓存中，
+//    单次延迟会偏向维持当前顺序
+// 定期据此估计每种阶段顺序 (包括跳过某些阶段) 的期望代价，换用最便宜的顺序。
+// 采样和计时每累计一定数量就整体减半，使顺序跟随查询特征的变化；半径改变时从头采样。
+// 查询可以多线程并发；统计按线程分槽，顺序的切换是原子的
+class CascadePruning final : public PruningAlgorithm {
+public:
+    // near_pivots：NearPivots 阶段对 p、q 各取最近的多少个 pivot
+    CascadePruning(int k, int max_iterations, uint64_t seed = 42, int near_pivots = 4);
+
+    void build(const Dataset& dataset) override;
+    bool save(const std::string& path) const override;
+    bool load(const std::string& path, const Dataset& dataset) override;
+    void insert_point(int id) override;
+    [[nodiscard]] IndexFootprint index_footprint() const override;
+    bool query_distance_exceeds(int p_idx, int q_idx, double r) override;
+    void query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) override;
+    size_t query_radius_bucket(int p_idx, int q_idx, const std::vector<double>& radii) override;
+    // 范围查询：按最近 pivot 分簇，整簇跳过 d(q, c) - 簇半径 > r 的簇，簇内二分定位 |d(x, c) - d(q, c)| <= r 的窗口，
+    // 窗口内的候选再用全部 pivot 的上下界过滤
+    void range_query(int p_idx, double r, std::vector<int>& results) override;
+    void range_query(PointView query, double r, std::vector<int>& results) override;
+    void reset_stats() override;
+
+    // 四个阶段的统计 (按 CascadeStage 顺序)
+    [[nodiscard]] std::vector<CascadeStageStats> stage_stats() const;
+    // 当前使用的阶段顺序，Exact 总是最后一个
+    [[nodiscard]] std::vector<CascadeStage> stage_order() const;
+
+private:
+    static constexpr size_t kBoundStages = 3;
+    static constexpr size_t kStages = 4;
+    static constexpr uint32_t kSampleMask = 1023;     // 每 1024 个点对抽样一个
+    static constexpr long long kReplanInterval = 64;  // 每个槽位每采样这么多次重新选择顺序
+    static constexpr long long kSampleWindow = 512;   // 槽位的采样数达到这么多时所有采样与计时减半
+    static constexpr uint32_t kExploreMask = 255;     // 批量查询每 256 批计时一次各阶段的代价
+    static constexpr size_t kExploreSpan = 256;       // 批量查询计时用的点对数 (批的开头)
+    static constexpr size_t kRecentPairs = 16;        // 逐个查询保留最近抽样的点对数，每采样这么多次计时一次
+
+    // 阶段顺序压缩在一个 32 位整数中：低 2 位为上下界阶段的个数，之后每 2 位一个阶段
+    static uint32_t encode_plan(const CascadeStage* stages, size_t count);
+    // Cluster -> NearPivots -> AllPivots (还没有采样时使用)
+    static constexpr uint32_t kFullPlan = 3u | (0u << 2) | (1u << 4) | (2u << 6);
+    // 每个线程各自计数，决定哪些点对被抽样、哪些批计时
+    static bool sample_pair();
+    // 一批 count 个点对计入计数，返回其中第一个被抽样的下标 (之后每隔 kSampleMask + 1 个一个)
+    static size_t take_batch_samples(size_t count);
+    static bool explore_batch();
+
+    struct alignas(64) Slot {
+        std::array<std::atomic<long long>, kStages> attempts{};
+        std::array<std::atomic<long long>, kStages> decisions{};
+        // 以下为选择顺序的依据：计时的总耗时和计时覆盖的点对数
+        std::array<std::atomic<long long>, kStages> ticks{};
+        std::array<std::atomic<long long>, kStages> timed{};
+        // 采样中能判定的上下界阶段的集合 (位 i 对应 CascadeStage i) 的出现次数
+        std::array<std::atomic<long long>, 1u << kBoundStages> decided_sets{};
+        std::atomic<long long> samples{0};
+        std::atomic<double> radius{-1.0}; // 采样时的半径
+        // 逐个查询最近抽样的点对 (p 在高 32 位)
+        std::array<std::atomic<uint64_t>, kRecentPairs> recent{};
+    };
+    static size_t thread_slot();
+
+    // 由距离表派生最近 pivot 列表、簇内有序成员表 (build / load 后调用)
+    void build_derived();
+    // 第 row 个点：按距离取最近的 near_ 个 pivot
+    void fill_near_pivots(size_t row);
+    [[nodiscard]] const double* pivot_dists(int idx) const {
+        return reinterpret_cast<const double*>(table_.row_data(static_cast<size_t>(idx))); // Float64 编码
+    }
+    // 执行一个上下界阶段：1 表示 d(p,q) > r，0 表示 d(p,q) <= r，-1 表示无法判定
+    [[nodiscard]] int decide_bound(CascadeStage stage, int p_idx, int q_idx, double r) const;
+    bool exact_exceeds(int p_idx, int q_idx, double r);
+    // 预取点对在某个阶段要读的数据 (最近 pivot 列表、距离表的行或坐标)
+    void prefetch_stage(CascadeStage stage, const QueryPair& pair) const;
+    // 采样：依次执行上下界阶段直到判定，记录能判定的阶段集合。返回判定结果，全部无法判定时返回 -1
+    int sample_bounds(Slot& slot, int p_idx, int q_idx, double r);
+    // 各阶段分别对 pairs 的前 count 个点对整遍执行并计时 (不计入统计)
+    void explore_costs(Slot& slot, const QueryPair* pairs, size_t count, double r);
+    // 槽位中选择顺序的依据全部清零 / 减半
+    static void clear_samples(Slot& slot);
+    static void age_samples(Slot& slot);
+    // 合并所有槽位的采样，选出期望代价最低的顺序
+    void replan();
+    void range_query_impl(PointView query, int exclude_idx, double r, std::vector<int>& results);
+
+    int k_;
+    int max_iterations_;
+    uint64_t seed_;
+    int near_;
+    const Dataset* dataset_ = nullptr;
+
+    Dataset pivots_;                       // k 个 k-means 中心
+    PivotDistanceTable table_;             // 每个点到 k 个 pivot 的距离 (Float64 编码)
+    std::vector<double> pivot_pair_dists_; // k*k
+    // 每个点最近的 near_ 个 pivot 及其距离 (升序)
+    std::vector<int> near_ids_;
+    std::vector<double> near_dists_;
+    // 每个点所属的簇 (最近的 pivot) 及到中心的距离，即上面的第 0 个；单独连续存放供 Cluster 阶段使用
+    std::vector<int> point_cluster_;
+    std::vector<double> point_cluster_dist_;
+
+    // 范围查询用的簇内成员表 (CSR)，结构同 KMeansTrianglePruning
+    std::vector<size_t> cluster_offsets_;
+    std::vector<int> cluster_members_;
+    std::vector<double> cluster_member_dists_;
+    std::vector<double> cluster_radius_;
+    std::vector<std::vector<int>> pending_members_;
+
+    std::atomic<uint32_t> plan_{kFullPlan};
+    std::array<Slot, QueryStats::kMaxSlots> slots_;
+};
@@ -0,0 +1,84 @@
+#include "edge_writer.h"
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+
+namespace {
+// 每个分片的写缓冲区大小，写满后一次 fwrite
+constexpr size_t kShardBufferBytes = 1 << 20;
+// 一条边格式化后的最大长度："-2147483648 -2147483648\n"
+constexpr size_t kMaxIntChars = 11;
+constexpr size_t kMaxEdgeChars = 2 * kMaxIntChars + 2;
+}
+
+ShardedEdgeWriter::~ShardedEdgeWriter() {
+    close();
+}
+
+bool ShardedEdgeWriter::open(const std::string& prefix, int num_shards) {
+    close();
+    prefix_ = prefix;
+    shards_ = std::vector<Shard>(static_cast<size_t>(std::max(1, num_shards)));
+    for (size_t t = 0; t < shards_.size(); ++t) {
+        const std::string path = prefix + "." + std::to_string(t);
+        shards_[t].file = std::fopen(path.c_str(), "wb");
+        if (shards_[t].file == nullptr) {
+            std::cerr << "Error: Could not open edge shard for writing: " << path << std::endl;
+            close();
+            return false;
+        }
+        shards_[t].buffer.reserve(kShardBufferBytes);
+    }
+    return true;
+}
+
+void ShardedEdgeWriter::write(int thread_id, const Edge* edges, size_t count) {
+    Shard& shard = shards_[static_cast<size_t>(thread_id)];
+    for (size_t i = 0; i < count; ++i) {
+        if (shard.buffer.size() + kMaxEdgeChars > kShardBufferBytes) flush(shard);
+        char line[kMaxEdgeChars];
+        char* end = std::to_chars(line, line + kMaxIntChars, edges[i].u).ptr;
+        *end++ = ' ';
+        end = std::to_chars(end, end + kMaxIntChars, edges[i].v).ptr;
+        *end++ = '\n';
+        shard.buffer.insert(shard.buffer.end(), line, end);
+    }
+}
+
+void ShardedEdgeWriter::flush(Shard& shard) {
+    if (shard.buffer.empty()) return;
+    if (std::fwrite(shard.buffer.data(), 1, shard.buffer.size(), shard.file) != shard.buffer.size()) {
+        shard.ok = false;
+    }
+    shard.bytes += shard.buffer.size();
+    shard.buffer.clear();
+}
+
+bool ShardedEdgeWriter::close() {
+    bool ok = true;
+    for (size_t t = 0; t < shards_.size(); ++t) {
+        Shard& shard = shards_[t];
+        if (shard.file == nullptr) continue;
+        flush(shard);
+        if (std::fclose(shard.file) != 0) shard.ok = false;
+        shard.file = nullptr;
+        if (!shard.ok) {
+            std::cerr << "Error: Failed writing edge shard: " << prefix_ << "." << t << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+size_t ShardedEdgeWriter::bytes_written() const {
+    size_t total = 0;
+    for (const Shard& shard : shards_) total += shard.bytes + shard.buffer.size();
+    return total;
+}
+
+std::vector<Edge> EdgeCollector::sorted_edges() const {
+    std::vector<Edge> all;
+    for (const auto& edges : per_thread_) all.insert(all.end(), edges.begin(), edges.end());
+    std::sort(all.begin(), all.end(), [](const Edge& a, const Edge& b) { return a.u != b.u ? a.u < b.u : a.v < b.v; });
+    return all;
+}
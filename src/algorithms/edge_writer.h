@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// 自连接输出的一条边 (u < v，均为原数据集中的点下标)
+struct Edge {
+    int u;
+    int v;
+};
+
+// 自连接结果的接收端。write 由工作线程调用：同一个 thread_id 不会被并发调用，
+// 不同 thread_id 之间可能并发，因此实现应按 thread_id 分片而不是加锁
+class EdgeSink {
+public:
+    virtual ~EdgeSink() = default;
+    virtual void write(int thread_id, const Edge* edges, size_t count) = 0;
+};
+
+// 分片的边表写出器：每个线程写自己的文件 <prefix>.<thread_id>，每行 "u v"，线程之间没有锁。
+// 所有分片拼接起来就是完整的边表 (顺序不保证)
+class ShardedEdgeWriter final : public EdgeSink {
+public:
+    ~ShardedEdgeWriter() override;
+
+    // 创建 num_shards 个分片文件；失败时输出错误信息并返回 false
+    bool open(const std::string& prefix, int num_shards);
+    void write(int thread_id, const Edge* edges, size_t count) override;
+    // 刷新并关闭所有分片；任何一次写入失败都会让 close 返回 false
+    bool close();
+
+    [[nodiscard]] size_t bytes_written() const;
+
+private:
+    struct alignas(64) Shard {
+        std::FILE* file = nullptr;
+        std::vector<char> buffer;
+        size_t bytes = 0;
+        bool ok = true;
+    };
+    void flush(Shard& shard);
+
+    std::string prefix_;
+    std::vector<Shard> shards_;
+};
+
+// 在内存中收集全部边 (每线程一个列表)，适合小规模数据或结果校验
+class EdgeCollector final : public EdgeSink {
+public:
+    explicit EdgeCollector(int num_threads) : per_thread_(static_cast<size_t>(num_threads)) {}
+    void write(int thread_id, const Edge* edges, size_t count) override {
+        per_thread_[thread_id].insert(per_thread_[thread_id].end(), edges, edges + count);
+    }
+    // 合并所有线程的结果并按 (u, v) 排序
+    [[nodiscard]] std::vector<Edge> sorted_edges() const;
+
+private:
+    std::vector<std::vector<Edge>> per_thread_;
+};
@@ -0,0 +1,214 @@
+#include "index_maintainer.h"
+#include <iostream>
+#include <stdexcept>
+
+IndexMaintainer::IndexMaintainer(Factory factory, Dataset initial, IndexMaintainerOptions options)
+    : factory_(std::move(factory)), options_(options) {
+    auto state = std::make_unique<State>();
+    state->dataset = std::move(initial);
+    const int n = static_cast<int>(state->dataset.size());
+    state->internal_of.resize(static_cast<size_t>(n));
+    state->external_of.resize(static_cast<size_t>(n));
+    for (int i = 0; i < n; ++i) {
+        state->internal_of[i] = state->dataset.is_erased(i) ? -1 : i;
+        state->external_of[i] = i;
+    }
+    build_state(*state);
+    state_ = std::move(state);
+    next_id_ = n;
+}
+
+IndexMaintainer::~IndexMaintainer() {
+    wait_for_rebuild();
+}
+
+void IndexMaintainer::build_state(State& state) {
+    state.algorithm = factory_();
+    state.algorithm->build(state.dataset);
+    if (options_.prefilter) {
+        state.prefilter.build(state.dataset);
+        state.algorithm->set_prefilter(&state.prefilter);
+    }
+}
+
+int IndexMaintainer::internal_id(int id) const {
+    const int internal =
+        id >= 0 && static_cast<size_t>(id) < state_->internal_of.size() ? state_->internal_of[id] : -1;
+    if (internal < 0) throw std::invalid_argument("IndexMaintainer: unknown or erased point id.");
+    return internal;
+}
+
+bool IndexMaintainer::should_rebuild() const {
+    return !rebuilding_ && state_->algorithm->drift() > options_.drift_threshold;
+}
+
+int IndexMaintainer::insert(PointView point) {
+    int id;
+    bool trigger;
+    {
+        std::unique_lock lock(mutex_);
+        State& state = *state_;
+        id = next_id_++;
+        const int internal = state.dataset.add_point(point);
+        state.internal_of.push_back(internal);
+        state.external_of.push_back(id);
+        if (options_.prefilter) state.prefilter.append(point);
+        state.algorithm->insert_point(internal);
+        if (rebuilding_) log_.push_back({true, id, internal});
+        trigger = should_rebuild();
+    }
+    if (trigger) rebuild();
+    return id;
+}
+
+bool IndexMaintainer::erase(int id) {
+    bool trigger;
+    {
+        std::unique_lock lock(mutex_);
+        State& state = *state_;
+        if (id < 0 || static_cast<size_t>(id) >= state.internal_of.size() || state.internal_of[id] < 0) return false;
+        const int internal = state.internal_of[id];
+        state.dataset.erase(internal);
+        state.algorithm->erase_point(internal);
+        state.internal_of[id] = -1;
+        if (rebuilding_) log_.push_back({false, id, internal});
+        trigger = should_rebuild();
+    }
+    if (trigger) rebuild();
+    return true;
+}
+
+bool IndexMaintainer::contains(int id) const {
+    std::shared_lock lock(mutex_);
+    return id >= 0 && static_cast<size_t>(id) < state_->internal_of.size() && state_->internal_of[id] >= 0;
+}
+
+bool IndexMaintainer::query_distance_exceeds(int p_id, int q_id, double r) {
+    std::shared_lock lock(mutex_);
+    return state_->algorithm->query_distance_exceeds(internal_id(p_id), internal_id(q_id), r);
+}
+
+void IndexMaintainer::query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) {
+    thread_local std::vector<QueryPair> mapped;
+    std::shared_lock lock(mutex_);
+    mapped.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        mapped[i] = {internal_id(pairs[i].p_idx), internal_id(pairs[i].q_idx)};
+    }
+    state_->algorithm->query_distance_exceeds_batch(mapped.data(), count, r, results);
+}
+
+void IndexMaintainer::range_query(int p_id, double r, std::vector<int>& results) {
+    std::shared_lock lock(mutex_);
+    state_->algorithm->range_query(internal_id(p_id), r, results);
+    for (int& x : results) x = state_->external_of[x];
+}
+
+void IndexMaintainer::range_query(PointView query, double r, std::vector<int>& results) {
+    std::shared_lock lock(mutex_);
+    state_->algorithm->range_query(query, r, results);
+    for (int& x : results) x = state_->external_of[x];
+}
+
+std::unique_ptr<IndexMaintainer::State> IndexMaintainer::take_snapshot() {
+    auto next = std::make_unique<State>();
+    rebuilding_ = true;
+    log_.clear();
+    next->dataset = state_->dataset;
+    next->external_of = state_->external_of;
+    return next;
+}
+
+void IndexMaintainer::rebuild() {
+    std::lock_guard worker_lock(worker_mutex_);
+    std::unique_ptr<State> next;
+    {
+        std::unique_lock lock(mutex_);
+        if (rebuilding_) return;
+        next = take_snapshot();
+    }
+    if (worker_.joinable()) worker_.join();
+    // 重建接连进行，直到替换后的索引不再需要重建
+    auto run = [this](std::unique_ptr<State> state) {
+        while (state != nullptr) state = run_rebuild(std::move(state));
+    };
+    if (options_.background) {
+        worker_ = std::thread(run, std::move(next));
+    } else {
+        run(std::move(next));
+    }
+}
+
+std::unique_ptr<IndexMaintainer::State> IndexMaintainer::run_rebuild(std::unique_ptr<State> next) {
+    // 快照在锁外压缩并构建，期间查询和增删照常作用于当前索引
+    const std::vector<int> kept = next->dataset.compact();
+    for (size_t i = 0; i < kept.size(); ++i) next->external_of[i] = next->external_of[kept[i]];
+    next->external_of.resize(kept.size());
+    build_state(*next);
+
+    std::unique_ptr<State> old;
+    std::unique_ptr<State> follow_up;
+    size_t points = 0;
+    size_t dropped = 0;
+    {
+        std::unique_lock lock(mutex_);
+        const bool replayed = !log_.empty();
+        next->internal_of.assign(static_cast<size_t>(next_id_), -1);
+        for (size_t i = 0; i < next->external_of.size(); ++i) {
+            next->internal_of[next->external_of[i]] = static_cast<int>(i);
+        }
+        for (const LogEntry& entry : log_) {
+            if (entry.insert) {
+                const PointView point = state_->dataset.get_point(entry.old_internal);
+                const int internal = next->dataset.add_point(point);
+                next->internal_of[entry.id] = internal;
+                next->external_of.push_back(entry.id);
+                if (options_.prefilter) next->prefilter.append(point);
+                next->algorithm->insert_point(internal);
+            } else if (next->internal_of[entry.id] >= 0) {
+                const int internal = next->internal_of[entry.id];
+                next->dataset.erase(internal);
+                next->algorithm->erase_point(internal);
+                next->internal_of[entry.id] = -1;
+            }
+        }
+        log_.clear();
+        old = std::move(state_);
+        state_ = std::move(next);
+        rebuilding_ = false;
+        ++rebuilds_;
+        points = state_->dataset.live_size();
+        dropped = old->dataset.erased_count();
+        // 重放的增删可能已使新索引超过阈值，之后没有新的增删就不会再触发检查，因此在这里接着重建。
+        // 没有重放任何增删时新索引是刚构建的，不再检查，保证更新停止后重建一定结束
+        if (replayed && should_rebuild()) follow_up = take_snapshot();
+    }
+    // 旧索引在锁外释放
+    std::cout << "Index rebuilt (" << points << " points, " << dropped << " tombstones dropped)." << std::endl;
+    return follow_up;
+}
+
+void IndexMaintainer::wait_for_rebuild() {
+    std::lock_guard worker_lock(worker_mutex_);
+    if (worker_.joinable()) worker_.join();
+}
+
+double IndexMaintainer::drift() const {
+    std::shared_lock lock(mutex_);
+    return state_->algorithm->drift();
+}
+
+size_t IndexMaintainer::size() const {
+    std::shared_lock lock(mutex_);
+    return state_->dataset.live_size();
+}
+
+size_t IndexMaintainer::rebuild_count() const {
+    std::shared_lock lock(mutex_);
+    return rebuilds_;
+}
+
+long long IndexMaintainer::get_full_calculations_count() const {
+    std::shared_lock lock(mutex_);
+    return state_->algorithm->get_full_calculations_count();
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "pruning_algorithm.h"
+#include "quantized_prefilter.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+struct IndexMaintainerOptions {
+    double drift_threshold = 0.25; // 算法的 drift() 超过该值时触发重建
+    bool background = true;        // false 时在触发更新的线程上同步重建
+    bool prefilter = false;        // 为当前索引维护一份量化预过滤 (见 quantized_prefilter.h)
+};
+
+// 持续增删的数据集上的索引维护：插入/删除直接作用于当前索引 (不重建)，
+// 当算法报告的漂移超过阈值时，在后台线程上基于压缩后的数据快照重建一份新索引，
+// 重放快照之后发生的增删，再在写锁下原子地替换当前索引。
+//
+// 对外使用稳定的点编号：初始数据集的第 i 个点编号为 i，之后插入的点依次编号，编号永不复用；
+// 删除的点先做墓碑标记，重建时才从数据中移除，届时内部下标会变化但编号不变。
+// 查询与增删可以在多个线程上并发调用：查询持有读锁，增删和替换持有写锁。
+// 查询中使用已删除或不存在的编号会抛出 std::invalid_argument
+class IndexMaintainer {
+public:
+    using Factory = std::function<std::unique_ptr<PruningAlgorithm>()>;
+
+    // 用 factory 创建的算法在 initial 上同步构建第一份索引；之后每次重建都调用 factory 得到新实例
+    IndexMaintainer(Factory factory, Dataset initial, IndexMaintainerOptions options = {});
+    ~IndexMaintainer();
+    IndexMaintainer(const IndexMaintainer&) = delete;
+    IndexMaintainer& operator=(const IndexMaintainer&) = delete;
+
+    // 插入一个点 (维度必须与数据集一致)，返回其编号
+    int insert(PointView point);
+    // 删除编号为 id 的点；编号不存在或已删除时返回 false
+    bool erase(int id);
+    [[nodiscard]] bool contains(int id) const;
+
+    bool query_distance_exceeds(int p_id, int q_id, double r);
+    void query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results);
+    // 结果为点的编号
+    void range_query(int p_id, double r, std::vector<int>& results);
+    void range_query(PointView query, double r, std::vector<int>& results);
+
+    // 立即开始一次重建 (已有重建在进行时什么也不做)
+    void rebuild();
+    // 等待正在进行的后台重建完成并替换 (包括重放日志后仍超过阈值而接着进行的重建)。
+    // 期间没有新的增删时，返回后 drift() 不超过阈值
+    void wait_for_rebuild();
+
+    [[nodiscard]] double drift() const;
+    [[nodiscard]] size_t size() const;         // 未删除的点数
+    [[nodiscard]] size_t rebuild_count() const; // 已完成替换的重建次数
+    [[nodiscard]] long long get_full_calculations_count() const;
+
+private:
+    // 一份完整的索引：数据、算法以及编号映射，重建时整体替换
+    struct State {
+        Dataset dataset;
+        std::unique_ptr<PruningAlgorithm> algorithm;
+        QuantizedPrefilter prefilter;
+        std::vector<int> internal_of; // 编号 -> 内部下标，已删除为 -1
+        std::vector<int> external_of; // 内部下标 -> 编号
+    };
+    // 重建开始后发生的增删，替换前在新索引上按顺序重放
+    struct LogEntry {
+        bool insert;
+        int id;
+        int old_internal; // 插入的点在旧索引中的下标 (坐标从旧数据集读取)
+    };
+
+    void build_state(State& state);
+    int internal_id(int id) const; // 调用方需持有锁
+    // 开始一次重建：复制当前数据和编号映射作为快照，之后的增删记入日志 (调用方需持有写锁)
+    std::unique_ptr<State> take_snapshot();
+    // 在新索引上建好 internal_of 并重放日志、替换当前索引。
+    // 重放后的索引仍超过漂移阈值时返回下一次重建的快照，否则返回 nullptr
+    std::unique_ptr<State> run_rebuild(std::unique_ptr<State> next);
+    [[nodiscard]] bool should_rebuild() const; // 调用方需持有锁
+
+    Factory factory_;
+    IndexMaintainerOptions options_;
+
+    mutable std::shared_mutex mutex_; // 保护以下成员
+    std::unique_ptr<State> state_;
+    int next_id_ = 0;
+    bool rebuilding_ = false;
+    std::vector<LogEntry> log_;
+    size_t rebuilds_ = 0;
+
+    std::mutex worker_mutex_; // 保护 worker_
+    std::thread worker_;
+};
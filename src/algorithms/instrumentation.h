@@ -0,0 +1,77 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// 热路径插桩开关：用 cmake -DPRUNING_INSTRUMENTATION=ON 构建时打开。
+// 关闭时下面的计数接口都是空的内联函数，查询路径上不产生任何额外指令
+#ifndef PRUNING_INSTRUMENTATION
+#define PRUNING_INSTRUMENTATION 0
+#endif
+
+// 点对查询 (query_distance_exceeds / query_distance_exceeds_batch) 由哪条规则判定的分项统计。
+// prefilter / full_calculations 总是有值；其余各项只在开启插桩时统计
+struct PruningBreakdown {
+    long long lower_bound = 0;       // 下界 > r，判定为超过
+    long long upper_bound = 0;       // 上界 <= r，判定为不超过
+    long long prefilter = 0;         // 量化预过滤判定
+    long long full_calculations = 0; // 完整距离计算
+    // 完整计算实际累加的维度数的直方图：第 i 个桶对应 (i * bucket_dims, (i + 1) * bucket_dims]，
+    // 最后一个桶还包含更大的值。不用提前退出的完整计算总是落在“全部维度”的桶里
+    std::vector<long long> dims_touched;
+    size_t bucket_dims = 0;
+};
+
+// 插桩计数：与 QueryStats 相同的按线程分槽方式
+class InstrumentationStats {
+public:
+    static constexpr size_t kMaxSlots = 128;
+    static constexpr size_t kHistogramBuckets = 64;
+
+    void add_bound_decisions(long long lower, long long upper) {
+        Slot& slot = slots_[thread_slot()];
+        if (lower != 0) slot.lower_bound.fetch_add(lower, std::memory_order_relaxed);
+        if (upper != 0) slot.upper_bound.fetch_add(upper, std::memory_order_relaxed);
+    }
+
+    void add_dims_touched(size_t bucket) {
+        slots_[thread_slot()].dims_touched[bucket < kHistogramBuckets ? bucket : kHistogramBuckets - 1].fetch_add(
+            1, std::memory_order_relaxed);
+    }
+
+    // 合并所有槽位，写入 breakdown 的 lower_bound / upper_bound / dims_touched
+    void merge_into(PruningBreakdown& breakdown) const {
+        breakdown.dims_touched.assign(kHistogramBuckets, 0);
+        for (const auto& slot : slots_) {
+            breakdown.lower_bound += slot.lower_bound.load(std::memory_order_relaxed);
+            breakdown.upper_bound += slot.upper_bound.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < kHistogramBuckets; ++i) {
+                breakdown.dims_touched[i] += slot.dims_touched[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void reset() {
+        for (auto& slot : slots_) {
+            slot.lower_bound.store(0, std::memory_order_relaxed);
+            slot.upper_bound.store(0, std::memory_order_relaxed);
+            for (auto& count : slot.dims_touched) count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<long long> lower_bound{0};
+        std::atomic<long long> upper_bound{0};
+        std::array<std::atomic<long long>, kHistogramBuckets> dims_touched{};
+    };
+
+    static size_t thread_slot() {
+        static std::atomic<size_t> next_id{0};
+        thread_local const size_t slot = next_id.fetch_add(1, std::memory_order_relaxed) % kMaxSlots;
+        return slot;
+    }
+
+    std::array<Slot, kMaxSlots> slots_;
+};
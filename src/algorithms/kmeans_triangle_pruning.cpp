@@ -1,30 +1,175 @@
 #include "kmeans_triangle_pruning.h"
 #include "../core/distance.h"
+#include "../core/index_file.h"
+#include "../core/kmeans.h"
+#include "../core/work_stealing.h"
 #include <iostream>
-#include <random>
 #include <algorithm>
+#include <cmath>
 #include <limits>
 
-KMeansTrianglePruning::KMeansTrianglePruning(int k, int max_iterations)
-    : k_(k), max_iterations_(max_iterations) {}
+KMeansTrianglePruning::KMeansTrianglePruning(int k, int max_iterations, uint64_t seed)
+    : k_(k), max_iterations_(max_iterations), seed_(seed) {}
 
 void KMeansTrianglePruning::build(const Dataset& dataset) {
-    dataset_ = &dataset;
     std::cout << "Building index with K-means (k=" << k_ << ")..." << std::endl;
     
-    // 运行 K-means 找到 pivots
-    run_kmeans();
-
-    // 预计算每个点到其中心点的距离
-    std::cout << "Pre-calculating point-to-pivot distances..." << std::endl;
-    point_to_pivot_dist_.resize(dataset_->size());
-    for (size_t i = 0; i < dataset_->size(); ++i) {
-        int pivot_idx = point_to_pivot_map_[i];
-        point_to_pivot_dist_[i] = euclidean_distance(dataset_->get_point(i), pivots_[pivot_idx]);
-    }
+    // 运行 K-means 找到 pivots；引擎同时给出每个点到其中心点的精确距离
+    KMeansResult kmeans = run_kmeans(dataset, kmeans_options());
+    std::cout << "K-means finished after " << kmeans.iterations << " iterations"
+              << (kmeans.converged ? " (converged)." : ".") << std::endl;
+    build_from_clustering(dataset, std::move(kmeans));
     std::cout << "Build finished." << std::endl;
 }
 
+KMeansOptions KMeansTrianglePruning::kmeans_options() const {
+    KMeansOptions options;
+    options.k = k_;
+    options.max_iterations = max_iterations_;
+    options.seed = seed_;
+    return options;
+}
+
+void KMeansTrianglePruning::build_from_clustering(const Dataset& dataset, KMeansResult kmeans) {
+    dataset_ = &dataset;
+    pivots_ = std::move(kmeans.centroids);
+    point_to_pivot_map_ = std::move(kmeans.assignments);
+    point_to_pivot_dist_ = std::move(kmeans.distances);
+
+    // 预计算中心点两两之间的距离，查询时的上下界检查因此只需 O(1)
+    pivot_pair_dists_.assign(static_cast<size_t>(k_) * k_, 0.0);
+    parallel_for_work_stealing(static_cast<size_t>(k_), hardware_thread_count(), 4, [&](size_t begin, size_t end, int) {
+        for (size_t a = begin; a < end; ++a) {
+            for (size_t b = 0; b < static_cast<size_t>(k_); ++b) {
+                if (a == b) continue;
+                pivot_pair_dists_[a * k_ + b] = euclidean_distance(pivots_.get_point(static_cast<int>(a)),
+                                                                   pivots_.get_point(static_cast<int>(b)));
+            }
+        }
+    });
+    build_cluster_lists();
+}
+
+namespace {
+constexpr uint32_t kIndexTag = make_index_tag("KMTP");
+enum SectionId : uint32_t {
+    kSectionParams = 1,     // int64: k, max_iterations, seed
+    kSectionPivots = 2,     // double: k 行 pivots (对齐行格式)
+    kSectionPivotMap = 3,   // int32: n
+    kSectionPivotDist = 4,  // double: n
+    kSectionPivotPairs = 5, // double: k*k
+};
+}
+
+bool KMeansTrianglePruning::save(const std::string& path) const {
+    const std::vector<int64_t> params = {k_, max_iterations_, static_cast<int64_t>(seed_)};
+    IndexFileWriter writer(kIndexTag, *dataset_);
+    writer.add_vector(kSectionParams, params);
+    writer.add_points(kSectionPivots, pivots_);
+    writer.add_vector(kSectionPivotMap, point_to_pivot_map_);
+    writer.add_vector(kSectionPivotDist, point_to_pivot_dist_);
+    writer.add_vector(kSectionPivotPairs, pivot_pair_dists_);
+    return writer.write(path);
+}
+
+bool KMeansTrianglePruning::load(const std::string& path, const Dataset& dataset) {
+    IndexFileReader reader;
+    if (!reader.open(path, kIndexTag, dataset)) {
+        return false;
+    }
+    std::vector<int64_t> params;
+    if (!reader.read_vector(kSectionParams, params, 3) || params[0] != k_) {
+        std::cerr << "Error: Index file " << path << " was built with different parameters (k)." << std::endl;
+        return false;
+    }
+    const size_t n = dataset.size();
+    if (!reader.read_points(kSectionPivots, dataset.dimensions(), pivots_) || pivots_.size() != static_cast<size_t>(k_) ||
+        !reader.view_vector(kSectionPivotMap, point_to_pivot_map_, n) ||
+        !reader.view_vector(kSectionPivotDist, point_to_pivot_dist_, n) ||
+        !reader.read_vector(kSectionPivotPairs, pivot_pair_dists_, static_cast<size_t>(k_) * k_)) {
+        std::cerr << "Error: Index file " << path << " is missing sections or has unexpected sizes." << std::endl;
+        return false;
+    }
+    dataset_ = &dataset;
+    build_cluster_lists();
+    return true;
+}
+
+void KMeansTrianglePruning::build_cluster_lists() {
+    const size_t k = static_cast<size_t>(k_);
+    const size_t n = point_to_pivot_map_.size();
+    cluster_offsets_.assign(k + 1, 0);
+    for (int c : point_to_pivot_map_) cluster_offsets_[c + 1]++;
+    for (size_t c = 0; c < k; ++c) cluster_offsets_[c + 1] += cluster_offsets_[c];
+
+    cluster_members_.resize(n);
+    std::vector<size_t> cursor(cluster_offsets_.begin(), cluster_offsets_.end() - 1);
+    for (size_t i = 0; i < n; ++i) {
+        cluster_members_[cursor[point_to_pivot_map_[i]]++] = static_cast<int>(i);
+    }
+
+    cluster_member_dists_.resize(n);
+    cluster_radius_.assign(k, 0.0);
+    pending_members_.assign(k, {});
+    double dist_sum = 0.0;
+    for (double d : point_to_pivot_dist_) dist_sum += d;
+    built_mean_dist_ = n > 0 ? dist_sum / static_cast<double>(n) : 0.0;
+    inserted_dist_sum_ = 0.0;
+    reset_update_counts(n);
+    parallel_for_work_stealing(k, hardware_thread_count(), 4, [&](size_t begin, size_t end, int) {
+        for (size_t c = begin; c < end; ++c) {
+            auto first = cluster_members_.begin() + cluster_offsets_[c];
+            auto last = cluster_members_.begin() + cluster_offsets_[c + 1];
+            std::sort(first, last, [&](int a, int b) {
+                return point_to_pivot_dist_[a] != point_to_pivot_dist_[b] ? point_to_pivot_dist_[a] < point_to_pivot_dist_[b]
+                                                                          : a < b;
+            });
+            for (size_t i = cluster_offsets_[c]; i < cluster_offsets_[c + 1]; ++i) {
+                cluster_member_dists_[i] = point_to_pivot_dist_[cluster_members_[i]];
+            }
+            if (first != last) cluster_radius_[c] = cluster_member_dists_[cluster_offsets_[c + 1] - 1];
+        }
+    });
+}
+
+void KMeansTrianglePruning::insert_point(int id) {
+    const PointView point = dataset_->get_point(id);
+    int best = 0;
+    double best_dist = std::numeric_limits<double>::infinity();
+    for (int c = 0; c < k_; ++c) {
+        const double d = euclidean_distance(point, pivots_.get_point(c));
+        if (d < best_dist) {
+            best_dist = d;
+            best = c;
+        }
+    }
+    point_to_pivot_map_.push_back(best);
+    point_to_pivot_dist_.push_back(best_dist);
+    pending_members_[best].push_back(id);
+    cluster_radius_[best] = std::max(cluster_radius_[best], best_dist);
+    inserted_dist_sum_ += best_dist;
+    ++inserted_since_build_;
+}
+
+double KMeansTrianglePruning::drift() const {
+    double drift = PruningAlgorithm::drift();
+    if (inserted_since_build_ > 0 && built_mean_dist_ > 0.0) {
+        const double inserted_mean = inserted_dist_sum_ / static_cast<double>(inserted_since_build_);
+        drift = std::max(drift, inserted_mean / built_mean_dist_ - 1.0);
+    }
+    return drift;
+}
+
+IndexFootprint KMeansTrianglePruning::index_footprint() const {
+    IndexFootprint footprint;
+    footprint.fixed_bytes = pivots_.size() * pivots_.stride() * sizeof(double) +
+                            pivot_pair_dists_.size() * sizeof(double) + cluster_offsets_.size() * sizeof(size_t) +
+                            cluster_radius_.size() * sizeof(double);
+    // 所属中心及距离，簇内成员表中的下标及距离
+    footprint.per_point_bytes = 2 * (sizeof(int) + sizeof(double));
+    return footprint;
+}
+
 bool KMeansTrianglePruning::query_distance_exceeds(int p_idx, int q_idx, double r) {
     // 获取点p, q的信息
     int pivot_p_idx = point_to_pivot_map_[p_idx];
@@ -38,78 +183,110 @@ bool KMeansTrianglePruning::query_distance_exceeds(int p_idx, int q_idx, double
     //    更有用的下界: d(p,q) >= d(pivot_p, pivot_q) - d(p, pivot_p) - d(q, pivot_q)
     // 2. 上界: d(p,q) <= d(p, pivot_p) + d(pivot_p, pivot_q) + d(q, pivot_q)
     
-    double dist_pivots = euclidean_distance(pivots_[pivot_p_idx], pivots_[pivot_q_idx]);
+    double dist_pivots = pivot_pair_dists_[static_cast<size_t>(pivot_p_idx) * k_ + pivot_q_idx];
     
     // 规则1 (基于下界): 如果 d(pivots) - d(p,pivot_p) - d(q,pivot_q) > r，那么 d(p,q) 必定 > r
     if (dist_pivots - dist_p_to_pivot - dist_q_to_pivot > r) {
+        count_bound_decisions(1, 0);
         return true; // 剪枝成功，返回 true
     }
 
     // 规则2 (基于上界): 如果 d(pivots) + d(p,pivot_p) + d(q,pivot_q) <= r, 那么 d(p,q) 必定 <= r
     if (dist_pivots + dist_p_to_pivot + dist_q_to_pivot <= r) {
+        count_bound_decisions(0, 1);
         return false; // 剪枝成功，返回 false
     }
 
-    // 剪枝失败，必须进行完整计算
-    full_calculations_count_++;
-    const auto& p = dataset_->get_point(p_idx);
-    const auto& q = dataset_->get_point(q_idx);
-    return euclidean_distance(p, q) > r;
-}
-
-// 内部 K-means 实现
-void KMeansTrianglePruning::run_kmeans() {
-    const auto& points = dataset_->get_all_points();
-    size_t num_points = points.size();
-    size_t dimensions = dataset_->dimensions();
-
-    // 1. 初始化中心点 (随机选择k个点)
-    pivots_.clear();
-    std::vector<int> initial_indices(num_points);
-    std::iota(initial_indices.begin(), initial_indices.end(), 0);
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(initial_indices.begin(), initial_indices.end(), g);
-    for (int i = 0; i < k_; ++i) {
-        pivots_.push_back(points[initial_indices[i]]);
+    // 剪枝失败：先尝试量化预过滤，仍无法判定才进行完整计算
+    int decision = prefilter_decide(p_idx, q_idx, r);
+    if (decision >= 0) {
+        return decision == 1;
     }
+    stats_.add_full_calculations(1);
+    const PointView p = dataset_->get_point(p_idx);
+    const PointView q = dataset_->get_point(q_idx);
+    record_full_calculation(p, q, r, false);
+    return full_calculation_exceeds(*dataset_, p_idx, q_idx, r, false);
+}
 
-    point_to_pivot_map_.assign(num_points, 0);
-
-    for (int iter = 0; iter < max_iterations_; ++iter) {
-        // 2. 分配步骤: 将每个点分配给最近的中心点
-        for (size_t i = 0; i < num_points; ++i) {
-            double min_dist_sq = std::numeric_limits<double>::max();
-            int best_pivot_idx = 0;
-            for (int j = 0; j < k_; ++j) {
-                double dist_sq = euclidean_distance_sq(points[i], pivots_[j]);
-                if (dist_sq < min_dist_sq) {
-                    min_dist_sq = dist_sq;
-                    best_pivot_idx = j;
-                }
-            }
-            point_to_pivot_map_[i] = best_pivot_idx;
+void KMeansTrianglePruning::query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) {
+    // 阶段1：对整批点对做 O(1) 的上下界检查，只记录无法判定的点对
+    std::vector<uint32_t>& undecided = batch_scratch();
+    undecided.clear();
+    long long exceeding = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const int p_idx = pairs[i].p_idx;
+        const int q_idx = pairs[i].q_idx;
+        const double dist_pivots = pivot_pair_dists_[static_cast<size_t>(point_to_pivot_map_[p_idx]) * k_ + point_to_pivot_map_[q_idx]];
+        const double dist_p_to_pivot = point_to_pivot_dist_[p_idx];
+        const double dist_q_to_pivot = point_to_pivot_dist_[q_idx];
+        if (dist_pivots - dist_p_to_pivot - dist_q_to_pivot > r) {
+            results[i] = 1;
+            ++exceeding;
+        } else if (dist_pivots + dist_p_to_pivot + dist_q_to_pivot <= r) {
+            results[i] = 0;
+        } else {
+            undecided.push_back(static_cast<uint32_t>(i));
         }
+    }
+    count_bound_decisions(exceeding, static_cast<long long>(count - undecided.size()) - exceeding);
 
-        // 3. 更新步骤: 重新计算每个簇的中心点
-        std::vector<Point> new_pivots(k_, Point(dimensions, 0.0));
-        std::vector<int> cluster_counts(k_, 0);
-        for (size_t i = 0; i < num_points; ++i) {
-            int pivot_idx = point_to_pivot_map_[i];
-            for (size_t d = 0; d < dimensions; ++d) {
-                new_pivots[pivot_idx][d] += points[i][d];
-            }
-            cluster_counts[pivot_idx]++;
-        }
+    // 阶段2：集中对剩余点对做完整计算
+    compute_undecided_batch(*dataset_, pairs, undecided, r, results);
+}
+
+size_t KMeansTrianglePruning::query_radius_bucket(int p_idx, int q_idx, const std::vector<double>& radii) {
+    // 与 query_distance_exceeds 相同的两条规则，界只算一次
+    const double dist_pivots = pivot_pair_dists_[static_cast<size_t>(point_to_pivot_map_[p_idx]) * k_ + point_to_pivot_map_[q_idx]];
+    const double dist_p_to_pivot = point_to_pivot_dist_[p_idx];
+    const double dist_q_to_pivot = point_to_pivot_dist_[q_idx];
+    return radius_bucket_from_bounds(*dataset_, p_idx, q_idx,
+                                     dist_pivots - dist_p_to_pivot - dist_q_to_pivot,
+                                     dist_pivots + dist_p_to_pivot + dist_q_to_pivot, radii);
+}
+
+void KMeansTrianglePruning::range_query(int p_idx, double r, std::vector<int>& results) {
+    range_query_impl(dataset_->get_point(p_idx), p_idx, r, results);
+}
 
-        for (int j = 0; j < k_; ++j) {
-            if (cluster_counts[j] > 0) {
-                for (size_t d = 0; d < dimensions; ++d) {
-                    new_pivots[j][d] /= cluster_counts[j];
-                }
-                pivots_[j] = new_pivots[j];
+void KMeansTrianglePruning::range_query(PointView query, double r, std::vector<int>& results) {
+    range_query_impl(query, -1, r, results);
+}
+
+void KMeansTrianglePruning::range_query_impl(PointView query, int exclude_idx, double r, std::vector<int>& results) {
+    results.clear();
+    long long full_calcs = 0;
+    const double* dists = cluster_member_dists_.data();
+    const QuantizedPrefilter::Code* code = exclude_idx >= 0 ? nullptr : prefilter_code(query);
+    const CompactPoints::Query* compact_query = exclude_idx >= 0 ? nullptr : compact_code(query);
+    for (int c = 0; c < k_; ++c) {
+        const double dist_to_pivot = euclidean_distance(query, pivots_.get_point(c));
+        // 簇内所有点 x 满足 d(x, c) <= 簇半径，因此 d(q, x) >= d(q, c) - 簇半径
+        if (dist_to_pivot - cluster_radius_[c] > r) continue;
+
+        // 候选点 x 已满足下界 |d(x, c) - d(q, c)| <= r
+        auto visit = [&](int x, double dist_x) {
+            if (x == exclude_idx || dataset_->is_erased(x)) return;
+            // 上界 d(x, c) + d(q, c) <= r：无需计算即可收录
+            if (dist_x + dist_to_pivot <= r) {
+                results.push_back(x);
+                return;
             }
+            int decision = prefilter_decide_range(exclude_idx, code, x, r);
+            if (decision < 0) {
+                ++full_calcs;
+                decision = range_calculation_exceeds(*dataset_, query, exclude_idx, compact_query, x, r) ? 1 : 0;
+            }
+            if (decision == 0) results.push_back(x);
+        };
+
+        // 下界 |d(x, c) - d(q, c)| <= r 才可能命中：在有序成员中二分定位窗口
+        const size_t end = cluster_offsets_[c + 1];
+        size_t i = static_cast<size_t>(std::lower_bound(dists + cluster_offsets_[c], dists + end, dist_to_pivot - r) - dists);
+        for (; i < end && dists[i] <= dist_to_pivot + r; ++i) visit(cluster_members_[i], dists[i]);
+        for (int x : pending_members_[c]) {
+            if (std::abs(point_to_pivot_dist_[x] - dist_to_pivot) <= r) visit(x, point_to_pivot_dist_[x]);
         }
-         // 简单的收敛判断可以加在这里，比如看中心点移动距离，但为简单起见，我们固定迭代次数
     }
-}
\ No newline at end of file
+    stats_.add_full_calculations(full_calcs);
+}
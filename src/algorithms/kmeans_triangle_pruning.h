@@ -1,23 +1,58 @@
 #pragma once
 #include "pruning_algorithm.h"
+#include "../core/kmeans.h"
+#include "../core/section_array.h"
+#include <cstdint>
 #include <vector>
 
 class KMeansTrianglePruning final : public PruningAlgorithm {
 public:
-    KMeansTrianglePruning(int k, int max_iterations);
+    // seed 决定 k-means++ 初始化，相同 seed 的构建结果可复现
+    KMeansTrianglePruning(int k, int max_iterations, uint64_t seed = 42);
 
     void build(const Dataset& dataset) override;
+    // 用已有的聚类结果 (在 dataset 上、按 kmeans_options() 运行) 构建，跳过 k-means 本身。
+    // 重排数据集时先聚类、按簇重排，再把聚类结果按同一排列传进来，使索引的簇与内存中的簇完全一致
+    void build_from_clustering(const Dataset& dataset, KMeansResult kmeans);
+    [[nodiscard]] KMeansOptions kmeans_options() const;
+    bool save(const std::string& path) const override;
+    bool load(const std::string& path, const Dataset& dataset) override;
+    // 新点分配给最近的中心 (中心保持不变)，先放进该簇的待合并列表，范围查询时与有序成员一起检查
+    void insert_point(int id) override;
+    // 在增删比例之外叠加簇的质量：新点到所属中心的平均距离相对构建时平均距离的增幅
+    [[nodiscard]] double drift() const override;
+    [[nodiscard]] IndexFootprint index_footprint() const override;
     bool query_distance_exceeds(int p_idx, int q_idx, double r) override;
+    void query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) override;
+    size_t query_radius_bucket(int p_idx, int q_idx, const std::vector<double>& radii) override;
+    // 范围查询：整簇跳过 d(q, 中心) - 簇半径 > r 的簇；簇内成员按到中心的距离排序，
+    // 二分定位 |d(x, 中心) - d(q, 中心)| <= r 的窗口，窗口内再用上界直接收录或完整计算
+    void range_query(int p_idx, double r, std::vector<int>& results) override;
+    void range_query(PointView query, double r, std::vector<int>& results) override;
 
 private:
-    // K-means 算法实现
-    void run_kmeans();
+    // 由 point_to_pivot_map_ / point_to_pivot_dist_ 派生簇内有序成员表 (build 与 load 后调用)
+    void build_cluster_lists();
+    void range_query_impl(PointView query, int exclude_idx, double r, std::vector<int>& results);
 
     int k_;
     int max_iterations_;
+    uint64_t seed_;
     const Dataset* dataset_ = nullptr; // 指向原始数据集
 
-    std::vector<Point> pivots_; // k个中心点 (pivots/centroids)
-    std::vector<int> point_to_pivot_map_; // 每个点属于哪个中心
-    std::vector<double> point_to_pivot_dist_; // 每个点到其所属中心的距离
+    Dataset pivots_; // k个中心点 (pivots/centroids)，连续对齐存储
+    SectionArray<int> point_to_pivot_map_; // 每个点属于哪个中心 (load 后直接指向索引文件映射)
+    SectionArray<double> point_to_pivot_dist_; // 每个点到其所属中心的距离 (同上)
+    std::vector<double> pivot_pair_dists_; // k*k 的中心点两两距离表，pivot_pair_dists_[a * k + b]
+
+    // 范围查询用的簇内成员表 (CSR)：第 c 簇的成员为 cluster_members_[cluster_offsets_[c] .. cluster_offsets_[c+1])，
+    // 按到中心的距离升序排列，cluster_member_dists_ 与之一一对应；cluster_radius_[c] 为该簇最大距离
+    std::vector<size_t> cluster_offsets_;
+    std::vector<int> cluster_members_;
+    std::vector<double> cluster_member_dists_;
+    std::vector<double> cluster_radius_;
+    // build 之后插入的点：第 c 簇的新成员 (未排序)，build_cluster_lists 时并入有序成员表
+    std::vector<std::vector<int>> pending_members_;
+    double built_mean_dist_ = 0.0;     // 构建时点到所属中心的平均距离
+    double inserted_dist_sum_ = 0.0;   // 构建后插入的点到所属中心的距离之和
 };
\ No newline at end of file
@@ -1,135 +1,245 @@
 #include "multi_pivot_triangle_pruning.h"
 #include "../core/distance.h"
+#include "../core/index_file.h"
+#include "../core/prefetch.h"
+#include "../core/work_stealing.h"
 #include <iostream>
-#include <random>
 #include <algorithm>
 #include <limits>
 #include <cmath> // for std::abs
 
-MultiPivotTrianglePruning::MultiPivotTrianglePruning(int k, int max_iterations)
-    : k_(k), max_iterations_(max_iterations) {}
+MultiPivotTrianglePruning::MultiPivotTrianglePruning(int k, int max_iterations, uint64_t seed, PivotTableEncoding encoding,
+                                                     PivotSelection selection)
+    : k_(k), max_iterations_(max_iterations), seed_(seed), encoding_(encoding), selection_(selection) {}
 
 void MultiPivotTrianglePruning::build(const Dataset& dataset) {
     dataset_ = &dataset;
-    std::cout << "Building index with Multi-Pivot Triangle Pruning (k=" << k_ << ")..." << std::endl;
-    
-    // 1. 运行 K-means 找到 k 个 pivots
-    run_kmeans();
+    std::cout << "Building index with Multi-Pivot Triangle Pruning (k=" << k_
+              << ", pivots=" << pivot_selection_name(selection_) << ")..." << std::endl;
+
+    // 1. 按所选策略找到 k 个 pivots
+    PivotSelectionOptions options;
+    options.strategy = selection_;
+    options.k = k_;
+    options.max_iterations = max_iterations_;
+    options.seed = seed_;
+    pivots_ = select_pivots(dataset, options);
 
     // 2. 预计算每个点到所有 k 个 pivots 的距离
     std::cout << "Pre-calculating point-to-all-pivots distances..." << std::endl;
-    size_t num_points = dataset_->size();
-    precomputed_dists_.assign(num_points, std::vector<double>(k_));
-
-    for (size_t i = 0; i < num_points; ++i) {
+    table_.build(dataset_->size(), static_cast<size_t>(k_), encoding_, [&](size_t i, double* out) {
+        const PointView point = dataset_->get_point(static_cast<int>(i));
         for (int j = 0; j < k_; ++j) {
-            precomputed_dists_[i][j] = euclidean_distance(dataset_->get_point(i), pivots_[j]);
+            out[j] = euclidean_distance(point, pivots_.get_point(j));
+        }
+    });
+    build_anchor_order();
+    std::cout << "Build finished (" << pivot_table_encoding_name(encoding_) << " distance table, "
+              << table_.memory_bytes() / (1024.0 * 1024.0) << " MB)." << std::endl;
+}
+
+namespace {
+constexpr uint32_t kIndexTag = make_index_tag("MPTP");
+enum SectionId : uint32_t {
+    kSectionParams = 1, // int64: k, max_iterations, seed, encoding, selection
+    kSectionPivots = 2, // double: k 行 pivots (对齐行格式)
+    kSectionTable = 3,  // 距离表，占用 3~5 三个节号
+};
+}
+
+bool MultiPivotTrianglePruning::save(const std::string& path) const {
+    const std::vector<int64_t> params = {k_, max_iterations_, static_cast<int64_t>(seed_), static_cast<int64_t>(encoding_),
+                                         static_cast<int64_t>(selection_)};
+    IndexFileWriter writer(kIndexTag, *dataset_);
+    writer.add_vector(kSectionParams, params);
+    writer.add_points(kSectionPivots, pivots_);
+    table_.add_sections(writer, kSectionTable);
+    return writer.write(path);
+}
+
+bool MultiPivotTrianglePruning::load(const std::string& path, const Dataset& dataset) {
+    IndexFileReader reader;
+    if (!reader.open(path, kIndexTag, dataset)) {
+        return false;
+    }
+    std::vector<int64_t> params;
+    if (!reader.read_vector(kSectionParams, params, 5) || params[0] != k_ ||
+        params[3] != static_cast<int64_t>(encoding_) || params[4] != static_cast<int64_t>(selection_)) {
+        std::cerr << "Error: Index file " << path
+                  << " was built with different parameters (k, table encoding or pivot selection)." << std::endl;
+        return false;
+    }
+    if (!reader.read_points(kSectionPivots, dataset.dimensions(), pivots_) || pivots_.size() != static_cast<size_t>(k_) ||
+        !table_.read_sections(reader, kSectionTable, dataset.size(), static_cast<size_t>(k_), encoding_)) {
+        std::cerr << "Error: Index file " << path << " is missing sections or has unexpected sizes." << std::endl;
+        return false;
+    }
+    dataset_ = &dataset;
+    build_anchor_order();
+    return true;
+}
+
+void MultiPivotTrianglePruning::build_anchor_order() {
+    const size_t n = dataset_->size();
+    std::vector<double> dists(n);
+    const PointView anchor = pivots_.get_point(0);
+    parallel_for_work_stealing(n, hardware_thread_count(), 256, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; ++i) {
+            dists[i] = euclidean_distance(dataset_->get_point(static_cast<int>(i)), anchor);
         }
+    });
+    anchor_order_.resize(n);
+    for (size_t i = 0; i < n; ++i) anchor_order_[i] = static_cast<int>(i);
+    std::sort(anchor_order_.begin(), anchor_order_.end(), [&](int a, int b) {
+        return dists[a] != dists[b] ? dists[a] < dists[b] : a < b;
+    });
+    anchor_dists_.resize(n);
+    for (size_t i = 0; i < n; ++i) anchor_dists_[i] = dists[anchor_order_[i]];
+    pending_anchor_ids_.clear();
+    pending_anchor_dists_.clear();
+    reset_update_counts(n);
+}
+
+void MultiPivotTrianglePruning::insert_point(int id) {
+    const PointView point = dataset_->get_point(id);
+    std::vector<double>& dists = pivot_distance_scratch();
+    dists.resize(static_cast<size_t>(k_));
+    for (int j = 0; j < k_; ++j) {
+        dists[j] = euclidean_distance(point, pivots_.get_point(j));
     }
-    std::cout << "Build finished." << std::endl;
+    table_.append_row(dists.data());
+    pending_anchor_ids_.push_back(id);
+    pending_anchor_dists_.push_back(dists[0]);
+    ++inserted_since_build_;
+}
+
+IndexFootprint MultiPivotTrianglePruning::index_footprint() const {
+    IndexFootprint footprint;
+    footprint.fixed_bytes = pivots_.size() * pivots_.stride() * sizeof(double);
+    // 距离表的一行及其 scale / slack，锚点有序表中的下标及距离
+    footprint.per_point_bytes = table_.row_bytes() + 2 * sizeof(double) + sizeof(int) + sizeof(double);
+    return footprint;
 }
 
 bool MultiPivotTrianglePruning::query_distance_exceeds(int p_idx, int q_idx, double r) {
     // --- A-La-Carte 三角不等式剪枝 ---
-    // 核心思想：遍历所有k个pivot，找到最紧的下界
-    
-    double max_lower_bound = 0.0;
-
-    // 查找p和q到所有pivots的预计算距离
-    const auto& p_dists_to_pivots = precomputed_dists_[p_idx];
-    const auto& q_dists_to_pivots = precomputed_dists_[q_idx];
-
-    for (int i = 0; i < k_; ++i) {
-        // 对于每个 pivot_i, 我们有 d(p,q) >= |d(p, pivot_i) - d(q, pivot_i)|
-        double dist_p_to_pivot_i = p_dists_to_pivots[i];
-        double dist_q_to_pivot_i = q_dists_to_pivots[i];
-        
-        double current_lower_bound = std::abs(dist_p_to_pivot_i - dist_q_to_pivot_i);
-        
-        if (current_lower_bound > max_lower_bound) {
-            max_lower_bound = current_lower_bound;
-        }
+    // 对每个 pivot_i：
+    //   下界 d(p,q) >= |d(p, pivot_i) - d(q, pivot_i)|，取所有 pivot 中最大的
+    //   上界 d(p,q) <= d(p, pivot_i) + d(q, pivot_i)，取所有 pivot 中最小的
+    // 两个界在同一次扫描中计算，任一界能判定就提前结束
+    int decision = table_.decide(static_cast<size_t>(p_idx), static_cast<size_t>(q_idx), r);
+    if (decision >= 0) {
+        count_bound_decisions(decision, 1 - decision);
+        return decision == 1;
     }
 
-    // 使用找到的最紧下界进行剪枝
-    if (max_lower_bound > r) {
-        // 剪枝成功，我们确定 d(p,q) > r
-        return true;
+    // 剪枝失败：先尝试量化预过滤，仍无法判定才进行完整计算
+    decision = prefilter_decide(p_idx, q_idx, r);
+    if (decision >= 0) {
+        return decision == 1;
     }
+    stats_.add_full_calculations(1);
+    const PointView p = dataset_->get_point(p_idx);
+    const PointView q = dataset_->get_point(q_idx);
+    record_full_calculation(p, q, r, false);
+    return full_calculation_exceeds(*dataset_, p_idx, q_idx, r, false);
+}
 
-    // 如果最紧的下界都无法剪枝，我们还可以尝试使用上界剪枝。
-    // 这里需要找到一个能提供最紧上界的pivot。
-    // d(p,q) <= d(p, pivot_i) + d(q, pivot_i)
-    // 我们要找使 d(p, pivot_i) + d(q, pivot_i) 最小的 pivot_i
-    double min_upper_bound = std::numeric_limits<double>::max();
-    for (int i = 0; i < k_; ++i) {
-        double current_upper_bound = p_dists_to_pivots[i] + q_dists_to_pivots[i];
-        if (current_upper_bound < min_upper_bound) {
-            min_upper_bound = current_upper_bound;
+void MultiPivotTrianglePruning::query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) {
+    // 阶段1：对整批点对做上下界检查，只记录无法判定的点对
+    std::vector<uint32_t>& undecided = batch_scratch();
+    undecided.clear();
+    long long exceeding = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (i + kPrefetchDistance < count) {
+            prefetch_bytes(table_.row_data(pairs[i + kPrefetchDistance].p_idx), table_.row_bytes());
+            prefetch_bytes(table_.row_data(pairs[i + kPrefetchDistance].q_idx), table_.row_bytes());
+        }
+        int decision = table_.decide(static_cast<size_t>(pairs[i].p_idx), static_cast<size_t>(pairs[i].q_idx), r);
+        if (decision >= 0) {
+            results[i] = static_cast<uint8_t>(decision);
+            exceeding += decision;
+        } else {
+            undecided.push_back(static_cast<uint32_t>(i));
         }
     }
+    count_bound_decisions(exceeding, static_cast<long long>(count - undecided.size()) - exceeding);
 
-    if (min_upper_bound <= r) {
-        // 剪枝成功，我们确定 d(p,q) <= r
-        return false;
-    }
+    // 阶段2：集中对剩余点对做完整计算
+    compute_undecided_batch(*dataset_, pairs, undecided, r, results);
+}
 
-    // 剪枝失败，必须进行完整计算
-    full_calculations_count_++;
-    const auto& p = dataset_->get_point(p_idx);
-    const auto& q = dataset_->get_point(q_idx);
-    return euclidean_distance(p, q) > r;
+size_t MultiPivotTrianglePruning::query_radius_bucket(int p_idx, int q_idx, const std::vector<double>& radii) {
+    // 扫描全部 pivot 得到最紧的上下界 (不能像 decide 那样对单个 r 提前结束)
+    double lower = 0.0;
+    double upper = 0.0;
+    table_.bounds(static_cast<size_t>(p_idx), static_cast<size_t>(q_idx), lower, upper);
+    return radius_bucket_from_bounds(*dataset_, p_idx, q_idx, lower, upper, radii);
 }
 
-// K-means 实现 (这部分代码与之前的 kmeans_triangle_pruning.cpp 完全相同)
-void MultiPivotTrianglePruning::run_kmeans() {
-    const auto& points = dataset_->get_all_points();
-    size_t num_points = points.size();
-    size_t dimensions = dataset_->dimensions();
-
-    pivots_.clear();
-    std::vector<int> initial_indices(num_points);
-    std::iota(initial_indices.begin(), initial_indices.end(), 0);
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(initial_indices.begin(), initial_indices.end(), g);
-    for (int i = 0; i < k_; ++i) {
-        pivots_.push_back(points[initial_indices[i]]);
-    }
+std::pair<size_t, size_t> MultiPivotTrianglePruning::anchor_window(double anchor_dist, double r) const {
+    auto first = std::lower_bound(anchor_dists_.begin(), anchor_dists_.end(), anchor_dist - r);
+    auto last = std::upper_bound(first, anchor_dists_.end(), anchor_dist + r);
+    return {static_cast<size_t>(first - anchor_dists_.begin()), static_cast<size_t>(last - anchor_dists_.begin())};
+}
 
-    std::vector<int> point_to_pivot_map(num_points, 0);
-
-    for (int iter = 0; iter < max_iterations_; ++iter) {
-        for (size_t i = 0; i < num_points; ++i) {
-            double min_dist_sq = std::numeric_limits<double>::max();
-            int best_pivot_idx = 0;
-            for (int j = 0; j < k_; ++j) {
-                double dist_sq = euclidean_distance_sq(points[i], pivots_[j]);
-                if (dist_sq < min_dist_sq) {
-                    min_dist_sq = dist_sq;
-                    best_pivot_idx = j;
-                }
-            }
-            point_to_pivot_map[i] = best_pivot_idx;
+void MultiPivotTrianglePruning::range_query(int p_idx, double r, std::vector<int>& results) {
+    results.clear();
+    const PointView p = dataset_->get_point(p_idx);
+    const double p_anchor_dist = euclidean_distance(p, pivots_.get_point(0));
+    const auto [begin, end] = anchor_window(p_anchor_dist, r);
+    long long full_calcs = 0;
+    auto visit = [&](int x) {
+        if (x == p_idx || dataset_->is_erased(x)) return;
+        int decision = table_.decide(static_cast<size_t>(p_idx), static_cast<size_t>(x), r);
+        if (decision < 0) decision = prefilter_decide_range(p_idx, nullptr, x, r);
+        if (decision < 0) {
+            ++full_calcs;
+            decision = range_calculation_exceeds(*dataset_, p, p_idx, nullptr, x, r) ? 1 : 0;
         }
-
-        std::vector<Point> new_pivots(k_, Point(dimensions, 0.0));
-        std::vector<int> cluster_counts(k_, 0);
-        for (size_t i = 0; i < num_points; ++i) {
-            int pivot_idx = point_to_pivot_map[i];
-            for (size_t d = 0; d < dimensions; ++d) {
-                new_pivots[pivot_idx][d] += points[i][d];
-            }
-            cluster_counts[pivot_idx]++;
+        if (decision == 0) results.push_back(x);
+    };
+    for (size_t i = begin; i < end; ++i) {
+        if (i + kPrefetchDistance < end) {
+            prefetch_bytes(table_.row_data(anchor_order_[i + kPrefetchDistance]), table_.row_bytes());
         }
+        visit(anchor_order_[i]);
+    }
+    for (size_t i = 0; i < pending_anchor_ids_.size(); ++i) {
+        if (std::abs(pending_anchor_dists_[i] - p_anchor_dist) <= r) visit(pending_anchor_ids_[i]);
+    }
+    stats_.add_full_calculations(full_calcs);
+}
 
-        for (int j = 0; j < k_; ++j) {
-            if (cluster_counts[j] > 0) {
-                for (size_t d = 0; d < dimensions; ++d) {
-                    new_pivots[j][d] /= cluster_counts[j];
-                }
-                pivots_[j] = new_pivots[j];
-            }
+void MultiPivotTrianglePruning::range_query(PointView query, double r, std::vector<int>& results) {
+    results.clear();
+    std::vector<double>& query_dists = pivot_distance_scratch();
+    query_dists.resize(static_cast<size_t>(k_));
+    for (int j = 0; j < k_; ++j) {
+        query_dists[j] = euclidean_distance(query, pivots_.get_point(j));
+    }
+    const QuantizedPrefilter::Code* code = prefilter_code(query);
+    const CompactPoints::Query* compact_query = compact_code(query);
+    const auto [begin, end] = anchor_window(query_dists[0], r);
+    long long full_calcs = 0;
+    auto visit = [&](int x) {
+        if (dataset_->is_erased(x)) return;
+        int decision = table_.decide_query(query_dists.data(), static_cast<size_t>(x), r);
+        if (decision < 0) decision = prefilter_decide_range(-1, code, x, r);
+        if (decision < 0) {
+            ++full_calcs;
+            decision = range_calculation_exceeds(*dataset_, query, -1, compact_query, x, r) ? 1 : 0;
+        }
+        if (decision == 0) results.push_back(x);
+    };
+    for (size_t i = begin; i < end; ++i) {
+        if (i + kPrefetchDistance < end) {
+            prefetch_bytes(table_.row_data(anchor_order_[i + kPrefetchDistance]), table_.row_bytes());
         }
+        visit(anchor_order_[i]);
     }
-}
\ No newline at end of file
+    for (size_t i = 0; i < pending_anchor_ids_.size(); ++i) {
+        if (std::abs(pending_anchor_dists_[i] - query_dists[0]) <= r) visit(pending_anchor_ids_[i]);
+    }
+    stats_.add_full_calculations(full_calcs);
+}
@@ -1,25 +1,59 @@
 #pragma once
+#include "pivot_distance_table.h"
+#include "../core/pivot_selection.h"
 #include "pruning_algorithm.h"
+#include <cstdint>
+#include <utility>
 #include <vector>
 
 class MultiPivotTrianglePruning : public PruningAlgorithm {
 public:
-    MultiPivotTrianglePruning(int k, int max_iterations);
+    // seed 决定 pivot 选取 (k-means++ 初始化或各策略的随机抽样)，相同 seed 的构建结果可复现；
+    // encoding 决定距离表的存储方式 (压缩编码的判定依然是可证明正确的)；
+    // selection 决定 pivot 的选取策略，max_iterations 仅对 k-means 有效
+    MultiPivotTrianglePruning(int k, int max_iterations, uint64_t seed = 42,
+                              PivotTableEncoding encoding = PivotTableEncoding::Float64,
+                              PivotSelection selection = PivotSelection::KMeans);
 
     void build(const Dataset& dataset) override;
+    bool save(const std::string& path) const override;
+    bool load(const std::string& path, const Dataset& dataset) override;
+    // 新点的距离表行当场算出并追加到表尾 (pivot 保持不变)；它到锚点的距离放进待合并列表
+    void insert_point(int id) override;
+    [[nodiscard]] IndexFootprint index_footprint() const override;
     bool query_distance_exceeds(int p_idx, int q_idx, double r) override;
+    void query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) override;
+    size_t query_radius_bucket(int p_idx, int q_idx, const std::vector<double>& radii) override;
+
+    // 范围查询：所有点按到第 0 个 pivot (锚点) 的距离排序，二分定位 |d(x,锚点) - d(q,锚点)| <= r 的窗口，
+    // 窗口内的候选再用距离表的上下界过滤，剩余的做完整计算
+    void range_query(int p_idx, double r, std::vector<int>& results) override;
+    void range_query(PointView query, double r, std::vector<int>& results) override;
+
+    [[nodiscard]] const PivotDistanceTable& pivot_table() const { return table_; }
 
 private:
-    // K-means 算法实现 (与之前相同)
-    void run_kmeans();
+    // 计算所有点到锚点的精确距离并排序 (build 与 load 后调用)
+    void build_anchor_order();
+    // 返回锚点距离窗口 [d - r, d + r] 在 anchor_order_ 中的下标范围
+    std::pair<size_t, size_t> anchor_window(double anchor_dist, double r) const;
 
     int k_;
     int max_iterations_;
+    uint64_t seed_;
+    PivotTableEncoding encoding_;
+    PivotSelection selection_;
     const Dataset* dataset_ = nullptr;
 
-    std::vector<Point> pivots_; // k个中心点 (pivots/centroids)
+    Dataset pivots_; // k个 pivot (k-means 中心或按策略选出的数据点)，连续对齐存储
     
     // 关键改动：存储每个点到所有k个pivot的距离
-    // precomputed_dists_[i][j] = distance(point_i, pivot_j)
-    std::vector<std::vector<double>> precomputed_dists_; 
-};
\ No newline at end of file
+    // table_ 的第 i 行 = 点 i 到 k 个 pivot 的距离，扁平连续存储
+    PivotDistanceTable table_;
+
+    std::vector<int> anchor_order_;    // 按到锚点距离升序排列的点下标
+    std::vector<double> anchor_dists_; // 与 anchor_order_ 对应的精确距离
+    // build 之后插入的点及其到锚点的距离 (未排序)，build_anchor_order 时并入有序表
+    std::vector<int> pending_anchor_ids_;
+    std::vector<double> pending_anchor_dists_;
+};
@@ -0,0 +1,347 @@
+#include "out_of_core_index.h"
+#include "../core/binary_format.h"
+#include "../core/distance.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+// 分块距离表文件：
+//   [0, sizeof(OutOfCoreHeader))      文件头
+//   [pivots_offset, ...)              k 个 pivot，每个 dimensions 个 double
+//   [blocks_offset, ...)              num_blocks 个定长块，每块 block_bytes 字节 (页对齐)：
+//                                     block_points 行的 PivotDistanceTable 映像，末块不足的行填 0
+constexpr char kOutOfCoreMagic[8] = {'P', 'R', 'U', 'N', 'E', 'O', 'O', 'C'};
+constexpr uint32_t kOutOfCoreVersion = 1;
+constexpr uint64_t kPageBytes = 4096;
+
+struct OutOfCoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t encoding;      // PivotTableEncoding
+    uint64_t count;         // 点数
+    uint64_t dimensions;
+    uint64_t k;
+    uint64_t block_points;
+    uint64_t block_bytes;
+    uint64_t pivots_offset;
+    uint64_t blocks_offset;
+    uint64_t source_bytes;  // 构建时 nodes.bin 的大小，用于发现数据集被替换
+    uint64_t reserved[2];
+};
+static_assert(sizeof(OutOfCoreHeader) == 96, "OutOfCoreHeader layout must stay fixed");
+
+uint64_t round_up(uint64_t value, uint64_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// 读取并校验 nodes.bin 的文件头 (规则同 Dataset::load_binary)，file_bytes 返回文件大小
+bool read_nodes_header(const std::string& path, BinaryDatasetHeader& header, uint64_t& file_bytes) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open binary nodes file: " << path << std::endl;
+        return false;
+    }
+    file_bytes = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kBinaryDatasetMagic, sizeof(header.magic)) != 0 ||
+        header.version != kBinaryDatasetVersion || header.dtype != static_cast<uint32_t>(BinaryDType::Float64) ||
+        header.stride < header.dimensions || header.stride % Dataset::kStrideMultiple != 0 ||
+        header.data_offset % Dataset::kAlignment != 0 ||
+        !binary_dataset_fits(header, file_bytes)) {
+        std::cerr << "Error: Not a valid binary nodes file (convert nodes.txt with convert_nodes): " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Knuth 的选择抽样：一遍扫描 [0, n) 得到 count 个升序的、不重复的均匀随机下标，只占用 O(count) 内存
+std::vector<size_t> sample_ids(size_t n, size_t count, uint64_t seed) {
+    std::vector<size_t> ids;
+    ids.reserve(count);
+    std::mt19937_64 gen(seed);
+    for (size_t i = 0; i < n && ids.size() < count; ++i) {
+        std::uniform_int_distribution<size_t> distrib(0, n - i - 1);
+        if (distrib(gen) < count - ids.size()) ids.push_back(i);
+    }
+    return ids;
+}
+
+} // namespace
+
+bool OutOfCoreIndex::build(const std::string& nodes_path, const std::string& table_path,
+                           const OutOfCoreOptions& options) {
+    if (options.k <= 0 || options.block_points == 0) {
+        throw std::invalid_argument("OutOfCoreIndex: k and block_points must be positive.");
+    }
+    BinaryDatasetHeader nodes;
+    uint64_t source_bytes = 0;
+    if (!read_nodes_header(nodes_path, nodes, source_bytes)) return false;
+    const size_t n = static_cast<size_t>(nodes.count);
+    const size_t dims = static_cast<size_t>(nodes.dimensions);
+    const size_t stride = static_cast<size_t>(nodes.stride);
+    const size_t k = static_cast<size_t>(options.k);
+
+    // 坐标按块顺序读取，缓存只保留当前块和预读的下一块
+    const size_t coord_block_bytes = options.block_points * stride * sizeof(double);
+    BlockCache coords;
+    if (!coords.open(nodes_path, nodes.data_offset, coord_block_bytes, nodes.count * stride * sizeof(double),
+                     2 * coord_block_bytes)) {
+        return false;
+    }
+    auto row = [&](const BlockCache::Block& block, size_t idx) {
+        return PointView{reinterpret_cast<const double*>(block.data()) + (idx % options.block_points) * stride, dims};
+    };
+
+    // 1. 在均匀抽取的样本上选取 pivot (第一遍顺序读)
+    std::cout << "Building out-of-core table (" << n << " points x " << dims << " dims, k=" << k << ", "
+              << pivot_table_encoding_name(options.encoding) << ", " << coords.num_blocks() << " blocks of "
+              << options.block_points << " points)..." << std::endl;
+    Dataset sample;
+    sample.reset(dims);
+    const std::vector<size_t> ids = sample_ids(n, std::min(options.sample_points, n), options.seed);
+    sample.reserve(ids.size());
+    for (size_t id : ids) {
+        const auto block = coords.get(id / options.block_points);
+        if (block == nullptr) return false;
+        sample.add_point(row(*block, id));
+    }
+    PivotSelectionOptions selection;
+    selection.strategy = options.selection;
+    selection.k = options.k;
+    selection.max_iterations = options.max_iterations;
+    selection.seed = options.seed;
+    const Dataset pivots = select_pivots(sample, selection);
+
+    // 2. 逐块计算距离表并写出 (第二遍顺序读)
+    OutOfCoreHeader header{};
+    std::memcpy(header.magic, kOutOfCoreMagic, sizeof(header.magic));
+    header.version = kOutOfCoreVersion;
+    header.encoding = static_cast<uint32_t>(options.encoding);
+    header.count = nodes.count;
+    header.dimensions = nodes.dimensions;
+    header.k = k;
+    header.block_points = options.block_points;
+    header.block_bytes = round_up(PivotDistanceTable::image_bytes(options.block_points, k, options.encoding), kPageBytes);
+    header.pivots_offset = sizeof(OutOfCoreHeader);
+    header.blocks_offset = round_up(header.pivots_offset + k * dims * sizeof(double), kPageBytes);
+    header.source_bytes = source_bytes;
+
+    std::ofstream out(table_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open file for writing: " << table_path << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (size_t j = 0; j < k; ++j) {
+        out.write(reinterpret_cast<const char*>(pivots.get_point(static_cast<int>(j)).data()),
+                  static_cast<std::streamsize>(dims * sizeof(double)));
+    }
+    std::vector<char> padding(header.blocks_offset - header.pivots_offset - k * dims * sizeof(double), 0);
+    out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+
+    std::vector<unsigned char> image(header.block_bytes);
+    for (size_t b = 0; b < coords.num_blocks(); ++b) {
+        if (b + 1 < coords.num_blocks()) coords.prefetch({b + 1});
+        const auto block = coords.get(b);
+        if (block == nullptr) return false;
+        const size_t first = b * options.block_points;
+        const size_t rows = std::min(options.block_points, n - first);
+        PivotDistanceTable table;
+        table.build(options.block_points, k, options.encoding, [&](size_t i, double* dists) {
+            for (size_t j = 0; j < k; ++j) {
+                dists[j] = i < rows ? euclidean_distance(row(*block, first + i), pivots.get_point(static_cast<int>(j))) : 0.0;
+            }
+        });
+        std::fill(image.begin(), image.end(), 0);
+        table.write_image(image.data());
+        out.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size()));
+    }
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Failed writing out-of-core table: " << table_path << std::endl;
+        return false;
+    }
+    std::cout << "Out-of-core table written to " << table_path << " ("
+              << static_cast<double>(header.blocks_offset + coords.num_blocks() * header.block_bytes) / (1024.0 * 1024.0)
+              << " MB)." << std::endl;
+    return true;
+}
+
+bool OutOfCoreIndex::open(const std::string& nodes_path, const std::string& table_path, size_t table_cache_bytes,
+                          size_t coord_cache_bytes) {
+    BinaryDatasetHeader nodes;
+    uint64_t source_bytes = 0;
+    if (!read_nodes_header(nodes_path, nodes, source_bytes)) return false;
+
+    std::ifstream in(table_path, std::ios::binary);
+    OutOfCoreHeader header{};
+    if (!in.is_open() || !in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kOutOfCoreMagic, sizeof(header.magic)) != 0 || header.version != kOutOfCoreVersion ||
+        header.encoding > static_cast<uint32_t>(PivotTableEncoding::UInt8) || header.k == 0 || header.block_points == 0) {
+        std::cerr << "Error: Not a valid out-of-core table: " << table_path << std::endl;
+        return false;
+    }
+    if (header.count != nodes.count || header.dimensions != nodes.dimensions || header.source_bytes != source_bytes) {
+        std::cerr << "Error: Out-of-core table " << table_path << " was built from a different dataset." << std::endl;
+        return false;
+    }
+    // pivot 取自数据集 (k <= count)，因此 pivot 区的大小不会溢出；块的大小按每行字节数逐项比较
+    const PivotTableEncoding encoding = static_cast<PivotTableEncoding>(header.encoding);
+    const uint64_t pivot_bytes = header.k * header.dimensions * sizeof(double);
+    const uint64_t block_row_bytes = PivotDistanceTable::image_bytes(1, static_cast<size_t>(header.k), encoding);
+    if (header.k > header.count || header.pivots_offset < sizeof(OutOfCoreHeader) ||
+        header.blocks_offset < header.pivots_offset || header.blocks_offset - header.pivots_offset < pivot_bytes ||
+        header.block_points > header.block_bytes / block_row_bytes) {
+        std::cerr << "Error: Out-of-core table has an inconsistent layout: " << table_path << std::endl;
+        return false;
+    }
+
+    num_points_ = static_cast<size_t>(nodes.count);
+    dims_ = static_cast<size_t>(nodes.dimensions);
+    stride_ = static_cast<size_t>(nodes.stride);
+    block_points_ = static_cast<size_t>(header.block_points);
+    encoding_ = encoding;
+    row_bytes_ = PivotDistanceTable::row_bytes_for(header.k, encoding_);
+    scan_ = PivotDistanceTable::scan_for(encoding_);
+
+    pivots_.reset(dims_);
+    std::vector<double> pivot(dims_);
+    in.seekg(static_cast<std::streamoff>(header.pivots_offset));
+    for (uint64_t j = 0; j < header.k; ++j) {
+        if (!in.read(reinterpret_cast<char*>(pivot.data()), static_cast<std::streamsize>(dims_ * sizeof(double)))) {
+            std::cerr << "Error: Out-of-core table is truncated: " << table_path << std::endl;
+            return false;
+        }
+        pivots_.add_point(PointView{pivot.data(), dims_});
+    }
+
+    const uint64_t num_blocks = (nodes.count + header.block_points - 1) / header.block_points;
+    if (!table_cache_.open(table_path, header.blocks_offset, header.block_bytes, num_blocks * header.block_bytes,
+                           table_cache_bytes) ||
+        !coord_cache_.open(nodes_path, nodes.data_offset, block_points_ * stride_ * sizeof(double),
+                           nodes.count * nodes.stride * sizeof(double), coord_cache_bytes)) {
+        return false;
+    }
+    reset_stats();
+    return true;
+}
+
+namespace {
+
+std::shared_ptr<const BlockCache::Block> fetch(BlockCache& cache, size_t block) {
+    auto data = cache.get(block);
+    if (data == nullptr) throw std::runtime_error("OutOfCoreIndex: failed reading a block");
+    return data;
+}
+
+} // namespace
+
+bool OutOfCoreIndex::query_distance_exceeds(int p_idx, int q_idx, double r) {
+    ++queries_;
+    const auto table_p = fetch(table_cache_, block_of(p_idx));
+    const auto table_q = block_of(q_idx) == block_of(p_idx) ? table_p : fetch(table_cache_, block_of(q_idx));
+    const int decision = decide(table_row(*table_p, p_idx), table_row(*table_q, q_idx), r);
+    if (decision >= 0) return decision == 1;
+
+    ++full_calculations_;
+    const auto coord_p = fetch(coord_cache_, block_of(p_idx));
+    const auto coord_q = block_of(q_idx) == block_of(p_idx) ? coord_p : fetch(coord_cache_, block_of(q_idx));
+    return is_distance_exceeding_early_exit(point(*coord_p, p_idx), point(*coord_q, q_idx), r);
+}
+
+void OutOfCoreIndex::order_by_blocks(const QueryPair* pairs, std::vector<uint32_t>& indices, BlockCache& cache) {
+    blocks_.clear();
+    for (uint32_t i : indices) {
+        const size_t a = block_of(pairs[i].p_idx);
+        const size_t b = block_of(pairs[i].q_idx);
+        keys_[i] = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+        blocks_.push_back(a);
+        blocks_.push_back(b);
+    }
+    std::sort(indices.begin(), indices.end(), [&](uint32_t x, uint32_t y) { return keys_[x] < keys_[y]; });
+    std::sort(blocks_.begin(), blocks_.end());
+    blocks_.erase(std::unique(blocks_.begin(), blocks_.end()), blocks_.end());
+    cache.prefetch(blocks_);
+}
+
+void OutOfCoreIndex::query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) {
+    queries_ += static_cast<long long>(count);
+    pending_.resize(count);
+    keys_.resize(count);
+    for (size_t i = 0; i < count; ++i) pending_[i] = static_cast<uint32_t>(i);
+
+    // 第一阶段：只读距离表块。排序后较小的块在一段连续的点对中保持不变，较大的块单调递增
+    order_by_blocks(pairs, pending_, table_cache_);
+    undecided_.clear();
+    std::shared_ptr<const BlockCache::Block> low;
+    std::shared_ptr<const BlockCache::Block> high;
+    size_t low_id = SIZE_MAX;
+    size_t high_id = SIZE_MAX;
+    auto load = [&](BlockCache& cache, size_t a, size_t b) {
+        const size_t lo = std::min(a, b);
+        const size_t hi = std::max(a, b);
+        if (lo != low_id) {
+            low = fetch(cache, lo);
+            low_id = lo;
+        }
+        if (hi != high_id) {
+            high = hi == lo ? low : fetch(cache, hi);
+            high_id = hi;
+        }
+    };
+    for (uint32_t i : pending_) {
+        const size_t a = block_of(pairs[i].p_idx);
+        const size_t b = block_of(pairs[i].q_idx);
+        load(table_cache_, a, b);
+        const BlockCache::Block& block_p = a == low_id ? *low : *high;
+        const BlockCache::Block& block_q = b == low_id ? *low : *high;
+        const int decision = decide(table_row(block_p, pairs[i].p_idx), table_row(block_q, pairs[i].q_idx), r);
+        if (decision >= 0) {
+            results[i] = static_cast<uint8_t>(decision);
+        } else {
+            undecided_.push_back(i);
+        }
+    }
+
+    // 第二阶段：剩余点对按坐标块排序后做完整计算
+    full_calculations_ += static_cast<long long>(undecided_.size());
+    order_by_blocks(pairs, undecided_, coord_cache_);
+    low_id = SIZE_MAX;
+    high_id = SIZE_MAX;
+    for (uint32_t i : undecided_) {
+        const size_t a = block_of(pairs[i].p_idx);
+        const size_t b = block_of(pairs[i].q_idx);
+        load(coord_cache_, a, b);
+        const BlockCache::Block& block_p = a == low_id ? *low : *high;
+        const BlockCache::Block& block_q = b == low_id ? *low : *high;
+        results[i] = is_distance_exceeding_early_exit(point(block_p, pairs[i].p_idx), point(block_q, pairs[i].q_idx), r)
+                         ? 1
+                         : 0;
+    }
+}
+
+OutOfCoreStats OutOfCoreIndex::stats() const {
+    OutOfCoreStats stats;
+    stats.queries = queries_;
+    stats.full_calculations = full_calculations_;
+    stats.table_hits = table_cache_.hits();
+    stats.table_misses = table_cache_.misses();
+    stats.table_bytes_read = table_cache_.bytes_read();
+    stats.coord_hits = coord_cache_.hits();
+    stats.coord_misses = coord_cache_.misses();
+    stats.coord_bytes_read = coord_cache_.bytes_read();
+    return stats;
+}
+
+void OutOfCoreIndex::reset_stats() {
+    queries_ = 0;
+    full_calculations_ = 0;
+    table_cache_.reset_stats();
+    coord_cache_.reset_stats();
+}
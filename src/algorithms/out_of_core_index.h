@@ -0,0 +1,125 @@
+#pragma once
+#include "../core/block_cache.h"
+#include "../core/dataset.h"
+#include "../core/pivot_selection.h"
+#include "pivot_distance_table.h"
+#include "pruning_algorithm.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 磁盘分块执行 (数据集和距离表都放不进内存时使用) 的构建参数
+struct OutOfCoreOptions {
+    int k = 64;
+    PivotSelection selection = PivotSelection::KMeans;
+    int max_iterations = 20;
+    uint64_t seed = 42;
+    size_t sample_points = 100000; // pivot 在多少个随机点上选取
+    size_t block_points = 4096;    // 每块的点数 (坐标块与距离表块一一对应)
+    PivotTableEncoding encoding = PivotTableEncoding::UInt8;
+};
+
+// 一段查询的 I/O 与剪枝统计
+struct OutOfCoreStats {
+    long long queries = 0;
+    long long full_calculations = 0;
+    long long table_hits = 0;
+    long long table_misses = 0;
+    uint64_t table_bytes_read = 0;
+    long long coord_hits = 0;
+    long long coord_misses = 0;
+    uint64_t coord_bytes_read = 0;
+
+    [[nodiscard]] double bytes_per_query() const {
+        return queries > 0 ? static_cast<double>(table_bytes_read + coord_bytes_read) / static_cast<double>(queries) : 0.0;
+    }
+    [[nodiscard]] double table_hit_rate() const {
+        const long long total = table_hits + table_misses;
+        return total > 0 ? static_cast<double>(table_hits) / static_cast<double>(total) : 0.0;
+    }
+    [[nodiscard]] double coord_hit_rate() const {
+        const long long total = coord_hits + coord_misses;
+        return total > 0 ? static_cast<double>(coord_hits) / static_cast<double>(total) : 0.0;
+    }
+};
+
+// 磁盘分块的多 pivot 剪枝：坐标留在 nodes.bin 中 (二进制格式本身就是按行连续存放，按 block_points 行切成定长块)，
+// 每个点到 k 个 pivot 的距离表按同样的分块写入另一个文件，每块是一张独立的 PivotDistanceTable 映像。
+// 常驻内存的只有 k 个 pivot 和两个有界的 LRU 块缓存 (见 block_cache.h)：
+//  - 剪枝只读距离表块，不读坐标；表默认用 8 位量化编码，每个点 k 字节，远小于坐标
+//  - 只有上下界无法判定的点对才读取坐标块做提前退出的完整计算
+// 批量查询先把点对按 (较小块号, 较大块号) 排序，对即将用到的块按升序发出预读提示，
+// 再依次处理，使每个块只在连续的一段点对中被用到、读盘接近顺序读。
+// 结果与在内存中对同一组 pivot 做多 pivot 剪枝相同 (压缩编码的界是可证明的)。
+// 查询不是线程安全的：并发查询时每个线程打开自己的 OutOfCoreIndex (文件只读，可以共享)
+class OutOfCoreIndex {
+public:
+    // 由 nodes.bin 构建分块距离表并写入 table_path：先按 seed 均匀抽取 sample_points 个点选取 pivot，
+    // 再逐块顺序读取坐标、计算该块的距离表并写出，内存中同时只保留一个坐标块。
+    // 文件无法读写或 nodes.bin 格式有误时打印错误并返回 false
+    static bool build(const std::string& nodes_path, const std::string& table_path, const OutOfCoreOptions& options);
+
+    // 打开 nodes.bin 与 build 写出的距离表 (两者的点数和维度必须一致)；两个缓存的容量分别为
+    // table_cache_bytes 和 coord_cache_bytes (各至少两个块)
+    bool open(const std::string& nodes_path, const std::string& table_path, size_t table_cache_bytes,
+              size_t coord_cache_bytes);
+
+    // 语义同 PruningAlgorithm 的点对查询 (true 表示 d(p, q) > r)
+    bool query_distance_exceeds(int p_idx, int q_idx, double r);
+    void query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results);
+
+    [[nodiscard]] size_t size() const { return num_points_; }
+    [[nodiscard]] size_t dimensions() const { return dims_; }
+    [[nodiscard]] size_t block_points() const { return block_points_; }
+    [[nodiscard]] int k() const { return static_cast<int>(pivots_.size()); }
+    [[nodiscard]] PivotTableEncoding encoding() const { return encoding_; }
+    // 常驻内存的 pivot
+    [[nodiscard]] const Dataset& pivots() const { return pivots_; }
+
+    [[nodiscard]] OutOfCoreStats stats() const;
+    void reset_stats();
+
+private:
+    // 距离表块映像中第 idx 个点的一行及其 scale / slack (布局见 PivotDistanceTable::write_image)
+    struct TableRow {
+        const unsigned char* data;
+        double scale;
+        double slack;
+    };
+    [[nodiscard]] TableRow table_row(const BlockCache::Block& block, int idx) const {
+        const size_t row = static_cast<size_t>(idx) % block_points_;
+        const auto* scales = reinterpret_cast<const double*>(block.data() + block_points_ * row_bytes_);
+        return {block.data() + row * row_bytes_, scales[row], scales[block_points_ + row]};
+    }
+    [[nodiscard]] int decide(const TableRow& p, const TableRow& q, double r) const {
+        const double slack = p.slack + q.slack;
+        return scan_(p.data, q.data, pivots_.size(), p.scale, q.scale, r + slack, r - slack);
+    }
+    [[nodiscard]] PointView point(const BlockCache::Block& block, int idx) const {
+        return {reinterpret_cast<const double*>(block.data()) + (static_cast<size_t>(idx) % block_points_) * stride_,
+                dims_};
+    }
+    [[nodiscard]] size_t block_of(int idx) const { return static_cast<size_t>(idx) / block_points_; }
+    // 把 indices 中的点对按 (较小块号, 较大块号) 排序，并按升序预读涉及的块 (keys_ 须已有 count 个元素)
+    void order_by_blocks(const QueryPair* pairs, std::vector<uint32_t>& indices, BlockCache& cache);
+
+    size_t num_points_ = 0;
+    size_t dims_ = 0;
+    size_t stride_ = 0;
+    size_t block_points_ = 0;
+    size_t row_bytes_ = 0; // 距离表的行
+    PivotTableEncoding encoding_ = PivotTableEncoding::UInt8;
+    PivotDistanceTable::ScanFn scan_ = nullptr;
+    Dataset pivots_;
+    BlockCache table_cache_;
+    BlockCache coord_cache_;
+    long long queries_ = 0;
+    long long full_calculations_ = 0;
+    // 批量查询的缓冲区 (复用容量)
+    std::vector<uint32_t> pending_;
+    std::vector<uint32_t> undecided_;
+    std::vector<uint64_t> keys_;
+    std::vector<size_t> blocks_;
+};
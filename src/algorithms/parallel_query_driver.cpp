@@ -0,0 +1,22 @@
+#include "parallel_query_driver.h"
+#include "../core/work_stealing.h"
+#include <algorithm>
+#include <chrono>
+
+ParallelQueryDriver::ParallelQueryDriver(int num_threads, size_t chunk_size)
+    : num_threads_(std::max(1, num_threads)), chunk_size_(std::max<size_t>(1, chunk_size)) {}
+
+ParallelQueryDriver::RunResult ParallelQueryDriver::run(PruningAlgorithm& algorithm, const std::vector<QueryPair>& pairs,
+                                                        double r, std::vector<uint8_t>& results) const {
+    results.resize(pairs.size());
+    auto start = std::chrono::steady_clock::now();
+    parallel_for_work_stealing(pairs.size(), num_threads_, chunk_size_, [&](size_t begin, size_t end, int) {
+        algorithm.query_distance_exceeds_batch(pairs.data() + begin, end - begin, r, results.data() + begin);
+    });
+    auto end = std::chrono::steady_clock::now();
+
+    RunResult result;
+    result.elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    result.queries_per_second = result.elapsed_ms > 0.0 ? pairs.size() / (result.elapsed_ms / 1000.0) : 0.0;
+    return result;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "pruning_algorithm.h"
+#include <vector>
+
+// 多线程查询驱动：把一批点对切成小块，由 num_threads 个线程通过
+// query_distance_exceeds_batch 并行执行，线程之间以工作窃取的方式平衡负载。
+class ParallelQueryDriver {
+public:
+    explicit ParallelQueryDriver(int num_threads, size_t chunk_size = 1024);
+
+    struct RunResult {
+        double elapsed_ms = 0.0;
+        double queries_per_second = 0.0;
+    };
+
+    // results 会被调整为 pairs.size()，results[i] = 1 表示 pairs[i] 的距离 > r
+    RunResult run(PruningAlgorithm& algorithm, const std::vector<QueryPair>& pairs, double r,
+                  std::vector<uint8_t>& results) const;
+
+    [[nodiscard]] int num_threads() const { return num_threads_; }
+
+private:
+    int num_threads_;
+    size_t chunk_size_;
+};
@@ -0,0 +1,464 @@
+#include "pivot_distance_table.h"
+#include "../core/distance_kernels.h"
+#include "../core/work_stealing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 用 float 计算上下界时，舍入误差相对于该行最大距离的上界 (留有充足余量)
+constexpr double kFloatArithmeticSlack = 1.0 / (1 << 20);
+
+template <typename T>
+struct ScanAccumulator { using type = float; };
+template <>
+struct ScanAccumulator<double> { using type = double; };
+
+// 融合扫描的标量/可移植版本。块内逐通道 max/min、每块结束时归约一次并检查两个阈值；
+// 没有 AVX2 时使用
+template <typename T>
+int scan_impl(const unsigned char* pa, const unsigned char* pb, size_t k,
+                                                    double scale_a, double scale_b,
+                                                    double lb_threshold, double ub_threshold) {
+    using Acc = typename ScanAccumulator<T>::type;
+    constexpr size_t kLanes = 64 / sizeof(Acc);
+    constexpr size_t kBlock = 2 * kLanes;
+
+    const T* a = reinterpret_cast<const T*>(pa);
+    const T* b = reinterpret_cast<const T*>(pb);
+    const Acc sa = static_cast<Acc>(scale_a);
+    const Acc sb = static_cast<Acc>(scale_b);
+
+    Acc lb[kLanes];
+    Acc ub[kLanes];
+    for (size_t l = 0; l < kLanes; ++l) {
+        lb[l] = 0;
+        ub[l] = std::numeric_limits<Acc>::max();
+    }
+
+    size_t j = 0;
+    for (; j + kBlock <= k; j += kBlock) {
+        for (size_t t = 0; t < kBlock; t += kLanes) {
+            for (size_t l = 0; l < kLanes; ++l) {
+                const Acc x = static_cast<Acc>(a[j + t + l]) * sa;
+                const Acc y = static_cast<Acc>(b[j + t + l]) * sb;
+                const Acc diff = x > y ? x - y : y - x;
+                const Acc sum = x + y;
+                lb[l] = diff > lb[l] ? diff : lb[l];
+                ub[l] = sum < ub[l] ? sum : ub[l];
+            }
+        }
+        Acc max_lb = lb[0];
+        Acc min_ub = ub[0];
+        for (size_t l = 1; l < kLanes; ++l) {
+            max_lb = lb[l] > max_lb ? lb[l] : max_lb;
+            min_ub = ub[l] < min_ub ? ub[l] : min_ub;
+        }
+        if (max_lb > lb_threshold) return 1;
+        if (min_ub <= ub_threshold) return 0;
+    }
+
+    Acc max_lb = lb[0];
+    Acc min_ub = ub[0];
+    for (size_t l = 1; l < kLanes; ++l) {
+        max_lb = lb[l] > max_lb ? lb[l] : max_lb;
+        min_ub = ub[l] < min_ub ? ub[l] : min_ub;
+    }
+    for (; j < k; ++j) {
+        const Acc x = static_cast<Acc>(a[j]) * sa;
+        const Acc y = static_cast<Acc>(b[j]) * sb;
+        const Acc diff = x > y ? x - y : y - x;
+        max_lb = diff > max_lb ? diff : max_lb;
+        min_ub = x + y < min_ub ? x + y : min_ub;
+    }
+    if (max_lb > lb_threshold) return 1;
+    if (min_ub <= ub_threshold) return 0;
+    return -1;
+}
+
+template <typename T>
+int scan_default(const unsigned char* a, const unsigned char* b, size_t k, double sa, double sb, double lo, double hi) {
+    return scan_impl<T>(a, b, k, sa, sb, lo, hi);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// ---------------------------------------------------------------
+//  显式 SIMD 版本：按元素类型加载并转换为 float (double 表保持 double)，
+//  每个向量同时更新 max|x-y| 与 min(x+y)，每块 (2 个向量) 归约检查一次
+// ---------------------------------------------------------------
+#define PRUNING_AVX2 __attribute__((target("avx2,fma"), always_inline)) inline
+#define PRUNING_AVX512 __attribute__((target("avx512f"), always_inline)) inline
+
+// AVX2：float 类编码每次 8 个元素，double 每次 4 个
+PRUNING_AVX2 __m256 avx2_load(const float* p) { return _mm256_loadu_ps(p); }
+PRUNING_AVX2 __m256 avx2_load(const uint16_t* p) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+}
+PRUNING_AVX2 __m256 avx2_load(const uint8_t* p) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));
+}
+PRUNING_AVX2 __m256d avx2_load(const double* p) { return _mm256_loadu_pd(p); }
+PRUNING_AVX2 __m256 avx2_set1(float v) { return _mm256_set1_ps(v); }
+PRUNING_AVX2 __m256d avx2_set1(double v) { return _mm256_set1_pd(v); }
+PRUNING_AVX2 void avx2_update(__m256 x, __m256 y, __m256& lb, __m256& ub) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    lb = _mm256_max_ps(lb, _mm256_and_ps(_mm256_sub_ps(x, y), abs_mask));
+    ub = _mm256_min_ps(ub, _mm256_add_ps(x, y));
+}
+PRUNING_AVX2 void avx2_update(__m256d x, __m256d y, __m256d& lb, __m256d& ub) {
+    const __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    lb = _mm256_max_pd(lb, _mm256_and_pd(_mm256_sub_pd(x, y), abs_mask));
+    ub = _mm256_min_pd(ub, _mm256_add_pd(x, y));
+}
+PRUNING_AVX2 __m256 avx2_mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+PRUNING_AVX2 __m256d avx2_mul(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+PRUNING_AVX2 void avx2_reduce(__m256 lb, __m256 ub, float& max_lb, float& min_ub) {
+    alignas(32) float l[8], u[8];
+    _mm256_store_ps(l, lb);
+    _mm256_store_ps(u, ub);
+    max_lb = *std::max_element(l, l + 8);
+    min_ub = *std::min_element(u, u + 8);
+}
+PRUNING_AVX2 void avx2_reduce(__m256d lb, __m256d ub, double& max_lb, double& min_ub) {
+    alignas(32) double l[4], u[4];
+    _mm256_store_pd(l, lb);
+    _mm256_store_pd(u, ub);
+    max_lb = *std::max_element(l, l + 4);
+    min_ub = *std::min_element(u, u + 4);
+}
+
+template <typename T>
+__attribute__((target("avx2,fma")))
+int scan_avx2(const unsigned char* pa, const unsigned char* pb, size_t k, double scale_a, double scale_b,
+              double lb_threshold, double ub_threshold) {
+    using Acc = typename ScanAccumulator<T>::type;
+    constexpr size_t kWidth = 32 / sizeof(Acc);
+    const T* a = reinterpret_cast<const T*>(pa);
+    const T* b = reinterpret_cast<const T*>(pb);
+    const auto sa = avx2_set1(static_cast<Acc>(scale_a));
+    const auto sb = avx2_set1(static_cast<Acc>(scale_b));
+    auto lb = avx2_set1(static_cast<Acc>(0));
+    auto ub = avx2_set1(std::numeric_limits<Acc>::max());
+    Acc max_lb = 0;
+    Acc min_ub = std::numeric_limits<Acc>::max();
+    size_t j = 0;
+    for (; j + 4 * kWidth <= k; j += 4 * kWidth) {
+        for (size_t t = 0; t < 4 * kWidth; t += kWidth) {
+            avx2_update(avx2_mul(avx2_load(a + j + t), sa), avx2_mul(avx2_load(b + j + t), sb), lb, ub);
+        }
+        avx2_reduce(lb, ub, max_lb, min_ub);
+        if (max_lb > lb_threshold) return 1;
+        if (min_ub <= ub_threshold) return 0;
+    }
+    avx2_reduce(lb, ub, max_lb, min_ub);
+    for (; j < k; ++j) {
+        const Acc x = static_cast<Acc>(a[j]) * static_cast<Acc>(scale_a);
+        const Acc y = static_cast<Acc>(b[j]) * static_cast<Acc>(scale_b);
+        max_lb = std::max(max_lb, x > y ? x - y : y - x);
+        min_ub = std::min(min_ub, x + y);
+    }
+    if (max_lb > lb_threshold) return 1;
+    if (min_ub <= ub_threshold) return 0;
+    return -1;
+}
+
+// AVX-512：float 类编码每次 16 个元素，double 每次 8 个
+PRUNING_AVX512 __m512 avx512_load(const float* p) { return _mm512_loadu_ps(p); }
+PRUNING_AVX512 __m512 avx512_load(const uint16_t* p) {
+    return _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+}
+PRUNING_AVX512 __m512 avx512_load(const uint8_t* p) {
+    return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+}
+PRUNING_AVX512 __m512d avx512_load(const double* p) { return _mm512_loadu_pd(p); }
+PRUNING_AVX512 __m512 avx512_set1(float v) { return _mm512_set1_ps(v); }
+PRUNING_AVX512 __m512d avx512_set1(double v) { return _mm512_set1_pd(v); }
+PRUNING_AVX512 void avx512_update(__m512 x, __m512 y, __m512& lb, __m512& ub) {
+    lb = _mm512_max_ps(lb, _mm512_abs_ps(_mm512_sub_ps(x, y)));
+    ub = _mm512_min_ps(ub, _mm512_add_ps(x, y));
+}
+PRUNING_AVX512 void avx512_update(__m512d x, __m512d y, __m512d& lb, __m512d& ub) {
+    lb = _mm512_max_pd(lb, _mm512_abs_pd(_mm512_sub_pd(x, y)));
+    ub = _mm512_min_pd(ub, _mm512_add_pd(x, y));
+}
+PRUNING_AVX512 __m512 avx512_mul(__m512 a, __m512 b) { return _mm512_mul_ps(a, b); }
+PRUNING_AVX512 __m512d avx512_mul(__m512d a, __m512d b) { return _mm512_mul_pd(a, b); }
+PRUNING_AVX512 void avx512_reduce(__m512 lb, __m512 ub, float& max_lb, float& min_ub) {
+    max_lb = _mm512_reduce_max_ps(lb);
+    min_ub = _mm512_reduce_min_ps(ub);
+}
+PRUNING_AVX512 void avx512_reduce(__m512d lb, __m512d ub, double& max_lb, double& min_ub) {
+    max_lb = _mm512_reduce_max_pd(lb);
+    min_ub = _mm512_reduce_min_pd(ub);
+}
+
+template <typename T>
+__attribute__((target("avx512f")))
+int scan_avx512(const unsigned char* pa, const unsigned char* pb, size_t k, double scale_a, double scale_b,
+                double lb_threshold, double ub_threshold) {
+    using Acc = typename ScanAccumulator<T>::type;
+    constexpr size_t kWidth = 64 / sizeof(Acc);
+    const T* a = reinterpret_cast<const T*>(pa);
+    const T* b = reinterpret_cast<const T*>(pb);
+    const auto sa = avx512_set1(static_cast<Acc>(scale_a));
+    const auto sb = avx512_set1(static_cast<Acc>(scale_b));
+    auto lb = avx512_set1(static_cast<Acc>(0));
+    auto ub = avx512_set1(std::numeric_limits<Acc>::max());
+    Acc max_lb = 0;
+    Acc min_ub = std::numeric_limits<Acc>::max();
+    size_t j = 0;
+    for (; j + 2 * kWidth <= k; j += 2 * kWidth) {
+        avx512_update(avx512_mul(avx512_load(a + j), sa), avx512_mul(avx512_load(b + j), sb), lb, ub);
+        avx512_update(avx512_mul(avx512_load(a + j + kWidth), sa), avx512_mul(avx512_load(b + j + kWidth), sb), lb, ub);
+        avx512_reduce(lb, ub, max_lb, min_ub);
+        if (max_lb > lb_threshold) return 1;
+        if (min_ub <= ub_threshold) return 0;
+    }
+    avx512_reduce(lb, ub, max_lb, min_ub);
+    for (; j < k; ++j) {
+        const Acc x = static_cast<Acc>(a[j]) * static_cast<Acc>(scale_a);
+        const Acc y = static_cast<Acc>(b[j]) * static_cast<Acc>(scale_b);
+        max_lb = std::max(max_lb, x > y ? x - y : y - x);
+        min_ub = std::min(min_ub, x + y);
+    }
+    if (max_lb > lb_threshold) return 1;
+    if (min_ub <= ub_threshold) return 0;
+    return -1;
+}
+
+#undef PRUNING_AVX2
+#undef PRUNING_AVX512
+#endif
+
+// 查询点一侧为精确 double 距离、另一侧为编码行的扫描 (范围查询用，每 16 个 pivot 检查一次)
+template <typename T>
+int scan_query(const double* q, const unsigned char* row, size_t k, double scale, double lb_threshold,
+               double ub_threshold) {
+    constexpr size_t kBlock = 16;
+    const T* a = reinterpret_cast<const T*>(row);
+    double max_lb = 0.0;
+    double min_ub = std::numeric_limits<double>::max();
+    for (size_t j = 0; j < k;) {
+        const size_t end = std::min(k, j + kBlock);
+        for (; j < end; ++j) {
+            const double x = static_cast<double>(a[j]) * scale;
+            max_lb = std::max(max_lb, std::abs(x - q[j]));
+            min_ub = std::min(min_ub, x + q[j]);
+        }
+        if (max_lb > lb_threshold) return 1;
+        if (min_ub <= ub_threshold) return 0;
+    }
+    return -1;
+}
+
+// 不提前退出的完整扫描：返回 max|x - y| 与 min(x + y) (多半径查询用，一次扫描得到的界对所有半径有效)
+template <typename T>
+void scan_bounds(const unsigned char* pa, const unsigned char* pb, size_t k, double scale_a, double scale_b,
+                 double& max_lb, double& min_ub) {
+    const T* a = reinterpret_cast<const T*>(pa);
+    const T* b = reinterpret_cast<const T*>(pb);
+    max_lb = 0.0;
+    min_ub = std::numeric_limits<double>::max();
+    for (size_t j = 0; j < k; ++j) {
+        const double x = static_cast<double>(a[j]) * scale_a;
+        const double y = static_cast<double>(b[j]) * scale_b;
+        max_lb = std::max(max_lb, std::abs(x - y));
+        min_ub = std::min(min_ub, x + y);
+    }
+}
+
+template <typename T>
+PivotDistanceTable::ScanFn select_scan() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (g_distance_kernels.level == SimdLevel::AVX512) return scan_avx512<T>;
+    if (g_distance_kernels.level >= SimdLevel::AVX2) return scan_avx2<T>;
+#endif
+    return scan_default<T>;
+}
+
+size_t element_size(PivotTableEncoding encoding) {
+    switch (encoding) {
+        case PivotTableEncoding::Float64: return sizeof(double);
+        case PivotTableEncoding::Float32: return sizeof(float);
+        case PivotTableEncoding::UInt16: return sizeof(uint16_t);
+        case PivotTableEncoding::UInt8: return sizeof(uint8_t);
+    }
+    return sizeof(double);
+}
+
+template <typename Q>
+void quantize_row(const double* dists, size_t k, Q* out, double& scale, double& slack) {
+    constexpr double kLevels = static_cast<double>(std::numeric_limits<Q>::max());
+    double row_max = 0.0;
+    for (size_t j = 0; j < k; ++j) row_max = std::max(row_max, dists[j]);
+    scale = row_max > 0.0 ? row_max / kLevels : 0.0;
+    for (size_t j = 0; j < k; ++j) {
+        double q = scale > 0.0 ? std::nearbyint(dists[j] / scale) : 0.0;
+        out[j] = static_cast<Q>(std::min(std::max(q, 0.0), kLevels));
+    }
+    // 四舍五入的量化误差不超过 scale / 2
+    slack = 0.5 * scale + row_max * kFloatArithmeticSlack;
+}
+
+} // namespace
+
+const char* pivot_table_encoding_name(PivotTableEncoding encoding) {
+    switch (encoding) {
+        case PivotTableEncoding::Float64: return "float64";
+        case PivotTableEncoding::Float32: return "float32";
+        case PivotTableEncoding::UInt16: return "uint16";
+        case PivotTableEncoding::UInt8: return "uint8";
+    }
+    return "unknown";
+}
+
+void PivotDistanceTable::init_layout(size_t num_rows, size_t k, PivotTableEncoding encoding) {
+    num_rows_ = num_rows;
+    k_ = k;
+    encoding_ = encoding;
+    // 每行补齐到 64 字节，使每行都从缓存行起始处开始
+    row_bytes_ = row_bytes_for(k, encoding);
+    scan_ = scan_for(encoding);
+}
+
+void PivotDistanceTable::build(size_t num_rows, size_t k, PivotTableEncoding encoding,
+                               const std::function<void(size_t row, double* out)>& fill_row) {
+    init_layout(num_rows, k, encoding);
+    data_.assign(num_rows * row_bytes_, 0);
+    scale_.assign(num_rows, 1.0);
+    slack_.assign(num_rows, 0.0);
+
+    parallel_for_work_stealing(num_rows, hardware_thread_count(), 64, [&](size_t begin, size_t end, int) {
+        std::vector<double> dists(k);
+        for (size_t row = begin; row < end; ++row) {
+            fill_row(row, dists.data());
+            store_row(row, dists.data());
+        }
+    });
+}
+
+void PivotDistanceTable::append_row(const double* dists) {
+    data_.resize((num_rows_ + 1) * row_bytes_, 0);
+    scale_.push_back(1.0);
+    slack_.push_back(0.0);
+    store_row(num_rows_++, dists);
+}
+
+void PivotDistanceTable::store_row(size_t row, const double* dists) {
+    unsigned char* out = data_.mutable_data() + row * row_bytes_;
+    double& scale = scale_.mutable_data()[row];
+    double& slack = slack_.mutable_data()[row];
+    switch (encoding_) {
+        case PivotTableEncoding::Float64:
+            std::memcpy(out, dists, k_ * sizeof(double));
+            break;
+        case PivotTableEncoding::Float32: {
+            auto* f = reinterpret_cast<float*>(out);
+            double row_max = 0.0;
+            for (size_t j = 0; j < k_; ++j) {
+                f[j] = static_cast<float>(dists[j]);
+                row_max = std::max(row_max, dists[j]);
+            }
+            // 转换为 float 的相对误差不超过 2^-24，已被 kFloatArithmeticSlack 覆盖
+            slack = row_max * kFloatArithmeticSlack;
+            break;
+        }
+        case PivotTableEncoding::UInt16:
+            quantize_row(dists, k_, reinterpret_cast<uint16_t*>(out), scale, slack);
+            break;
+        case PivotTableEncoding::UInt8:
+            quantize_row(dists, k_, reinterpret_cast<uint8_t*>(out), scale, slack);
+            break;
+    }
+}
+
+int PivotDistanceTable::decide_query(const double* query_dists, size_t row, double r) const {
+    const double slack = slack_[row];
+    const unsigned char* p = row_data(row);
+    switch (encoding_) {
+        case PivotTableEncoding::Float64: return scan_query<double>(query_dists, p, k_, scale_[row], r + slack, r - slack);
+        case PivotTableEncoding::Float32: return scan_query<float>(query_dists, p, k_, scale_[row], r + slack, r - slack);
+        case PivotTableEncoding::UInt16: return scan_query<uint16_t>(query_dists, p, k_, scale_[row], r + slack, r - slack);
+        case PivotTableEncoding::UInt8: return scan_query<uint8_t>(query_dists, p, k_, scale_[row], r + slack, r - slack);
+    }
+    return -1;
+}
+
+void PivotDistanceTable::bounds(size_t p_row, size_t q_row, double& lower, double& upper) const {
+    const unsigned char* a = row_data(p_row);
+    const unsigned char* b = row_data(q_row);
+    const double sa = scale_[p_row];
+    const double sb = scale_[q_row];
+    double max_lb = 0.0;
+    double min_ub = std::numeric_limits<double>::max();
+    switch (encoding_) {
+        case PivotTableEncoding::Float64: scan_bounds<double>(a, b, k_, sa, sb, max_lb, min_ub); break;
+        case PivotTableEncoding::Float32: scan_bounds<float>(a, b, k_, sa, sb, max_lb, min_ub); break;
+        case PivotTableEncoding::UInt16: scan_bounds<uint16_t>(a, b, k_, sa, sb, max_lb, min_ub); break;
+        case PivotTableEncoding::UInt8: scan_bounds<uint8_t>(a, b, k_, sa, sb, max_lb, min_ub); break;
+    }
+    const double slack = slack_[p_row] + slack_[q_row];
+    lower = max_lb - slack;
+    upper = min_ub + slack;
+}
+
+double PivotDistanceTable::value(size_t row, size_t j) const {
+    const unsigned char* p = row_data(row);
+    switch (encoding_) {
+        case PivotTableEncoding::Float64: return reinterpret_cast<const double*>(p)[j];
+        case PivotTableEncoding::Float32: return reinterpret_cast<const float*>(p)[j];
+        case PivotTableEncoding::UInt16: return reinterpret_cast<const uint16_t*>(p)[j] * scale_[row];
+        case PivotTableEncoding::UInt8: return reinterpret_cast<const uint8_t*>(p)[j] * scale_[row];
+    }
+    return 0.0;
+}
+
+size_t PivotDistanceTable::memory_bytes() const {
+    return data_.size() + scale_.size() * sizeof(double) + slack_.size() * sizeof(double);
+}
+
+size_t PivotDistanceTable::row_bytes_for(size_t k, PivotTableEncoding encoding) {
+    return (k * element_size(encoding) + 63) / 64 * 64;
+}
+
+size_t PivotDistanceTable::image_bytes(size_t num_rows, size_t k, PivotTableEncoding encoding) {
+    return num_rows * (row_bytes_for(k, encoding) + 2 * sizeof(double));
+}
+
+void PivotDistanceTable::write_image(unsigned char* out) const {
+    std::memcpy(out, data_.data(), data_.size());
+    out += data_.size();
+    std::memcpy(out, scale_.data(), scale_.size() * sizeof(double));
+    out += scale_.size() * sizeof(double);
+    std::memcpy(out, slack_.data(), slack_.size() * sizeof(double));
+}
+
+PivotDistanceTable::ScanFn PivotDistanceTable::scan_for(PivotTableEncoding encoding) {
+    switch (encoding) {
+        case PivotTableEncoding::Float64: return select_scan<double>();
+        case PivotTableEncoding::Float32: return select_scan<float>();
+        case PivotTableEncoding::UInt16: return select_scan<uint16_t>();
+        case PivotTableEncoding::UInt8: return select_scan<uint8_t>();
+    }
+    return nullptr;
+}
+
+void PivotDistanceTable::add_sections(IndexFileWriter& writer, uint32_t first_id) const {
+    writer.add_vector(first_id, data_);
+    writer.add_vector(first_id + 1, scale_);
+    writer.add_vector(first_id + 2, slack_);
+}
+
+bool PivotDistanceTable::read_sections(const IndexFileReader& reader, uint32_t first_id, size_t expected_rows,
+                                       size_t expected_k, PivotTableEncoding encoding) {
+    init_layout(expected_rows, expected_k, encoding);
+    return reader.view_vector(first_id, data_, expected_rows * row_bytes_) &&
+           reader.view_vector(first_id + 1, scale_, expected_rows) &&
+           reader.view_vector(first_id + 2, slack_, expected_rows);
+}
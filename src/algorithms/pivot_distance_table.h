@@ -0,0 +1,93 @@
+#pragma once
+#include "../core/aligned_allocator.h"
+#include "../core/index_file.h"
+#include "../core/section_array.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// 距离表的存储编码
+enum class PivotTableEncoding : uint32_t {
+    Float64 = 0, // 原始 double，与未压缩时的判定结果完全一致
+    Float32 = 1, // float，内存减半
+    UInt16 = 2,  // 每行按该行最大距离线性量化到 16 位
+    UInt8 = 3,   // 每行按该行最大距离线性量化到 8 位
+};
+
+const char* pivot_table_encoding_name(PivotTableEncoding encoding);
+
+// 每个点到 k 个 pivot 的距离表：一块连续、按 64 字节对齐的行主序缓冲区。
+//
+// 压缩编码都是“可证明”的：每行记录一个误差上界 slack(row)，保证
+//   |value(row, j) - d(row, pivot_j)| <= slack(row)
+// (已包含量化误差以及用 float 计算上下界时的舍入误差)。判定时把下界减去、
+// 上界加上两行的 slack，因此剪枝结论永远正确，压缩只会让少量点对退回完整计算。
+class PivotDistanceTable {
+public:
+    // 构建 num_rows x k 的表：fill_row(row, out) 写出该行 k 个精确距离 (并行调用)
+    void build(size_t num_rows, size_t k, PivotTableEncoding encoding,
+               const std::function<void(size_t row, double* out)>& fill_row);
+
+    // 在末尾追加一行 (该点到 k 个 pivot 的精确距离)，按表的编码存储
+    void append_row(const double* dists);
+
+    // 一次融合扫描同时维护最紧下界 max|d(p,v)-d(q,v)| 与最紧上界 min(d(p,v)+d(q,v))，
+    // 每处理一块 pivot 就检查一次，任一界能判定就立即返回。
+    // 返回 1 表示已证明 d(p,q) > r，0 表示已证明 d(p,q) <= r，-1 表示无法判定
+    [[nodiscard]] int decide(size_t p_row, size_t q_row, double r) const {
+        const double slack = slack_[p_row] + slack_[q_row];
+        return scan_(row_data(p_row), row_data(q_row), k_, scale_[p_row], scale_[q_row], r + slack, r - slack);
+    }
+
+    // 与 decide 相同，但一侧是查询点到 k 个 pivot 的精确距离 (用于范围查询中不在表里的查询点)
+    [[nodiscard]] int decide_query(const double* query_dists, size_t row, double r) const;
+
+    // 不提前退出，扫描全部 pivot 得到可证明的界 (已计入两行的 slack)：
+    // lower > r 蕴含 d(p,q) > r，upper <= r 蕴含 d(p,q) <= r，与 decide 的判定规则一致
+    void bounds(size_t p_row, size_t q_row, double& lower, double& upper) const;
+
+    // 解码后的近似距离 (误差不超过 slack(row))
+    [[nodiscard]] double value(size_t row, size_t j) const;
+    [[nodiscard]] double slack(size_t row) const { return slack_[row]; }
+
+    [[nodiscard]] size_t rows() const { return num_rows_; }
+    [[nodiscard]] size_t k() const { return k_; }
+    [[nodiscard]] PivotTableEncoding encoding() const { return encoding_; }
+    // 表占用的内存 (字节)
+    [[nodiscard]] size_t memory_bytes() const;
+    [[nodiscard]] const unsigned char* row_data(size_t row) const { return data_.data() + row * row_bytes_; }
+    [[nodiscard]] size_t row_bytes() const { return row_bytes_; }
+
+    // 表的原始字节映像 (用于按块存放在磁盘上的表，见 out_of_core_index.h)：编码后的全部行
+    // (每行 row_bytes_for 字节)，之后依次是 num_rows 个 scale 和 num_rows 个 slack (double)。
+    // 映像可以不经解码直接判定：对两行调用 scan_for(encoding)，阈值同 decide
+    static size_t row_bytes_for(size_t k, PivotTableEncoding encoding);
+    static size_t image_bytes(size_t num_rows, size_t k, PivotTableEncoding encoding);
+    void write_image(unsigned char* out) const;
+
+    // 持久化：占用 first_id 起的连续 3 个节号。read_sections 不拷贝，表直接使用 reader 的文件映射
+    void add_sections(IndexFileWriter& writer, uint32_t first_id) const;
+    bool read_sections(const IndexFileReader& reader, uint32_t first_id, size_t expected_rows, size_t expected_k,
+                       PivotTableEncoding encoding);
+
+    using ScanFn = int (*)(const unsigned char* a, const unsigned char* b, size_t k, double scale_a, double scale_b,
+                           double lb_threshold, double ub_threshold);
+    // 按当前指令集为编码选出的扫描内核 (decide 所用的同一个)
+    static ScanFn scan_for(PivotTableEncoding encoding);
+
+private:
+    void init_layout(size_t num_rows, size_t k, PivotTableEncoding encoding);
+    // 把一行精确距离按编码写入第 row 行，并设置该行的 scale / slack
+    void store_row(size_t row, const double* dists);
+
+    size_t num_rows_ = 0;
+    size_t k_ = 0;
+    size_t row_bytes_ = 0;
+    PivotTableEncoding encoding_ = PivotTableEncoding::Float64;
+    // 从索引文件加载时三者直接指向文件映射 (见 read_sections)，append_row 时才拷贝到自有内存
+    SectionArray<unsigned char, AlignedAllocator<unsigned char, 64>> data_;
+    SectionArray<double> scale_; // 解码：value = stored * scale (浮点编码时为 1)
+    SectionArray<double> slack_; // 每行的误差上界
+    ScanFn scan_ = nullptr;
+};
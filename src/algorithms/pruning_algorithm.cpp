@@ -0,0 +1,125 @@
+#include "pruning_algorithm.h"
+#include "../core/dimension_transform.h"
+#include "../core/distance.h"
+#include "../core/prefetch.h"
+#include <algorithm>
+
+std::vector<uint32_t>& PruningAlgorithm::batch_scratch() {
+    thread_local std::vector<uint32_t> scratch;
+    return scratch;
+}
+
+std::vector<double>& PruningAlgorithm::pivot_distance_scratch() {
+    thread_local std::vector<double> scratch;
+    return scratch;
+}
+
+PruningBreakdown PruningAlgorithm::get_pruning_breakdown() const {
+    PruningBreakdown breakdown;
+    breakdown.prefilter = stats_.prefilter_decisions();
+    breakdown.full_calculations = stats_.full_calculations();
+    breakdown.bucket_dims = g_distance_kernels.exit_block;
+#if PRUNING_INSTRUMENTATION
+    instrumentation_.merge_into(breakdown);
+#endif
+    return breakdown;
+}
+
+double PruningAlgorithm::drift() const {
+    return static_cast<double>(inserted_since_build_ + erased_since_build_) /
+           static_cast<double>(std::max<size_t>(1, built_points_));
+}
+
+#if PRUNING_INSTRUMENTATION
+void PruningAlgorithm::record_dims_touched(PointView p, PointView q, double r, bool early_exit) {
+    const size_t touched = early_exit ? early_exit_dimensions_touched(p, q, r) : p.size();
+    const size_t block = g_distance_kernels.exit_block;
+    instrumentation_.add_dims_touched(touched > 0 ? (touched - 1) / block : 0);
+}
+#endif
+
+size_t PruningAlgorithm::radius_bucket_from_bounds(const Dataset& dataset, int p_idx, int q_idx, double lower,
+                                                   double upper, const std::vector<double>& radii) {
+    // 小于下界的半径一定被超过，不小于上界的半径一定不被超过：答案落在 [first, last]
+    const size_t first = static_cast<size_t>(std::lower_bound(radii.begin(), radii.end(), lower) - radii.begin());
+    const size_t last =
+        static_cast<size_t>(std::lower_bound(radii.begin() + static_cast<std::ptrdiff_t>(first), radii.end(), upper) -
+                            radii.begin());
+    if (first == last) return first;
+
+    // 只需要区分到 radii[last - 1]：部分和一旦超过它，[first, last) 内的半径全部被超过
+    stats_.add_full_calculations(1);
+    const double cap = radii[last - 1];
+    const PointView p = dataset.get_point(p_idx);
+    const PointView q = dataset.get_point(q_idx);
+    record_full_calculation(p, q, cap, true);
+    if (compact_ != nullptr) {
+        const size_t bucket = compact_->decide_bucket(p_idx, q_idx, radii.data(), first, last);
+        if (bucket != CompactPoints::kUndecided) return bucket;
+        stats_.add_exact_fallbacks(1);
+    }
+    const double sum_sq = g_distance_kernels.l2_sq_capped(p.data(), q.data(), p.size(), cap * cap);
+    return static_cast<size_t>(std::partition_point(radii.begin() + static_cast<std::ptrdiff_t>(first),
+                                                    radii.begin() + static_cast<std::ptrdiff_t>(last),
+                                                    [&](double r) { return sum_sq > r * r; }) -
+                               radii.begin());
+}
+
+int PruningAlgorithm::prefilter_decide_range(int p_idx, const QuantizedPrefilter::Code* query_code, int x_idx,
+                                             double r) {
+    if (prefilter_ == nullptr) return -1;
+    int decision = p_idx >= 0 ? prefilter_->decide(p_idx, x_idx, r)
+                              : (query_code != nullptr ? prefilter_->decide(*query_code, x_idx, r) : -1);
+    if (decision >= 0) stats_.add_prefilter_decisions(1);
+    return decision;
+}
+
+const QuantizedPrefilter::Code* PruningAlgorithm::prefilter_code(PointView query) const {
+    if (prefilter_ == nullptr) return nullptr;
+    thread_local QuantizedPrefilter::Code code;
+    prefilter_->encode(query, code);
+    return &code;
+}
+
+const CompactPoints::Query* PruningAlgorithm::compact_code(PointView query) const {
+    if (compact_ == nullptr) return nullptr;
+    thread_local CompactPoints::Query code;
+    return compact_->encode(query, code) ? &code : nullptr;
+}
+
+void PruningAlgorithm::compute_undecided_batch(const Dataset& dataset, const QueryPair* pairs,
+                                               std::vector<uint32_t>& undecided, double r, uint8_t* results) {
+    if (prefilter_ != nullptr) {
+        // 量化码只有 double 的 1/8，这一遍基本在缓存中完成；判定不了的点对原地压缩到前面
+        size_t kept = 0;
+        for (size_t i = 0; i < undecided.size(); ++i) {
+            const QueryPair& pair = pairs[undecided[i]];
+            const int decision = prefilter_->decide(pair.p_idx, pair.q_idx, r);
+            if (decision >= 0) {
+                results[undecided[i]] = static_cast<uint8_t>(decision);
+            } else {
+                undecided[kept++] = undecided[i];
+            }
+        }
+        stats_.add_prefilter_decisions(static_cast<long long>(undecided.size() - kept));
+        undecided.resize(kept);
+    }
+
+    const size_t n = undecided.size();
+    stats_.add_full_calculations(static_cast<long long>(n));
+    for (size_t i = 0; i < n; ++i) {
+        if (i + kPrefetchDistance < n) {
+            const QueryPair& ahead = pairs[undecided[i + kPrefetchDistance]];
+            if (compact_ != nullptr) {
+                prefetch_bytes(compact_->row_data(ahead.p_idx), compact_->row_bytes());
+                prefetch_bytes(compact_->row_data(ahead.q_idx), compact_->row_bytes());
+            } else {
+                prefetch_point(dataset.get_point(ahead.p_idx));
+                prefetch_point(dataset.get_point(ahead.q_idx));
+            }
+        }
+        const QueryPair& pair = pairs[undecided[i]];
+        record_full_calculation(dataset.get_point(pair.p_idx), dataset.get_point(pair.q_idx), r, false);
+        results[undecided[i]] = full_calculation_exceeds(dataset, pair.p_idx, pair.q_idx, r, false) ? 1 : 0;
+    }
+}
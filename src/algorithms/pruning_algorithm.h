@@ -1,6 +1,31 @@
 #pragma once
+#include "../core/compact_points.h"
 #include "../core/dataset.h"
+#include "../core/distance.h"
+#include "instrumentation.h"
+#include "quantized_prefilter.h"
+#include "query_stats.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
 
+// 一次查询的点对 (p_idx, q_idx)
+struct QueryPair {
+    int p_idx;
+    int q_idx;
+};
+
+// 索引占用的内存 (不含数据集本身、预过滤和紧凑副本)，分为与点数无关的部分和每个点的部分，
+// 以便把在样本上构建的索引的内存换算到完整数据集
+struct IndexFootprint {
+    size_t fixed_bytes = 0;     // pivot 坐标、pivot 两两距离等
+    size_t per_point_bytes = 0; // 距离表的一行、所属簇等
+    [[nodiscard]] size_t bytes(size_t num_points) const { return fixed_bytes + per_point_bytes * num_points; }
+};
+
+// 查询接口 (query_distance_exceeds / query_distance_exceeds_batch) 在 build 完成后
+// 可以被多个线程并发调用：查询只读索引数据，统计信息按线程分槽累加。
 class PruningAlgorithm {
 public:
     virtual ~PruningAlgorithm() = default;
@@ -8,14 +33,184 @@ public:
     // 预处理/构建索引的方法
     virtual void build(const Dataset& dataset) = 0;
 
+    // 持久化：save 把 build 得到的索引写入 path；load 从 path 恢复索引以代替 build。
+    // 文件带校验和以及构建时数据集的指纹，文件损坏或 dataset 与构建时不同都会让 load 返回 false
+    virtual bool save(const std::string& path) const = 0;
+    virtual bool load(const std::string& path, const Dataset& dataset) = 0;
+
     // 查询接口：判断 p_idx 和 q_idx 两点的距离是否超过 r
     // 返回 true 表示 dist > r, false 表示 dist <= r
     virtual bool query_distance_exceeds(int p_idx, int q_idx, double r) = 0;
 
-    // 获取统计信息：完整计算的次数
-    [[nodiscard]] long long get_full_calculations_count() const { return full_calculations_count_; }
-    void reset_stats() { full_calculations_count_ = 0; }
+    // 批量查询接口：results[i] = 1 表示 pairs[i] 的距离 > r，0 表示 <= r
+    // 默认实现逐个调用 query_distance_exceeds；子类应重写为
+    // “先对整批做上下界检查，再对剩余点对集中做完整计算”的两阶段实现
+    virtual void query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) {
+        for (size_t i = 0; i < count; ++i) {
+            results[i] = query_distance_exceeds(pairs[i].p_idx, pairs[i].q_idx, r) ? 1 : 0;
+        }
+    }
+
+    // 多半径查询：radii 按升序排列，返回 d(p, q) 超过的半径个数 b，即第一个满足 d <= radii[b] 的下标
+    // (全部超过时为 radii.size())。对每个 i 都有 radii[i] 被超过 <=> i < b，与逐个调用
+    // query_distance_exceeds 的结论一致。上下界只计算一次；只有 [下界, 上界] 跨越多个区间时才计算距离，
+    // 且分块累加到超过仍未判定的最大半径时就提前结束
+    virtual size_t query_radius_bucket(int p_idx, int q_idx, const std::vector<double>& radii) = 0;
+
+    // 范围查询：把所有满足 d(p, x) <= r 的点 x 的下标写入 results (先清空，顺序不保证)。
+    // 调用方在多次查询之间复用同一个 results，容量稳定后查询过程不再分配内存。
+    // 按下标查询时结果不包含 p_idx 本身；按坐标查询时 query 的维度必须与数据集一致
+    virtual void range_query(int p_idx, double r, std::vector<int>& results) = 0;
+    virtual void range_query(PointView query, double r, std::vector<int>& results) = 0;
+
+    // 增量维护 (通常经由 IndexMaintainer 调用)，两者都不能与查询并发执行。
+    // insert_point：build/load 时传入的数据集在末尾追加了点 id (id == dataset.size() - 1) 之后调用，
+    // 把它加入索引而不重建：新点分配给最近的 pivot，它的预计算距离当场算出。
+    // 设置了 prefilter 或紧凑副本时，调用方必须先对它们调用 append。
+    // erase_point：dataset.erase(id) 之后调用；该点不再出现在范围查询结果中，点对查询也不应再使用它
+    virtual void insert_point(int id) = 0;
+    virtual void erase_point(int id) {
+        (void)id;
+        ++erased_since_build_;
+    }
+    // 索引相对构建时的漂移程度，0 表示与刚构建时相同。默认为构建后增删的点数占构建时点数的比例；
+    // 子类可以再叠加剪枝质量的变化。IndexMaintainer 在漂移超过阈值时在后台重建
+    [[nodiscard]] virtual double drift() const;
+
+    // build / load 之后索引的内存占用 (按元素个数计，不含容器预留的容量)；不建索引的算法为 0
+    [[nodiscard]] virtual IndexFootprint index_footprint() const { return {}; }
+
+    // 可选的低精度预过滤阶段 (见 quantized_prefilter.h)：设置后，上下界无法判定的点对先用
+    // 量化距离的可证明上下界判定，仍无法判定的才做完整计算；结果不变。
+    // prefilter 必须基于同一个数据集构建，且生命周期长于本对象；传 nullptr 关闭
+    virtual void set_prefilter(const QuantizedPrefilter* prefilter) { prefilter_ = prefilter; }
+
+    // 可选的紧凑坐标副本 (见 compact_points.h)：设置后点对查询、多半径查询和范围查询的完整计算
+    // 先读取 float32 / float16 坐标，访存量减半或更少；由舍入误差界判定不了的点对再读取 Dataset 精确计算，
+    // 结果不变。
+    // points 必须基于同一个数据集构建，且生命周期长于本对象；传 nullptr 关闭
+    virtual void set_compact_points(const CompactPoints* points) { compact_ = points; }
+
+    // 统计信息相关的函数是虚函数，包装其它算法的装饰器 (如 ReorderedAlgorithm) 把它们转发给内部算法
+    // 获取统计信息：完整计算的次数 (合并所有线程的计数)
+    [[nodiscard]] virtual long long get_full_calculations_count() const { return stats_.full_calculations(); }
+    // 由预过滤判定、因而省去的完整计算次数
+    [[nodiscard]] virtual long long get_prefilter_decisions_count() const { return stats_.prefilter_decisions(); }
+    // 设置了紧凑副本时，其误差界无法判定、改为读取 double 坐标的完整计算次数
+    [[nodiscard]] virtual long long get_exact_fallbacks_count() const { return stats_.exact_fallbacks(); }
+    // 点对查询按判定规则的分项统计 (见 instrumentation.h)，范围查询不计入分项和直方图
+    [[nodiscard]] virtual PruningBreakdown get_pruning_breakdown() const;
+    static constexpr bool kInstrumentationEnabled = PRUNING_INSTRUMENTATION != 0;
+    virtual void reset_stats() {
+        stats_.reset();
+#if PRUNING_INSTRUMENTATION
+        instrumentation_.reset();
+#endif
+    }
 
 protected:
-    long long full_calculations_count_ = 0; // 用于统计剪枝失败、必须进行完整计算的次数
-};
\ No newline at end of file
+    // 批量查询中，第二阶段提前预取多少个点对之后的数据
+    static constexpr size_t kPrefetchDistance = 4;
+
+    // 批量查询第一阶段用来记录“未能判定”的点对下标的缓冲区 (每线程一个，复用容量)
+    static std::vector<uint32_t>& batch_scratch();
+
+    // 范围查询中存放查询点到各 pivot 距离的缓冲区 (每线程一个，复用容量)
+    static std::vector<double>& pivot_distance_scratch();
+
+    // 完整计算之前的预过滤：未设置 prefilter 时返回 -1；否则返回值含义同 QuantizedPrefilter::decide，
+    // 判定成功时计入统计
+    int prefilter_decide(int p_idx, int q_idx, double r) {
+        if (prefilter_ == nullptr) return -1;
+        int decision = prefilter_->decide(p_idx, q_idx, r);
+        if (decision >= 0) stats_.add_prefilter_decisions(1);
+        return decision;
+    }
+
+    // 范围查询的预过滤：p_idx >= 0 时查询点是数据集中的第 p_idx 个点，否则使用 query_code
+    // (由 prefilter_code 生成)。未设置 prefilter 时返回 -1
+    int prefilter_decide_range(int p_idx, const QuantizedPrefilter::Code* query_code, int x_idx, double r);
+    // 把不在数据集中的查询点量化一次 (每线程复用的缓冲区)；未设置 prefilter 时返回 nullptr
+    const QuantizedPrefilter::Code* prefilter_code(PointView query) const;
+
+    // 插桩：点对查询由上下界判定 (lower 个判定为超过，upper 个判定为不超过)；未开启插桩时为空
+    void count_bound_decisions(long long lower, long long upper) {
+#if PRUNING_INSTRUMENTATION
+        instrumentation_.add_bound_decisions(lower, upper);
+#else
+        (void)lower;
+        (void)upper;
+#endif
+    }
+    // 插桩：一次完整计算累加了多少维度。early_exit 为 true 时按分块提前退出的规则模拟，否则为全部维度
+    void record_full_calculation(PointView p, PointView q, double r, bool early_exit) {
+#if PRUNING_INSTRUMENTATION
+        record_dims_touched(p, q, r, early_exit);
+#else
+        (void)p;
+        (void)q;
+        (void)r;
+        (void)early_exit;
+#endif
+    }
+
+    // 点对查询的完整计算：设置了紧凑副本时先由副本判定，判定不了 (或未设置) 时读取 dataset。
+    // early_exit 为 true 时使用分块提前退出的判定 (同 is_distance_exceeding_early_exit)
+    bool full_calculation_exceeds(const Dataset& dataset, int p_idx, int q_idx, double r, bool early_exit) {
+        if (compact_ != nullptr) {
+            const int decision =
+                early_exit ? compact_->decide_early_exit(p_idx, q_idx, r) : compact_->decide(p_idx, q_idx, r);
+            if (decision >= 0) return decision == 1;
+            stats_.add_exact_fallbacks(1);
+        }
+        const PointView p = dataset.get_point(p_idx);
+        const PointView q = dataset.get_point(q_idx);
+        return early_exit ? is_distance_exceeding_early_exit(p, q, r) : euclidean_distance(p, q) > r;
+    }
+
+    // 范围查询的完整计算 (分块提前退出)：p_idx >= 0 时查询点 query 是数据集中的第 p_idx 个点，
+    // 否则使用 compact_query (由 compact_code 生成)。紧凑副本判定不了 (或未设置) 时读取 dataset
+    bool range_calculation_exceeds(const Dataset& dataset, PointView query, int p_idx,
+                                   const CompactPoints::Query* compact_query, int x_idx, double r) {
+        if (compact_ != nullptr) {
+            const int decision = p_idx >= 0 ? compact_->decide_early_exit(p_idx, x_idx, r)
+                                 : compact_query != nullptr ? compact_->decide_early_exit(*compact_query, x_idx, r)
+                                                            : -1;
+            if (decision >= 0) return decision == 1;
+            stats_.add_exact_fallbacks(1);
+        }
+        return is_distance_exceeding_early_exit(query, dataset.get_point(x_idx), r);
+    }
+    // 把不在数据集中的查询点舍入为紧凑行 (每线程复用的缓冲区)；未设置紧凑副本或坐标超出范围时返回 nullptr
+    const CompactPoints::Query* compact_code(PointView query) const;
+
+    // 多半径查询的公共部分：已知 lower (lower > r 蕴含 d > r) 与 upper (upper <= r 蕴含 d <= r) 时
+    // 确定区间下标，必要时对 p、q 做提前退出的完整计算 (计入统计；设置了紧凑副本时先由它判定)
+    size_t radius_bucket_from_bounds(const Dataset& dataset, int p_idx, int q_idx, double lower, double upper,
+                                     const std::vector<double>& radii);
+
+    // 批量查询第二阶段：对 undecided 中列出的点对先做预过滤 (若已设置，判定的点对会从 undecided 中移除)，
+    // 再集中做完整距离计算，计算第 i 个时预取第 i + kPrefetchDistance 个点对的坐标
+    void compute_undecided_batch(const Dataset& dataset, const QueryPair* pairs,
+                                 std::vector<uint32_t>& undecided, double r, uint8_t* results);
+
+    // build / load 完成时调用，清零增删计数
+    void reset_update_counts(size_t built_points) {
+        built_points_ = built_points;
+        inserted_since_build_ = 0;
+        erased_since_build_ = 0;
+    }
+
+    QueryStats stats_; // 用于统计剪枝失败、必须进行完整计算的次数
+    size_t built_points_ = 0;
+    size_t inserted_since_build_ = 0;
+    size_t erased_since_build_ = 0;
+    const QuantizedPrefilter* prefilter_ = nullptr;
+    const CompactPoints* compact_ = nullptr;
+
+private:
+#if PRUNING_INSTRUMENTATION
+    void record_dims_touched(PointView p, PointView q, double r, bool early_exit);
+    InstrumentationStats instrumentation_;
+#endif
+};
@@ -0,0 +1,135 @@
+#include "quantized_prefilter.h"
+#include "../core/distance_kernels.h"
+#include "../core/work_stealing.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kLevels = 127.0;
+// 点积按块累加到 int32：127 * 127 * 65536 < 2^31，不会溢出
+constexpr size_t kDotChunk = 65536;
+// 判定时额外要求的相对余量，保证与 double 精确计算 (其自身也有舍入) 的结论一致
+constexpr double kDecisionMargin = 1e-12;
+
+// always_inline 使它在下面带 target 属性的包装函数中按对应指令集展开 (整数乘加可自动向量化)
+__attribute__((always_inline)) inline int64_t dot_impl(const int8_t* a, const int8_t* b, size_t n) {
+    int64_t total = 0;
+    for (size_t i = 0; i < n; i += kDotChunk) {
+        const size_t end = std::min(n, i + kDotChunk);
+        int32_t acc = 0;
+        for (size_t j = i; j < end; ++j) {
+            acc += static_cast<int32_t>(a[j]) * static_cast<int32_t>(b[j]);
+        }
+        total += acc;
+    }
+    return total;
+}
+
+int64_t dot_default(const int8_t* a, const int8_t* b, size_t n) {
+    return dot_impl(a, b, n);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) int64_t dot_avx2(const int8_t* a, const int8_t* b, size_t n) {
+    return dot_impl(a, b, n);
+}
+#endif
+
+} // namespace
+
+void QuantizedPrefilter::build(const Dataset& dataset, int num_threads) {
+    num_points_ = dataset.size();
+    dims_ = dataset.dimensions();
+    stride_ = (dims_ + 63) / 64 * 64;
+    num_threads = num_threads > 0 ? num_threads : hardware_thread_count();
+#if defined(__x86_64__) || defined(__i386__)
+    dot_ = g_distance_kernels.level >= SimdLevel::AVX2 ? dot_avx2 : dot_default;
+#else
+    dot_ = dot_default;
+#endif
+
+    // 以全局均值为中心量化，缩放因子只需覆盖每个点相对均值的偏移
+    std::vector<std::vector<double>> partial(static_cast<size_t>(num_threads), std::vector<double>(dims_, 0.0));
+    parallel_for_work_stealing(num_points_, num_threads, 1024, [&](size_t begin, size_t end, int thread_id) {
+        std::vector<double>& sum = partial[thread_id];
+        for (size_t i = begin; i < end; ++i) {
+            const PointView p = dataset.get_point(static_cast<int>(i));
+            for (size_t j = 0; j < dims_; ++j) sum[j] += p[j];
+        }
+    });
+    mean_.assign(dims_, 0.0);
+    for (const auto& sum : partial) {
+        for (size_t j = 0; j < dims_; ++j) mean_[j] += sum[j];
+    }
+    for (double& m : mean_) m /= static_cast<double>(std::max<size_t>(1, num_points_));
+
+    codes_.assign(num_points_ * stride_, 0);
+    scale_.assign(num_points_, 0.0);
+    norm_sq_.assign(num_points_, 0);
+    error_.assign(num_points_, 0.0);
+    parallel_for_work_stealing(num_points_, num_threads, 256, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; ++i) {
+            error_[i] = encode_row(dataset.get_point(static_cast<int>(i)).data(), codes_.data() + i * stride_,
+                                   scale_[i], norm_sq_[i]);
+        }
+    });
+}
+
+void QuantizedPrefilter::append(PointView point) {
+    const size_t i = num_points_++;
+    codes_.resize(num_points_ * stride_, 0);
+    scale_.push_back(0.0);
+    norm_sq_.push_back(0);
+    error_.push_back(encode_row(point.data(), codes_.data() + i * stride_, scale_[i], norm_sq_[i]));
+}
+
+double QuantizedPrefilter::encode_row(const double* x, int8_t* out, double& scale, int64_t& norm_sq) const {
+    double max_abs = 0.0;
+    for (size_t j = 0; j < dims_; ++j) max_abs = std::max(max_abs, std::abs(x[j] - mean_[j]));
+    scale = max_abs > 0.0 ? max_abs / kLevels : 0.0;
+
+    double error_sq = 0.0;
+    double magnitude_sq = 0.0;
+    int64_t n = 0;
+    for (size_t j = 0; j < dims_; ++j) {
+        double c = scale > 0.0 ? std::nearbyint((x[j] - mean_[j]) / scale) : 0.0;
+        c = std::min(std::max(c, -kLevels), kLevels);
+        out[j] = static_cast<int8_t>(c);
+        n += static_cast<int64_t>(c) * static_cast<int64_t>(c);
+        const double diff = x[j] - (mean_[j] + scale * c);
+        error_sq += diff * diff;
+        magnitude_sq += x[j] * x[j] + mean_[j] * mean_[j];
+    }
+    norm_sq = n;
+    // 误差本身是用浮点算出来的：加上与维数和向量模长成比例的舍入余量，得到可靠的上界
+    const double rounding = static_cast<double>(dims_ + 4) * 8e-16 *
+                            (std::sqrt(magnitude_sq) + scale * std::sqrt(static_cast<double>(n)));
+    return std::sqrt(error_sq) * (1.0 + 1e-9) + rounding;
+}
+
+void QuantizedPrefilter::encode(PointView point, Code& out) const {
+    out.codes.resize(dims_);
+    out.error = encode_row(point.data(), out.codes.data(), out.scale, out.norm_sq);
+}
+
+int QuantizedPrefilter::decide_codes(const int8_t* a, double scale_a, int64_t norm_a, double error_a, const int8_t* b,
+                                     double scale_b, int64_t norm_b, double error_b, double r) const {
+    const int64_t dot = dot_(a, b, dims_);
+    const double t_a = scale_a * scale_a * static_cast<double>(norm_a);
+    const double t_b = scale_b * scale_b * static_cast<double>(norm_b);
+    // |2 s_a s_b <c_a, c_b>| <= t_a + t_b，因此计算 d̂^2 的舍入误差不超过 (t_a + t_b) 的若干 ulp
+    const double approx_sq = t_a + t_b - 2.0 * scale_a * scale_b * static_cast<double>(dot);
+    const double eps = 1e-15 * (t_a + t_b);
+    const double lower = std::sqrt(std::max(0.0, approx_sq - eps)) * (1.0 - 1e-15);
+    const double upper = std::sqrt(std::max(0.0, approx_sq + eps)) * (1.0 + 1e-15);
+    const double error = error_a + error_b;
+    if (lower - error > r * (1.0 + kDecisionMargin)) return 1;
+    if (upper + error <= r * (1.0 - kDecisionMargin)) return 0;
+    return -1;
+}
+
+size_t QuantizedPrefilter::memory_bytes() const {
+    return codes_.size() + scale_.size() * sizeof(double) + norm_sq_.size() * sizeof(int64_t) +
+           error_.size() * sizeof(double) + mean_.size() * sizeof(double);
+}
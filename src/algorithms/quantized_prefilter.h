@@ -0,0 +1,60 @@
+#pragma once
+#include "../core/aligned_allocator.h"
+#include "../core/dataset.h"
+#include <cstdint>
+#include <vector>
+
+// 可证明正确的低精度预过滤：每个点保存一份 int8 量化副本 (内存为 double 的 1/8)。
+//
+// 编码：x ≈ x̂ = m + s_x * c_x，其中 m 为全局各维均值，s_x 为该点自己的缩放因子，
+// c_x ∈ [-127, 127]^d。构建时精确计算每个点的重建误差 e_x = ||x - x̂||，由三角不等式
+//   d(x̂, ŷ) - e_x - e_y <= d(x, y) <= d(x̂, ŷ) + e_x + e_y
+// 而 d(x̂, ŷ)^2 = s_x^2 |c_x|^2 + s_y^2 |c_y|^2 - 2 s_x s_y <c_x, c_y>，只需一次 int8 点积。
+// 所有浮点舍入误差都计入余量，因此判定结果与精确计算完全一致，无法判定时返回 -1。
+class QuantizedPrefilter {
+public:
+    // 量化后的单个点 (用于不在数据集中的查询点)
+    struct Code {
+        std::vector<int8_t> codes;
+        double scale = 0.0;
+        int64_t norm_sq = 0; // |c|^2
+        double error = 0.0;  // 重建误差的上界
+    };
+
+    void build(const Dataset& dataset, int num_threads = 0);
+    // 追加一个点 (数据集末尾新增的点)：沿用构建时的均值，误差上界照常精确计算，判定依然正确
+    void append(PointView point);
+
+    // 返回 1 表示已证明 d(p, q) > r，0 表示已证明 d(p, q) <= r，-1 表示无法判定
+    [[nodiscard]] int decide(int p_idx, int q_idx, double r) const {
+        return decide_codes(code_data(p_idx), scale_[p_idx], norm_sq_[p_idx], error_[p_idx], code_data(q_idx),
+                            scale_[q_idx], norm_sq_[q_idx], error_[q_idx], r);
+    }
+    // 查询点一侧使用 encode 得到的编码
+    [[nodiscard]] int decide(const Code& query, int q_idx, double r) const {
+        return decide_codes(query.codes.data(), query.scale, query.norm_sq, query.error, code_data(q_idx),
+                            scale_[q_idx], norm_sq_[q_idx], error_[q_idx], r);
+    }
+    // 用与数据集相同的均值量化任意点 (复用 out 的容量)
+    void encode(PointView point, Code& out) const;
+
+    [[nodiscard]] bool empty() const { return num_points_ == 0; }
+    [[nodiscard]] size_t memory_bytes() const;
+    [[nodiscard]] const int8_t* code_data(int idx) const { return codes_.data() + static_cast<size_t>(idx) * stride_; }
+
+private:
+    int decide_codes(const int8_t* a, double scale_a, int64_t norm_a, double error_a, const int8_t* b, double scale_b,
+                     int64_t norm_b, double error_b, double r) const;
+    // 量化一个点并返回重建误差的上界
+    double encode_row(const double* x, int8_t* out, double& scale, int64_t& norm_sq) const;
+
+    size_t num_points_ = 0;
+    size_t dims_ = 0;
+    size_t stride_ = 0; // 每行字节数，补齐到 64
+    std::vector<double> mean_;
+    std::vector<int8_t, AlignedAllocator<int8_t, 64>> codes_;
+    std::vector<double> scale_;
+    std::vector<int64_t> norm_sq_;
+    std::vector<double> error_;
+    int64_t (*dot_)(const int8_t* a, const int8_t* b, size_t n) = nullptr;
+};
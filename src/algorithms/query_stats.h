@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// 线程安全的查询统计：每个线程写入自己的槽位 (独占一个缓存行，避免伪共享)，
+// 读取时再把所有槽位合并。槽位数量固定，线程数超过槽位数时多个线程会共享槽位，
+// 由于计数使用原子加法，此时依然是正确的。
+class QueryStats {
+public:
+    static constexpr size_t kMaxSlots = 128;
+
+    void add_full_calculations(long long n) {
+        slots_[thread_slot()].full_calculations.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void add_prefilter_decisions(long long n) {
+        slots_[thread_slot()].prefilter_decisions.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void add_exact_fallbacks(long long n) {
+        slots_[thread_slot()].exact_fallbacks.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] long long full_calculations() const {
+        long long total = 0;
+        for (const auto& slot : slots_) {
+            total += slot.full_calculations.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    [[nodiscard]] long long prefilter_decisions() const {
+        long long total = 0;
+        for (const auto& slot : slots_) {
+            total += slot.prefilter_decisions.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    [[nodiscard]] long long exact_fallbacks() const {
+        long long total = 0;
+        for (const auto& slot : slots_) {
+            total += slot.exact_fallbacks.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    void reset() {
+        for (auto& slot : slots_) {
+            slot.full_calculations.store(0, std::memory_order_relaxed);
+            slot.prefilter_decisions.store(0, std::memory_order_relaxed);
+            slot.exact_fallbacks.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<long long> full_calculations{0};
+        std::atomic<long long> prefilter_decisions{0}; // 由量化预过滤判定、省去完整计算的次数
+        std::atomic<long long> exact_fallbacks{0};     // 紧凑副本判定不了、读取 double 坐标的完整计算次数
+    };
+
+    // 每个线程第一次使用时分配一个递增编号，之后固定不变
+    static size_t thread_slot() {
+        static std::atomic<size_t> next_id{0};
+        thread_local const size_t slot = next_id.fetch_add(1, std::memory_order_relaxed) % kMaxSlots;
+        return slot;
+    }
+
+    std::array<Slot, kMaxSlots> slots_;
+};
@@ -0,0 +1,238 @@
+#include "reordered_algorithm.h"
+#include "kmeans_triangle_pruning.h"
+#include "../core/index_file.h"
+#include "../core/kmeans.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+constexpr uint32_t kIndexTag = make_index_tag("REOR");
+enum SectionId : uint32_t {
+    kSectionParams = 1, // int64: order
+    kSectionOrder = 2,  // int32: n，重排后第 i 个点的原始下标
+};
+} // namespace
+
+ReorderedAlgorithm::ReorderedAlgorithm(std::unique_ptr<PruningAlgorithm> inner, PointOrder order, int cluster_k,
+                                       uint64_t seed)
+    : inner_(std::move(inner)), order_(order), cluster_k_(cluster_k), seed_(seed) {}
+
+void ReorderedAlgorithm::build(const Dataset& dataset) {
+    const AttachedCopies attached = detach_copies();
+    dataset_ = &dataset;
+    build_reordered(&dataset);
+    reattach_copies(attached);
+}
+
+void ReorderedAlgorithm::build(Dataset&& dataset) {
+    const AttachedCopies attached = detach_copies();
+    dataset_ = nullptr;
+    reordered_ = std::move(dataset);
+    build_reordered(nullptr);
+    reattach_copies(attached);
+}
+
+void ReorderedAlgorithm::build_reordered(const Dataset* source) {
+    // 接管时排列在原地重排之前计算，此时 reordered_ 仍是原顺序
+    const Dataset& dataset = source != nullptr ? *source : reordered_;
+    std::cout << "Reordering points (" << point_order_name(order_) << " order)..." << std::endl;
+    auto* kmeans_inner = dynamic_cast<KMeansTrianglePruning*>(inner_.get());
+    if (order_ == PointOrder::Cluster) {
+        KMeansOptions options;
+        if (kmeans_inner != nullptr) {
+            options = kmeans_inner->kmeans_options();
+        } else {
+            options.k = std::min(cluster_k_, static_cast<int>(dataset.size()));
+            options.seed = seed_;
+        }
+        KMeansResult kmeans = run_kmeans(dataset, options);
+        to_original_ = cluster_order(kmeans);
+        apply_order(source);
+        if (kmeans_inner != nullptr) {
+            // 聚类结果按同一排列搬到内部下标，内部索引不再重新聚类
+            KMeansResult permuted;
+            permuted.centroids = std::move(kmeans.centroids);
+            permuted.iterations = kmeans.iterations;
+            permuted.converged = kmeans.converged;
+            permuted.assignments.resize(to_original_.size());
+            permuted.distances.resize(to_original_.size());
+            for (size_t i = 0; i < to_original_.size(); ++i) {
+                permuted.assignments[i] = kmeans.assignments[to_original_[i]];
+                permuted.distances[i] = kmeans.distances[to_original_[i]];
+            }
+            kmeans_inner->build_from_clustering(reordered_, std::move(permuted));
+            return;
+        }
+    } else if (order_ == PointOrder::Morton) {
+        to_original_ = morton_order(dataset);
+        apply_order(source);
+    } else {
+        to_original_.resize(dataset.size());
+        for (size_t i = 0; i < to_original_.size(); ++i) to_original_[i] = static_cast<int>(i);
+        apply_order(source);
+    }
+    inner_->build(reordered_);
+}
+
+void ReorderedAlgorithm::apply_order(const Dataset* dataset) {
+    to_internal_.assign(to_original_.size(), 0);
+    for (size_t i = 0; i < to_original_.size(); ++i) to_internal_[to_original_[i]] = static_cast<int>(i);
+    if (dataset != nullptr) {
+        reordered_ = permute_points(*dataset, to_original_);
+    } else {
+        reordered_.permute(to_original_);
+    }
+}
+
+bool ReorderedAlgorithm::save(const std::string& path) const {
+    const std::vector<int64_t> params = {static_cast<int64_t>(order_)};
+    // 原顺序的第 i 个点是 reordered_ 的第 to_internal_[i] 个点：不需要原数据集也能算出它的指纹
+    IndexFileWriter writer(kIndexTag, reordered_, to_internal_);
+    writer.add_vector(kSectionParams, params);
+    writer.add_vector(kSectionOrder, to_original_);
+    return writer.write(path) && inner_->save(path + ".inner");
+}
+
+bool ReorderedAlgorithm::load(const std::string& path, const Dataset& dataset) {
+    IndexFileReader reader;
+    if (!reader.open(path, kIndexTag, dataset)) {
+        return false;
+    }
+    std::vector<int64_t> params;
+    if (!reader.read_vector(kSectionParams, params, 1) || params[0] != static_cast<int64_t>(order_)) {
+        std::cerr << "Error: Index file " << path << " was built with a different point order." << std::endl;
+        return false;
+    }
+    if (!reader.read_vector(kSectionOrder, to_original_, dataset.size())) {
+        std::cerr << "Error: Index file " << path << " is missing sections or has unexpected sizes." << std::endl;
+        return false;
+    }
+    std::vector<char> seen(dataset.size(), 0);
+    for (int id : to_original_) {
+        if (id < 0 || static_cast<size_t>(id) >= dataset.size() || seen[id] != 0) {
+            std::cerr << "Error: Index file " << path << " contains an invalid permutation." << std::endl;
+            return false;
+        }
+        seen[id] = 1;
+    }
+    const AttachedCopies attached = detach_copies();
+    dataset_ = &dataset;
+    apply_order(&dataset);
+    if (!inner_->load(path + ".inner", reordered_)) return false;
+    reattach_copies(attached);
+    return true;
+}
+
+void ReorderedAlgorithm::insert_point(int id) {
+    if (dataset_ == nullptr) {
+        throw std::invalid_argument("ReorderedAlgorithm: the dataset was handed over to build, use add_point.");
+    }
+    add_point(dataset_->get_point(id));
+}
+
+int ReorderedAlgorithm::add_point(PointView point) {
+    const int id = static_cast<int>(to_original_.size());
+    const int internal = reordered_.add_point(point);
+    to_original_.push_back(id);
+    to_internal_.push_back(internal);
+    if (!prefilter_.empty()) prefilter_.append(point);
+    if (!compact_points_.empty() && !compact_points_.append(point)) {
+        // 新点超出紧凑类型的表示范围：关闭紧凑副本，内部算法退回读取 double 坐标
+        inner_->set_compact_points(nullptr);
+        compact_points_ = CompactPoints();
+    }
+    inner_->insert_point(internal);
+    return id;
+}
+
+IndexFootprint ReorderedAlgorithm::index_footprint() const {
+    IndexFootprint footprint = inner_->index_footprint();
+    footprint.per_point_bytes += reordered_.stride() * sizeof(double) + 2 * sizeof(int);
+    return footprint;
+}
+
+void ReorderedAlgorithm::erase_point(int id) {
+    reordered_.erase(to_internal_[id]);
+    inner_->erase_point(to_internal_[id]);
+}
+
+ReorderedAlgorithm::AttachedCopies ReorderedAlgorithm::detach_copies() {
+    const AttachedCopies attached = {!prefilter_.empty(), !compact_points_.empty(), compact_points_.type()};
+    inner_->set_prefilter(nullptr);
+    inner_->set_compact_points(nullptr);
+    prefilter_ = QuantizedPrefilter();
+    compact_points_ = CompactPoints();
+    return attached;
+}
+
+void ReorderedAlgorithm::reattach_copies(const AttachedCopies& attached) {
+    if (attached.prefilter) {
+        prefilter_.build(reordered_);
+        inner_->set_prefilter(&prefilter_);
+    }
+    if (attached.compact_points) {
+        if (compact_points_.build(reordered_, attached.compact_type)) {
+            inner_->set_compact_points(&compact_points_);
+        } else {
+            compact_points_ = CompactPoints();
+        }
+    }
+}
+
+void ReorderedAlgorithm::set_prefilter(const QuantizedPrefilter* prefilter) {
+    if (prefilter == nullptr) {
+        inner_->set_prefilter(nullptr);
+        prefilter_ = QuantizedPrefilter();
+        return;
+    }
+    if (prefilter_.empty()) prefilter_.build(reordered_);
+    inner_->set_prefilter(&prefilter_);
+}
+
+void ReorderedAlgorithm::set_compact_points(const CompactPoints* points) {
+    if (points == nullptr) {
+        inner_->set_compact_points(nullptr);
+        compact_points_ = CompactPoints();
+        return;
+    }
+    if ((compact_points_.empty() || compact_points_.type() != points->type()) &&
+        !compact_points_.build(reordered_, points->type())) {
+        inner_->set_compact_points(nullptr);
+        compact_points_ = CompactPoints();
+        return;
+    }
+    inner_->set_compact_points(&compact_points_);
+}
+
+bool ReorderedAlgorithm::query_distance_exceeds(int p_idx, int q_idx, double r) {
+    return inner_->query_distance_exceeds(to_internal_[p_idx], to_internal_[q_idx], r);
+}
+
+void ReorderedAlgorithm::query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r,
+                                                      uint8_t* results) {
+    thread_local std::vector<QueryPair> mapped;
+    mapped.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        mapped[i] = {to_internal_[pairs[i].p_idx], to_internal_[pairs[i].q_idx]};
+    }
+    inner_->query_distance_exceeds_batch(mapped.data(), count, r, results);
+}
+
+size_t ReorderedAlgorithm::query_radius_bucket(int p_idx, int q_idx, const std::vector<double>& radii) {
+    return inner_->query_radius_bucket(to_internal_[p_idx], to_internal_[q_idx], radii);
+}
+
+void ReorderedAlgorithm::range_query(int p_idx, double r, std::vector<int>& results) {
+    inner_->range_query(to_internal_[p_idx], r, results);
+    map_results_to_original(results);
+}
+
+void ReorderedAlgorithm::range_query(PointView query, double r, std::vector<int>& results) {
+    inner_->range_query(query, r, results);
+    map_results_to_original(results);
+}
+
+void ReorderedAlgorithm::map_results_to_original(std::vector<int>& results) const {
+    for (int& id : results) id = to_original_[id];
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "../core/point_order.h"
+#include "pruning_algorithm.h"
+#include "quantized_prefilter.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 重排装饰器：build 时把数据集按 PointOrder 物理重排，内部算法在重排后的数据集上构建，
+// 使空间上相近的点 (以及内部算法按点下标存放的预计算距离) 位于相邻的内存中。
+// 调用方始终使用原始下标：查询时把下标映射到内部下标，范围查询的结果再映射回原始下标。
+// build(const Dataset&) 复制出重排后的副本，调用方的数据集必须继续有效 (insert_point 从中读取新点)；
+// 调用方不再需要原数据集时用 build(Dataset&&) 交给本对象原地重排，坐标只有这一份。删除标记随点重排。
+//
+// 按簇重排且内部算法是 KMeansTrianglePruning 时，聚类只运行一次并直接交给内部算法，
+// 因此索引中的每个簇恰好是内存中连续的一段，簇内顺序与成员表一致。
+// 预过滤和紧凑副本按点下标索引，set_prefilter / set_compact_points 收到的对象只作开关
+// (紧凑副本还决定存储类型)：内部会在重排后的数据集上另建一份，build / load 之后按新的排列重建并重新交给内部算法
+class ReorderedAlgorithm final : public PruningAlgorithm {
+public:
+    // cluster_k / seed 只在按簇重排、且内部算法不是 KMeansTrianglePruning 时用于聚类
+    ReorderedAlgorithm(std::unique_ptr<PruningAlgorithm> inner, PointOrder order, int cluster_k = 256,
+                       uint64_t seed = 42);
+
+    void build(const Dataset& dataset) override;
+    // 接管 dataset 并原地重排，不再复制；之后用 add_point 追加新点
+    void build(Dataset&& dataset);
+    // 写出两个文件：path 保存排列 (带原数据集的指纹)，path + ".inner" 保存内部索引
+    bool save(const std::string& path) const override;
+    bool load(const std::string& path, const Dataset& dataset) override;
+    // 新点追加到重排后数据集的末尾 (不参与重排，直到下一次 build)，删除标记同步到重排后的数据集。
+    // 接管了数据集时调用方没有可供读取的数据集，insert_point 抛出 std::invalid_argument，改用 add_point
+    void insert_point(int id) override;
+    // 追加一个点并加入索引，返回它的原始下标 (接管数据集与复制两种方式都可使用)
+    int add_point(PointView point);
+    void erase_point(int id) override;
+    [[nodiscard]] double drift() const override { return inner_->drift(); }
+    // 内部索引加上重排后的数据集与两个下标映射
+    [[nodiscard]] IndexFootprint index_footprint() const override;
+    bool query_distance_exceeds(int p_idx, int q_idx, double r) override;
+    void query_distance_exceeds_batch(const QueryPair* pairs, size_t count, double r, uint8_t* results) override;
+    size_t query_radius_bucket(int p_idx, int q_idx, const std::vector<double>& radii) override;
+    void range_query(int p_idx, double r, std::vector<int>& results) override;
+    void range_query(PointView query, double r, std::vector<int>& results) override;
+
+    void set_prefilter(const QuantizedPrefilter* prefilter) override;
+    void set_compact_points(const CompactPoints* points) override;
+    [[nodiscard]] long long get_full_calculations_count() const override { return inner_->get_full_calculations_count(); }
+    [[nodiscard]] long long get_prefilter_decisions_count() const override {
+        return inner_->get_prefilter_decisions_count();
+    }
+    [[nodiscard]] long long get_exact_fallbacks_count() const override { return inner_->get_exact_fallbacks_count(); }
+    [[nodiscard]] PruningBreakdown get_pruning_breakdown() const override { return inner_->get_pruning_breakdown(); }
+    void reset_stats() override { inner_->reset_stats(); }
+
+    [[nodiscard]] PointOrder order() const { return order_; }
+    [[nodiscard]] const Dataset& reordered_dataset() const { return reordered_; }
+    [[nodiscard]] PruningAlgorithm& inner() { return *inner_; }
+    // 原始下标 -> 内部下标 / 内部下标 -> 原始下标
+    [[nodiscard]] int to_internal(int original) const { return to_internal_[original]; }
+    [[nodiscard]] int to_original(int internal) const { return to_original_[internal]; }
+
+private:
+    // 已交给内部算法的副本 (非空即已启用)
+    struct AttachedCopies {
+        bool prefilter;
+        bool compact_points;
+        ScalarType compact_type;
+    };
+    // 计算排列并在重排后的数据集上构建内部算法；source 为 nullptr 时数据集已接管到 reordered_ 中
+    void build_reordered(const Dataset* source);
+    // 重排之前收回并清空两份副本，之后在新的 reordered_ 上重建并重新启用
+    AttachedCopies detach_copies();
+    void reattach_copies(const AttachedCopies& attached);
+    // 由 to_original_ 建立反向映射并得到重排后的数据集：dataset 为 nullptr 时原地重排已接管的 reordered_
+    void apply_order(const Dataset* dataset);
+    void map_results_to_original(std::vector<int>& results) const;
+
+    std::unique_ptr<PruningAlgorithm> inner_;
+    PointOrder order_;
+    int cluster_k_;
+    uint64_t seed_;
+    const Dataset* dataset_ = nullptr; // 调用方的数据集 (insert_point 从中读取新点)；接管时为 nullptr
+    Dataset reordered_;
+    std::vector<int> to_internal_;
+    std::vector<int> to_original_;
+    QuantizedPrefilter prefilter_; // 基于 reordered_ 构建，按需创建；非空当且仅当已交给内部算法
+    CompactPoints compact_points_; // 同上
+};
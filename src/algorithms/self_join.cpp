@@ -0,0 +1,252 @@
+#include "self_join.h"
+#include "../core/distance.h"
+#include "../core/kmeans.h"
+#include "../core/work_stealing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// 自动选取块大小时，每一侧的块坐标所占字节数 (两侧合计约 128 KB，落在 L2 内)
+constexpr size_t kTileBytes = 64 * 1024;
+// 每个线程攒够这么多条边再交给 sink
+constexpr size_t kEdgeBufferSize = 4096;
+
+// 按簇重排后的数据：第 c 簇占据 [offsets[c], offsets[c+1])，簇内按到中心的距离升序
+struct ClusteredData {
+    Dataset points;
+    std::vector<int> ids;
+    std::vector<double> dists;
+    std::vector<size_t> offsets;
+    std::vector<double> radius;
+    Dataset centroids;
+};
+
+struct ClusterPair {
+    int a;
+    int b;
+    double center_dist;
+    long long pairs;
+};
+
+struct alignas(64) ThreadState {
+    long long bound_accepted = 0;
+    long long distance_computations = 0;
+    long long edges = 0;
+    std::vector<Edge> buffer;
+};
+
+ClusteredData partition(const Dataset& dataset, const SelfJoinOptions& options, int num_threads) {
+    KMeansOptions kmeans_options;
+    kmeans_options.k = std::min(options.k, static_cast<int>(dataset.size()));
+    kmeans_options.max_iterations = options.max_iterations;
+    kmeans_options.seed = options.seed;
+    kmeans_options.num_threads = num_threads;
+    KMeansResult kmeans = run_kmeans(dataset, kmeans_options);
+
+    const size_t n = dataset.size();
+    const size_t k = kmeans.centroids.size();
+    ClusteredData data;
+    data.offsets.assign(k + 1, 0);
+    for (int c : kmeans.assignments) data.offsets[c + 1]++;
+    for (size_t c = 0; c < k; ++c) data.offsets[c + 1] += data.offsets[c];
+    data.ids.resize(n);
+    std::vector<size_t> cursor(data.offsets.begin(), data.offsets.end() - 1);
+    for (size_t i = 0; i < n; ++i) data.ids[cursor[kmeans.assignments[i]]++] = static_cast<int>(i);
+
+    data.dists.resize(n);
+    data.radius.assign(k, 0.0);
+    data.points.reset(dataset.dimensions());
+    data.points.resize(n);
+    double* out = data.points.mutable_data();
+    const size_t stride = data.points.stride();
+    parallel_for_work_stealing(k, num_threads, 4, [&](size_t begin, size_t end, int) {
+        for (size_t c = begin; c < end; ++c) {
+            auto first = data.ids.begin() + data.offsets[c];
+            auto last = data.ids.begin() + data.offsets[c + 1];
+            std::sort(first, last, [&](int x, int y) {
+                return kmeans.distances[x] != kmeans.distances[y] ? kmeans.distances[x] < kmeans.distances[y] : x < y;
+            });
+            for (size_t i = data.offsets[c]; i < data.offsets[c + 1]; ++i) {
+                data.dists[i] = kmeans.distances[data.ids[i]];
+                const PointView src = dataset.get_point(data.ids[i]);
+                std::memcpy(out + i * stride, src.data(), src.size() * sizeof(double));
+            }
+            if (first != last) data.radius[c] = data.dists[data.offsets[c + 1] - 1];
+        }
+    });
+    data.centroids = std::move(kmeans.centroids);
+    return data;
+}
+
+class JoinWorker {
+public:
+    JoinWorker(const ClusteredData& data, double r, size_t tile, EdgeSink& sink, int thread_id, ThreadState& state)
+        : data_(data), r_(r), tile_(tile), sink_(sink), thread_id_(thread_id), state_(state) {}
+
+    // 不同簇之间：点对 (x ∈ a, y ∈ b)
+    void join_clusters(const ClusterPair& pair) {
+        const double D = pair.center_dist;
+        const size_t a_begin = data_.offsets[pair.a], a_end = data_.offsets[pair.a + 1];
+        const size_t b_begin = data_.offsets[pair.b], b_end = data_.offsets[pair.b + 1];
+        const double* dists = data_.dists.data();
+        for (size_t xt = a_begin; xt < a_end; xt += tile_) {
+            const size_t xt_end = std::min(xt + tile_, a_end);
+            // 下界排除 d(y,b) < D - d(x,a) - r 的成员：对块内 d(x,a) 最大的点阈值最小，
+            // 比它还小的 y 对整块都被排除，是 b 中的一段前缀
+            const double threshold = D - dists[xt_end - 1] - r_;
+            const size_t y_start =
+                static_cast<size_t>(std::lower_bound(dists + b_begin, dists + b_end, threshold) - dists);
+            for (size_t yt = y_start; yt < b_end; yt += tile_) {
+                const size_t yt_end = std::min(yt + tile_, b_end);
+                for (size_t x = xt; x < xt_end; ++x) {
+                    const double dx = dists[x];
+                    for (size_t y = yt; y < yt_end; ++y) {
+                        const double dy = dists[y];
+                        if (D - dx - dy > r_) continue;
+                        if (dx + D + dy <= r_) {
+                            state_.bound_accepted++;
+                            emit(x, y);
+                        } else {
+                            check(x, y);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // 簇内：点对 (x < y，均在同一簇 c)，下界 |d(x,c) - d(y,c)|，上界 d(x,c) + d(y,c)
+    void join_within(int c) {
+        const size_t begin = data_.offsets[c], end = data_.offsets[c + 1];
+        const double* dists = data_.dists.data();
+        for (size_t xt = begin; xt < end; xt += tile_) {
+            const size_t xt_end = std::min(xt + tile_, end);
+            for (size_t yt = xt; yt < end; yt += tile_) {
+                // 成员按距离升序：后面的块与当前 x 块的距离差只会更大
+                if (dists[yt] - dists[xt_end - 1] > r_) break;
+                const size_t yt_end = std::min(yt + tile_, end);
+                for (size_t x = xt; x < xt_end; ++x) {
+                    const double dx = dists[x];
+                    for (size_t y = std::max(yt, x + 1); y < yt_end; ++y) {
+                        const double dy = dists[y];
+                        if (dy - dx > r_) break;
+                        if (dx + dy <= r_) {
+                            state_.bound_accepted++;
+                            emit(x, y);
+                        } else {
+                            check(x, y);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void flush() {
+        if (!state_.buffer.empty()) {
+            sink_.write(thread_id_, state_.buffer.data(), state_.buffer.size());
+            state_.buffer.clear();
+        }
+    }
+
+private:
+    void check(size_t x, size_t y) {
+        state_.distance_computations++;
+        if (!is_distance_exceeding_early_exit(data_.points.get_point(static_cast<int>(x)),
+                                              data_.points.get_point(static_cast<int>(y)), r_)) {
+            emit(x, y);
+        }
+    }
+
+    void emit(size_t x, size_t y) {
+        const int u = data_.ids[x];
+        const int v = data_.ids[y];
+        state_.buffer.push_back(u < v ? Edge{u, v} : Edge{v, u});
+        state_.edges++;
+        if (state_.buffer.size() >= kEdgeBufferSize) flush();
+    }
+
+    const ClusteredData& data_;
+    double r_;
+    size_t tile_;
+    EdgeSink& sink_;
+    int thread_id_;
+    ThreadState& state_;
+};
+
+} // namespace
+
+SelfJoinStats run_self_join(const Dataset& dataset, double r, const SelfJoinOptions& options, EdgeSink& sink) {
+    SelfJoinStats stats;
+    stats.points = dataset.size();
+    const long long n = static_cast<long long>(dataset.size());
+    stats.total_pairs = n * (n - 1) / 2;
+    if (n < 2) return stats;
+
+    const int num_threads = options.num_threads > 0 ? options.num_threads : hardware_thread_count();
+    auto start = std::chrono::steady_clock::now();
+    const ClusteredData data = partition(dataset, options, num_threads);
+    auto partitioned = std::chrono::steady_clock::now();
+    stats.partition_ms = std::chrono::duration<double, std::milli>(partitioned - start).count();
+
+    // 簇级剪枝：D(a,b) - R_a - R_b > r 的簇对中不可能有距离 <= r 的点对
+    const size_t k = data.centroids.size();
+    stats.clusters = k;
+    std::vector<std::vector<ClusterPair>> surviving(k);
+    parallel_for_work_stealing(k, num_threads, 4, [&](size_t begin, size_t end, int) {
+        for (size_t a = begin; a < end; ++a) {
+            const long long size_a = static_cast<long long>(data.offsets[a + 1] - data.offsets[a]);
+            if (size_a == 0) continue;
+            for (size_t b = a; b < k; ++b) {
+                const long long size_b = static_cast<long long>(data.offsets[b + 1] - data.offsets[b]);
+                if (size_b == 0) continue;
+                const double D = a == b ? 0.0 : euclidean_distance(data.centroids.get_point(static_cast<int>(a)),
+                                                                   data.centroids.get_point(static_cast<int>(b)));
+                if (D - data.radius[a] - data.radius[b] > r) continue;
+                const long long pairs = a == b ? size_a * (size_a - 1) / 2 : size_a * size_b;
+                surviving[a].push_back({static_cast<int>(a), static_cast<int>(b), D, pairs});
+            }
+        }
+    });
+    std::vector<ClusterPair> work;
+    size_t nonempty = 0;
+    for (size_t a = 0; a < k; ++a) {
+        if (data.offsets[a + 1] > data.offsets[a]) nonempty++;
+        for (const ClusterPair& pair : surviving[a]) {
+            stats.candidate_pairs += pair.pairs;
+            work.push_back(pair);
+        }
+    }
+    stats.cluster_pairs = static_cast<long long>(nonempty * (nonempty + 1) / 2);
+    stats.cluster_pairs_pruned = stats.cluster_pairs - static_cast<long long>(work.size());
+    // 先处理大块，工作窃取在尾部只剩小块时更容易均衡
+    std::sort(work.begin(), work.end(), [](const ClusterPair& x, const ClusterPair& y) { return x.pairs > y.pairs; });
+
+    const size_t tile = options.tile_points > 0
+                            ? options.tile_points
+                            : std::max<size_t>(8, kTileBytes / (data.points.stride() * sizeof(double)));
+    std::vector<ThreadState> states(static_cast<size_t>(num_threads));
+    parallel_for_work_stealing(work.size(), num_threads, 1, [&](size_t begin, size_t end, int thread_id) {
+        JoinWorker worker(data, r, tile, sink, thread_id, states[thread_id]);
+        for (size_t i = begin; i < end; ++i) {
+            if (work[i].a == work[i].b) {
+                worker.join_within(work[i].a);
+            } else {
+                worker.join_clusters(work[i]);
+            }
+        }
+    });
+    for (int t = 0; t < num_threads; ++t) {
+        ThreadState& state = states[t];
+        JoinWorker(data, r, tile, sink, t, state).flush();
+        stats.bound_accepted += state.bound_accepted;
+        stats.distance_computations += state.distance_computations;
+        stats.edges += state.edges;
+    }
+    stats.bound_rejected = stats.candidate_pairs - stats.bound_accepted - stats.distance_computations;
+    stats.join_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - partitioned).count();
+    return stats;
+}
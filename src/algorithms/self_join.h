@@ -0,0 +1,43 @@
+#pragma once
+#include "edge_writer.h"
+#include "../core/dataset.h"
+#include <cstdint>
+
+// 相似度自连接：找出数据集中所有 d(p, q) <= r 的点对 (p < q)。
+//
+// 基于 k-means 划分：
+//  1. 簇级剪枝：中心距离 D(a, b) 减去两簇半径仍大于 r 的簇对整体跳过；
+//  2. 点级剪枝：对剩余簇对中的点对，先用 D(a,b) - d(x,a) - d(y,b) > r (下界) 与
+//     d(x,a) + D(a,b) + d(y,b) <= r (上界) 判定，簇内成员按到中心的距离排序，
+//     下界排除的成员是一段前缀，可以整段跳过；
+//  3. 剩余点对按缓存大小切成 tile x tile 的块，多线程 (工作窃取) 逐块做提前退出的完整计算。
+// 数据按簇重新排列成连续存储，使每个块的坐标在内存中相邻。
+struct SelfJoinOptions {
+    int k = 500;
+    int max_iterations = 20;
+    uint64_t seed = 42;
+    int num_threads = 0;     // <= 0 表示使用全部硬件线程
+    size_t tile_points = 0;  // 每个块一侧的点数；0 表示按维度自动选取 (两块坐标约占 128 KB)
+};
+
+struct SelfJoinStats {
+    size_t points = 0;
+    size_t clusters = 0;
+    long long cluster_pairs = 0;         // 簇对总数 (含簇与自身)
+    long long cluster_pairs_pruned = 0;  // 被簇级剪枝跳过的簇对
+    long long total_pairs = 0;           // n(n-1)/2
+    long long candidate_pairs = 0;       // 通过簇级剪枝的点对
+    long long bound_rejected = 0;        // 被点级下界排除的点对
+    long long bound_accepted = 0;        // 被点级上界直接收录的点对
+    long long distance_computations = 0; // 完整距离计算次数
+    long long edges = 0;                 // 输出的边数
+    double partition_ms = 0.0;           // k-means 划分与重排耗时
+    double join_ms = 0.0;                // 连接阶段耗时
+    // 连接阶段每秒“覆盖”的点对数 (total_pairs / join 时间)，以及每秒输出的边数
+    [[nodiscard]] double pairs_per_second() const { return join_ms > 0.0 ? total_pairs / (join_ms / 1000.0) : 0.0; }
+    [[nodiscard]] double edges_per_second() const { return join_ms > 0.0 ? edges / (join_ms / 1000.0) : 0.0; }
+};
+
+// 把所有 d(p, q) <= r 的点对写入 sink (每条边 u < v，顺序不保证)。
+// sink 会以 thread_id ∈ [0, 线程数) 被调用；k 会被截断到数据集大小
+SelfJoinStats run_self_join(const Dataset& dataset, double r, const SelfJoinOptions& options, EdgeSink& sink);
@@ -0,0 +1,259 @@
+#include "auto_tuner.h"
+#include "../algorithms/algorithm_factory.h"
+#include "benchmark_runner.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    const size_t mid = values.size() / 2;
+    return values.size() % 2 == 1 ? values[mid] : 0.5 * (values[mid - 1] + values[mid]);
+}
+
+// 不放回地均匀抽取 count 个点，保持它们在原数据集中的相对顺序
+Dataset sample_dataset(const Dataset& dataset, size_t count, uint64_t seed) {
+    std::vector<int> ids(dataset.size());
+    std::iota(ids.begin(), ids.end(), 0);
+    std::mt19937_64 gen(seed);
+    for (size_t i = 0; i < count; ++i) {
+        std::uniform_int_distribution<size_t> distrib(i, ids.size() - 1);
+        std::swap(ids[i], ids[distrib(gen)]);
+    }
+    ids.resize(count);
+    std::sort(ids.begin(), ids.end());
+    Dataset sample;
+    sample.reset(dataset.dimensions());
+    sample.reserve(count);
+    for (int id : ids) sample.add_point(dataset.get_point(id));
+    return sample;
+}
+
+// 每轮计时至少持续这么久 (不足时把全部点对重复查询多遍)，样本上的一遍查询往往只有零点几毫秒
+constexpr double kMinTrialNs = 20e6;
+
+// 批量查询一个半径：预热一遍后计时 trials 轮，返回每个点对耗时的中位数；full_calculations 为一遍查询的次数
+double time_batches(PruningAlgorithm& algorithm, const std::vector<QueryPair>& pairs, double r,
+                    const TuningOptions& options, long long& full_calculations) {
+    const size_t n = pairs.size();
+    const size_t batch_size = static_cast<size_t>(options.batch_size);
+    std::vector<uint8_t> results(n);
+    auto run = [&]() {
+        for (size_t offset = 0; offset < n; offset += batch_size) {
+            const size_t count = std::min(batch_size, n - offset);
+            algorithm.query_distance_exceeds_batch(pairs.data() + offset, count, r, results.data() + offset);
+        }
+    };
+    run();
+    std::vector<double> ns;
+    for (int trial = 0; trial < options.trials; ++trial) {
+        algorithm.reset_stats();
+        const auto start = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::nano> elapsed{0.0};
+        long long passes = 0;
+        do {
+            run();
+            ++passes;
+            elapsed = std::chrono::steady_clock::now() - start;
+        } while (elapsed.count() < kMinTrialNs);
+        ns.push_back(elapsed.count() / static_cast<double>(n * static_cast<size_t>(passes)));
+        if (trial == 0) full_calculations = algorithm.get_full_calculations_count() / passes;
+    }
+    return median(ns);
+}
+
+} // namespace
+
+bool parse_radius_distribution(const std::string& text, std::vector<WeightedRadius>& radii) {
+    std::vector<WeightedRadius> parsed;
+    std::stringstream ss(text);
+    std::string item;
+    try {
+        while (std::getline(ss, item, ',')) {
+            if (item.empty()) continue;
+            const size_t colon = item.find(':');
+            WeightedRadius entry;
+            entry.radius = std::stod(item.substr(0, colon));
+            if (colon != std::string::npos) entry.weight = std::stod(item.substr(colon + 1));
+            if (!(entry.radius > 0.0) || !(entry.weight >= 0.0)) return false;
+            parsed.push_back(entry);
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    if (parsed.empty()) return false;
+    radii = std::move(parsed);
+    return true;
+}
+
+TuningResult auto_tune(const Dataset& dataset, const TuningOptions& options, std::ostream& log) {
+    double total_weight = 0.0;
+    for (const WeightedRadius& entry : options.radii) total_weight += entry.weight;
+    if (options.radii.empty() || !(total_weight > 0.0)) {
+        throw std::invalid_argument("auto_tune: radius distribution is empty");
+    }
+    if (options.trials <= 0 || options.batch_size <= 0 || options.sample_queries == 0) {
+        throw std::invalid_argument("auto_tune: trials, batch_size and sample_queries must be positive");
+    }
+    for (const std::string& name : options.algorithms) {
+        if (make_algorithm(name, 1) == nullptr) throw std::invalid_argument("auto_tune: unknown algorithm " + name);
+    }
+
+    TuningResult result;
+    result.num_points = dataset.size();
+    result.dimensions = dataset.dimensions();
+    result.sample_points = std::min(options.sample_points, dataset.size());
+    if (result.sample_points < 2) throw std::invalid_argument("auto_tune: need at least 2 sample points");
+    const Dataset sample = sample_dataset(dataset, result.sample_points, options.seed);
+    const std::vector<QueryPair> pairs = generate_query_pairs(sample.size(), options.sample_queries, options.seed + 1);
+
+    // 距离分布 (同 analyze_ground_truth)：各个半径下能被下界检查省去的点对比例的上限
+    std::vector<double> sorted_radii;
+    for (const WeightedRadius& entry : options.radii) sorted_radii.push_back(entry.radius);
+    std::sort(sorted_radii.begin(), sorted_radii.end());
+    const std::vector<long long> buckets = count_radius_buckets(sample, pairs, sorted_radii);
+    log << "Sample: " << sample.size() << " of " << dataset.size() << " points x " << dataset.dimensions()
+        << " dims, " << pairs.size() << " pairs per radius" << std::endl;
+    for (const WeightedRadius& entry : options.radii) {
+        const size_t b = static_cast<size_t>(std::upper_bound(sorted_radii.begin(), sorted_radii.end(), entry.radius) -
+                                             sorted_radii.begin());
+        long long exceeding = 0;
+        for (size_t i = b; i < buckets.size(); ++i) exceeding += buckets[i];
+        result.exceeding_fraction.push_back(static_cast<double>(exceeding) / static_cast<double>(pairs.size()));
+        log << std::fixed << std::setprecision(2) << "  r=" << entry.radius << " (weight "
+            << entry.weight / total_weight << "): " << 100.0 * result.exceeding_fraction.back() << "% of pairs have d > r"
+            << std::endl;
+    }
+
+    std::vector<int> ks = options.ks;
+    std::sort(ks.begin(), ks.end());
+    for (const std::string& name : options.algorithms) {
+        const std::vector<int> candidate_ks = algorithm_uses_k(name) ? ks : std::vector<int>{0};
+        for (int k : candidate_ks) {
+            if (k > 0 && static_cast<size_t>(k) * 2 > sample.size()) break;
+            TuningCandidate candidate;
+            candidate.algorithm = name;
+            candidate.k = k;
+            auto algorithm = make_algorithm(name, k, options.iterations, options.seed);
+            const auto start = std::chrono::steady_clock::now();
+            algorithm->build(sample);
+            candidate.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            candidate.memory_bytes = algorithm->index_footprint().bytes(dataset.size());
+            candidate.within_budget = options.memory_budget_bytes == 0 || candidate.memory_bytes <= options.memory_budget_bytes;
+
+            log << std::fixed << std::setprecision(2) << "  " << std::left << std::setw(14) << name << std::right
+                << " k=" << std::setw(5) << k << " | index " << std::setw(10)
+                << static_cast<double>(candidate.memory_bytes) / (1024.0 * 1024.0) << " MB";
+            if (!candidate.within_budget) {
+                log << " | over budget" << std::endl;
+                result.candidates.push_back(std::move(candidate));
+                // 内存随 k 单调增长，同一算法更大的 k 同样超出预算
+                break;
+            }
+            for (const WeightedRadius& entry : options.radii) {
+                long long full_calculations = 0;
+                const double ns = time_batches(*algorithm, pairs, entry.radius, options, full_calculations);
+                const double weight = entry.weight / total_weight;
+                candidate.radius_ns.push_back(ns);
+                candidate.ns_per_query += weight * ns;
+                candidate.pruning_rate += weight * (1.0 - static_cast<double>(full_calculations) /
+                                                              static_cast<double>(pairs.size()));
+            }
+            log << " | build " << std::setw(9) << candidate.build_ms << " ms | prune " << std::setw(6)
+                << candidate.pruning_rate * 100.0 << "% | " << std::setw(8) << candidate.ns_per_query << " ns/query"
+                << std::endl;
+            result.candidates.push_back(std::move(candidate));
+        }
+    }
+
+    for (size_t i = 0; i < result.candidates.size(); ++i) {
+        const TuningCandidate& candidate = result.candidates[i];
+        if (!candidate.within_budget) continue;
+        if (result.best < 0 || candidate.ns_per_query < result.candidates[result.best].ns_per_query) {
+            result.best = static_cast<int>(i);
+        }
+    }
+    return result;
+}
+
+bool write_tuned_config(const std::string& path, const std::string& dataset_dir, const TuningOptions& options,
+                        const TuningResult& result) {
+    if (result.best < 0) {
+        std::cerr << "Error: No candidate fits the memory budget" << std::endl;
+        return false;
+    }
+    std::string dir = dataset_dir;
+    while (dir.size() > 1 && dir.back() == '/') dir.pop_back();
+    const size_t slash = dir.find_last_of('/');
+    const std::string data_root = slash == std::string::npos ? "./" : dir.substr(0, slash + 1);
+    const std::string dataset_name = slash == std::string::npos ? dir : dir.substr(slash + 1);
+
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open file for writing: " << path << std::endl;
+        return false;
+    }
+    const TuningCandidate& best = result.candidates[static_cast<size_t>(result.best)];
+    auto describe = [&](const TuningCandidate& candidate) {
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(2) << candidate.algorithm << " k=" << candidate.k << " | index "
+             << static_cast<double>(candidate.memory_bytes) / (1024.0 * 1024.0) << " MB";
+        if (!candidate.within_budget) {
+            line << " | over budget";
+        } else {
+            line << " | prune " << candidate.pruning_rate * 100.0 << "% | " << candidate.ns_per_query << " ns/query";
+        }
+        return line.str();
+    };
+
+    out << "# Auto-tuned for " << dataset_name << ": " << result.num_points << " points x " << result.dimensions
+        << " dims (candidates built on " << result.sample_points << " sampled points)\n";
+    out << "# Memory budget: ";
+    if (options.memory_budget_bytes == 0) {
+        out << "unlimited\n";
+    } else {
+        out << std::fixed << std::setprecision(2) << static_cast<double>(options.memory_budget_bytes) / (1024.0 * 1024.0)
+            << " MB\n";
+    }
+    out << "# Radius distribution:" << std::defaultfloat << std::setprecision(12);
+    for (size_t i = 0; i < options.radii.size(); ++i) {
+        out << (i == 0 ? " " : ", ") << options.radii[i].radius << " (weight " << options.radii[i].weight << ", "
+            << std::fixed << std::setprecision(2) << 100.0 * result.exceeding_fraction[i] << "% of pairs have d > r)"
+            << std::defaultfloat << std::setprecision(12);
+    }
+    out << "\n# Chosen: " << describe(best) << "\n";
+    out << "# All candidates (batched, weighted by the radius distribution):\n";
+    std::vector<const TuningCandidate*> ranked;
+    for (const TuningCandidate& candidate : result.candidates) ranked.push_back(&candidate);
+    std::stable_sort(ranked.begin(), ranked.end(), [](const TuningCandidate* a, const TuningCandidate* b) {
+        if (a->within_budget != b->within_budget) return a->within_budget;
+        return a->within_budget && a->ns_per_query < b->ns_per_query;
+    });
+    for (const TuningCandidate* candidate : ranked) out << "#   " << describe(*candidate) << "\n";
+
+    out << std::defaultfloat << std::setprecision(12);
+    out << "data_root = " << data_root << "\n";
+    out << "datasets = " << dataset_name << "\n";
+    out << "algorithms = " << best.algorithm << "\n";
+    if (best.k > 0) out << "k = " << best.k << "\n";
+    out << "radius = ";
+    for (size_t i = 0; i < options.radii.size(); ++i) out << (i == 0 ? "" : ",") << options.radii[i].radius;
+    out << "\n";
+    out << "iterations = " << options.iterations << "\n";
+    out << "batch_size = " << options.batch_size << "\n";
+    out << "seed = " << options.seed << "\n";
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Failed writing tuned config: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
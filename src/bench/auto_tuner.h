@@ -0,0 +1,68 @@
+#pragma once
+#include "../algorithms/pruning_algorithm.h"
+#include "../core/dataset.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 工作负载半径分布中的一项：比例为 weight 的查询使用半径 radius
+struct WeightedRadius {
+    double radius = 0.0;
+    double weight = 1.0;
+};
+
+// 解析 "0.5:3,1.0:1" 形式的半径分布 (权重可省略，默认为 1；权重不必归一化)。格式有误时返回 false
+bool parse_radius_distribution(const std::string& text, std::vector<WeightedRadius>& radii);
+
+struct TuningOptions {
+    std::vector<WeightedRadius> radii;  // 工作负载的半径分布
+    size_t memory_budget_bytes = 0;     // 完整数据集上索引内存的上限，0 表示不限
+    size_t sample_points = 20000;       // 候选索引在多少个随机点上构建 (不超过数据集大小)
+    size_t sample_queries = 20000;      // 每个半径计时的点对数
+    std::vector<std::string> algorithms = {"brute", "kmeans", "multipivot", "multipivot-u8", "multipivot-ff",
+                                           "cascade"};
+    std::vector<int> ks = {16, 32, 64, 128, 256};
+    int trials = 3;        // 每个半径重复计时的轮数，取中位数
+    int iterations = 20;   // k-means 最大迭代次数
+    int batch_size = 4096; // 计时使用批量查询
+    uint64_t seed = 42;    // 样本、点对和索引构建的随机种子
+};
+
+// 一个候选 (算法, k) 在样本上的测量结果，各项按半径分布的权重加权平均
+struct TuningCandidate {
+    std::string algorithm;
+    int k = 0; // 不使用 k 的算法为 0
+    size_t memory_bytes = 0;    // 换算到完整数据集的索引内存
+    bool within_budget = true;  // 超出预算的候选不测量查询
+    double build_ms = 0.0;      // 在样本上的构建时间
+    double pruning_rate = 0.0;  // 省去完整计算的比例 (0~1)
+    double ns_per_query = 0.0;  // 批量查询的每个点对耗时
+    std::vector<double> radius_ns; // 每个半径的每个点对耗时 (与 TuningOptions::radii 对应)
+};
+
+struct TuningResult {
+    size_t num_points = 0; // 完整数据集
+    size_t dimensions = 0;
+    size_t sample_points = 0;
+    // 每个半径下距离 > r 的点对比例 (暴力计算得到)，即下界检查能省去的完整计算的上限
+    std::vector<double> exceeding_fraction;
+    std::vector<TuningCandidate> candidates; // 按测量顺序
+    int best = -1; // candidates 中加权 ns/query 最低且不超预算的候选，没有时为 -1
+};
+
+// 自动调参：从 dataset 中随机抽取 sample_points 个点，对每个 (算法, k) 在样本上构建索引，
+// 按索引的内存占用 (换算到完整数据集，见 IndexFootprint) 剔除超出预算的候选，
+// 其余的用半径分布中的每个半径计时批量查询，选出加权 ns/query 最低的候选。
+//
+// k-means / pivot 的个数不随样本缩放：k 个簇在样本和完整数据集上划分的是同一个分布，
+// 剪枝率大体一致；样本比完整数据集更容易留在缓存中，ns/query 偏乐观，但候选之间的排序通常不变。
+// k 不小于样本点数一半的候选被跳过。进度写入 log。选项有误 (没有半径、样本不足 2 个点、算法未知) 时
+// 抛出 std::invalid_argument
+TuningResult auto_tune(const Dataset& dataset, const TuningOptions& options, std::ostream& log);
+
+// 把选出的配置写成 benchmark 的配置文件 (key = value，见 benchmark_config.h)，测量结果写在注释中。
+// dataset_dir 拆成 data_root 和 datasets；result.best < 0 或文件无法写入时打印错误并返回 false
+bool write_tuned_config(const std::string& path, const std::string& dataset_dir, const TuningOptions& options,
+                        const TuningResult& result);
@@ -0,0 +1,177 @@
+#include "benchmark_config.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+std::string trim(const std::string& s) {
+    const size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    const size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+std::vector<std::string> split_list(const std::string& value) {
+    std::vector<std::string> items;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        item = trim(item);
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+bool parse_bool(const std::string& value, bool& out) {
+    if (value == "1" || value == "true" || value == "yes" || value == "on") {
+        out = true;
+        return true;
+    }
+    if (value == "0" || value == "false" || value == "no" || value == "off") {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+// 把一个 key = value 应用到 config；数值格式错误或键名未知时返回 false
+bool apply_option(const std::string& key, const std::string& value, BenchmarkConfig& config) {
+    try {
+        if (key == "data_root") {
+            config.data_root = value;
+            if (!config.data_root.empty() && config.data_root.back() != '/') config.data_root += '/';
+        } else if (key == "datasets") {
+            config.datasets = split_list(value);
+        } else if (key == "algorithms") {
+            config.algorithms = split_list(value);
+        } else if (key == "k") {
+            config.ks.clear();
+            for (const std::string& item : split_list(value)) config.ks.push_back(std::stoi(item));
+        } else if (key == "radius") {
+            config.radii.clear();
+            for (const std::string& item : split_list(value)) config.radii.push_back(std::stod(item));
+        } else if (key == "workload") {
+            if (value != "random" && value != "edges") return false;
+            config.workload = value;
+        } else if (key == "queries") {
+            config.num_queries = std::stoi(value);
+        } else if (key == "warmup") {
+            config.warmup_queries = std::stoi(value);
+        } else if (key == "trials") {
+            config.trials = std::stoi(value);
+        } else if (key == "seed") {
+            config.seed = std::stoull(value);
+        } else if (key == "threads") {
+            config.threads = std::stoi(value);
+        } else if (key == "iterations") {
+            config.iterations = std::stoi(value);
+        } else if (key == "batch_size") {
+            config.batch_size = std::stoi(value);
+        } else if (key == "index_cache") {
+            return parse_bool(value, config.index_cache);
+        } else if (key == "prefilter") {
+            return parse_bool(value, config.prefilter);
+        } else if (key == "storage") {
+            return parse_scalar_type(value, config.storage);
+        } else if (key == "transform") {
+            return parse_dimension_transform(value, config.transform);
+        } else if (key == "json") {
+            config.json_path = value;
+        } else if (key == "csv") {
+            config.csv_path = value;
+        } else {
+            return false;
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool load_benchmark_config(const std::string& path, BenchmarkConfig& config) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open benchmark config: " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        const size_t eq = line.find('=');
+        const std::string key = eq == std::string::npos ? "" : trim(line.substr(0, eq));
+        if (key.empty() || !apply_option(key, trim(line.substr(eq + 1)), config)) {
+            std::cerr << "Error: Invalid setting at " << path << ":" << line_number << ": " << line << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parse_benchmark_args(int argc, char** argv, BenchmarkConfig& config) {
+    std::vector<std::pair<std::string, std::string>> options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            std::cerr << "Error: Unexpected argument: " << arg << std::endl;
+            return false;
+        }
+        arg = arg.substr(2);
+        const size_t eq = arg.find('=');
+        if (eq != std::string::npos) {
+            options.emplace_back(arg.substr(0, eq), arg.substr(eq + 1));
+        } else if (i + 1 < argc) {
+            options.emplace_back(arg, argv[++i]);
+        } else {
+            std::cerr << "Error: Missing value for --" << arg << std::endl;
+            return false;
+        }
+    }
+    // 配置文件先于其余参数生效，因此命令行上的值总是覆盖文件中的值
+    for (const auto& [key, value] : options) {
+        if (key == "config" && !load_benchmark_config(value, config)) return false;
+    }
+    for (const auto& [key, value] : options) {
+        if (key == "config") continue;
+        if (!apply_option(key, value, config)) {
+            std::cerr << "Error: Invalid option --" << key << " " << value << std::endl;
+            return false;
+        }
+    }
+    if (config.num_queries <= 0 || config.trials <= 0 || config.batch_size <= 0 || config.warmup_queries < 0) {
+        std::cerr << "Error: queries, trials and batch_size must be positive" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+const char* benchmark_usage() {
+    return "  --config FILE          key = value settings (same keys as below, command line wins)\n"
+           "  --data_root DIR        directory containing the datasets (default ../data/)\n"
+           "  --datasets A,B         dataset directory names\n"
+           "  --algorithms A,B       brute, kmeans, multipivot, multipivot-u8, multipivot-ff, cascade\n"
+           "                         (append @cluster or @morton to reorder points first)\n"
+           "  --k 100,500            pivot / cluster counts\n"
+           "  --radius 0.5,1.0       query radii\n"
+           "  --workload W           random pairs, or edges: every edge in <dataset>/edges.txt grouped by\n"
+           "                         source node (default random)\n"
+           "  --queries N            query pairs per trial (default 100000)\n"
+           "  --warmup N             untimed warmup queries (default 10000)\n"
+           "  --trials N             timed repetitions (default 5)\n"
+           "  --seed S               RNG seed for pairs and index builds (default 42)\n"
+           "  --threads N            threads for the parallel run, 0 = all, 1 = skip (default 0)\n"
+           "  --iterations N         k-means iterations (default 20)\n"
+           "  --batch_size N         batch size for the batched run (default 4096)\n"
+           "  --index_cache BOOL     load/save indexes in the dataset directory (default false)\n"
+           "  --prefilter BOOL       attach the int8 quantized prefilter (default false)\n"
+           "  --storage TYPE         coordinates read by full calculations: float64, float32 or float16\n"
+           "                         (rounded copies with per-point error bounds, default float64)\n"
+           "  --transform NAME       none, variance or pca (default none)\n"
+           "  --json FILE            write results as JSON\n"
+           "  --csv FILE             write results as CSV\n";
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "../core/compact_points.h"
+#include "../core/dimension_transform.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 基准测试的全部参数。datasets / algorithms / ks / radii 构成参数网格，
+// 每个组合 (不使用 k 的算法对每个 k 只运行一次) 产生一条结果
+struct BenchmarkConfig {
+    std::string data_root = "../data/";
+    std::vector<std::string> datasets = {"PubMed"};
+    std::vector<std::string> algorithms = {"brute", "kmeans", "multipivot"};
+    std::vector<int> ks = {500};
+    std::vector<double> radii = {0.5};
+
+    // random：num_queries 个均匀随机的点对；edges：数据集目录下 edges.txt 的全部边，按源点分组
+    // (见 edge_workload.h)，此时忽略 num_queries，预热取前 warmup_queries 条边
+    std::string workload = "random";
+    int num_queries = 100000;   // 每轮查询的点对数 (全部满足 p != q)
+    int warmup_queries = 10000; // 计时前的预热查询数
+    int trials = 5;             // 重复计时的轮数
+    uint64_t seed = 42;         // 点对生成和索引构建的随机种子
+    int threads = 0;            // 多线程吞吐量测试的线程数，0 表示全部硬件线程，1 表示跳过
+    int iterations = 20;        // k-means 最大迭代次数
+    int batch_size = 4096;
+    bool index_cache = false;   // 在数据集目录下读写索引缓存
+    bool prefilter = false;     // 为每个算法挂上 int8 量化预过滤
+    ScalarType storage = ScalarType::Float64; // 完整计算读取的坐标类型 (见 compact_points.h)
+    DimensionTransformKind transform = DimensionTransformKind::None;
+
+    std::string json_path; // 为空则不输出
+    std::string csv_path;
+};
+
+// 读取 key = value 格式的配置文件 ('#' 之后为注释)，键名与命令行参数相同 (不带 "--")；
+// 列表值用逗号分隔。文件无法打开或内容有误时打印错误并返回 false
+bool load_benchmark_config(const std::string& path, BenchmarkConfig& config);
+
+// 解析命令行：--key value 或 --key=value。--config FILE 先加载文件，其余参数覆盖文件中的值
+bool parse_benchmark_args(int argc, char** argv, BenchmarkConfig& config);
+
+// 命令行参数说明 (用于 Usage 输出)
+const char* benchmark_usage();
@@ -0,0 +1,271 @@
+#include "benchmark_runner.h"
+#include "../algorithms/algorithm_factory.h"
+#include "../algorithms/brute_force_algorithm.h"
+#include "../algorithms/parallel_query_driver.h"
+#include "../algorithms/quantized_prefilter.h"
+#include "../core/compact_points.h"
+#include "../core/cycle_clock.h"
+#include "../core/distance_kernels.h"
+#include "../core/work_stealing.h"
+#include "edge_workload.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+namespace {
+
+double median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    const size_t mid = values.size() / 2;
+    return values.size() % 2 == 1 ? values[mid] : 0.5 * (values[mid - 1] + values[mid]);
+}
+
+// 就地选择第 q 分位 (最近秩法)
+uint64_t percentile(std::vector<uint64_t>& ticks, double q) {
+    const size_t rank = static_cast<size_t>(std::ceil(q * static_cast<double>(ticks.size())));
+    const size_t idx = std::min(ticks.size() - 1, rank > 0 ? rank - 1 : 0);
+    std::nth_element(ticks.begin(), ticks.begin() + static_cast<std::ptrdiff_t>(idx), ticks.end());
+    return ticks[idx];
+}
+
+size_t count_mismatches(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    size_t n = 0;
+    for (size_t i = 0; i < a.size(); ++i) n += a[i] != b[i] ? 1 : 0;
+    return n;
+}
+
+// 对一个已构建好的算法和一个半径运行预热 + 全部计时轮次
+void measure(PruningAlgorithm& algorithm, const std::vector<QueryPair>& pairs, const std::vector<QueryPair>& warmup,
+             double r, const BenchmarkConfig& config, int parallel_threads, BenchmarkResult& result) {
+    const size_t n = pairs.size();
+    std::vector<uint8_t> reference(n);
+    std::vector<uint8_t> results(n);
+    std::vector<uint64_t> ticks(n * static_cast<size_t>(config.trials));
+    std::vector<double> single_qps;
+    std::vector<double> batch_qps;
+    std::vector<double> parallel_qps;
+
+    volatile size_t sink = 0;
+    for (const QueryPair& pair : warmup) {
+        sink = sink + (algorithm.query_distance_exceeds(pair.p_idx, pair.q_idx, r) ? 1 : 0);
+    }
+
+    const size_t batch_size = static_cast<size_t>(config.batch_size);
+    for (int trial = 0; trial < config.trials; ++trial) {
+        // 逐条查询：每条查询前后各读一次计数器，墙钟时间只取整轮的总耗时
+        std::vector<uint8_t>& single = trial == 0 ? reference : results;
+        uint64_t* trial_ticks = ticks.data() + static_cast<size_t>(trial) * n;
+        algorithm.reset_stats();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; ++i) {
+            const uint64_t t0 = CycleClock::now();
+            single[i] = algorithm.query_distance_exceeds(pairs[i].p_idx, pairs[i].q_idx, r) ? 1 : 0;
+            trial_ticks[i] = CycleClock::now() - t0;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        single_qps.push_back(static_cast<double>(n) / std::max(elapsed.count(), 1e-12));
+        if (trial == 0) {
+            result.full_calculations = algorithm.get_full_calculations_count();
+            result.prefilter_decisions = algorithm.get_prefilter_decisions_count();
+            result.exact_fallbacks = algorithm.get_exact_fallbacks_count();
+        } else {
+            result.mismatches += count_mismatches(reference, results);
+        }
+
+        start = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset < n; offset += batch_size) {
+            const size_t count = std::min(batch_size, n - offset);
+            algorithm.query_distance_exceeds_batch(pairs.data() + offset, count, r, results.data() + offset);
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        batch_qps.push_back(static_cast<double>(n) / std::max(elapsed.count(), 1e-12));
+        result.mismatches += count_mismatches(reference, results);
+
+        if (parallel_threads > 1) {
+            ParallelQueryDriver driver(parallel_threads);
+            const auto run = driver.run(algorithm, pairs, r, results);
+            parallel_qps.push_back(run.queries_per_second);
+            result.mismatches += count_mismatches(reference, results);
+        }
+    }
+
+    result.queries = static_cast<long long>(n);
+    result.exceeding = std::count(reference.begin(), reference.end(), uint8_t{1});
+    result.pruning_rate =
+        n > 0 ? static_cast<double>(static_cast<long long>(n) - result.full_calculations) / static_cast<double>(n) : 0.0;
+    result.latency = summarize_latencies(ticks);
+    result.single_qps = median(single_qps);
+    result.batch_qps = median(batch_qps);
+    result.parallel_threads = parallel_threads > 1 ? parallel_threads : 0;
+    result.parallel_qps = median(parallel_qps);
+}
+
+} // namespace
+
+std::vector<QueryPair> generate_query_pairs(size_t num_points, size_t count, uint64_t seed) {
+    std::vector<QueryPair> pairs;
+    if (num_points < 2) return pairs;
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<int> distrib(0, static_cast<int>(num_points) - 1);
+    pairs.reserve(count);
+    while (pairs.size() < count) {
+        const int p_idx = distrib(gen);
+        const int q_idx = distrib(gen);
+        if (p_idx != q_idx) pairs.push_back({p_idx, q_idx});
+    }
+    return pairs;
+}
+
+std::vector<long long> count_radius_buckets(const Dataset& dataset, const std::vector<QueryPair>& pairs,
+                                            const std::vector<double>& radii) {
+    std::vector<long long> counts(radii.size() + 1, 0);
+    BruteForceAlgorithm exact;
+    exact.build(dataset);
+    for (const QueryPair& pair : pairs) {
+        counts[exact.query_radius_bucket(pair.p_idx, pair.q_idx, radii)]++;
+    }
+    return counts;
+}
+
+LatencySummary summarize_latencies(std::vector<uint64_t>& ticks) {
+    LatencySummary summary;
+    if (ticks.empty()) return summary;
+    const double scale = CycleClock::ns_per_tick();
+    double total = 0.0;
+    for (uint64_t t : ticks) total += static_cast<double>(t);
+    summary.mean_ns = total / static_cast<double>(ticks.size()) * scale;
+    summary.max_ns = static_cast<double>(*std::max_element(ticks.begin(), ticks.end())) * scale;
+    summary.p999_ns = static_cast<double>(percentile(ticks, 0.999)) * scale;
+    summary.p99_ns = static_cast<double>(percentile(ticks, 0.99)) * scale;
+    summary.p50_ns = static_cast<double>(percentile(ticks, 0.50)) * scale;
+    return summary;
+}
+
+bool run_benchmark(const BenchmarkConfig& config, std::vector<BenchmarkResult>& results, std::ostream& log) {
+    for (const std::string& name : config.algorithms) {
+        if (make_algorithm(name, 1) == nullptr) {
+            log << "Error: Unknown algorithm: " << name << std::endl;
+            return false;
+        }
+    }
+    const int parallel_threads = config.threads > 0 ? config.threads : hardware_thread_count();
+    log << "Timer resolution: " << std::setprecision(3) << CycleClock::ns_per_tick() << " ns/tick" << std::endl;
+
+    for (const std::string& dataset_name : config.datasets) {
+        const std::string dataset_dir = config.data_root + dataset_name;
+        Dataset dataset;
+        if (!dataset.load_from_directory(dataset_dir)) {
+            log << "Error: Failed to load dataset: " << dataset_dir << std::endl;
+            return false;
+        }
+        if (config.transform != DimensionTransformKind::None) {
+            DimensionTransform::fit(dataset, config.transform).apply(dataset);
+        }
+        // 各数据集依次运行，此时没有查询线程
+        specialize_distance_kernels(dataset.dimensions());
+        log << "Dataset " << dataset_name << ": " << dataset.size() << " points x " << dataset.dimensions()
+            << " dims" << std::endl;
+        QuantizedPrefilter prefilter;
+        if (config.prefilter) prefilter.build(dataset);
+        CompactPoints compact;
+        const bool use_compact = config.storage != ScalarType::Float64 && compact.build(dataset, config.storage);
+        if (config.storage != ScalarType::Float64 && !use_compact) {
+            log << "Warning: Coordinates exceed the " << scalar_type_name(config.storage)
+                << " range, full calculations use float64." << std::endl;
+        }
+        if (use_compact && !dataset.is_mapped()) {
+            // 解析自文本 (或经过变换) 的坐标在自有内存中：写到临时文件改为映射，
+            // 这样构建索引之后 double 坐标同样可以离开内存。必须在构建索引之前完成
+            const std::string spill_path = (std::filesystem::temp_directory_path() /
+                                            ("benchmark_" + std::to_string(std::random_device{}()) + ".bin"))
+                                               .string();
+            if (!dataset.map_to_file(spill_path)) {
+                log << "Warning: Could not spill float64 coordinates to " << spill_path
+                    << ", they stay resident." << std::endl;
+            }
+        }
+        if (use_compact) {
+            log << "Compact coordinates: " << compact.memory_bytes() / (1024.0 * 1024.0) << " MB, max rounding error "
+                << compact.max_error() << "; float64 rows are read only for pairs within that margin of r"
+                << (dataset.is_mapped() ? " (kept on disk, mapped pages released after each index build)"
+                                        : " (resident)")
+                << std::endl;
+        }
+        log << "Distance kernels: " << g_distance_kernels.name;
+        if (g_distance_kernels.fixed_dimensions != 0) log << " (unrolled for " << g_distance_kernels.fixed_dimensions << " dims)";
+        if (use_compact) log << ", full calculations on " << compact.kernel_name();
+        log << std::endl;
+
+        // 同一数据集上的所有算法和半径使用同一份工作负载，结果可以逐行对比
+        std::vector<QueryPair> pairs;
+        std::vector<QueryPair> warmup;
+        if (config.workload == "edges") {
+            std::vector<QueryPair> edges;
+            if (!load_edge_list(dataset_dir + "/edges.txt", dataset.size(), edges)) return false;
+            EdgeWorkload grouped = group_edges_by_source(edges, dataset.size());
+            log << "Workload: " << grouped.pairs.size() << " edges from " << grouped.num_sources
+                << " source nodes (grouped by source)" << std::endl;
+            pairs = std::move(grouped.pairs);
+            const size_t warmup_count = std::min(pairs.size(), static_cast<size_t>(config.warmup_queries));
+            warmup.assign(pairs.begin(), pairs.begin() + static_cast<std::ptrdiff_t>(warmup_count));
+        } else {
+            pairs = generate_query_pairs(dataset.size(), static_cast<size_t>(config.num_queries), config.seed);
+            warmup = generate_query_pairs(dataset.size(), static_cast<size_t>(config.warmup_queries), config.seed + 1);
+        }
+
+        for (const std::string& name : config.algorithms) {
+            const std::vector<int> ks = algorithm_uses_k(name) ? config.ks : std::vector<int>{0};
+            for (int k : ks) {
+                auto algorithm = make_algorithm(name, k, config.iterations, config.seed);
+                const std::string index_file = algorithm_index_file(name, k);
+                const std::string index_path =
+                    config.index_cache && !index_file.empty() ? dataset_dir + "/" + index_file : "";
+
+                BenchmarkResult base;
+                base.dataset = dataset_name;
+                base.num_points = dataset.size();
+                base.dimensions = dataset.dimensions();
+                base.algorithm = name;
+                base.k = k;
+                auto start = std::chrono::steady_clock::now();
+                if (!index_path.empty() && std::ifstream(index_path).good()) {
+                    base.index_loaded = algorithm->load(index_path, dataset);
+                }
+                if (!base.index_loaded) {
+                    algorithm->build(dataset);
+                    if (!index_path.empty()) algorithm->save(index_path);
+                }
+                base.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if (config.prefilter) algorithm->set_prefilter(&prefilter);
+                if (use_compact) {
+                    algorithm->set_compact_points(&compact);
+                    // 构建索引时读过全部 double 坐标；之后只有紧凑坐标判定不了的点对才需要它们
+                    dataset.release_mapped_pages();
+                }
+
+                for (double r : config.radii) {
+                    BenchmarkResult result = base;
+                    result.radius = r;
+                    measure(*algorithm, pairs, warmup, r, config, parallel_threads, result);
+                    log << std::fixed << std::setprecision(2) << "  " << std::left << std::setw(14) << name
+                        << std::right << " k=" << std::setw(5) << k << " r=" << std::setw(8) << r
+                        << " | prune " << std::setw(6) << result.pruning_rate * 100.0 << "%"
+                        << " | p50 " << std::setw(9) << result.latency.p50_ns << " ns"
+                        << " | p99 " << std::setw(9) << result.latency.p99_ns << " ns"
+                        << " | p999 " << std::setw(10) << result.latency.p999_ns << " ns"
+                        << " | batch " << std::setw(12) << result.batch_qps << " q/s";
+                    if (use_compact) log << " | float64 fallbacks " << result.exact_fallbacks;
+                    log
+                        << (result.mismatches > 0 ? " | RESULTS DIFFER" : "") << std::endl;
+                    results.push_back(std::move(result));
+                }
+            }
+        }
+    }
+    return true;
+}
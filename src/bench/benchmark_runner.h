@@ -0,0 +1,58 @@
+#pragma once
+#include "../algorithms/pruning_algorithm.h"
+#include "benchmark_config.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 生成 count 个均匀随机的点对，保证 p_idx != q_idx (p == q 的抽样会被重抽，而不是丢弃)；
+// 相同的 seed 生成相同的点对
+std::vector<QueryPair> generate_query_pairs(size_t num_points, size_t count, uint64_t seed);
+
+// 点对距离的分布：对每个点对调用一次多半径查询 (暴力计算，超过最大半径时提前退出)，
+// 返回 radii.size() + 1 个计数，第 b 个为距离落在 (radii[b-1], radii[b]] 的点对数 (radii 按升序排列)
+std::vector<long long> count_radius_buckets(const Dataset& dataset, const std::vector<QueryPair>& pairs,
+                                            const std::vector<double>& radii);
+
+// 逐条查询延迟的分布 (纳秒)
+struct LatencySummary {
+    double mean_ns = 0.0;
+    double p50_ns = 0.0;
+    double p99_ns = 0.0;
+    double p999_ns = 0.0;
+    double max_ns = 0.0;
+};
+
+// 由 CycleClock 计数计算分布 (会重排 ticks)
+LatencySummary summarize_latencies(std::vector<uint64_t>& ticks);
+
+// 参数网格中一个组合的结果。吞吐量取各轮的中位数，延迟分布合并所有轮次的样本
+struct BenchmarkResult {
+    std::string dataset;
+    size_t num_points = 0;
+    size_t dimensions = 0;
+    std::string algorithm;
+    int k = 0; // 不使用 k 的算法为 0
+    double radius = 0.0;
+
+    bool index_loaded = false;
+    double build_ms = 0.0;
+
+    long long queries = 0;         // 每轮的点对数
+    long long exceeding = 0;       // 距离 > r 的点对数
+    long long full_calculations = 0; // 每轮的完整计算次数
+    long long prefilter_decisions = 0;
+    long long exact_fallbacks = 0; // 紧凑坐标判定不了、读取 double 坐标的完整计算次数 (--storage)
+    double pruning_rate = 0.0;     // 省去完整计算的比例 (0~1)
+
+    LatencySummary latency;
+    double single_qps = 0.0;
+    double batch_qps = 0.0;
+    int parallel_threads = 0; // 0 表示未运行多线程测试
+    double parallel_qps = 0.0;
+    size_t mismatches = 0; // 批量 / 多线程结果与逐条查询不一致的点对数 (应为 0)
+};
+
+// 依次运行参数网格中的全部组合，进度写入 log。数据集无法加载或算法名称未知时返回 false
+bool run_benchmark(const BenchmarkConfig& config, std::vector<BenchmarkResult>& results, std::ostream& log);
@@ -0,0 +1,117 @@
+#include "edge_workload.h"
+#include "../algorithms/parallel_query_driver.h"
+#include "../core/mapped_file.h"
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+inline bool is_separator(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == ',';
+}
+
+// 解析一行的前两列；空行和注释行返回 0，成功返回 1，格式错误返回 -1
+int parse_edge_line(const char* p, const char* end, long long& u, long long& v) {
+    while (p < end && is_separator(*p)) ++p;
+    if (p == end || *p == '#' || *p == '%') return 0;
+    for (long long* out : {&u, &v}) {
+        while (p < end && is_separator(*p)) ++p;
+        auto [next, ec] = std::from_chars(p, end, *out);
+        if (ec != std::errc() || (next < end && !is_separator(*next))) return -1;
+        p = next;
+    }
+    return 1;
+}
+
+} // namespace
+
+bool load_edge_list(const std::string& path, size_t num_points, std::vector<QueryPair>& edges) {
+    edges.clear();
+    MappedFile file;
+    if (!file.open(path)) {
+        // 空文件无法映射，视为没有边
+        if (std::ifstream(path).good()) return true;
+        std::cerr << "Error: Could not open edge list: " << path << std::endl;
+        return false;
+    }
+    const char* p = file.data();
+    const char* end = p + file.size();
+    size_t line = 0;
+    while (p < end) {
+        ++line;
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        const char* line_end = newline ? newline : end;
+        long long u = 0;
+        long long v = 0;
+        const int status = parse_edge_line(p, line_end, u, v);
+        if (status < 0) {
+            std::cerr << "Error: Invalid edge at " << path << ":" << line << std::endl;
+            return false;
+        }
+        if (status > 0) {
+            if (u < 0 || v < 0 || static_cast<size_t>(u) >= num_points || static_cast<size_t>(v) >= num_points) {
+                std::cerr << "Error: Edge endpoint out of range (" << num_points << " points) at " << path << ":" << line
+                          << std::endl;
+                return false;
+            }
+            edges.push_back({static_cast<int>(u), static_cast<int>(v)});
+        }
+        p = newline ? newline + 1 : end;
+    }
+    return true;
+}
+
+EdgeWorkload group_edges_by_source(const std::vector<QueryPair>& edges, size_t num_points) {
+    EdgeWorkload workload;
+    std::vector<uint32_t> offsets(num_points + 1, 0);
+    for (const QueryPair& edge : edges) offsets[static_cast<size_t>(edge.p_idx) + 1]++;
+    for (size_t i = 0; i < num_points; ++i) {
+        if (offsets[i + 1] > 0) workload.num_sources++;
+        offsets[i + 1] += offsets[i];
+    }
+    workload.pairs.resize(edges.size());
+    workload.order.resize(edges.size());
+    for (size_t i = 0; i < edges.size(); ++i) {
+        const uint32_t slot = offsets[static_cast<size_t>(edges[i].p_idx)]++;
+        workload.pairs[slot] = edges[i];
+        workload.order[slot] = static_cast<uint32_t>(i);
+    }
+    return workload;
+}
+
+EdgeRunStats run_edge_workload(PruningAlgorithm& algorithm, const EdgeWorkload& workload, double r, int num_threads,
+                               std::vector<uint8_t>& bits) {
+    std::vector<uint8_t> results;
+    const ParallelQueryDriver driver(num_threads);
+    const auto run = driver.run(algorithm, workload.pairs, r, results);
+
+    EdgeRunStats stats;
+    stats.edges = workload.pairs.size();
+    stats.elapsed_ms = run.elapsed_ms;
+    stats.edges_per_second = run.queries_per_second;
+    bits.assign((workload.pairs.size() + 7) / 8, 0);
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i] == 0) continue;
+        const uint32_t edge = workload.order[i];
+        bits[edge / 8] |= static_cast<uint8_t>(1u << (edge % 8));
+        stats.exceeding++;
+    }
+    return stats;
+}
+
+bool write_edge_bitmap(const std::string& path, const std::vector<uint8_t>& bits) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open file for writing: " << path << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(bits.data()), static_cast<std::streamsize>(bits.size()));
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Failed writing edge bitmap: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "../algorithms/pruning_algorithm.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 图数据集的边表工作负载：点对取自数据集目录下的 edges.txt，而不是均匀随机的点对。
+//
+// edges.txt 每行一条边 "u v" (下标从 0 开始，对应 nodes.txt 的行号；以空白或逗号分隔，
+// 其后的列如权重被忽略)，空行和以 '#' / '%' 开头的行被跳过。
+// 读取后按源点 u 分组 (稳定的计数排序)：同一个源点的边相邻，连续查询时 p 的坐标和距离表的行一直在缓存中
+
+// 读取边表；文件无法打开、格式有误或下标超出 [0, num_points) 时打印错误 (含行号) 并返回 false
+bool load_edge_list(const std::string& path, size_t num_points, std::vector<QueryPair>& edges);
+
+// 按源点分组后的边：pairs[i] 是文件中的第 order[i] 条边
+struct EdgeWorkload {
+    std::vector<QueryPair> pairs;
+    std::vector<uint32_t> order;
+    size_t num_sources = 0; // 至少有一条出边的源点个数
+};
+
+EdgeWorkload group_edges_by_source(const std::vector<QueryPair>& edges, size_t num_points);
+
+struct EdgeRunStats {
+    size_t edges = 0;
+    long long exceeding = 0; // 距离 > r 的边数
+    double elapsed_ms = 0.0;
+    double edges_per_second = 0.0;
+};
+
+// 经由 ParallelQueryDriver (批量查询、工作窃取) 对全部边查询一次。
+// bits 按文件中的边序打包：第 i 条边的距离 > r 时第 i 位 (bits[i / 8] 的第 i % 8 位) 为 1
+EdgeRunStats run_edge_workload(PruningAlgorithm& algorithm, const EdgeWorkload& workload, double r, int num_threads,
+                               std::vector<uint8_t>& bits);
+
+// 把位图原样写入文件 (ceil(边数 / 8) 字节，无文件头)；失败时打印错误并返回 false
+bool write_edge_bitmap(const std::string& path, const std::vector<uint8_t>& bits);
@@ -0,0 +1,151 @@
+#include "result_writer.h"
+#include "../core/distance_kernels.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+namespace {
+
+std::string json_string(const std::string& s) {
+    std::ostringstream out;
+    out << '"';
+    for (char c : s) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+template <typename T>
+std::string json_list(const std::vector<T>& values) {
+    std::ostringstream out;
+    out << std::setprecision(17) << '[';
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) out << ", ";
+        if constexpr (std::is_same_v<T, std::string>) {
+            out << json_string(values[i]);
+        } else {
+            out << values[i];
+        }
+    }
+    out << ']';
+    return out.str();
+}
+
+// 每个数据集实际运行的点对数 {"dataset": pairs, ...} (按结果中首次出现的顺序)
+std::string json_dataset_queries(const std::vector<BenchmarkResult>& results) {
+    std::ostringstream out;
+    std::vector<std::string> seen;
+    out << '{';
+    for (const BenchmarkResult& r : results) {
+        if (std::find(seen.begin(), seen.end(), r.dataset) != seen.end()) continue;
+        out << (seen.empty() ? "" : ", ") << json_string(r.dataset) << ": " << r.queries;
+        seen.push_back(r.dataset);
+    }
+    out << '}';
+    return out.str();
+}
+
+// CSV 字段：含逗号或引号时加引号
+std::string csv_field(const std::string& s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string quoted = "\"";
+    for (char c : s) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+bool finish(std::ofstream& out, const std::string& path) {
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Failed writing benchmark results: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool write_results_json(const std::string& path, const BenchmarkConfig& config,
+                        const std::vector<BenchmarkResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open file for writing: " << path << std::endl;
+        return false;
+    }
+    out << std::setprecision(10);
+    out << "{\n  \"config\": {\n"
+        << "    \"data_root\": " << json_string(config.data_root) << ",\n"
+        << "    \"datasets\": " << json_list(config.datasets) << ",\n"
+        << "    \"algorithms\": " << json_list(config.algorithms) << ",\n"
+        << "    \"k\": " << json_list(config.ks) << ",\n"
+        << "    \"radius\": " << json_list(config.radii) << ",\n"
+        << "    \"workload\": " << json_string(config.workload) << ",\n"
+        << "    \"queries\": "
+        << (config.workload == "edges" ? json_dataset_queries(results) : std::to_string(config.num_queries)) << ",\n"
+        << "    \"warmup\": " << config.warmup_queries << ",\n"
+        << "    \"trials\": " << config.trials << ",\n"
+        << "    \"seed\": " << config.seed << ",\n"
+        << "    \"batch_size\": " << config.batch_size << ",\n"
+        << "    \"prefilter\": " << (config.prefilter ? "true" : "false") << ",\n"
+        << "    \"storage\": " << json_string(scalar_type_name(config.storage)) << ",\n"
+        << "    \"transform\": " << json_string(dimension_transform_name(config.transform)) << ",\n"
+        << "    \"distance_kernels\": " << json_string(g_distance_kernels.name) << "\n"
+        << "  },\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& r = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {"
+            << "\"dataset\": " << json_string(r.dataset) << ", \"points\": " << r.num_points
+            << ", \"dimensions\": " << r.dimensions << ", \"algorithm\": " << json_string(r.algorithm)
+            << ", \"k\": " << r.k << ", \"radius\": " << r.radius
+            << ", \"index_loaded\": " << (r.index_loaded ? "true" : "false") << ", \"build_ms\": " << r.build_ms
+            << ", \"queries\": " << r.queries << ", \"exceeding\": " << r.exceeding
+            << ", \"full_calculations\": " << r.full_calculations
+            << ", \"prefilter_decisions\": " << r.prefilter_decisions << ", \"exact_fallbacks\": " << r.exact_fallbacks
+            << ", \"pruning_rate\": " << r.pruning_rate
+            << ", \"latency_mean_ns\": " << r.latency.mean_ns << ", \"latency_p50_ns\": " << r.latency.p50_ns
+            << ", \"latency_p99_ns\": " << r.latency.p99_ns << ", \"latency_p999_ns\": " << r.latency.p999_ns
+            << ", \"latency_max_ns\": " << r.latency.max_ns << ", \"single_qps\": " << r.single_qps
+            << ", \"batch_qps\": " << r.batch_qps << ", \"parallel_threads\": " << r.parallel_threads
+            << ", \"parallel_qps\": " << r.parallel_qps << ", \"mismatches\": " << r.mismatches << "}";
+    }
+    out << "\n  ]\n}\n";
+    return finish(out, path);
+}
+
+bool write_results_csv(const std::string& path, const std::vector<BenchmarkResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open file for writing: " << path << std::endl;
+        return false;
+    }
+    out << "dataset,points,dimensions,algorithm,k,radius,index_loaded,build_ms,queries,exceeding,"
+           "full_calculations,prefilter_decisions,exact_fallbacks,pruning_rate,latency_mean_ns,latency_p50_ns,latency_p99_ns,"
+           "latency_p999_ns,latency_max_ns,single_qps,batch_qps,parallel_threads,parallel_qps,mismatches\n";
+    out << std::setprecision(10);
+    for (const BenchmarkResult& r : results) {
+        out << csv_field(r.dataset) << ',' << r.num_points << ',' << r.dimensions << ',' << csv_field(r.algorithm)
+            << ',' << r.k << ',' << r.radius << ',' << (r.index_loaded ? 1 : 0) << ',' << r.build_ms << ','
+            << r.queries << ',' << r.exceeding << ',' << r.full_calculations << ',' << r.prefilter_decisions << ','
+            << r.exact_fallbacks << ',' << r.pruning_rate << ',' << r.latency.mean_ns << ',' << r.latency.p50_ns << ',' << r.latency.p99_ns
+            << ',' << r.latency.p999_ns << ',' << r.latency.max_ns << ',' << r.single_qps << ',' << r.batch_qps
+            << ',' << r.parallel_threads << ',' << r.parallel_qps << ',' << r.mismatches << '\n';
+    }
+    return finish(out, path);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "benchmark_config.h"
+#include "benchmark_runner.h"
+#include <string>
+#include <vector>
+
+// 把基准测试结果写成机器可读的格式，供回归看板读取。
+// JSON：{"config": {...}, "results": [{...}, ...]}；CSV：表头 + 每个参数组合一行。
+// 两种格式的字段名相同，延迟单位为纳秒，吞吐量单位为 queries/s。文件写入失败时打印错误并返回 false。
+// 每个结果的 queries 是实际运行的点对数；config.queries 在 edges 工作负载下是各数据集的边数 {"dataset": n}
+bool write_results_json(const std::string& path, const BenchmarkConfig& config,
+                        const std::vector<BenchmarkResult>& results);
+bool write_results_csv(const std::string& path, const std::vector<BenchmarkResult>& results);
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+// 二进制数据集格式 (nodes.bin)，版本 1：
+//
+//   [0, sizeof(BinaryDatasetHeader))   文件头
+//   [header.data_offset, ...)          count 行坐标，每行 stride 个元素，行主序，
+//                                      行尾的填充部分为 0
+//
+// data_offset 是页大小 (4096) 的整数倍，因此 mmap 后坐标块的起始地址天然满足
+// alignment 要求，Dataset 可以直接在映射内存上工作而无需任何拷贝。
+// source_bytes / source_mtime_ns 记录转换时 nodes.txt 的大小与修改时间 (均为 0 表示未记录)，
+// 加载目录时与当前的 nodes.txt 比较，发现文本被更新过就不再使用这份二进制文件。
+// 所有整数与浮点数均为小端序。
+
+enum class BinaryDType : uint32_t {
+    Float64 = 1,
+};
+
+constexpr char kBinaryDatasetMagic[8] = {'P', 'R', 'U', 'N', 'E', 'D', 'S', '\0'};
+constexpr uint32_t kBinaryDatasetVersion = 1;
+constexpr uint64_t kBinaryDatasetDataOffset = 4096;
+
+struct BinaryDatasetHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t dtype;       // BinaryDType
+    uint64_t count;       // 点数
+    uint64_t dimensions;  // 维度
+    uint64_t stride;      // 每行元素个数 (>= dimensions)
+    uint64_t alignment;   // 每行起始地址的对齐字节数
+    uint64_t data_offset; // 坐标块相对文件起始的偏移
+    uint64_t source_bytes;    // 转换自的 nodes.txt 的大小
+    int64_t source_mtime_ns;  // 转换自的 nodes.txt 的修改时间
+    uint64_t reserved[1];
+};
+
+static_assert(sizeof(BinaryDatasetHeader) == 80, "BinaryDatasetHeader layout must stay fixed");
+
+// 坐标块 (count 行，每行 stride 个 double) 是否完整地位于 file_bytes 字节的文件内。
+// 头部字段不可信，因此用除法比较，不做可能溢出的 count * stride 乘法
+inline bool binary_dataset_fits(const BinaryDatasetHeader& header, uint64_t file_bytes) {
+    if (header.data_offset > file_bytes) return false;
+    if (header.count == 0) return true;
+    if (header.stride == 0 || header.stride > (file_bytes - header.data_offset) / sizeof(double)) return false;
+    return header.count <= (file_bytes - header.data_offset) / (header.stride * sizeof(double));
+}
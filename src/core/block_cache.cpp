@@ -0,0 +1,120 @@
+#include "block_cache.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+BlockCache::~BlockCache() {
+    close();
+}
+
+bool BlockCache::open(const std::string& path, uint64_t offset, size_t block_bytes, uint64_t total_bytes,
+                      size_t capacity_bytes) {
+    close();
+#if defined(_WIN32)
+    std::cerr << "Error: Block files are not supported on this platform: " << path << std::endl;
+    return false;
+#else
+    if (block_bytes == 0) {
+        std::cerr << "Error: Block size must be positive: " << path << std::endl;
+        return false;
+    }
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        std::cerr << "Error: Could not open block file: " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd_, &info) != 0 || static_cast<uint64_t>(info.st_size) < offset + total_bytes) {
+        std::cerr << "Error: Block file is truncated: " << path << std::endl;
+        close();
+        return false;
+    }
+    path_ = path;
+    offset_ = offset;
+    total_bytes_ = total_bytes;
+    block_bytes_ = block_bytes;
+    num_blocks_ = static_cast<size_t>((total_bytes + block_bytes - 1) / block_bytes);
+    capacity_blocks_ = std::max<size_t>(2, capacity_bytes / block_bytes);
+    entries_.assign(num_blocks_, Entry{});
+    return true;
+#endif
+}
+
+void BlockCache::close() {
+#if !defined(_WIN32)
+    if (fd_ >= 0) ::close(fd_);
+#endif
+    fd_ = -1;
+    entries_.clear();
+    lru_.clear();
+    num_blocks_ = 0;
+}
+
+size_t BlockCache::block_length(size_t block) const {
+    const uint64_t begin = static_cast<uint64_t>(block) * block_bytes_;
+    return static_cast<size_t>(std::min<uint64_t>(block_bytes_, total_bytes_ - begin));
+}
+
+std::shared_ptr<const BlockCache::Block> BlockCache::get(size_t block) {
+    Entry& entry = entries_[block];
+    if (entry.block != nullptr) {
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, entry.position);
+        return entry.block;
+    }
+    ++misses_;
+#if defined(_WIN32)
+    return nullptr;
+#else
+    auto data = std::make_shared<Block>(block_length(block));
+    size_t done = 0;
+    while (done < data->size()) {
+        const ssize_t n = ::pread(fd_, data->data() + done, data->size() - done,
+                                  static_cast<off_t>(offset_ + static_cast<uint64_t>(block) * block_bytes_ + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            std::cerr << "Error: Failed reading block " << block << " of " << path_ << std::endl;
+            return nullptr;
+        }
+        done += static_cast<size_t>(n);
+    }
+    bytes_read_ += data->size();
+
+    if (lru_.size() >= capacity_blocks_) {
+        entries_[lru_.back()].block.reset();
+        lru_.pop_back();
+    }
+    lru_.push_front(block);
+    entry.position = lru_.begin();
+    entry.block = std::move(data);
+    return entry.block;
+#endif
+}
+
+void BlockCache::prefetch(const std::vector<size_t>& blocks) {
+#if defined(POSIX_FADV_WILLNEED)
+    size_t i = 0;
+    while (i < blocks.size()) {
+        if (entries_[blocks[i]].block != nullptr) {
+            ++i;
+            continue;
+        }
+        // 合并连续的未缓存块
+        size_t j = i + 1;
+        while (j < blocks.size() && blocks[j] == blocks[j - 1] + 1 && entries_[blocks[j]].block == nullptr) ++j;
+        const uint64_t begin = offset_ + static_cast<uint64_t>(blocks[i]) * block_bytes_;
+        const uint64_t length = static_cast<uint64_t>(blocks[j - 1] - blocks[i]) * block_bytes_ + block_length(blocks[j - 1]);
+        ::posix_fadvise(fd_, static_cast<off_t>(begin), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+        i = j;
+    }
+#else
+    (void)blocks;
+#endif
+}
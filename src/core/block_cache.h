@@ -0,0 +1,73 @@
+#pragma once
+#include "aligned_allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 文件中一段定长块的只读 LRU 缓存：块 b 占 [offset + b * block_bytes, offset + (b + 1) * block_bytes)
+// (最后一块可以较短)，缓存最多保留 capacity_bytes / block_bytes 个块 (至少 2 个)。
+//
+// 未命中的块用 pread 同步读入 64 字节对齐的缓冲区。prefetch 对即将读取的块调用
+// posix_fadvise(WILLNEED)，让内核按升序预读这些范围，随后的 pread 多半直接命中页缓存；
+// 调用方按块号升序访问时磁盘上是顺序读。
+// get 返回的块由 shared_ptr 持有，之后即使被淘汰也保持有效。不是线程安全的
+class BlockCache {
+public:
+    using Block = std::vector<unsigned char, AlignedAllocator<unsigned char, 64>>;
+
+    BlockCache() = default;
+    ~BlockCache();
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    // 打开文件中 [offset, offset + total_bytes) 这一段；文件无法打开或不够长时打印错误并返回 false
+    bool open(const std::string& path, uint64_t offset, size_t block_bytes, uint64_t total_bytes,
+              size_t capacity_bytes);
+    void close();
+
+    // 返回块 b 的内容；读取失败时打印错误并返回 nullptr
+    std::shared_ptr<const Block> get(size_t block);
+    // 提示即将按升序读取 blocks 中的块 (已缓存的跳过，相邻的块合并为一次提示)
+    void prefetch(const std::vector<size_t>& blocks);
+
+    [[nodiscard]] size_t num_blocks() const { return num_blocks_; }
+    [[nodiscard]] size_t block_bytes() const { return block_bytes_; }
+    [[nodiscard]] size_t capacity_blocks() const { return capacity_blocks_; }
+    [[nodiscard]] size_t cached_blocks() const { return lru_.size(); }
+
+    // 统计：命中 / 未命中的次数和从文件读取的字节数
+    [[nodiscard]] long long hits() const { return hits_; }
+    [[nodiscard]] long long misses() const { return misses_; }
+    [[nodiscard]] uint64_t bytes_read() const { return bytes_read_; }
+    [[nodiscard]] double hit_rate() const {
+        return hits_ + misses_ > 0 ? static_cast<double>(hits_) / static_cast<double>(hits_ + misses_) : 0.0;
+    }
+    void reset_stats() {
+        hits_ = 0;
+        misses_ = 0;
+        bytes_read_ = 0;
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<const Block> block;
+        std::list<size_t>::iterator position; // 在 lru_ 中的位置 (block 非空时有效)
+    };
+    [[nodiscard]] size_t block_length(size_t block) const;
+
+    int fd_ = -1;
+    std::string path_;
+    uint64_t offset_ = 0;
+    uint64_t total_bytes_ = 0;
+    size_t block_bytes_ = 0;
+    size_t num_blocks_ = 0;
+    size_t capacity_blocks_ = 0;
+    std::vector<Entry> entries_; // 按块号
+    std::list<size_t> lru_;      // 表头为最近使用
+    long long hits_ = 0;
+    long long misses_ = 0;
+    uint64_t bytes_read_ = 0;
+};
@@ -0,0 +1,314 @@
+#include "compact_points.h"
+#include "distance_kernels.h"
+#include "float16.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PRUNING_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+#define PRUNING_KERNEL __attribute__((always_inline)) inline
+#define PRUNING_KERNEL_AVX2 __attribute__((target("avx2,fma,f16c"), always_inline)) inline
+
+// 提前退出的检查粒度，与 double 内核的 SSE2 / AVX2 版本相同
+constexpr size_t kExitBlock = 16;
+
+inline double widen(float v) { return v; }
+inline double widen(uint16_t v) { return half_to_float(v); }
+
+// ---------------------------------------------------------------
+//  标量实现：逐个转换为 double 后累加
+// ---------------------------------------------------------------
+template <typename T>
+PRUNING_KERNEL double l2_sq_scalar_impl(const void* pa, const void* pb, size_t n) {
+    const T* a = static_cast<const T*>(pa);
+    const T* b = static_cast<const T*>(pb);
+    double sum_sq = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        const double diff = widen(a[i]) - widen(b[i]);
+        sum_sq += diff * diff;
+    }
+    return sum_sq;
+}
+
+// 分块累加，部分和超过 limit 时立即返回该部分和 (否则返回完整的和)
+template <typename T>
+PRUNING_KERNEL double l2_sq_bounded_scalar_impl(const void* pa, const void* pb, size_t n, double limit) {
+    const T* a = static_cast<const T*>(pa);
+    const T* b = static_cast<const T*>(pb);
+    double partial_sum_sq = 0.0;
+    size_t i = 0;
+    for (; i + kExitBlock <= n; i += kExitBlock) {
+        for (size_t j = i; j < i + kExitBlock; ++j) {
+            const double diff = widen(a[j]) - widen(b[j]);
+            partial_sum_sq += diff * diff;
+        }
+        if (partial_sum_sq > limit) return partial_sum_sq;
+    }
+    for (; i < n; ++i) {
+        const double diff = widen(a[i]) - widen(b[i]);
+        partial_sum_sq += diff * diff;
+    }
+    return partial_sum_sq;
+}
+
+#ifdef PRUNING_X86
+
+// ---------------------------------------------------------------
+//  AVX2 + F16C：一次读入 8 个窄类型坐标 (float16 用 vcvtph2ps 转为 float)，再拆成两组 4 x double
+// ---------------------------------------------------------------
+PRUNING_KERNEL_AVX2 void load8(const float* p, __m256d& lo, __m256d& hi) {
+    const __m256 v = _mm256_loadu_ps(p);
+    lo = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+    hi = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+}
+
+PRUNING_KERNEL_AVX2 void load8(const uint16_t* p, __m256d& lo, __m256d& hi) {
+    const __m256 v = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    lo = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+    hi = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+}
+
+// 累加第 i ~ i+7 维的平方差
+template <typename T>
+PRUNING_KERNEL_AVX2 void accumulate8(const void* a, const void* b, size_t i, __m256d& acc0, __m256d& acc1) {
+    __m256d a0, a1, b0, b1;
+    load8(static_cast<const T*>(a) + i, a0, a1);
+    load8(static_cast<const T*>(b) + i, b0, b1);
+    const __m256d d0 = _mm256_sub_pd(a0, b0);
+    const __m256d d1 = _mm256_sub_pd(a1, b1);
+    acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+    acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+}
+
+PRUNING_KERNEL_AVX2 double hsum_avx2(__m256d v) {
+    const __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+template <typename T>
+PRUNING_KERNEL_AVX2 double l2_sq_avx2_impl(const void* pa, const void* pb, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) accumulate8<T>(pa, pb, i, acc0, acc1);
+    double sum_sq = hsum_avx2(_mm256_add_pd(acc0, acc1));
+    const T* a = static_cast<const T*>(pa);
+    const T* b = static_cast<const T*>(pb);
+    for (; i < n; ++i) {
+        const double diff = widen(a[i]) - widen(b[i]);
+        sum_sq += diff * diff;
+    }
+    return sum_sq;
+}
+
+template <typename T>
+PRUNING_KERNEL_AVX2 double l2_sq_bounded_avx2_impl(const void* pa, const void* pb, size_t n, double limit) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + kExitBlock <= n; i += kExitBlock) {
+        accumulate8<T>(pa, pb, i, acc0, acc1);
+        accumulate8<T>(pa, pb, i + 8, acc0, acc1);
+        const double partial_sum_sq = hsum_avx2(_mm256_add_pd(acc0, acc1));
+        if (partial_sum_sq > limit) return partial_sum_sq;
+    }
+    for (; i + 8 <= n; i += 8) accumulate8<T>(pa, pb, i, acc0, acc1);
+    double sum_sq = hsum_avx2(_mm256_add_pd(acc0, acc1));
+    const T* a = static_cast<const T*>(pa);
+    const T* b = static_cast<const T*>(pb);
+    for (; i < n; ++i) {
+        const double diff = widen(a[i]) - widen(b[i]);
+        sum_sq += diff * diff;
+    }
+    return sum_sq;
+}
+
+#endif // PRUNING_X86
+
+// 内核表使用的函数：通用版本与固定维数版本 (n == D 时以编译期常量调用同一份实现，见 distance_kernels.cpp)
+#define PRUNING_DEFINE_COMPACT_KERNELS(LEVEL, ATTR)                                                          \
+    template <typename T>                                                                                     \
+    ATTR double l2_sq_##LEVEL(const void* a, const void* b, size_t n) {                                      \
+        return l2_sq_##LEVEL##_impl<T>(a, b, n);                                                             \
+    }                                                                                                         \
+    template <typename T>                                                                                     \
+    ATTR double l2_sq_bounded_##LEVEL(const void* a, const void* b, size_t n, double limit) {                \
+        return l2_sq_bounded_##LEVEL##_impl<T>(a, b, n, limit);                                              \
+    }                                                                                                         \
+    template <typename T, size_t D>                                                                           \
+    ATTR double l2_sq_##LEVEL##_fixed(const void* a, const void* b, size_t n) {                              \
+        return n == D ? l2_sq_##LEVEL##_impl<T>(a, b, D) : l2_sq_##LEVEL##_impl<T>(a, b, n);                 \
+    }                                                                                                         \
+    template <typename T, size_t D>                                                                           \
+    ATTR double l2_sq_bounded_##LEVEL##_fixed(const void* a, const void* b, size_t n, double limit) {        \
+        return n == D ? l2_sq_bounded_##LEVEL##_impl<T>(a, b, D, limit)                                      \
+                      : l2_sq_bounded_##LEVEL##_impl<T>(a, b, n, limit);                                     \
+    }
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Waggressive-loop-optimizations"
+PRUNING_DEFINE_COMPACT_KERNELS(scalar, )
+#ifdef PRUNING_X86
+PRUNING_DEFINE_COMPACT_KERNELS(avx2, __attribute__((target("avx2,fma,f16c"))))
+#endif
+#pragma GCC diagnostic pop
+
+struct CompactKernels {
+    CompactPoints::L2SqFn l2_sq;
+    CompactPoints::L2SqBoundedFn l2_sq_bounded;
+    const char* level;
+};
+
+template <typename T, size_t D>
+CompactKernels fixed_kernels(bool avx2) {
+#ifdef PRUNING_X86
+    if (avx2) return {l2_sq_avx2_fixed<T, D>, l2_sq_bounded_avx2_fixed<T, D>, "avx2"};
+#endif
+    (void)avx2;
+    return {l2_sq_scalar_fixed<T, D>, l2_sq_bounded_scalar_fixed<T, D>, "scalar"};
+}
+
+// 按类型、指令集和维数选择内核。固定维数版本跟随 double 内核的选择 (g_distance_kernels.fixed_dimensions)，
+// 因此 PRUNING_FIXED_DIM=0 同样对这里生效
+template <typename T>
+CompactKernels select_kernels(size_t dims) {
+    bool avx2 = false;
+#ifdef PRUNING_X86
+    __builtin_cpu_init();
+    avx2 = g_distance_kernels.level >= SimdLevel::AVX2 && __builtin_cpu_supports("f16c");
+#endif
+    if (g_distance_kernels.fixed_dimensions == dims) {
+        switch (dims) {
+            case 128: return fixed_kernels<T, 128>(avx2);
+            case 384: return fixed_kernels<T, 384>(avx2);
+            case 500: return fixed_kernels<T, 500>(avx2);
+            case 768: return fixed_kernels<T, 768>(avx2);
+            default: break;
+        }
+    }
+#ifdef PRUNING_X86
+    if (avx2) return {l2_sq_avx2<T>, l2_sq_bounded_avx2<T>, "avx2"};
+#endif
+    return {l2_sq_scalar<T>, l2_sq_bounded_scalar<T>, "scalar"};
+}
+
+size_t scalar_bytes(ScalarType type) {
+    return type == ScalarType::Float16 ? sizeof(uint16_t) : type == ScalarType::Float32 ? sizeof(float) : sizeof(double);
+}
+
+} // namespace
+
+const char* scalar_type_name(ScalarType type) {
+    switch (type) {
+        case ScalarType::Float64: return "float64";
+        case ScalarType::Float32: return "float32";
+        case ScalarType::Float16: return "float16";
+    }
+    return "unknown";
+}
+
+bool parse_scalar_type(const std::string& name, ScalarType& type) {
+    for (ScalarType candidate : {ScalarType::Float64, ScalarType::Float32, ScalarType::Float16}) {
+        if (name == scalar_type_name(candidate)) {
+            type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CompactPoints::build(const Dataset& dataset, ScalarType type) {
+    if (type == ScalarType::Float64) {
+        throw std::invalid_argument("CompactPoints: float64 storage is the Dataset itself.");
+    }
+    type_ = type;
+    dims_ = dataset.dimensions();
+    row_bytes_ = (dims_ * scalar_bytes(type) + 63) / 64 * 64;
+    // 累加 dims 个平方项的相对舍入误差不超过 (dims + 1) u，另留出计算门限时的几次舍入
+    slack_ = static_cast<double>(dims_ + 16) * DBL_EPSILON;
+    num_points_ = 0;
+    data_.assign(dataset.size() * row_bytes_, 0);
+    error_.assign(dataset.size(), 0.0);
+    for (size_t i = 0; i < dataset.size(); ++i) {
+        if (!store_row(dataset.get_point(static_cast<int>(i)).data(), data_.data() + i * row_bytes_, error_[i])) {
+            data_.clear();
+            data_.shrink_to_fit();
+            error_.clear();
+            error_.shrink_to_fit();
+            return false;
+        }
+    }
+    num_points_ = dataset.size();
+
+    const CompactKernels kernels = type == ScalarType::Float16 ? select_kernels<uint16_t>(dims_) : select_kernels<float>(dims_);
+    l2_sq_ = kernels.l2_sq;
+    l2_sq_bounded_ = kernels.l2_sq_bounded;
+    kernel_name_ = std::string(scalar_type_name(type)) + "-" + kernels.level;
+    if (g_distance_kernels.fixed_dimensions == dims_) kernel_name_ += "-" + std::to_string(dims_);
+    return true;
+}
+
+bool CompactPoints::append(PointView point) {
+    std::vector<unsigned char> row(row_bytes_, 0);
+    double error = 0.0;
+    if (!store_row(point.data(), row.data(), error)) return false;
+    data_.insert(data_.end(), row.begin(), row.end());
+    error_.push_back(error);
+    ++num_points_;
+    return true;
+}
+
+size_t CompactPoints::decide_bucket(int a, int b, const double* radii, size_t first, size_t last) const {
+    const double margin = error_[a] + error_[b];
+    // 部分和超过最大半径的门限时提前返回：此时它也超过其余半径 (门限随半径递增) 的门限
+    const double cap = thresholds(margin, radii[last - 1]).exceeds;
+    const double sum_sq = l2_sq_bounded_(row_data(a), row_data(b), dims_, cap);
+    for (size_t i = first; i < last; ++i) {
+        const Thresholds t = thresholds(margin, radii[i]);
+        if (sum_sq > t.exceeds) continue;
+        return sum_sq <= t.within ? i : kUndecided;
+    }
+    return last;
+}
+
+bool CompactPoints::encode(PointView point, Query& query) const {
+    query.row.assign(row_bytes_, 0);
+    return store_row(point.data(), query.row.data(), query.error);
+}
+
+double CompactPoints::max_error() const {
+    double result = 0.0;
+    for (double e : error_) result = std::max(result, e);
+    return result;
+}
+
+bool CompactPoints::store_row(const double* x, unsigned char* out, double& error) const {
+    double error_sq = 0.0;
+    for (size_t j = 0; j < dims_; ++j) {
+        // 就近舍入；超出目标类型范围 (或本身不是有限值) 的坐标无法给出有限的误差界
+        const auto f = static_cast<float>(x[j]);
+        double stored = f;
+        if (type_ == ScalarType::Float32) {
+            std::memcpy(out + j * sizeof(float), &f, sizeof(float));
+        } else {
+            const uint16_t h = float_to_half(f);
+            stored = half_to_float(h);
+            std::memcpy(out + j * sizeof(uint16_t), &h, sizeof(uint16_t));
+        }
+        if (!std::isfinite(stored) || !std::isfinite(x[j])) return false;
+        // x 与其舍入值同号且相差不到一倍 (或舍入为 0)，差是精确的
+        const double diff = x[j] - stored;
+        error_sq += diff * diff;
+    }
+    // 平方和与开方的舍入由 slack_ 覆盖
+    error = std::sqrt(error_sq) * (1.0 + slack_);
+    return true;
+}
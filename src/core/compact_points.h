@@ -0,0 +1,116 @@
+#pragma once
+#include "aligned_allocator.h"
+#include "dataset.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 坐标的存储类型
+enum class ScalarType : uint32_t {
+    Float64 = 0, // Dataset 本身 (不建副本)
+    Float32 = 1,
+    Float16 = 2, // IEEE 754 binary16
+};
+
+const char* scalar_type_name(ScalarType type);
+// 解析 "float64" / "float32" / "float16"，无法识别时返回 false
+bool parse_scalar_type(const std::string& name, ScalarType& type);
+
+// 数据集坐标的紧凑副本 (float32 或 float16)：点对查询的完整计算读它，每个点占用的缓存行只有 double 的 1/2 或 1/4。
+//
+// 坐标按就近舍入存储 (不要求能精确表示，文本解析得到的坐标一般都不能)，构建时精确计算每个点的舍入误差
+// e_x = ||x - x̃||，由三角不等式 d(x̃, ỹ) - e_x - e_y <= d(x, y) <= d(x̃, ỹ) + e_x + e_y 判定，
+// 浮点累加的舍入也计入余量 (与 QuantizedPrefilter 的做法相同)。判定是可证明正确的；
+// 只有 d(x̃, ỹ) 落在 r ± (e_x + e_y) 之内时无法判定，由调用方读取 Dataset 的 double 坐标精确计算。
+// 点对查询、多半径查询和范围查询都先由紧凑坐标判定，因此 double 坐标只在这少数点对上被读取：
+// 数据集映射自文件时 (nodes.bin，或用 Dataset::map_to_file 转存的解析结果)，构建完索引后可以用
+// Dataset::release_mapped_pages 让它们留在磁盘上 (benchmark 的 --storage 即如此)。
+// 内核按类型、指令集 (AVX2 + F16C) 和维数 (128 / 384 / 500 / 768 为展开的固定维数版本) 在 build 时选定一次
+class CompactPoints {
+public:
+    using L2SqFn = double (*)(const void* a, const void* b, size_t n);
+    // 分块累加，部分和超过 limit 时提前返回该部分和
+    using L2SqBoundedFn = double (*)(const void* a, const void* b, size_t n, double limit);
+
+    // type 为 Float64 时抛出 std::invalid_argument (直接使用 Dataset 即可)。
+    // 有坐标超出 type 的表示范围 (float16 为 ±65504) 或不是有限值时返回 false
+    bool build(const Dataset& dataset, ScalarType type);
+    // 追加一个点 (数据集末尾新增的点)；坐标超出范围时返回 false 且不做任何修改
+    bool append(PointView point);
+
+    // 不在数据集中的查询点舍入后的行及其舍入误差 (由 encode 生成)
+    struct Query {
+        std::vector<unsigned char, AlignedAllocator<unsigned char, 64>> row;
+        double error = 0.0;
+    };
+    // 多半径判定无法给出结论时 decide_bucket 的返回值
+    static constexpr size_t kUndecided = static_cast<size_t>(-1);
+
+    // 返回 1 表示已证明 d(a, b) > r，0 表示已证明 d(a, b) <= r，-1 表示无法判定
+    [[nodiscard]] int decide(int a, int b, double r) const {
+        const Thresholds t = thresholds(error_[a] + error_[b], r);
+        const double sum_sq = l2_sq_(row_data(a), row_data(b), dims_);
+        return sum_sq > t.exceeds ? 1 : (sum_sq <= t.within ? 0 : -1);
+    }
+    // 同上，分块累加，部分和已能证明 d(a, b) > r 时提前退出
+    [[nodiscard]] int decide_early_exit(int a, int b, double r) const {
+        return decide_rows(row_data(a), row_data(b), error_[a] + error_[b], r);
+    }
+    // 查询点与第 b 个点，其余同 decide_early_exit
+    [[nodiscard]] int decide_early_exit(const Query& query, int b, double r) const {
+        return decide_rows(query.row.data(), row_data(b), query.error + error_[b], r);
+    }
+    // 多半径查询：radii[first, last) 升序排列，返回 i 使 radii[first, i) 都已证明被 d(a, b) 超过、
+    // radii[i] (i < last 时) 已证明不被超过；部分和超过 radii[last - 1] 的门限时提前退出。无法判定时返回 kUndecided
+    [[nodiscard]] size_t decide_bucket(int a, int b, const double* radii, size_t first, size_t last) const;
+    // 把查询点舍入为紧凑行；坐标超出范围时返回 false
+    bool encode(PointView point, Query& query) const;
+
+    [[nodiscard]] bool empty() const { return num_points_ == 0; }
+    [[nodiscard]] size_t size() const { return num_points_; }
+    [[nodiscard]] size_t dimensions() const { return dims_; }
+    [[nodiscard]] ScalarType type() const { return type_; }
+    [[nodiscard]] size_t memory_bytes() const { return data_.capacity() + error_.capacity() * sizeof(double); }
+    [[nodiscard]] const unsigned char* row_data(int idx) const {
+        return data_.data() + static_cast<size_t>(idx) * row_bytes_;
+    }
+    [[nodiscard]] size_t row_bytes() const { return row_bytes_; }
+    // 第 idx 个点的舍入误差上界，以及全部点中的最大值
+    [[nodiscard]] double error(int idx) const { return error_[idx]; }
+    [[nodiscard]] double max_error() const;
+    // 选定的内核 (如 "float16-avx2-768")
+    [[nodiscard]] const std::string& kernel_name() const { return kernel_name_; }
+
+private:
+    // 近似距离平方 s 的门限：s > exceeds 蕴含 d > r，s <= within 蕴含 d <= r
+    struct Thresholds {
+        double exceeds;
+        double within;
+    };
+    // margin 为两个点的舍入误差之和
+    [[nodiscard]] Thresholds thresholds(double margin, double r) const {
+        const double upper = r + margin;
+        const double lower = r - margin;
+        return {upper * upper * (1.0 + slack_), lower > 0.0 ? lower * lower * (1.0 - slack_) : -1.0};
+    }
+    [[nodiscard]] int decide_rows(const unsigned char* a, const unsigned char* b, double margin, double r) const {
+        const Thresholds t = thresholds(margin, r);
+        const double sum_sq = l2_sq_bounded_(a, b, dims_, t.exceeds);
+        return sum_sq > t.exceeds ? 1 : (sum_sq <= t.within ? 0 : -1);
+    }
+    // 把一行 double 坐标舍入后写入 out 并给出误差上界，坐标超出范围时返回 false
+    bool store_row(const double* x, unsigned char* out, double& error) const;
+
+    size_t num_points_ = 0;
+    size_t dims_ = 0;
+    size_t row_bytes_ = 0; // 补齐到 64
+    ScalarType type_ = ScalarType::Float32;
+    std::vector<unsigned char, AlignedAllocator<unsigned char, 64>> data_;
+    L2SqFn l2_sq_ = nullptr;
+    L2SqBoundedFn l2_sq_bounded_ = nullptr;
+    std::vector<double> error_; // 每个点的舍入误差上界 (已计入 slack_)
+    double slack_ = 0.0;        // 累加与门限计算的相对舍入余量
+    std::string kernel_name_;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// 低开销计时：x86 上直接读时间戳计数器 (rdtsc，约 20 个周期，比 steady_clock::now 便宜一个数量级)，
+// 其它平台退化为 steady_clock 的纳秒计数。现代 x86 的 TSC 频率恒定，与当前核心频率无关。
+// 逐条查询计时只需要 now() 的差值，换算成纳秒放到统计阶段再做
+class CycleClock {
+public:
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+#endif
+    }
+
+    // 每个计数对应的纳秒数 (首次调用时用 steady_clock 校准约 20 ms)
+    static double ns_per_tick() {
+        static const double value = calibrate();
+        return value;
+    }
+
+private:
+    static double calibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+        const auto start_time = std::chrono::steady_clock::now();
+        const uint64_t start_ticks = __rdtsc();
+        std::chrono::steady_clock::time_point end_time;
+        do {
+            end_time = std::chrono::steady_clock::now();
+        } while (end_time - start_time < std::chrono::milliseconds(20));
+        const uint64_t ticks = __rdtsc() - start_ticks;
+        const double ns = std::chrono::duration<double, std::nano>(end_time - start_time).count();
+        return ticks > 0 ? ns / static_cast<double>(ticks) : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+};
@@ -1,15 +1,280 @@
 #include "dataset.h"
+#include "binary_format.h"
+#include "hash.h"
+#include "text_parser.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// 按 row_of(i) 给出的顺序对 count 行做哈希；sampled 时只取均匀分布的 kFingerprintSamples 行 (含首尾两行)
+template <typename RowOf>
+uint64_t hash_rows(size_t count, size_t dimensions, bool sampled, RowOf row_of) {
+    Hash64 hash;
+    hash.update_value(static_cast<uint64_t>(count));
+    hash.update_value(static_cast<uint64_t>(dimensions));
+    const size_t samples = Dataset::kFingerprintSamples;
+    if (!sampled || count <= samples) {
+        for (size_t i = 0; i < count; ++i) hash.update(row_of(i), dimensions * sizeof(double));
+    } else {
+        for (size_t j = 0; j < samples; ++j) {
+            hash.update(row_of(j * (count - 1) / (samples - 1)), dimensions * sizeof(double));
+        }
+    }
+    return hash.digest();
+}
+
+} // namespace
+
+Dataset::Dataset(const Dataset& other)
+    : data_(other.data_), mapping_(other.mapping_),
+      num_points_(other.num_points_), dimensions_(other.dimensions_), stride_(other.stride_),
+      erased_(other.erased_), erased_count_(other.erased_count_) {
+    base_ = mapping_ ? other.base_ : data_.data();
+}
+
+Dataset::Dataset(Dataset&& other) noexcept
+    : data_(std::move(other.data_)), mapping_(std::move(other.mapping_)), base_(other.base_),
+      num_points_(other.num_points_), dimensions_(other.dimensions_), stride_(other.stride_),
+      erased_(std::move(other.erased_)), erased_count_(other.erased_count_) {
+    other.reset(0);
+}
+
+Dataset& Dataset::operator=(const Dataset& other) {
+    if (this != &other) {
+        Dataset copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+Dataset& Dataset::operator=(Dataset&& other) noexcept {
+    if (this != &other) {
+        data_ = std::move(other.data_);
+        mapping_ = std::move(other.mapping_);
+        base_ = other.base_;
+        num_points_ = other.num_points_;
+        dimensions_ = other.dimensions_;
+        stride_ = other.stride_;
+        erased_ = std::move(other.erased_);
+        erased_count_ = other.erased_count_;
+        other.reset(0);
+    }
+    return *this;
+}
+
+void Dataset::reset(size_t dimensions) {
+    data_.clear();
+    mapping_.reset();
+    base_ = data_.data();
+    num_points_ = 0;
+    erased_.clear();
+    erased_count_ = 0;
+    dimensions_ = dimensions;
+    // 把每行长度补齐到缓存行的整数倍，保证每一行都是 64 字节对齐的
+    stride_ = (dimensions + kStrideMultiple - 1) / kStrideMultiple * kStrideMultiple;
+}
+
+void Dataset::reserve(size_t num_points) {
+    materialize();
+    data_.reserve(num_points * stride_);
+    base_ = data_.data();
+}
+
+void Dataset::materialize() {
+    if (!mapping_) return;
+    data_.assign(base_, base_ + num_points_ * stride_);
+    mapping_.reset();
+    base_ = data_.data();
+}
+
+int Dataset::add_point(PointView p) {
+    assert(p.size() == dimensions_);
+    materialize();
+    size_t offset = data_.size();
+    data_.resize(offset + stride_, 0.0);
+    std::copy(p.begin(), p.end(), data_.begin() + static_cast<std::ptrdiff_t>(offset));
+    base_ = data_.data();
+    return static_cast<int>(num_points_++);
+}
+
+void Dataset::resize(size_t num_points) {
+    materialize();
+    data_.resize(num_points * stride_, 0.0);
+    base_ = data_.data();
+    num_points_ = num_points;
+    if (erased_.size() > num_points) {
+        erased_.resize(num_points);
+        erased_count_ = static_cast<size_t>(std::count(erased_.begin(), erased_.end(), uint8_t{1}));
+    }
+}
+
+void Dataset::erase(int index) {
+    assert(index >= 0 && static_cast<size_t>(index) < num_points_);
+    if (erased_.size() < num_points_) erased_.resize(num_points_, 0);
+    if (erased_[index] == 0) {
+        erased_[index] = 1;
+        ++erased_count_;
+    }
+}
+
+std::vector<int> Dataset::compact() {
+    std::vector<int> kept;
+    kept.reserve(live_size());
+    for (size_t i = 0; i < num_points_; ++i) {
+        if (!is_erased(static_cast<int>(i))) kept.push_back(static_cast<int>(i));
+    }
+    if (kept.size() != num_points_) {
+        materialize();
+        for (size_t i = 0; i < kept.size(); ++i) {
+            if (static_cast<size_t>(kept[i]) == i) continue;
+            std::copy_n(data_.data() + static_cast<size_t>(kept[i]) * stride_, stride_, data_.data() + i * stride_);
+        }
+        resize(kept.size());
+    }
+    erased_.clear();
+    erased_count_ = 0;
+    return kept;
+}
+
+void Dataset::permute(const std::vector<int>& order) {
+    std::vector<uint8_t> placed(num_points_, 0);
+    bool valid = order.size() == num_points_;
+    for (size_t i = 0; valid && i < order.size(); ++i) {
+        valid = order[i] >= 0 && static_cast<size_t>(order[i]) < num_points_ && placed[order[i]] == 0;
+        if (valid) placed[order[i]] = 1;
+    }
+    if (!valid) throw std::invalid_argument("Dataset::permute: order is not a permutation of the points.");
+
+    materialize();
+    // 沿置换的环移动：环首的行暂存一份，其余行各自搬到目标位置
+    std::fill(placed.begin(), placed.end(), uint8_t{0});
+    std::vector<double> row(stride_);
+    double* data = data_.data();
+    for (size_t start = 0; start < num_points_; ++start) {
+        if (placed[start] != 0) continue;
+        std::copy_n(data + start * stride_, stride_, row.data());
+        size_t i = start;
+        for (size_t from = static_cast<size_t>(order[i]); from != start; from = static_cast<size_t>(order[i])) {
+            std::copy_n(data + from * stride_, stride_, data + i * stride_);
+            placed[i] = 1;
+            i = from;
+        }
+        std::copy_n(row.data(), stride_, data + i * stride_);
+        placed[i] = 1;
+    }
+    if (erased_count_ > 0) {
+        erased_.resize(num_points_, 0);
+        std::vector<uint8_t> erased(num_points_);
+        for (size_t i = 0; i < num_points_; ++i) erased[i] = erased_[order[i]];
+        erased_ = std::move(erased);
+    }
+}
+
+double* Dataset::mutable_data() {
+    materialize();
+    return data_.data();
+}
+
+bool Dataset::release_mapped_pages() const {
+    if (mapping_ == nullptr) return false;
+    mapping_->release_pages();
+    return true;
+}
+
+bool Dataset::map_to_file(const std::string& path) {
+    if (mapping_ != nullptr) return true;
+    Dataset mapped;
+    if (!save_binary(path) || !mapped.load_binary(path)) return false;
+    // 映射持有 inode，删除目录项之后数据仍然可读，进程退出时由系统回收
+    std::remove(path.c_str());
+    mapped.erased_ = std::move(erased_);
+    mapped.erased_count_ = erased_count_;
+    *this = std::move(mapped);
+    return true;
+}
+
+uint64_t Dataset::fingerprint() const {
+    return hash_rows(num_points_, dimensions_, false, [&](size_t i) { return base_ + i * stride_; });
+}
+
+uint64_t Dataset::sampled_fingerprint() const {
+    return hash_rows(num_points_, dimensions_, true, [&](size_t i) { return base_ + i * stride_; });
+}
+
+uint64_t Dataset::fingerprint(const std::vector<int>& order) const {
+    return hash_rows(order.size(), dimensions_, false,
+                     [&](size_t i) { return base_ + static_cast<size_t>(order[i]) * stride_; });
+}
+
+uint64_t Dataset::sampled_fingerprint(const std::vector<int>& order) const {
+    return hash_rows(order.size(), dimensions_, true,
+                     [&](size_t i) { return base_ + static_cast<size_t>(order[i]) * stride_; });
+}
+
+bool stat_source_file(const std::string& path, SourceStamp& stamp) {
+    std::error_code error;
+    const auto bytes = std::filesystem::file_size(path, error);
+    if (error) return false;
+    const auto mtime = std::filesystem::last_write_time(path, error);
+    if (error) return false;
+    stamp.bytes = static_cast<uint64_t>(bytes);
+    stamp.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+    return true;
+}
 
 bool Dataset::load_from_directory(const std::string& dir_path) {
-    // 拼接出 nodes.txt 的完整路径
+    // 拼接出 nodes.bin / nodes.txt 的完整路径
     // 注意：在 Windows 上，路径分隔符可能是 '\'。为简单起见，这里使用 '/'，
     // 在现代操作系统和C++库中通常可以通用。
-    // 使用 C++17 的 <filesystem> 是更健壮的做法。
+    std::string bin_filepath = dir_path + "/nodes.bin";
     std::string nodes_filepath = dir_path + "/nodes.txt";
+    if (std::ifstream(bin_filepath).good() && load_binary(bin_filepath)) {
+        // 只有 nodes.bin 时直接使用；两者都在时 nodes.bin 必须转换自当前的 nodes.txt
+        SourceStamp current;
+        BinaryDatasetHeader header;
+        std::memcpy(&header, mapping_->data(), sizeof(header));
+        if (!stat_source_file(nodes_filepath, current) ||
+            (header.source_bytes == current.bytes && header.source_mtime_ns == current.mtime_ns &&
+             header.source_bytes != 0)) {
+            std::cout << "Dataset '" << dir_path << "' mapped from nodes.bin: " << num_points_ << " points, "
+                      << dimensions_ << " dimensions." << std::endl;
+            return true;
+        }
+        std::cerr << "Warning: " << bin_filepath << " was not converted from the current nodes.txt "
+                  << "(size or modification time differ); parsing nodes.txt instead. Re-run convert_nodes to refresh it."
+                  << std::endl;
+    }
+
+    if (!load_text(nodes_filepath)) {
+        return false;
+    }
+    std::cout << "Dataset '" << dir_path << "' loaded: " << num_points_ << " points, "
+              << dimensions_ << " dimensions." << std::endl;
+    return true;
+}
+
+bool Dataset::load_text(const std::string& nodes_filepath, int num_threads) {
+    MappedFile file;
+    if (!file.open(nodes_filepath)) {
+        // 无法映射 (文件不存在、为空或平台不支持) 时回退到逐行解析
+        return load_text_stream(nodes_filepath);
+    }
+    if (!parse_nodes_text(file.data(), file.size(), *this, num_threads, nodes_filepath)) {
+        return false;
+    }
+    return true;
+}
 
+bool Dataset::load_text_stream(const std::string& nodes_filepath) {
     std::ifstream file(nodes_filepath);
     if (!file.is_open()) {
         std::cerr << "Error: Could not open nodes file: " << nodes_filepath << std::endl;
@@ -17,35 +282,115 @@ bool Dataset::load_from_directory(const std::string& dir_path) {
     }
 
     // 清空旧数据，以便重用 Dataset 对象
-    points_.clear();
-    dimensions_ = 0;
+    reset(0);
 
     std::string line;
+    Point row; // 复用同一个行缓冲，避免每行一次堆分配
     while (std::getline(file, line)) {
         if (line.empty()) continue;
 
         std::stringstream ss(line);
-        Point p;
+        row.clear();
         double val;
         while (ss >> val) {
-            p.push_back(val);
+            row.push_back(val);
         }
 
-        if (!p.empty()) {
-            if (points_.empty()) {
-                dimensions_ = p.size();
-            } else {
-                if (p.size() != dimensions_) {
-                    std::cerr << "Error: Inconsistent dimension in dataset file." << std::endl;
-                    points_.clear(); // 加载失败，清空
-                    return false;
-                }
+        if (!row.empty()) {
+            if (num_points_ == 0) {
+                reset(row.size());
+            } else if (row.size() != dimensions_) {
+                std::cerr << "Error: Inconsistent dimension in dataset file." << std::endl;
+                reset(0); // 加载失败，清空
+                return false;
             }
-            points_.push_back(p);
+            add_point(row);
         }
     }
+    return true;
+}
 
-    std::cout << "Dataset '" << dir_path << "' loaded: " << points_.size() << " points, "
-              << dimensions_ << " dimensions." << std::endl;
+bool Dataset::load_binary(const std::string& bin_filepath) {
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(bin_filepath)) {
+        std::cerr << "Error: Could not map binary nodes file: " << bin_filepath << std::endl;
+        return false;
+    }
+    if (mapping->size() < sizeof(BinaryDatasetHeader)) {
+        std::cerr << "Error: Binary nodes file is truncated: " << bin_filepath << std::endl;
+        return false;
+    }
+
+    BinaryDatasetHeader header;
+    std::memcpy(&header, mapping->data(), sizeof(header));
+    if (std::memcmp(header.magic, kBinaryDatasetMagic, sizeof(header.magic)) != 0) {
+        std::cerr << "Error: Not a binary nodes file: " << bin_filepath << std::endl;
+        return false;
+    }
+    if (header.version != kBinaryDatasetVersion) {
+        std::cerr << "Error: Unsupported binary nodes version " << header.version << ": " << bin_filepath << std::endl;
+        return false;
+    }
+    if (header.dtype != static_cast<uint32_t>(BinaryDType::Float64)) {
+        std::cerr << "Error: Unsupported binary nodes dtype " << header.dtype << ": " << bin_filepath << std::endl;
+        return false;
+    }
+    // Dataset 要求每行 64 字节对齐，因此行跨度与数据偏移都必须满足对齐要求
+    if (header.stride < header.dimensions || header.stride % kStrideMultiple != 0 ||
+        header.alignment % kAlignment != 0 || header.data_offset % kAlignment != 0) {
+        std::cerr << "Error: Binary nodes layout is not " << kAlignment << "-byte aligned: " << bin_filepath << std::endl;
+        return false;
+    }
+    if (!binary_dataset_fits(header, mapping->size())) {
+        std::cerr << "Error: Binary nodes file is truncated: " << bin_filepath << std::endl;
+        return false;
+    }
+
+    reset(0);
+    num_points_ = header.count;
+    dimensions_ = header.dimensions;
+    stride_ = header.stride;
+    base_ = reinterpret_cast<const double*>(mapping->data() + header.data_offset);
+    mapping_ = std::move(mapping);
+    return true;
+}
+
+bool Dataset::save_binary(const std::string& bin_filepath, const SourceStamp& source) const {
+    // 不能原地截断：其它进程可能正映射着这个文件
+    const std::string tmp_filepath = bin_filepath + ".tmp";
+    std::ofstream out(tmp_filepath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open output file: " << tmp_filepath << std::endl;
+        return false;
+    }
+
+    BinaryDatasetHeader header{};
+    std::memcpy(header.magic, kBinaryDatasetMagic, sizeof(header.magic));
+    header.version = kBinaryDatasetVersion;
+    header.dtype = static_cast<uint32_t>(BinaryDType::Float64);
+    header.count = num_points_;
+    header.dimensions = dimensions_;
+    header.stride = stride_;
+    header.alignment = kAlignment;
+    header.data_offset = kBinaryDatasetDataOffset;
+    header.source_bytes = source.bytes;
+    header.source_mtime_ns = source.mtime_ns;
+
+    std::vector<char> header_block(kBinaryDatasetDataOffset, 0);
+    std::memcpy(header_block.data(), &header, sizeof(header));
+    out.write(header_block.data(), static_cast<std::streamsize>(header_block.size()));
+    // 行尾的填充部分也恒为 0，可以整块写出
+    out.write(reinterpret_cast<const char*>(base_), static_cast<std::streamsize>(num_points_ * stride_ * sizeof(double)));
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Failed to write binary nodes file: " << tmp_filepath << std::endl;
+        std::remove(tmp_filepath.c_str());
+        return false;
+    }
+    if (std::rename(tmp_filepath.c_str(), bin_filepath.c_str()) != 0) {
+        std::cerr << "Error: Could not replace " << bin_filepath << " with " << tmp_filepath << std::endl;
+        std::remove(tmp_filepath.c_str());
+        return false;
+    }
     return true;
-}
\ No newline at end of file
+}
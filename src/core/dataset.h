@@ -1,20 +1,116 @@
 #pragma once
+#include "aligned_allocator.h"
+#include "mapped_file.h"
 #include "point.h"
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+// 文本源文件的大小与修改时间：写进 nodes.bin，加载目录时用来发现 nodes.txt 在转换之后被更新过
+struct SourceStamp {
+    uint64_t bytes = 0;
+    int64_t mtime_ns = 0;
+};
+// 读取文件当前的大小与修改时间，文件不存在时返回 false
+bool stat_source_file(const std::string& path, SourceStamp& stamp);
+
 class Dataset {
 public:
-    // 从指定的数据集目录加载数据 (会寻找目录下的 nodes.txt)
+    // 每行起始地址按 64 字节（一个缓存行）对齐
+    static constexpr size_t kAlignment = 64;
+    static constexpr size_t kStrideMultiple = kAlignment / sizeof(double);
+
+    Dataset() = default;
+    Dataset(const Dataset& other);
+    Dataset(Dataset&& other) noexcept;
+    Dataset& operator=(const Dataset& other);
+    Dataset& operator=(Dataset&& other) noexcept;
+
+    // 从指定的数据集目录加载数据：优先内存映射 nodes.bin，不存在时回退到解析 nodes.txt。
+    // nodes.txt 的大小或修改时间与 nodes.bin 记录的不一致 (或没有记录) 时打印警告并解析 nodes.txt。
+    // 加载不会改变距离内核：按维数选择内核由调用方在开始查询之前完成 (见 specialize_distance_kernels)
     bool load_from_directory(const std::string& dir_path);
+    // 解析文本格式 (每行一个点，坐标以空白分隔)：内存映射后分块并行解析，见 text_parser.h
+    bool load_text(const std::string& nodes_filepath, int num_threads = 0);
+    // 基于 std::getline + stringstream 的逐行解析器。速度慢，保留作为
+    // 无法内存映射时的回退路径，以及解析性能对比的基线
+    bool load_text_stream(const std::string& nodes_filepath);
+    // 零拷贝地映射二进制格式 (见 binary_format.h)；映射的页在多个进程之间共享
+    bool load_binary(const std::string& bin_filepath);
+    // 写出二进制格式，source 为转换自的文本文件 (在解析之前取得，见 stat_source_file)。
+    // 先写 <bin_filepath>.tmp 再 rename 覆盖：正在映射旧文件的进程继续使用旧的 inode，不会因截断收到 SIGBUS
+    bool save_binary(const std::string& bin_filepath, const SourceStamp& source = {}) const;
 
-    [[nodiscard]] const Point& get_point(int index) const { return points_[index]; }
-    [[nodiscard]] size_t size() const { return points_.size(); }
+    // 清空数据并设定维度，之后可通过 add_point 逐个追加点
+    void reset(size_t dimensions);
+    void reserve(size_t num_points);
+    // 追加一个点 (维度必须与 dimensions() 一致)，返回其下标。
+    // 若数据来自内存映射，会先把数据拷贝到自有内存中
+    int add_point(PointView p);
+    // 调整点数，新增的点坐标为 0
+    void resize(size_t num_points);
+    // 删除标记 (墓碑)：erase 只做标记，点的下标和坐标保持不变，直到 compact 才真正移除。
+    // 带标记的点不再出现在范围查询结果中 (见 PruningAlgorithm::erase_point)
+    void erase(int index);
+    [[nodiscard]] bool is_erased(int index) const {
+        return static_cast<size_t>(index) < erased_.size() && erased_[index] != 0;
+    }
+    [[nodiscard]] size_t erased_count() const { return erased_count_; }
+    // 未被删除的点数
+    [[nodiscard]] size_t live_size() const { return num_points_ - erased_count_; }
+    // 移除所有带删除标记的点，其余点保持相对顺序。返回保留的点的原下标：
+    // 压缩后第 i 个点原来是第 kept[i] 个点
+    std::vector<int> compact();
+    // 原地重排：之后第 i 个点是原来的第 order[i] 个点，删除标记随点移动。只需一行的额外内存
+    // (数据来自内存映射时先拷贝到自有内存中)。order 不是 [0, size()) 的排列时抛出 std::invalid_argument
+    void permute(const std::vector<int>& order);
+    // 可写的行主序缓冲区 (若数据来自内存映射，会先拷贝到自有内存中)。
+    // 写入时必须保持每行的填充部分为 0
+    [[nodiscard]] double* mutable_data();
+
+    [[nodiscard]] PointView get_point(int index) const {
+        return {base_ + static_cast<size_t>(index) * stride_, dimensions_};
+    }
+    [[nodiscard]] size_t size() const { return num_points_; }
     [[nodiscard]] size_t dimensions() const { return dimensions_; }
 
-    [[nodiscard]] const std::vector<Point>& get_all_points() const { return points_; }
+    // 连续的行主序缓冲区：第 i 个点位于 data() + i * stride()，
+    // stride() >= dimensions()，多出的填充部分恒为 0
+    [[nodiscard]] const double* data() const { return base_; }
+    [[nodiscard]] size_t stride() const { return stride_; }
+    // 数据是否直接位于内存映射的文件中
+    [[nodiscard]] bool is_mapped() const { return mapping_ != nullptr; }
+    // 内存映射的数据集：让已载入的页失效，之后只有被访问到的行才重新读入 (用于 double 坐标只在
+    // 少数点对上读取的场合，见 CompactPoints)。数据在自有内存中时什么也不做并返回 false
+    bool release_mapped_pages() const;
+    // 把自有内存中的坐标写到 path 并改为内存映射它，随后删除该文件 (映射保持有效)，释放自有缓冲区；
+    // 删除标记保留。之后可以像 nodes.bin 一样用 release_mapped_pages 让 double 坐标留在磁盘上。
+    // 已经是内存映射时什么也不做。坐标的地址会改变，因此必须在构建索引等持有 get_point 结果之前调用
+    bool map_to_file(const std::string& path);
+
+    // 数据集指纹：对点数、维度和全部坐标 (不含行尾填充) 做哈希。
+    // 持久化的索引用它来识别自己是否基于同一份数据构建
+    [[nodiscard]] uint64_t fingerprint() const;
+    // 抽样指纹：只对点数、维度和均匀抽取的 kFingerprintSamples 行做哈希，与数据集大小无关，
+    // 加载索引时用它代替读取全部坐标的 fingerprint()
+    static constexpr size_t kFingerprintSamples = 64;
+    [[nodiscard]] uint64_t sampled_fingerprint() const;
+    // 按 order 的顺序 (第 i 行为 get_point(order[i])) 计算的两种指纹，
+    // 等于按该顺序复制出的数据集的 fingerprint() / sampled_fingerprint()，但不需要那份副本
+    [[nodiscard]] uint64_t fingerprint(const std::vector<int>& order) const;
+    [[nodiscard]] uint64_t sampled_fingerprint(const std::vector<int>& order) const;
 
 private:
-    std::vector<Point> points_;
+    // 把内存映射的数据拷贝到自有缓冲区 (追加点之前调用)
+    void materialize();
+
+    std::vector<double, AlignedAllocator<double, kAlignment>> data_;
+    std::shared_ptr<const MappedFile> mapping_; // 非空时 base_ 指向映射内存
+    const double* base_ = nullptr;
+    size_t num_points_ = 0;
     size_t dimensions_ = 0;
-};
\ No newline at end of file
+    size_t stride_ = 0;
+    std::vector<uint8_t> erased_; // 按需扩展，超出长度的点视为未删除
+    size_t erased_count_ = 0;
+};
@@ -0,0 +1,261 @@
+#include "dimension_transform.h"
+#include "distance_kernels.h"
+#include "work_stealing.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 协方差累加时每个线程持有一个 d x d 矩阵，限制线程数以控制内存
+constexpr int kMaxCovarianceThreads = 16;
+// Jacobi 方法的最大扫描轮数 (通常 6~10 轮即收敛)
+constexpr int kMaxJacobiSweeps = 50;
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : hardware_thread_count();
+}
+
+std::vector<double> column_means(const Dataset& dataset, int num_threads) {
+    const size_t d = dataset.dimensions();
+    std::vector<std::vector<double>> partial(static_cast<size_t>(num_threads), std::vector<double>(d, 0.0));
+    parallel_for_work_stealing(dataset.size(), num_threads, 1024, [&](size_t begin, size_t end, int thread_id) {
+        std::vector<double>& sum = partial[thread_id];
+        for (size_t i = begin; i < end; ++i) {
+            const PointView p = dataset.get_point(static_cast<int>(i));
+            for (size_t j = 0; j < d; ++j) sum[j] += p[j];
+        }
+    });
+    std::vector<double> mean(d, 0.0);
+    for (const auto& sum : partial) {
+        for (size_t j = 0; j < d; ++j) mean[j] += sum[j];
+    }
+    for (double& m : mean) m /= static_cast<double>(std::max<size_t>(1, dataset.size()));
+    return mean;
+}
+
+// 样本协方差矩阵 (d x d，行主序)；只累加上三角，最后对称填充
+std::vector<double> covariance(const Dataset& dataset, const std::vector<double>& mean, int num_threads) {
+    const size_t d = dataset.dimensions();
+    num_threads = std::min(num_threads, kMaxCovarianceThreads);
+    std::vector<std::vector<double>> partial(static_cast<size_t>(num_threads), std::vector<double>(d * d, 0.0));
+    parallel_for_work_stealing(dataset.size(), num_threads, 256, [&](size_t begin, size_t end, int thread_id) {
+        std::vector<double>& cov = partial[thread_id];
+        std::vector<double> centered(d);
+        for (size_t i = begin; i < end; ++i) {
+            const PointView p = dataset.get_point(static_cast<int>(i));
+            for (size_t j = 0; j < d; ++j) centered[j] = p[j] - mean[j];
+            for (size_t a = 0; a < d; ++a) {
+                const double ca = centered[a];
+                double* row = cov.data() + a * d;
+                for (size_t b = a; b < d; ++b) row[b] += ca * centered[b];
+            }
+        }
+    });
+    std::vector<double> cov(d * d, 0.0);
+    for (const auto& part : partial) {
+        for (size_t i = 0; i < d * d; ++i) cov[i] += part[i];
+    }
+    const double denom = static_cast<double>(std::max<size_t>(1, dataset.size()));
+    for (size_t a = 0; a < d; ++a) {
+        for (size_t b = a; b < d; ++b) {
+            cov[a * d + b] /= denom;
+            cov[b * d + a] = cov[a * d + b];
+        }
+    }
+    return cov;
+}
+
+// 循环 Jacobi 方法求对称矩阵 a (d x d) 的特征分解。
+// 结束时 a 的对角线为特征值；vt 的第 j 行是对应的单位特征向量
+void jacobi_eigen(std::vector<double>& a, size_t d, std::vector<double>& vt) {
+    vt.assign(d * d, 0.0);
+    for (size_t i = 0; i < d; ++i) vt[i * d + i] = 1.0;
+
+    double total = 0.0;
+    for (double x : a) total += x * x;
+    for (int sweep = 0; sweep < kMaxJacobiSweeps; ++sweep) {
+        double off = 0.0;
+        for (size_t p = 0; p < d; ++p) {
+            for (size_t q = p + 1; q < d; ++q) off += a[p * d + q] * a[p * d + q];
+        }
+        if (off <= 1e-24 * total) break;
+
+        for (size_t p = 0; p < d; ++p) {
+            for (size_t q = p + 1; q < d; ++q) {
+                const double apq = a[p * d + q];
+                if (apq == 0.0) continue;
+                // 选择旋转角使 a'[p][q] = 0
+                const double theta = (a[q * d + q] - a[p * d + p]) / (2.0 * apq);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+                // A' = J^T A J：先更新第 p、q 列，再更新第 p、q 行
+                for (size_t k = 0; k < d; ++k) {
+                    const double akp = a[k * d + p];
+                    const double akq = a[k * d + q];
+                    a[k * d + p] = c * akp - s * akq;
+                    a[k * d + q] = s * akp + c * akq;
+                }
+                double* row_p = a.data() + p * d;
+                double* row_q = a.data() + q * d;
+                double* vp = vt.data() + p * d;
+                double* vq = vt.data() + q * d;
+                for (size_t k = 0; k < d; ++k) {
+                    const double apk = row_p[k];
+                    const double aqk = row_q[k];
+                    row_p[k] = c * apk - s * aqk;
+                    row_q[k] = s * apk + c * aqk;
+                    const double vpk = vp[k];
+                    const double vqk = vq[k];
+                    vp[k] = c * vpk - s * vqk;
+                    vq[k] = s * vpk + c * vqk;
+                }
+                a[p * d + q] = 0.0;
+                a[q * d + p] = 0.0;
+            }
+        }
+    }
+}
+
+} // namespace
+
+const char* dimension_transform_name(DimensionTransformKind kind) {
+    switch (kind) {
+        case DimensionTransformKind::None: return "none";
+        case DimensionTransformKind::VarianceOrder: return "variance";
+        case DimensionTransformKind::PCA: return "pca";
+    }
+    return "unknown";
+}
+
+bool parse_dimension_transform(const std::string& name, DimensionTransformKind& kind) {
+    for (DimensionTransformKind k : {DimensionTransformKind::None, DimensionTransformKind::VarianceOrder,
+                                     DimensionTransformKind::PCA}) {
+        if (name == dimension_transform_name(k)) {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+DimensionTransform DimensionTransform::fit(const Dataset& dataset, DimensionTransformKind kind, int num_threads) {
+    num_threads = resolve_threads(num_threads);
+    DimensionTransform transform;
+    transform.kind_ = kind;
+    transform.dims_ = dataset.dimensions();
+    const size_t d = transform.dims_;
+    const std::vector<double> mean = column_means(dataset, num_threads);
+
+    if (kind == DimensionTransformKind::PCA) {
+        std::vector<double> cov = covariance(dataset, mean, num_threads);
+        std::vector<double> vt;
+        jacobi_eigen(cov, d, vt);
+        std::vector<size_t> order(d);
+        for (size_t j = 0; j < d; ++j) order[j] = j;
+        std::stable_sort(order.begin(), order.end(), [&](size_t x, size_t y) { return cov[x * d + x] > cov[y * d + y]; });
+        transform.mean_ = mean;
+        transform.components_.resize(d * d);
+        transform.output_variance_.resize(d);
+        for (size_t j = 0; j < d; ++j) {
+            std::copy(vt.begin() + order[j] * d, vt.begin() + (order[j] + 1) * d, transform.components_.begin() + j * d);
+            transform.output_variance_[j] = std::max(0.0, cov[order[j] * d + order[j]]);
+        }
+        return transform;
+    }
+
+    // 各维度方差 (两遍法，数值上比 E[x^2] - E[x]^2 稳定)
+    std::vector<std::vector<double>> partial(static_cast<size_t>(num_threads), std::vector<double>(d, 0.0));
+    parallel_for_work_stealing(dataset.size(), num_threads, 1024, [&](size_t begin, size_t end, int thread_id) {
+        std::vector<double>& sum = partial[thread_id];
+        for (size_t i = begin; i < end; ++i) {
+            const PointView p = dataset.get_point(static_cast<int>(i));
+            for (size_t j = 0; j < d; ++j) sum[j] += (p[j] - mean[j]) * (p[j] - mean[j]);
+        }
+    });
+    std::vector<double> variance(d, 0.0);
+    for (const auto& sum : partial) {
+        for (size_t j = 0; j < d; ++j) variance[j] += sum[j];
+    }
+    for (double& v : variance) v /= static_cast<double>(std::max<size_t>(1, dataset.size()));
+
+    transform.order_.resize(d);
+    for (size_t j = 0; j < d; ++j) transform.order_[j] = j;
+    if (kind == DimensionTransformKind::VarianceOrder) {
+        std::stable_sort(transform.order_.begin(), transform.order_.end(),
+                         [&](size_t x, size_t y) { return variance[x] > variance[y]; });
+    }
+    transform.output_variance_.resize(d);
+    for (size_t j = 0; j < d; ++j) transform.output_variance_[j] = variance[transform.order_[j]];
+    return transform;
+}
+
+void DimensionTransform::apply(PointView point, double* out) const {
+    const size_t d = dims_;
+    if (kind_ == DimensionTransformKind::PCA) {
+        for (size_t j = 0; j < d; ++j) {
+            const double* component = components_.data() + j * d;
+            double sum = 0.0;
+            for (size_t i = 0; i < d; ++i) sum += component[i] * (point[i] - mean_[i]);
+            out[j] = sum;
+        }
+        return;
+    }
+    for (size_t j = 0; j < d; ++j) out[j] = point[order_[j]];
+}
+
+void DimensionTransform::project(PointView point, size_t count, double* out) const {
+    const size_t d = dims_;
+    count = std::min(count, d);
+    if (kind_ == DimensionTransformKind::PCA) {
+        for (size_t j = 0; j < count; ++j) {
+            const double* component = components_.data() + j * d;
+            double sum = 0.0;
+            for (size_t i = 0; i < d; ++i) sum += component[i] * (point[i] - mean_[i]);
+            out[j] = sum;
+        }
+        return;
+    }
+    for (size_t j = 0; j < count; ++j) out[j] = point[order_[j]];
+}
+
+void DimensionTransform::apply(Dataset& dataset, int num_threads) const {
+    if (kind_ == DimensionTransformKind::None) return;
+    double* data = dataset.mutable_data();
+    const size_t stride = dataset.stride();
+    parallel_for_work_stealing(dataset.size(), resolve_threads(num_threads), 256, [&](size_t begin, size_t end, int) {
+        std::vector<double> transformed(dims_);
+        for (size_t i = begin; i < end; ++i) {
+            double* row = data + i * stride;
+            apply(PointView(row, dims_), transformed.data());
+            std::copy(transformed.begin(), transformed.end(), row);
+        }
+    });
+}
+
+size_t DimensionTransform::dimensions_for_variance(double fraction) const {
+    double total = 0.0;
+    for (double v : output_variance_) total += v;
+    double prefix = 0.0;
+    for (size_t j = 0; j < output_variance_.size(); ++j) {
+        prefix += output_variance_[j];
+        if (prefix >= fraction * total) return j + 1;
+    }
+    return output_variance_.size();
+}
+
+size_t early_exit_dimensions_touched(PointView a, PointView b, double r) {
+    const size_t n = a.size();
+    const size_t block = g_distance_kernels.exit_block;
+    const double r_sq = r * r;
+    double sum_sq = 0.0;
+    size_t i = 0;
+    for (; i + block <= n; i += block) {
+        for (size_t j = i; j < i + block; ++j) {
+            const double diff = a[j] - b[j];
+            sum_sq += diff * diff;
+        }
+        if (sum_sq > r_sq) return i + block;
+    }
+    return n;
+}
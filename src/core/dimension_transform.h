@@ -0,0 +1,50 @@
+#pragma once
+#include "dataset.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 维度预处理：让方差大的维度排在前面，使分块提前退出的距离判断
+// (is_distance_exceeding_early_exit) 在前几个块就能累积到足够的部分距离而退出。
+// 两种变换都保持欧氏距离不变 (维度置换 / 平移 + 正交旋转)，只会带来浮点舍入级别的差异，
+// 因此所有索引和查询结果都不受影响；但数据指纹会改变，已保存的索引需要重新构建。
+enum class DimensionTransformKind : uint32_t {
+    None = 0,
+    VarianceOrder = 1, // 按方差从大到小重排维度
+    PCA = 2,           // 减去均值后旋转到主成分坐标系 (协方差矩阵用 Jacobi 方法特征分解)
+};
+
+const char* dimension_transform_name(DimensionTransformKind kind);
+bool parse_dimension_transform(const std::string& name, DimensionTransformKind& kind);
+
+class DimensionTransform {
+public:
+    // 在 dataset 上估计变换 (各维度方差或协方差矩阵)
+    static DimensionTransform fit(const Dataset& dataset, DimensionTransformKind kind, int num_threads = 0);
+
+    // 原地变换整个数据集
+    void apply(Dataset& dataset, int num_threads = 0) const;
+    // 变换单个点 (例如不在数据集中的查询点)，out 需有 dimensions() 个元素
+    void apply(PointView point, double* out) const;
+    // 只计算变换后的前 count 个维度 (例如 PCA 的前几个主成分坐标)，out 需有 count 个元素
+    void project(PointView point, size_t count, double* out) const;
+
+    [[nodiscard]] DimensionTransformKind kind() const { return kind_; }
+    [[nodiscard]] size_t dimensions() const { return dims_; }
+    // 变换后每个维度的方差 (降序)
+    [[nodiscard]] const std::vector<double>& output_variance() const { return output_variance_; }
+    // 变换后前多少个维度累计占总方差的 fraction
+    [[nodiscard]] size_t dimensions_for_variance(double fraction) const;
+
+private:
+    DimensionTransformKind kind_ = DimensionTransformKind::None;
+    size_t dims_ = 0;
+    std::vector<size_t> order_;         // VarianceOrder：输出第 j 维 = 输入第 order_[j] 维
+    std::vector<double> mean_;          // PCA：各维度均值
+    std::vector<double> components_;    // PCA：dims x dims，第 j 行是第 j 主成分 (单位向量)
+    std::vector<double> output_variance_;
+};
+
+// 模拟分块提前退出：返回判断 d(a, b) > r 时实际累加了多少个维度
+// (与 l2_sq_exceeds 的行为一致，按 g_distance_kernels.exit_block 为粒度)
+size_t early_exit_dimensions_touched(PointView a, PointView b, double r);
@@ -1,24 +1,19 @@
 #pragma once
+#include "distance_kernels.h"
 #include "point.h"
+#include <cassert>
 #include <cmath>
 #include <numeric>
-#include <stdexcept>
 
 // 计算两点之间欧氏距离的平方（避免开方，速度更快）
-inline double euclidean_distance_sq(const Point& p1, const Point& p2) {
-    if (p1.size() != p2.size()) {
-        throw std::invalid_argument("Points must have the same dimension.");
-    }
-    double sum_sq = 0.0;
-    for (size_t i = 0; i < p1.size(); ++i) {
-        double diff = p1[i] - p2[i];
-        sum_sq += diff * diff;
-    }
-    return sum_sq;
+// 维度一致性只在 Debug 构建中检查，热路径上不再做分支
+inline double euclidean_distance_sq(PointView p1, PointView p2) {
+    assert(p1.size() == p2.size() && "Points must have the same dimension.");
+    return g_distance_kernels.l2_sq(p1.data(), p2.data(), p1.size());
 }
 
 // 计算两点之间的欧氏距离
-inline double euclidean_distance(const Point& p1, const Point& p2) {
+inline double euclidean_distance(PointView p1, PointView p2) {
     return std::sqrt(euclidean_distance_sq(p1, p2));
 }
 
@@ -27,24 +22,8 @@ inline double euclidean_distance(const Point& p1, const Point& p2) {
 // ===================================================================
 // 判断两点距离是否超过r，使用提前退出优化
 // 返回 true 表示 dist > r, false 表示 dist <= r
-inline bool is_distance_exceeding_early_exit(const Point& p1, const Point& p2, double r) {
-    if (p1.size() != p2.size()) {
-        throw std::invalid_argument("Points must have the same dimension.");
-    }
-
-    const double r_sq = r * r;
-    double partial_sum_sq = 0.0;
-
-    for (size_t i = 0; i < p1.size(); ++i) {
-        const double diff = p1[i] - p2[i];
-        partial_sum_sq += diff * diff;
-
-        // 提前退出判断
-        if (partial_sum_sq > r_sq) {
-            return true;
-        }
-    }
-
-    // 如果循环正常结束，说明 partial_sum_sq <= r_sq
-    return false;
-}
\ No newline at end of file
+// 内核按块 (16~32 维) 累加，每块只与阈值比较一次，块内可以完全向量化
+inline bool is_distance_exceeding_early_exit(PointView p1, PointView p2, double r) {
+    assert(p1.size() == p2.size() && "Points must have the same dimension.");
+    return g_distance_kernels.l2_sq_exceeds(p1.data(), p2.data(), p1.size(), r * r);
+}
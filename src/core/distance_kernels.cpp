@@ -0,0 +1,356 @@
+#include "distance_kernels.h"
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define PRUNING_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 各级别的实现函数都强制内联：内核表里的通用版本以运行期维数调用它们，
+// 固定维数版本以编译期常量调用同一份实现 (见 PRUNING_DEFINE_KERNELS)
+#define PRUNING_KERNEL __attribute__((always_inline)) inline
+#define PRUNING_KERNEL_AVX2 __attribute__((target("avx2,fma"), always_inline)) inline
+#define PRUNING_KERNEL_AVX512 __attribute__((target("avx512f"), always_inline)) inline
+
+// ---------------------------------------------------------------
+//  通用标量实现 (任何平台均可用)
+// ---------------------------------------------------------------
+PRUNING_KERNEL double l2_sq_scalar_impl(const double* a, const double* b, size_t n) {
+    double sum_sq = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        double diff = a[i] - b[i];
+        sum_sq += diff * diff;
+    }
+    return sum_sq;
+}
+
+PRUNING_KERNEL double l2_sq_capped_scalar_impl(const double* a, const double* b, size_t n, double cap_sq) {
+    constexpr size_t kBlock = 16;
+    double partial_sum_sq = 0.0;
+    size_t i = 0;
+    for (; i + kBlock <= n; i += kBlock) {
+        // 块内不做分支，编译器可以展开/向量化
+        for (size_t j = i; j < i + kBlock; ++j) {
+            double diff = a[j] - b[j];
+            partial_sum_sq += diff * diff;
+        }
+        if (partial_sum_sq > cap_sq) return partial_sum_sq;
+    }
+    for (; i < n; ++i) {
+        double diff = a[i] - b[i];
+        partial_sum_sq += diff * diff;
+    }
+    return partial_sum_sq;
+}
+
+PRUNING_KERNEL bool l2_sq_exceeds_scalar_impl(const double* a, const double* b, size_t n, double r_sq) {
+    return l2_sq_capped_scalar_impl(a, b, n, r_sq) > r_sq;
+}
+
+#ifdef PRUNING_X86
+
+// ---------------------------------------------------------------
+//  SSE2 (x86-64 基线指令集)
+// ---------------------------------------------------------------
+inline double hsum_sse2(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+PRUNING_KERNEL double l2_sq_sse2_impl(const double* a, const double* b, size_t n) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    __m128d acc2 = _mm_setzero_pd(), acc3 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i));
+        __m128d d1 = _mm_sub_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2));
+        __m128d d2 = _mm_sub_pd(_mm_loadu_pd(a + i + 4), _mm_loadu_pd(b + i + 4));
+        __m128d d3 = _mm_sub_pd(_mm_loadu_pd(a + i + 6), _mm_loadu_pd(b + i + 6));
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(d0, d0));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(d1, d1));
+        acc2 = _mm_add_pd(acc2, _mm_mul_pd(d2, d2));
+        acc3 = _mm_add_pd(acc3, _mm_mul_pd(d3, d3));
+    }
+    double sum_sq = hsum_sse2(_mm_add_pd(_mm_add_pd(acc0, acc1), _mm_add_pd(acc2, acc3)));
+    for (; i < n; ++i) {
+        double diff = a[i] - b[i];
+        sum_sq += diff * diff;
+    }
+    return sum_sq;
+}
+
+PRUNING_KERNEL double l2_sq_capped_sse2_impl(const double* a, const double* b, size_t n, double cap_sq) {
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        for (size_t j = i; j < i + 16; j += 4) {
+            __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + j), _mm_loadu_pd(b + j));
+            __m128d d1 = _mm_sub_pd(_mm_loadu_pd(a + j + 2), _mm_loadu_pd(b + j + 2));
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(d0, d0));
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(d1, d1));
+        }
+        const double partial_sum_sq = hsum_sse2(_mm_add_pd(acc0, acc1));
+        if (partial_sum_sq > cap_sq) return partial_sum_sq;
+    }
+    double partial_sum_sq = hsum_sse2(_mm_add_pd(acc0, acc1));
+    for (; i < n; ++i) {
+        double diff = a[i] - b[i];
+        partial_sum_sq += diff * diff;
+    }
+    return partial_sum_sq;
+}
+
+PRUNING_KERNEL bool l2_sq_exceeds_sse2_impl(const double* a, const double* b, size_t n, double r_sq) {
+    return l2_sq_capped_sse2_impl(a, b, n, r_sq) > r_sq;
+}
+
+// ---------------------------------------------------------------
+//  AVX2 + FMA
+// ---------------------------------------------------------------
+__attribute__((target("avx2,fma")))
+inline double hsum_avx2(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+PRUNING_KERNEL_AVX2 double l2_sq_avx2_impl(const double* a, const double* b, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+        __m256d d2 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8));
+        __m256d d3 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12));
+        acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+        acc2 = _mm256_fmadd_pd(d2, d2, acc2);
+        acc3 = _mm256_fmadd_pd(d3, d3, acc3);
+    }
+    for (; i + 4 <= n; i += 4) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+    }
+    double sum_sq = hsum_avx2(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+    for (; i < n; ++i) {
+        double diff = a[i] - b[i];
+        sum_sq += diff * diff;
+    }
+    return sum_sq;
+}
+
+PRUNING_KERNEL_AVX2 double l2_sq_capped_avx2_impl(const double* a, const double* b, size_t n, double cap_sq) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+        __m256d d2 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8));
+        __m256d d3 = _mm256_sub_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12));
+        acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+        acc2 = _mm256_fmadd_pd(d2, d2, acc2);
+        acc3 = _mm256_fmadd_pd(d3, d3, acc3);
+        // 每 16 维检查一次阈值
+        const double partial_sum_sq = hsum_avx2(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+        if (partial_sum_sq > cap_sq) return partial_sum_sq;
+    }
+    double partial_sum_sq = hsum_avx2(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+    for (; i < n; ++i) {
+        double diff = a[i] - b[i];
+        partial_sum_sq += diff * diff;
+    }
+    return partial_sum_sq;
+}
+
+PRUNING_KERNEL_AVX2 bool l2_sq_exceeds_avx2_impl(const double* a, const double* b, size_t n, double r_sq) {
+    return l2_sq_capped_avx2_impl(a, b, n, r_sq) > r_sq;
+}
+
+// ---------------------------------------------------------------
+//  AVX-512F
+// ---------------------------------------------------------------
+PRUNING_KERNEL_AVX512 double l2_sq_avx512_impl(const double* a, const double* b, size_t n) {
+    __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+    __m512d acc2 = _mm512_setzero_pd(), acc3 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+        __m512d d1 = _mm512_sub_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8));
+        __m512d d2 = _mm512_sub_pd(_mm512_loadu_pd(a + i + 16), _mm512_loadu_pd(b + i + 16));
+        __m512d d3 = _mm512_sub_pd(_mm512_loadu_pd(a + i + 24), _mm512_loadu_pd(b + i + 24));
+        acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+        acc2 = _mm512_fmadd_pd(d2, d2, acc2);
+        acc3 = _mm512_fmadd_pd(d3, d3, acc3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+        acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+    }
+    if (i < n) {
+        // 尾部用掩码加载，未选中的通道为 0
+        __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1u);
+        __m512d d0 = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i));
+        acc1 = _mm512_fmadd_pd(d0, d0, acc1);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(acc0, acc1), _mm512_add_pd(acc2, acc3)));
+}
+
+PRUNING_KERNEL_AVX512 double l2_sq_capped_avx512_impl(const double* a, const double* b, size_t n, double cap_sq) {
+    __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+    __m512d acc2 = _mm512_setzero_pd(), acc3 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+        __m512d d1 = _mm512_sub_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8));
+        __m512d d2 = _mm512_sub_pd(_mm512_loadu_pd(a + i + 16), _mm512_loadu_pd(b + i + 16));
+        __m512d d3 = _mm512_sub_pd(_mm512_loadu_pd(a + i + 24), _mm512_loadu_pd(b + i + 24));
+        acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+        acc2 = _mm512_fmadd_pd(d2, d2, acc2);
+        acc3 = _mm512_fmadd_pd(d3, d3, acc3);
+        // 每 32 维检查一次阈值
+        const double partial_sum_sq =
+            _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(acc0, acc1), _mm512_add_pd(acc2, acc3)));
+        if (partial_sum_sq > cap_sq) return partial_sum_sq;
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+        acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+    }
+    if (i < n) {
+        __mmask8 mask = static_cast<__mmask8>((1u << (n - i)) - 1u);
+        __m512d d0 = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i));
+        acc1 = _mm512_fmadd_pd(d0, d0, acc1);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(acc0, acc1), _mm512_add_pd(acc2, acc3)));
+}
+
+PRUNING_KERNEL_AVX512 bool l2_sq_exceeds_avx512_impl(const double* a, const double* b, size_t n, double r_sq) {
+    return l2_sq_capped_avx512_impl(a, b, n, r_sq) > r_sq;
+}
+
+#endif // PRUNING_X86
+
+// 一个固定维数的内核组
+struct FixedDimensionKernels {
+    size_t dimensions;
+    double (*l2_sq)(const double*, const double*, size_t);
+    bool (*l2_sq_exceeds)(const double*, const double*, size_t, double);
+    double (*l2_sq_capped)(const double*, const double*, size_t, double);
+};
+
+// 为一个级别生成内核表使用的函数：通用版本 (运行期维数) 与固定维数版本。
+// 固定维数版本在 n == D 时以编译期常量 D 调用同一份实现：循环次数已知，编译器可以完全展开并去掉
+// 尾部处理，累加顺序不变，因此结果与通用版本逐位相同；n != D 时退回通用实现
+#define PRUNING_DEFINE_KERNELS(LEVEL, ATTR)                                                                  \
+    ATTR double l2_sq_##LEVEL(const double* a, const double* b, size_t n) {                                  \
+        return l2_sq_##LEVEL##_impl(a, b, n);                                                                \
+    }                                                                                                         \
+    ATTR bool l2_sq_exceeds_##LEVEL(const double* a, const double* b, size_t n, double r_sq) {               \
+        return l2_sq_exceeds_##LEVEL##_impl(a, b, n, r_sq);                                                  \
+    }                                                                                                         \
+    ATTR double l2_sq_capped_##LEVEL(const double* a, const double* b, size_t n, double cap_sq) {            \
+        return l2_sq_capped_##LEVEL##_impl(a, b, n, cap_sq);                                                 \
+    }                                                                                                         \
+    template <size_t D>                                                                                       \
+    ATTR double l2_sq_##LEVEL##_fixed(const double* a, const double* b, size_t n) {                          \
+        return n == D ? l2_sq_##LEVEL##_impl(a, b, D) : l2_sq_##LEVEL##_impl(a, b, n);                       \
+    }                                                                                                         \
+    template <size_t D>                                                                                       \
+    ATTR bool l2_sq_exceeds_##LEVEL##_fixed(const double* a, const double* b, size_t n, double r_sq) {       \
+        return n == D ? l2_sq_exceeds_##LEVEL##_impl(a, b, D, r_sq) : l2_sq_exceeds_##LEVEL##_impl(a, b, n, r_sq); \
+    }                                                                                                         \
+    template <size_t D>                                                                                       \
+    ATTR double l2_sq_capped_##LEVEL##_fixed(const double* a, const double* b, size_t n, double cap_sq) {    \
+        return n == D ? l2_sq_capped_##LEVEL##_impl(a, b, D, cap_sq) : l2_sq_capped_##LEVEL##_impl(a, b, n, cap_sq); \
+    }                                                                                                         \
+    template <size_t D>                                                                                       \
+    constexpr FixedDimensionKernels fixed_kernels_##LEVEL() {                                                 \
+        return {D, l2_sq_##LEVEL##_fixed<D>, l2_sq_exceeds_##LEVEL##_fixed<D>, l2_sq_capped_##LEVEL##_fixed<D>}; \
+    }                                                                                                         \
+    constexpr FixedDimensionKernels kFixedKernels_##LEVEL[] = {                                              \
+        fixed_kernels_##LEVEL<128>(), fixed_kernels_##LEVEL<384>(), fixed_kernels_##LEVEL<500>(),              \
+        fixed_kernels_##LEVEL<768>()};
+
+// 维数为常量时，GCC 会对已经不可能执行的尾部循环误报越界迭代
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Waggressive-loop-optimizations"
+PRUNING_DEFINE_KERNELS(scalar, )
+#ifdef PRUNING_X86
+PRUNING_DEFINE_KERNELS(sse2, )
+PRUNING_DEFINE_KERNELS(avx2, __attribute__((target("avx2,fma"))))
+PRUNING_DEFINE_KERNELS(avx512, __attribute__((target("avx512f"))))
+#endif
+#pragma GCC diagnostic pop
+
+constexpr DistanceKernels kScalarKernels{l2_sq_scalar, l2_sq_exceeds_scalar, l2_sq_capped_scalar, "scalar", 16, SimdLevel::Scalar};
+#ifdef PRUNING_X86
+constexpr DistanceKernels kSse2Kernels{l2_sq_sse2, l2_sq_exceeds_sse2, l2_sq_capped_sse2, "sse2", 16, SimdLevel::SSE2};
+constexpr DistanceKernels kAvx2Kernels{l2_sq_avx2, l2_sq_exceeds_avx2, l2_sq_capped_avx2, "avx2", 16, SimdLevel::AVX2};
+constexpr DistanceKernels kAvx512Kernels{l2_sq_avx512, l2_sq_exceeds_avx512, l2_sq_capped_avx512, "avx512", 32, SimdLevel::AVX512};
+#endif
+
+DistanceKernels select_distance_kernels() {
+    const char* forced = std::getenv("PRUNING_SIMD");
+    auto allowed = [forced](const char* name) {
+        if (forced == nullptr) return true;
+        // 强制选择某一级别时，只允许不高于它的级别
+        static const char* const kOrder[] = {"scalar", "sse2", "avx2", "avx512"};
+        int forced_level = -1, level = -1;
+        for (int i = 0; i < 4; ++i) {
+            if (std::strcmp(forced, kOrder[i]) == 0) forced_level = i;
+            if (std::strcmp(name, kOrder[i]) == 0) level = i;
+        }
+        return forced_level < 0 || level <= forced_level;
+    };
+#ifdef PRUNING_X86
+    __builtin_cpu_init();
+    if (allowed("avx512") && __builtin_cpu_supports("avx512f")) return kAvx512Kernels;
+    if (allowed("avx2") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return kAvx2Kernels;
+    if (allowed("sse2")) return kSse2Kernels;
+#endif
+    return kScalarKernels;
+}
+
+// 按 CPUID 选出的通用内核 (进程内只选一次)
+const DistanceKernels& generic_kernels() {
+    static const DistanceKernels kernels = select_distance_kernels();
+    return kernels;
+}
+
+} // namespace
+
+DistanceKernels g_distance_kernels = generic_kernels();
+
+void specialize_distance_kernels(size_t dimensions) {
+    DistanceKernels kernels = generic_kernels();
+    const char* disabled = std::getenv("PRUNING_FIXED_DIM");
+    if (disabled == nullptr || std::strcmp(disabled, "0") != 0) {
+        const FixedDimensionKernels* first = std::begin(kFixedKernels_scalar);
+        const FixedDimensionKernels* last = std::end(kFixedKernels_scalar);
+#ifdef PRUNING_X86
+        switch (kernels.level) {
+            case SimdLevel::Scalar: break;
+            case SimdLevel::SSE2: first = std::begin(kFixedKernels_sse2); last = std::end(kFixedKernels_sse2); break;
+            case SimdLevel::AVX2: first = std::begin(kFixedKernels_avx2); last = std::end(kFixedKernels_avx2); break;
+            case SimdLevel::AVX512: first = std::begin(kFixedKernels_avx512); last = std::end(kFixedKernels_avx512); break;
+        }
+#endif
+        for (const FixedDimensionKernels* fixed = first; fixed != last; ++fixed) {
+            if (fixed->dimensions != dimensions) continue;
+            kernels.l2_sq = fixed->l2_sq;
+            kernels.l2_sq_exceeds = fixed->l2_sq_exceeds;
+            kernels.l2_sq_capped = fixed->l2_sq_capped;
+            kernels.fixed_dimensions = dimensions;
+        }
+    }
+    g_distance_kernels = kernels;
+}
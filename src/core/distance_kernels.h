@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+
+// 指令集级别，按能力从低到高排列
+enum class SimdLevel { Scalar = 0, SSE2 = 1, AVX2 = 2, AVX512 = 3 };
+
+// 距离计算内核表：启动时根据 CPUID 选择一次 (scalar / SSE2 / AVX2 / AVX-512)，
+// 之后所有距离函数都通过这里的函数指针调用，热路径上不再做任何特性检测。
+struct DistanceKernels {
+    // 返回 sum((a[i] - b[i])^2)
+    double (*l2_sq)(const double* a, const double* b, size_t n);
+    // 分块累加平方差，每处理一个块 (16~32 维) 才与 r_sq 比较一次；
+    // 返回 true 表示 sum > r_sq
+    bool (*l2_sq_exceeds)(const double* a, const double* b, size_t n, double r_sq);
+    // 与 l2_sq_exceeds 相同的分块累加：某块之后部分和 > cap_sq 就返回该部分和，否则返回完整的和。
+    // 因此 l2_sq_exceeds(a, b, n, r_sq) == (l2_sq_capped(a, b, n, r_sq) > r_sq)，
+    // 且对任意 r_sq <= cap_sq，“返回值 > r_sq” 与 l2_sq_exceeds 的结论一致
+    double (*l2_sq_capped)(const double* a, const double* b, size_t n, double cap_sq);
+    const char* name;
+    size_t exit_block; // l2_sq_exceeds 每检查一次阈值处理的维数
+    SimdLevel level; // 其它需要按指令集分派的内核 (如 pivot 距离表扫描) 与这里保持一致
+    size_t fixed_dimensions = 0; // 非 0 表示上面三个内核是针对该维数展开的版本
+};
+
+// 当前进程使用的内核。可用环境变量 PRUNING_SIMD=scalar|sse2|avx2|avx512
+// 强制选择较低的指令集 (便于对比测试)，但不会选择 CPU 不支持的指令集。
+// 只由 specialize_distance_kernels 修改；查询线程读取它时不加锁
+extern DistanceKernels g_distance_kernels;
+
+// 针对常见维数 (128, 384, 500, 768) 换用编译期固定维数、完全展开的内核，其它维数恢复通用内核。
+// 它改写进程内的全局内核表，因此只能在没有其它线程计算距离时调用：各程序在加载数据集之后、
+// 构建索引和启动查询线程之前调用一次 (Dataset 与 OutOfCoreIndex 的加载都不会调用它)。
+// 固定维数的内核遇到其它维数时自动退回通用实现，因此同时使用不同维数的数据 (如降维后的副本)
+// 依然正确，不调用也只是慢一些。环境变量 PRUNING_FIXED_DIM=0 关闭
+void specialize_distance_kernels(size_t dimensions);
@@ -0,0 +1,55 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// IEEE 754 半精度 (binary16) 与 float 之间的转换，按位实现，不依赖 F16C 等指令集。
+// 批量转换的 SIMD 路径见 compact_points.cpp
+
+// float -> half，就近舍入 (平局取偶)；超出范围变为 ±inf，NaN 保持为 NaN
+inline uint16_t float_to_half(float value) {
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    const auto sign = static_cast<uint16_t>((x >> 16) & 0x8000u);
+    const uint32_t abs = x & 0x7fffffffu;
+    if (abs >= 0x7f800000u) return static_cast<uint16_t>(sign | 0x7c00u | (abs > 0x7f800000u ? 0x200u : 0u));
+    if (abs >= 0x477ff000u) return static_cast<uint16_t>(sign | 0x7c00u); // >= 65520 舍入为 inf
+    if (abs < 0x38800000u) {
+        // 半精度的非规格化数：值为 m * 2^-24
+        if (abs < 0x33000000u) return sign; // < 2^-25 (含平局) 舍入为 0
+        const uint32_t exponent = abs >> 23;
+        const uint32_t mantissa = (abs & 0x7fffffu) | 0x800000u;
+        const uint32_t shift = 126u - exponent;
+        uint32_t m = mantissa >> shift;
+        const uint32_t rem = mantissa & ((1u << shift) - 1u);
+        const uint32_t half = 1u << (shift - 1u);
+        if (rem > half || (rem == half && (m & 1u) != 0)) ++m;
+        return static_cast<uint16_t>(sign | m);
+    }
+    // 规格化数：指数偏置从 127 调整为 15，尾数截去 13 位后舍入 (进位可以自然地进入指数位)
+    const uint32_t rebased = abs - (112u << 23);
+    uint32_t h = rebased >> 13;
+    const uint32_t rem = rebased & 0x1fffu;
+    if (rem > 0x1000u || (rem == 0x1000u && (h & 1u) != 0)) ++h;
+    return static_cast<uint16_t>(sign | h);
+}
+
+// half -> float (精确)
+inline float half_to_float(uint16_t h) {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1fu;
+    const uint32_t mantissa = h & 0x3ffu;
+    uint32_t x;
+    if (exponent == 0) {
+        const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign != 0 ? -magnitude : magnitude;
+    }
+    if (exponent == 31) {
+        x = sign | 0x7f800000u | (mantissa << 13);
+    } else {
+        x = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    }
+    float value;
+    std::memcpy(&value, &x, sizeof(value));
+    return value;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// 简单快速的 64 位流式哈希 (按 8 字节字处理，最后做 murmur3 的 fmix64 雪崩)。
+// 用于索引文件的校验和与数据集指纹，不用于任何安全相关的场景。
+class Hash64 {
+public:
+    explicit Hash64(uint64_t seed = 0x9E3779B97F4A7C15ULL) : state_(seed) {}
+
+    void update(const void* data, size_t bytes) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        length_ += bytes;
+        // 先补齐上次遗留的不足 8 字节的部分
+        while (pending_bytes_ > 0 && pending_bytes_ < 8 && bytes > 0) {
+            pending_ |= static_cast<uint64_t>(*p++) << (8 * pending_bytes_++);
+            --bytes;
+        }
+        if (pending_bytes_ == 8) {
+            mix(pending_);
+            pending_ = 0;
+            pending_bytes_ = 0;
+        }
+        for (; bytes >= 8; bytes -= 8, p += 8) {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            mix(word);
+        }
+        for (; bytes > 0; --bytes) {
+            pending_ |= static_cast<uint64_t>(*p++) << (8 * pending_bytes_++);
+        }
+    }
+
+    template <typename T>
+    void update_value(const T& value) { update(&value, sizeof(T)); }
+
+    [[nodiscard]] uint64_t digest() const {
+        uint64_t h = state_;
+        if (pending_bytes_ > 0) h = step(h, pending_);
+        h ^= length_;
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+private:
+    static uint64_t step(uint64_t h, uint64_t word) {
+        word *= 0x87C37B91114253D5ULL;
+        word = (word << 31) | (word >> 33);
+        h ^= word;
+        h = (h << 27) | (h >> 37);
+        return h * 5 + 0x52DCE729;
+    }
+    void mix(uint64_t word) { state_ = step(state_, word); }
+
+    uint64_t state_;
+    uint64_t pending_ = 0;
+    size_t pending_bytes_ = 0;
+    uint64_t length_ = 0;
+};
@@ -0,0 +1,170 @@
+#include "index_file.h"
+#include "hash.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr size_t kSectionAlignment = 64;
+
+size_t align_up(size_t value) {
+    return (value + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+} // namespace
+
+IndexFileWriter::IndexFileWriter(uint32_t algorithm_tag, const Dataset& dataset)
+    : algorithm_tag_(algorithm_tag), fingerprint_(dataset.fingerprint()),
+      sampled_fingerprint_(dataset.sampled_fingerprint()), dataset_size_(dataset.size()),
+      dataset_dimensions_(dataset.dimensions()) {}
+
+IndexFileWriter::IndexFileWriter(uint32_t algorithm_tag, const Dataset& dataset, const std::vector<int>& order)
+    : algorithm_tag_(algorithm_tag), fingerprint_(dataset.fingerprint(order)),
+      sampled_fingerprint_(dataset.sampled_fingerprint(order)), dataset_size_(order.size()),
+      dataset_dimensions_(dataset.dimensions()) {}
+
+void IndexFileWriter::add_section(uint32_t id, const void* data, size_t element_size, size_t element_count) {
+    sections_.push_back({id, data, element_size, element_count});
+}
+
+bool IndexFileWriter::write(const std::string& path) const {
+    // 计算布局
+    std::vector<IndexSectionEntry> entries;
+    size_t offset = align_up(sizeof(IndexFileHeader) + sections_.size() * sizeof(IndexSectionEntry));
+    for (const Section& s : sections_) {
+        entries.push_back({s.id, static_cast<uint32_t>(s.element_size), s.element_count, offset});
+        offset = align_up(offset + s.element_size * s.element_count);
+    }
+
+    // 按写出顺序组装文件头之后的全部字节，同时计算校验和
+    const char zeros[kSectionAlignment] = {};
+    Hash64 checksum;
+    size_t position = sizeof(IndexFileHeader);
+    auto emit = [&](std::ofstream* out, const void* data, size_t bytes) {
+        if (out) out->write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        else checksum.update(data, bytes);
+        position += bytes;
+    };
+    auto emit_payload = [&](std::ofstream* out) {
+        position = sizeof(IndexFileHeader);
+        emit(out, entries.data(), entries.size() * sizeof(IndexSectionEntry));
+        for (size_t i = 0; i < sections_.size(); ++i) {
+            emit(out, zeros, entries[i].offset - position);
+            emit(out, sections_[i].data, sections_[i].element_size * sections_[i].element_count);
+        }
+        emit(out, zeros, align_up(position) - position);
+    };
+    emit_payload(nullptr);
+
+    IndexFileHeader header{};
+    std::memcpy(header.magic, kIndexFileMagic, sizeof(header.magic));
+    header.version = kIndexFileVersion;
+    header.algorithm_tag = algorithm_tag_;
+    header.dataset_fingerprint = fingerprint_;
+    header.dataset_size = dataset_size_;
+    header.dataset_dimensions = dataset_dimensions_;
+    header.dataset_sampled_fingerprint = sampled_fingerprint_;
+    header.checksum = checksum.digest();
+    header.section_count = static_cast<uint32_t>(sections_.size());
+
+    // 不能原地截断：加载过的索引直接指向映射中的节
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open index file for writing: " << tmp_path << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    emit_payload(&out);
+    out.close();
+    if (!out.good()) {
+        std::cerr << "Error: Failed to write index file: " << tmp_path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: Could not replace index file: " << path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool IndexFileReader::open(const std::string& path, uint32_t algorithm_tag, const Dataset& dataset) {
+    entries_.clear();
+    // 每次打开使用新的映射：之前 view_vector 交出去的节继续持有旧映射
+    file_ = std::make_shared<MappedFile>();
+    if (!file_->open(path)) {
+        std::cerr << "Error: Could not open index file: " << path << std::endl;
+        return false;
+    }
+    if (file_->size() < sizeof(IndexFileHeader)) {
+        std::cerr << "Error: Index file is truncated: " << path << std::endl;
+        return false;
+    }
+    IndexFileHeader header;
+    std::memcpy(&header, file_->data(), sizeof(header));
+    if (std::memcmp(header.magic, kIndexFileMagic, sizeof(header.magic)) != 0 || header.version != kIndexFileVersion) {
+        std::cerr << "Error: Not a supported index file: " << path << std::endl;
+        return false;
+    }
+    if (header.algorithm_tag != algorithm_tag) {
+        std::cerr << "Error: Index file was built by a different algorithm: " << path << std::endl;
+        return false;
+    }
+    // 抽样指纹与数据集大小无关；没有记录抽样指纹的旧文件只能比较完整指纹
+    if (header.dataset_size != dataset.size() || header.dataset_dimensions != dataset.dimensions() ||
+        (header.dataset_sampled_fingerprint != 0 ? header.dataset_sampled_fingerprint != dataset.sampled_fingerprint()
+                                                 : header.dataset_fingerprint != dataset.fingerprint())) {
+        std::cerr << "Error: Index file is stale (dataset fingerprint mismatch): " << path << std::endl;
+        return false;
+    }
+    const size_t table_bytes = static_cast<size_t>(header.section_count) * sizeof(IndexSectionEntry);
+    if (table_bytes > file_->size() - sizeof(IndexFileHeader)) {
+        std::cerr << "Error: Index file is truncated: " << path << std::endl;
+        return false;
+    }
+    Hash64 checksum;
+    checksum.update(file_->data() + sizeof(IndexFileHeader), file_->size() - sizeof(IndexFileHeader));
+    if (checksum.digest() != header.checksum) {
+        std::cerr << "Error: Index file checksum mismatch (corrupted): " << path << std::endl;
+        return false;
+    }
+
+    entries_.resize(header.section_count);
+    std::memcpy(entries_.data(), file_->data() + sizeof(IndexFileHeader), table_bytes);
+    for (const IndexSectionEntry& e : entries_) {
+        // 节会被直接当作 T 数组访问：偏移必须保持写出时的对齐，长度用除法检查以免乘法溢出
+        if (e.offset > file_->size() || e.offset % kSectionAlignment != 0 ||
+            (e.element_size != 0 && e.element_count > (file_->size() - e.offset) / e.element_size)) {
+            std::cerr << "Error: Index file section out of range: " << path << std::endl;
+            entries_.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+const void* IndexFileReader::section(uint32_t id, size_t element_size, size_t& element_count) const {
+    for (const IndexSectionEntry& e : entries_) {
+        if (e.id == id) {
+            if (e.element_size != element_size) return nullptr;
+            element_count = e.element_count;
+            return file_->data() + e.offset;
+        }
+    }
+    return nullptr;
+}
+
+bool IndexFileReader::read_points(uint32_t id, size_t dimensions, Dataset& out) const {
+    size_t count = 0;
+    const void* data = section(id, sizeof(double), count);
+    out.reset(dimensions);
+    if (data == nullptr || out.stride() == 0 || count % out.stride() != 0) {
+        return false;
+    }
+    out.resize(count / out.stride());
+    if (count > 0) std::memcpy(out.mutable_data(), data, count * sizeof(double));
+    return true;
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include "dataset.h"
+#include "mapped_file.h"
+#include "section_array.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 持久化索引的通用文件格式 (版本 1)：
+//
+//   [0, 64)          IndexFileHeader
+//   [64, ...)        节表：section_count 个 IndexSectionEntry
+//   ...              各节的原始数组数据，每节起始偏移按 64 字节对齐
+//
+// 整个文件可以直接 mmap，每节都是一段对齐的定长元素数组：大的节 (距离表等) 由 view_vector 直接
+// 指向映射内存，不做拷贝。checksum 覆盖文件头之后的全部字节；dataset_fingerprint / dataset_sampled_fingerprint
+// 记录构建索引时数据集的指纹 (Dataset::fingerprint / sampled_fingerprint)。加载时比较点数、维度和抽样指纹，
+// 不匹配即拒绝，避免使用过期索引，且不需要读取整个数据集；没有抽样指纹的旧文件退回比较完整指纹。
+
+constexpr char kIndexFileMagic[8] = {'P', 'R', 'U', 'N', 'E', 'I', 'D', 'X'};
+constexpr uint32_t kIndexFileVersion = 1;
+
+// 由四个字符组成的算法标识，例如 make_index_tag("KMTP")
+constexpr uint32_t make_index_tag(const char (&s)[5]) {
+    return static_cast<uint32_t>(static_cast<unsigned char>(s[0])) |
+           static_cast<uint32_t>(static_cast<unsigned char>(s[1])) << 8 |
+           static_cast<uint32_t>(static_cast<unsigned char>(s[2])) << 16 |
+           static_cast<uint32_t>(static_cast<unsigned char>(s[3])) << 24;
+}
+
+struct IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t algorithm_tag;
+    uint64_t dataset_fingerprint;
+    uint64_t dataset_size;
+    uint64_t dataset_dimensions;
+    uint64_t checksum;
+    uint32_t section_count;
+    uint32_t reserved0;
+    uint64_t dataset_sampled_fingerprint; // 0 表示未记录
+};
+static_assert(sizeof(IndexFileHeader) == 64, "IndexFileHeader layout must stay fixed");
+
+struct IndexSectionEntry {
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t element_count;
+    uint64_t offset;
+};
+static_assert(sizeof(IndexSectionEntry) == 24, "IndexSectionEntry layout must stay fixed");
+
+class IndexFileWriter {
+public:
+    IndexFileWriter(uint32_t algorithm_tag, const Dataset& dataset);
+    // 数据集只以重排后的形式存在时 (见 ReorderedAlgorithm)：指纹按原顺序计算，
+    // 原顺序的第 i 个点是 dataset 的第 order[i] 个点
+    IndexFileWriter(uint32_t algorithm_tag, const Dataset& dataset, const std::vector<int>& order);
+
+    // 登记一节数据。只保存指针，数据必须保持有效直到 write() 返回
+    void add_section(uint32_t id, const void* data, size_t element_size, size_t element_count);
+
+    template <typename T, typename Alloc>
+    void add_vector(uint32_t id, const std::vector<T, Alloc>& values) {
+        add_section(id, values.data(), sizeof(T), values.size());
+    }
+    template <typename T, typename Alloc>
+    void add_vector(uint32_t id, const SectionArray<T, Alloc>& values) {
+        add_section(id, values.data(), sizeof(T), values.size());
+    }
+
+    // 登记一组点 (例如 pivots)，按 Dataset 的对齐行格式原样写出
+    void add_points(uint32_t id, const Dataset& points) {
+        add_section(id, points.data(), sizeof(double), points.size() * points.stride());
+    }
+
+    // 先写 <path>.tmp 再 rename 覆盖：正在映射旧文件的加载方继续使用旧的 inode
+    bool write(const std::string& path) const;
+
+private:
+    struct Section {
+        uint32_t id;
+        const void* data;
+        size_t element_size;
+        size_t element_count;
+    };
+
+    uint32_t algorithm_tag_;
+    uint64_t fingerprint_;
+    uint64_t sampled_fingerprint_;
+    uint64_t dataset_size_;
+    uint64_t dataset_dimensions_;
+    std::vector<Section> sections_;
+};
+
+class IndexFileReader {
+public:
+    // 映射并校验文件：魔数、版本、算法标识、数据集的点数、维度与抽样指纹以及校验和。失败时在 stderr 说明原因
+    bool open(const std::string& path, uint32_t algorithm_tag, const Dataset& dataset);
+
+    // 查找一节并检查元素大小，返回 nullptr 表示不存在或元素大小不符
+    [[nodiscard]] const void* section(uint32_t id, size_t element_size, size_t& element_count) const;
+
+    // 把一节拷贝到 out 中；expected_count 不为 SIZE_MAX 时还会检查元素个数
+    template <typename T, typename Alloc>
+    bool read_vector(uint32_t id, std::vector<T, Alloc>& out, size_t expected_count = SIZE_MAX) const {
+        size_t count = 0;
+        const void* data = section(id, sizeof(T), count);
+        if (data == nullptr || (expected_count != SIZE_MAX && count != expected_count)) {
+            return false;
+        }
+        out.resize(count);
+        if (count > 0) std::memcpy(out.data(), data, count * sizeof(T));
+        return true;
+    }
+
+    // 让 out 直接指向映射中的一节 (零拷贝)：out 持有映射，reader 销毁后仍然有效。
+    // expected_count 的含义同 read_vector
+    template <typename T, typename Alloc>
+    bool view_vector(uint32_t id, SectionArray<T, Alloc>& out, size_t expected_count = SIZE_MAX) const {
+        size_t count = 0;
+        const void* data = section(id, sizeof(T), count);
+        if (data == nullptr || (expected_count != SIZE_MAX && count != expected_count)) {
+            return false;
+        }
+        out.map(file_, static_cast<const T*>(data), count);
+        return true;
+    }
+
+    // 读取 add_points 写出的一组点，dimensions 为每个点的维度
+    bool read_points(uint32_t id, size_t dimensions, Dataset& out) const;
+
+private:
+    std::shared_ptr<MappedFile> file_;
+    std::vector<IndexSectionEntry> entries_;
+};
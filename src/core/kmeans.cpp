@@ -0,0 +1,254 @@
+#include "kmeans.h"
+#include "distance.h"
+#include "work_stealing.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+using AlignedVector = std::vector<double, AlignedAllocator<double, Dataset::kAlignment>>;
+
+// 中心点矩阵：与 Dataset 使用相同的行跨度 (stride)，保证每行对齐
+struct CentroidMatrix {
+    size_t k = 0;
+    size_t dim = 0;
+    size_t stride = 0;
+    AlignedVector data;
+
+    void init(size_t k_, size_t dim_, size_t stride_) {
+        k = k_;
+        dim = dim_;
+        stride = stride_;
+        data.assign(k * stride, 0.0);
+    }
+    [[nodiscard]] PointView row(size_t j) const { return {data.data() + j * stride, dim}; }
+    [[nodiscard]] double* mutable_row(size_t j) { return data.data() + j * stride; }
+};
+
+class KMeansEngine {
+public:
+    KMeansEngine(const Dataset& dataset, const KMeansOptions& options)
+        : dataset_(dataset), options_(options),
+          n_(dataset.size()), k_(static_cast<size_t>(options.k)),
+          num_threads_(options.num_threads > 0 ? options.num_threads : hardware_thread_count()) {}
+
+    KMeansResult run() {
+        centroids_.init(k_, dataset_.dimensions(), dataset_.stride());
+        next_centroids_.init(k_, dataset_.dimensions(), dataset_.stride());
+        assignments_.assign(n_, 0);
+        upper_.assign(n_, 0.0);
+        lower_.assign(n_, 0.0);
+        half_min_center_dist_.assign(k_, 0.0);
+        center_moves_.assign(k_, 0.0);
+        cluster_offsets_.assign(k_ + 1, 0);
+        cluster_members_.assign(n_, 0);
+
+        seed_kmeans_plus_plus();
+        full_assignment();
+
+        KMeansResult result;
+        for (int iter = 1; iter <= options_.max_iterations; ++iter) {
+            update_centroids();
+            result.iterations = iter;
+            if (iter == options_.max_iterations) break;
+            if (hamerly_assignment() == 0) {
+                // 没有点改变归属，中心点已经是当前划分的均值，达到不动点
+                result.converged = true;
+                break;
+            }
+        }
+
+        result.centroids.reset(dataset_.dimensions());
+        result.centroids.reserve(k_);
+        for (size_t j = 0; j < k_; ++j) {
+            result.centroids.add_point(centroids_.row(j));
+        }
+        result.assignments = assignments_;
+        result.distances.resize(n_);
+        parallel_for_work_stealing(n_, num_threads_, 256, [&](size_t begin, size_t end, int) {
+            for (size_t i = begin; i < end; ++i) {
+                result.distances[i] = euclidean_distance(point(i), centroids_.row(assignments_[i]));
+            }
+        });
+        return result;
+    }
+
+private:
+    [[nodiscard]] PointView point(size_t i) const { return dataset_.get_point(static_cast<int>(i)); }
+
+    // k-means++：第一个中心均匀随机选取，之后按到最近已选中心的距离平方成比例采样
+    void seed_kmeans_plus_plus() {
+        std::mt19937_64 gen(options_.seed);
+        std::vector<double> min_dist_sq(n_, std::numeric_limits<double>::max());
+
+        size_t chosen = std::uniform_int_distribution<size_t>(0, n_ - 1)(gen);
+        for (size_t j = 0; j < k_; ++j) {
+            PointView src = point(chosen);
+            std::copy(src.begin(), src.end(), centroids_.mutable_row(j));
+            if (j + 1 == k_) break;
+
+            PointView center = centroids_.row(j);
+            parallel_for_work_stealing(n_, num_threads_, 256, [&](size_t begin, size_t end, int) {
+                for (size_t i = begin; i < end; ++i) {
+                    min_dist_sq[i] = std::min(min_dist_sq[i], euclidean_distance_sq(point(i), center));
+                }
+            });
+
+            double total = 0.0;
+            for (double d : min_dist_sq) total += d;
+            if (total <= 0.0) {
+                // 剩余的点都与已选中心重合，退化为均匀采样
+                chosen = std::uniform_int_distribution<size_t>(0, n_ - 1)(gen);
+                continue;
+            }
+            double target = std::uniform_real_distribution<double>(0.0, total)(gen);
+            chosen = n_ - 1;
+            for (size_t i = 0; i < n_; ++i) {
+                target -= min_dist_sq[i];
+                if (target < 0.0 && min_dist_sq[i] > 0.0) {
+                    chosen = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    // 对点 i 扫描所有中心，返回最近中心的编号，并写入最近/次近距离
+    int nearest_two(size_t i, double& best_dist, double& second_dist) const {
+        double best_sq = std::numeric_limits<double>::max();
+        double second_sq = std::numeric_limits<double>::max();
+        int best = 0;
+        PointView p = point(i);
+        for (size_t j = 0; j < k_; ++j) {
+            double d_sq = euclidean_distance_sq(p, centroids_.row(j));
+            if (d_sq < best_sq) {
+                second_sq = best_sq;
+                best_sq = d_sq;
+                best = static_cast<int>(j);
+            } else if (d_sq < second_sq) {
+                second_sq = d_sq;
+            }
+        }
+        best_dist = std::sqrt(best_sq);
+        second_dist = k_ > 1 ? std::sqrt(second_sq) : std::numeric_limits<double>::max();
+        return best;
+    }
+
+    void full_assignment() {
+        parallel_for_work_stealing(n_, num_threads_, 64, [&](size_t begin, size_t end, int) {
+            for (size_t i = begin; i < end; ++i) {
+                assignments_[i] = nearest_two(i, upper_[i], lower_[i]);
+            }
+        });
+    }
+
+    // Hamerly 分配步骤，返回改变了归属的点数
+    size_t hamerly_assignment() {
+        // s(j) = 中心 j 到其它中心最近距离的一半；若 u(i) <= max(s(a(i)), l(i))，点 i 的归属不会变
+        parallel_for_work_stealing(k_, num_threads_, 4, [&](size_t begin, size_t end, int) {
+            for (size_t j = begin; j < end; ++j) {
+                double min_dist_sq = std::numeric_limits<double>::max();
+                for (size_t other = 0; other < k_; ++other) {
+                    if (other == j) continue;
+                    min_dist_sq = std::min(min_dist_sq, euclidean_distance_sq(centroids_.row(j), centroids_.row(other)));
+                }
+                half_min_center_dist_[j] = 0.5 * std::sqrt(min_dist_sq);
+            }
+        });
+
+        std::vector<size_t> changed_per_thread(num_threads_, 0);
+        parallel_for_work_stealing(n_, num_threads_, 256, [&](size_t begin, size_t end, int thread_id) {
+            size_t changed = 0;
+            for (size_t i = begin; i < end; ++i) {
+                const int a = assignments_[i];
+                const double bound = std::max(half_min_center_dist_[a], lower_[i]);
+                if (upper_[i] <= bound) continue;
+                // 收紧上界后再判断一次
+                upper_[i] = euclidean_distance(point(i), centroids_.row(a));
+                if (upper_[i] <= bound) continue;
+                int best = nearest_two(i, upper_[i], lower_[i]);
+                if (best != a) {
+                    assignments_[i] = best;
+                    changed++;
+                }
+            }
+            changed_per_thread[thread_id] += changed;
+        });
+
+        size_t total_changed = 0;
+        for (size_t c : changed_per_thread) total_changed += c;
+        return total_changed;
+    }
+
+    // 更新步骤：按簇分组后并行求均值，并据中心移动量放松 Hamerly 上下界
+    void update_centroids() {
+        const size_t dim = dataset_.dimensions();
+
+        // 计数排序得到每个簇的成员列表 (CSR)
+        std::fill(cluster_offsets_.begin(), cluster_offsets_.end(), 0);
+        for (size_t i = 0; i < n_; ++i) cluster_offsets_[assignments_[i] + 1]++;
+        for (size_t j = 0; j < k_; ++j) cluster_offsets_[j + 1] += cluster_offsets_[j];
+        std::vector<size_t> cursor(cluster_offsets_.begin(), cluster_offsets_.end() - 1);
+        for (size_t i = 0; i < n_; ++i) cluster_members_[cursor[assignments_[i]]++] = static_cast<int>(i);
+
+        parallel_for_work_stealing(k_, num_threads_, 1, [&](size_t begin, size_t end, int) {
+            for (size_t j = begin; j < end; ++j) {
+                double* next = next_centroids_.mutable_row(j);
+                const size_t first = cluster_offsets_[j];
+                const size_t last = cluster_offsets_[j + 1];
+                if (first == last) {
+                    // 空簇保留原中心
+                    std::copy(centroids_.row(j).begin(), centroids_.row(j).end(), next);
+                    center_moves_[j] = 0.0;
+                    continue;
+                }
+                std::fill(next, next + dim, 0.0);
+                for (size_t m = first; m < last; ++m) {
+                    PointView p = point(cluster_members_[m]);
+                    for (size_t d = 0; d < dim; ++d) next[d] += p[d];
+                }
+                const double inv_count = 1.0 / static_cast<double>(last - first);
+                for (size_t d = 0; d < dim; ++d) next[d] *= inv_count;
+                center_moves_[j] = euclidean_distance(centroids_.row(j), next_centroids_.row(j));
+            }
+        });
+        std::swap(centroids_, next_centroids_);
+
+        double max_move = 0.0;
+        for (double move : center_moves_) max_move = std::max(max_move, move);
+        parallel_for_work_stealing(n_, num_threads_, 1024, [&](size_t begin, size_t end, int) {
+            for (size_t i = begin; i < end; ++i) {
+                upper_[i] += center_moves_[assignments_[i]];
+                lower_[i] -= max_move;
+            }
+        });
+    }
+
+    const Dataset& dataset_;
+    const KMeansOptions& options_;
+    const size_t n_;
+    const size_t k_;
+    const int num_threads_;
+
+    CentroidMatrix centroids_;
+    CentroidMatrix next_centroids_;
+    std::vector<int> assignments_;
+    std::vector<double> upper_;                // 到所属中心距离的上界
+    std::vector<double> lower_;                // 到其它任意中心距离的下界
+    std::vector<double> half_min_center_dist_; // s(j)
+    std::vector<double> center_moves_;         // 本轮每个中心的移动距离
+    std::vector<size_t> cluster_offsets_;
+    std::vector<int> cluster_members_;
+};
+
+} // namespace
+
+KMeansResult run_kmeans(const Dataset& dataset, const KMeansOptions& options) {
+    if (options.k <= 0 || static_cast<size_t>(options.k) > dataset.size()) {
+        throw std::invalid_argument("K-means requires 0 < k <= number of points.");
+    }
+    return KMeansEngine(dataset, options).run();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "dataset.h"
+#include <cstdint>
+#include <vector>
+
+// 两个 pivot 索引共用的 K-means 引擎：
+//  - k-means++ 初始化 (D^2 采样)，由 seed 决定，结果可复现
+//  - Hamerly 三角不等式加速的 Lloyd 迭代：每个点维护到所属中心的上界和到次近中心的下界，
+//    大部分点每轮无需与所有中心计算距离
+//  - 分配与更新步骤都多线程执行；当一轮迭代中没有任何点改变归属时提前停止
+struct KMeansOptions {
+    int k = 0;
+    int max_iterations = 20;
+    uint64_t seed = 42;
+    int num_threads = 0; // <= 0 表示使用全部硬件线程
+};
+
+struct KMeansResult {
+    Dataset centroids;             // k 个中心点，连续对齐存储
+    std::vector<int> assignments;  // 每个点所属的中心
+    std::vector<double> distances; // 每个点到其所属 (最终) 中心的精确距离
+    int iterations = 0;            // 实际执行的更新轮数
+    bool converged = false;
+};
+
+// k 必须满足 0 < k <= dataset.size()，否则抛出 std::invalid_argument
+KMeansResult run_kmeans(const Dataset& dataset, const KMeansOptions& options);
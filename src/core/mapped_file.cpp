@@ -0,0 +1,58 @@
+#include "mapped_file.h"
+#include <iostream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+#if defined(_WIN32)
+    std::cerr << "Error: Memory-mapped files are not supported on this platform: " << path << std::endl;
+    return false;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        // 空文件无法映射，由调用方决定如何处理
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // 映射建立后即可关闭文件描述符
+    if (addr == MAP_FAILED) {
+        std::cerr << "Error: mmap failed for file: " << path << std::endl;
+        return false;
+    }
+    data_ = addr;
+    size_ = static_cast<size_t>(info.st_size);
+    return true;
+#endif
+}
+
+void MappedFile::release_pages() const {
+#if !defined(_WIN32)
+    // 只读的共享文件映射上 MADV_DONTNEED 只是丢弃页表项，不会丢失数据
+    if (data_ != nullptr) madvise(data_, size_, MADV_DONTNEED);
+#endif
+}
+
+void MappedFile::close() {
+#if !defined(_WIN32)
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// 只读内存映射文件 (RAII)。映射使用 MAP_SHARED，多个进程映射同一文件时共享物理页。
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 打开并映射整个文件，失败时返回 false (并在 stderr 输出原因)
+    bool open(const std::string& path);
+    void close();
+
+    [[nodiscard]] const char* data() const { return static_cast<const char*>(data_); }
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] bool is_open() const { return data_ != nullptr; }
+    // 让本进程已载入的映射页失效 (内容不变，之后访问到的页再从页缓存或文件读入)，降低常驻内存
+    void release_pages() const;
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,112 @@
+#include "perf_counters.h"
+#include <sstream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#if defined(__linux__)
+int open_event(uint32_t type, uint64_t config) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+} // namespace
+
+PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+    for (int fd : fds_) {
+        if (fd >= 0) close(fd);
+    }
+#endif
+}
+
+bool PerfCounters::open() {
+#if defined(__linux__)
+    if (available()) return true;
+    fds_[Cycles] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fds_[Instructions] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    // 通用的 cache-misses 事件在 x86 上对应末级缓存未命中
+    fds_[LLCMisses] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    fds_[BranchMisses] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+    return available();
+}
+
+bool PerfCounters::available() const {
+    for (int fd : fds_) {
+        if (fd >= 0) return true;
+    }
+    return false;
+}
+
+void PerfCounters::start() {
+#if defined(__linux__)
+    for (int fd : fds_) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+PerfCounters::Sample PerfCounters::stop() {
+    Sample sample;
+#if defined(__linux__)
+    for (size_t e = 0; e < kNumEvents; ++e) {
+        if (fds_[e] < 0) continue;
+        ioctl(fds_[e], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t data[3] = {0, 0, 0}; // value, time_enabled, time_running
+        if (read(fds_[e], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) continue;
+        // 计数器被多路复用时只在部分时间内计数，按比例放大
+        const double scale = static_cast<double>(data[1]) / static_cast<double>(data[2]);
+        sample.values[e] = static_cast<uint64_t>(static_cast<double>(data[0]) * scale);
+        sample.valid[e] = true;
+    }
+#endif
+    return sample;
+}
+
+const char* PerfCounters::event_name(Event event) {
+    switch (event) {
+        case Cycles: return "cycles";
+        case Instructions: return "instructions";
+        case LLCMisses: return "LLC misses";
+        case BranchMisses: return "branch misses";
+        default: return "unknown";
+    }
+}
+
+std::string format_perf_sample(const PerfCounters::Sample& sample, long long per_item) {
+    std::ostringstream out;
+    for (size_t e = 0; e < PerfCounters::kNumEvents; ++e) {
+        if (e > 0) out << " | ";
+        out << PerfCounters::event_name(static_cast<PerfCounters::Event>(e)) << ": ";
+        if (!sample.valid[e]) {
+            out << "n/a";
+            continue;
+        }
+        out << sample.values[e];
+        if (per_item > 0) {
+            out << " (" << static_cast<double>(sample.values[e]) / static_cast<double>(per_item) << "/q)";
+        }
+    }
+    if (sample.valid[PerfCounters::Cycles] && sample.valid[PerfCounters::Instructions]) {
+        out << " | IPC: " << sample.ipc();
+    }
+    return out.str();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+// 硬件性能计数器 (Linux perf_event_open)：cycles、instructions、LLC misses、branch misses。
+// 只统计用户态，计数器设置为 inherit，因此 start 之后创建的工作线程 (parallel_for_work_stealing
+// 每次都新建线程) 的计数在线程退出时也会合并进来。
+// 权限不足 (perf_event_paranoid 过高、容器限制) 或非 Linux 平台上 open 返回 false，各项标记为不可用
+class PerfCounters {
+public:
+    enum Event : size_t { Cycles = 0, Instructions, LLCMisses, BranchMisses, kNumEvents };
+
+    struct Sample {
+        std::array<uint64_t, kNumEvents> values{};
+        std::array<bool, kNumEvents> valid{};
+        [[nodiscard]] double ipc() const {
+            return valid[Cycles] && valid[Instructions] && values[Cycles] > 0
+                       ? static_cast<double>(values[Instructions]) / static_cast<double>(values[Cycles])
+                       : 0.0;
+        }
+    };
+
+    PerfCounters() = default;
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // 打开计数器 (处于停止状态)；至少一个事件可用时返回 true
+    bool open();
+    [[nodiscard]] bool available() const;
+
+    // 清零并开始计数 / 停止计数并返回 start 以来的计数 (多路复用时按运行时间比例放大)
+    void start();
+    Sample stop();
+
+    static const char* event_name(Event event);
+
+private:
+    std::array<int, kNumEvents> fds_{-1, -1, -1, -1};
+};
+
+// 把一个阶段的计数格式化成一行，per_item > 0 时附带每项 (如每次查询) 的平均值
+std::string format_perf_sample(const PerfCounters::Sample& sample, long long per_item = 0);
@@ -0,0 +1,248 @@
+#include "pivot_selection.h"
+#include "distance.h"
+#include "kmeans.h"
+#include "work_stealing.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+// MaxVariance 中估计每个候选点距离方差所用的样本点数
+constexpr size_t kVarianceSamples = 256;
+// MaxVariance 中 pivot 之间的最小间距 (相对于样本平均距离)
+constexpr double kVarianceSpacing = 0.5;
+
+struct Selector {
+    const Dataset& dataset;
+    const PivotSelectionOptions& options;
+    size_t n;
+    size_t k;
+    int num_threads;
+    std::mt19937_64 gen;
+
+    Selector(const Dataset& dataset_, const PivotSelectionOptions& options_)
+        : dataset(dataset_), options(options_), n(dataset_.size()), k(static_cast<size_t>(options_.k)),
+          num_threads(options_.num_threads > 0 ? options_.num_threads : hardware_thread_count()),
+          gen(options_.seed) {}
+
+    [[nodiscard]] PointView point(size_t i) const { return dataset.get_point(static_cast<int>(i)); }
+
+    Dataset to_dataset(const std::vector<size_t>& indices) const {
+        Dataset pivots;
+        pivots.reset(dataset.dimensions());
+        pivots.reserve(indices.size());
+        for (size_t i : indices) pivots.add_point(point(i));
+        return pivots;
+    }
+
+    // 部分 Fisher-Yates：返回 m 个互不相同的随机下标
+    std::vector<size_t> sample_distinct(size_t m) {
+        std::vector<size_t> perm(n);
+        for (size_t i = 0; i < n; ++i) perm[i] = i;
+        for (size_t i = 0; i < m; ++i) {
+            std::swap(perm[i], perm[std::uniform_int_distribution<size_t>(i, n - 1)(gen)]);
+        }
+        perm.resize(m);
+        return perm;
+    }
+
+    std::vector<size_t> random() { return sample_distinct(k); }
+
+    // 最远优先遍历：第一个 pivot 随机选取，之后每次选取到已选集合最小距离最大的点。
+    // 各线程分别求局部最大值再合并，平局取下标最小者，结果与线程调度无关
+    std::vector<size_t> farthest_first() {
+        std::vector<size_t> chosen;
+        chosen.reserve(k);
+        std::vector<double> min_dist(n, std::numeric_limits<double>::max());
+        struct Best {
+            double dist;
+            size_t index;
+        };
+        std::vector<Best> thread_best(static_cast<size_t>(num_threads));
+
+        size_t next = std::uniform_int_distribution<size_t>(0, n - 1)(gen);
+        while (chosen.size() < k) {
+            chosen.push_back(next);
+            if (chosen.size() == k) break;
+            const PointView pivot = point(next);
+            std::fill(thread_best.begin(), thread_best.end(), Best{-1.0, n});
+            parallel_for_work_stealing(n, num_threads, 256, [&](size_t begin, size_t end, int thread_id) {
+                Best best = thread_best[thread_id];
+                for (size_t i = begin; i < end; ++i) {
+                    min_dist[i] = std::min(min_dist[i], euclidean_distance(point(i), pivot));
+                    if (min_dist[i] > best.dist || (min_dist[i] == best.dist && i < best.index)) {
+                        best = {min_dist[i], i};
+                    }
+                }
+                thread_best[thread_id] = best;
+            });
+            Best best{-1.0, n};
+            for (const Best& b : thread_best) {
+                if (b.dist > best.dist || (b.dist == best.dist && b.index < best.index)) best = b;
+            }
+            next = best.index;
+        }
+        return chosen;
+    }
+
+    // 最大方差：在 candidates * k 个随机候选中，按到样本点距离的方差从大到小选取。
+    // 方差大的点位于数据外围，对不同点给出差异明显的距离，下界更有区分度；
+    // 但这样的点往往扎堆在同一片外围区域，因此 (类似 sparse spatial selection)
+    // 要求新 pivot 与已选 pivot 的距离不小于样本平均距离的 kVarianceSpacing 倍，不足 k 个时再按方差补齐
+    std::vector<size_t> max_variance() {
+        const size_t pool_size = std::min(n, std::max(k, options.candidates * k));
+        std::vector<size_t> pool = sample_distinct(pool_size);
+        std::vector<size_t> samples = sample_distinct(std::min(n, kVarianceSamples));
+
+        std::vector<double> variance(pool_size);
+        std::vector<double> mean_dist(pool_size);
+        parallel_for_work_stealing(pool_size, num_threads, 16, [&](size_t begin, size_t end, int) {
+            for (size_t c = begin; c < end; ++c) {
+                const PointView candidate = point(pool[c]);
+                double sum = 0.0, sum_sq = 0.0;
+                for (size_t s : samples) {
+                    double d = euclidean_distance(candidate, point(s));
+                    sum += d;
+                    sum_sq += d * d;
+                }
+                mean_dist[c] = sum / samples.size();
+                variance[c] = sum_sq / samples.size() - mean_dist[c] * mean_dist[c];
+            }
+        });
+        double spacing = 0.0;
+        for (double d : mean_dist) spacing += d;
+        spacing = kVarianceSpacing * spacing / pool_size;
+
+        std::vector<size_t> order(pool_size);
+        for (size_t c = 0; c < pool_size; ++c) order[c] = c;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return variance[a] != variance[b] ? variance[a] > variance[b] : a < b;
+        });
+        std::vector<size_t> chosen;
+        std::vector<char> taken(pool_size, 0);
+        chosen.reserve(k);
+        for (size_t c : order) {
+            if (chosen.size() == k) break;
+            bool far_enough = true;
+            for (size_t i : chosen) {
+                if (euclidean_distance(point(pool[c]), point(i)) < spacing) {
+                    far_enough = false;
+                    break;
+                }
+            }
+            if (far_enough) {
+                chosen.push_back(pool[c]);
+                taken[c] = 1;
+            }
+        }
+        for (size_t c : order) {
+            if (chosen.size() == k) break;
+            if (!taken[c]) chosen.push_back(pool[c]);
+        }
+        return chosen;
+    }
+
+    // Bustos et al. 的增量选取：固定一组样本点对 (x, y)，维护当前 pivot 集合给出的下界
+    // max_v |d(x,v) - d(y,v)|；每一步从 candidates 个随机未选点中选出使样本平均下界最大的点
+    std::vector<size_t> incremental() {
+        const size_t num_pairs = std::max<size_t>(1, options.sample_pairs);
+        std::vector<size_t> xs(num_pairs), ys(num_pairs);
+        std::uniform_int_distribution<size_t> any_point(0, n - 1);
+        for (size_t a = 0; a < num_pairs; ++a) {
+            xs[a] = any_point(gen);
+            ys[a] = any_point(gen);
+        }
+        std::vector<double> lower_bound(num_pairs, 0.0);
+
+        // pool[0, remaining) 是尚未选中的点
+        std::vector<size_t> pool(n);
+        for (size_t i = 0; i < n; ++i) pool[i] = i;
+        size_t remaining = n;
+
+        const size_t num_candidates = std::max<size_t>(1, options.candidates);
+        std::vector<size_t> candidate_slots(num_candidates);
+        std::vector<double> scores(num_candidates);
+        std::vector<double> diffs(num_candidates * num_pairs);
+
+        std::vector<size_t> chosen;
+        chosen.reserve(k);
+        while (chosen.size() < k) {
+            const size_t m = std::min(num_candidates, remaining);
+            for (size_t c = 0; c < m; ++c) {
+                candidate_slots[c] = std::uniform_int_distribution<size_t>(0, remaining - 1)(gen);
+            }
+            parallel_for_work_stealing(m, num_threads, 1, [&](size_t begin, size_t end, int) {
+                for (size_t c = begin; c < end; ++c) {
+                    const PointView candidate = point(pool[candidate_slots[c]]);
+                    double* diff = diffs.data() + c * num_pairs;
+                    double score = 0.0;
+                    for (size_t a = 0; a < num_pairs; ++a) {
+                        diff[a] = std::abs(euclidean_distance(point(xs[a]), candidate) -
+                                           euclidean_distance(point(ys[a]), candidate));
+                        score += std::max(lower_bound[a], diff[a]);
+                    }
+                    scores[c] = score;
+                }
+            });
+            const size_t best = static_cast<size_t>(std::max_element(scores.begin(), scores.begin() + m) - scores.begin());
+            const double* diff = diffs.data() + best * num_pairs;
+            for (size_t a = 0; a < num_pairs; ++a) lower_bound[a] = std::max(lower_bound[a], diff[a]);
+
+            const size_t slot = candidate_slots[best];
+            chosen.push_back(pool[slot]);
+            std::swap(pool[slot], pool[--remaining]);
+        }
+        return chosen;
+    }
+};
+
+} // namespace
+
+const char* pivot_selection_name(PivotSelection selection) {
+    switch (selection) {
+        case PivotSelection::KMeans: return "kmeans";
+        case PivotSelection::FarthestFirst: return "farthest";
+        case PivotSelection::MaxVariance: return "maxvar";
+        case PivotSelection::Incremental: return "incremental";
+        case PivotSelection::Random: return "random";
+    }
+    return "unknown";
+}
+
+bool parse_pivot_selection(const std::string& name, PivotSelection& selection) {
+    for (PivotSelection s : {PivotSelection::KMeans, PivotSelection::FarthestFirst, PivotSelection::MaxVariance,
+                             PivotSelection::Incremental, PivotSelection::Random}) {
+        if (name == pivot_selection_name(s)) {
+            selection = s;
+            return true;
+        }
+    }
+    return false;
+}
+
+Dataset select_pivots(const Dataset& dataset, const PivotSelectionOptions& options) {
+    if (options.k <= 0 || static_cast<size_t>(options.k) > dataset.size()) {
+        throw std::invalid_argument("Pivot selection requires 0 < k <= number of points.");
+    }
+    if (options.strategy == PivotSelection::KMeans) {
+        KMeansOptions kmeans_options;
+        kmeans_options.k = options.k;
+        kmeans_options.max_iterations = options.max_iterations;
+        kmeans_options.seed = options.seed;
+        kmeans_options.num_threads = options.num_threads;
+        return run_kmeans(dataset, kmeans_options).centroids;
+    }
+
+    Selector selector(dataset, options);
+    switch (options.strategy) {
+        case PivotSelection::FarthestFirst: return selector.to_dataset(selector.farthest_first());
+        case PivotSelection::MaxVariance: return selector.to_dataset(selector.max_variance());
+        case PivotSelection::Incremental: return selector.to_dataset(selector.incremental());
+        case PivotSelection::Random:
+        case PivotSelection::KMeans: break;
+    }
+    return selector.to_dataset(selector.random());
+}
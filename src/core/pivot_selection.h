@@ -0,0 +1,33 @@
+#pragma once
+#include "dataset.h"
+#include <cstdint>
+#include <string>
+
+// 多 pivot 剪枝的 pivot 选取策略。
+// 下界 |d(p,v) - d(q,v)| 在 pivot 彼此远离、位于数据"外围"时最紧，
+// 而 k-means 中心位于稠密区域中央，因此通常需要多得多的 pivot 才能达到相同剪枝率。
+enum class PivotSelection : uint32_t {
+    KMeans = 0,        // k-means 中心 (原有行为)
+    FarthestFirst = 1, // 最远优先遍历：每次选取离已选 pivot 集合最远的点
+    MaxVariance = 2,   // 从候选点中选取到样本点距离方差最大的 k 个
+    Incremental = 3,   // Bustos et al. 增量选取：每次从候选中选使样本点对平均下界最大的点
+    Random = 4,        // 均匀随机抽样 k 个数据点
+};
+
+const char* pivot_selection_name(PivotSelection selection);
+// 解析策略名 (与 pivot_selection_name 的输出一致)，未知名称返回 false
+bool parse_pivot_selection(const std::string& name, PivotSelection& selection);
+
+struct PivotSelectionOptions {
+    PivotSelection strategy = PivotSelection::KMeans;
+    int k = 0;
+    int max_iterations = 20;   // 仅 KMeans 使用
+    uint64_t seed = 42;        // 所有策略都由 seed 决定，结果可复现
+    int num_threads = 0;       // <= 0 表示使用全部硬件线程
+    size_t sample_pairs = 2000; // Incremental：评估平均下界所用的样本点对数
+    size_t candidates = 32;     // Incremental：每选一个 pivot 评估的候选点数；MaxVariance：候选池为 candidates * k
+};
+
+// 按策略选出 k 个 pivot (连续对齐存储)。
+// k 必须满足 0 < k <= dataset.size()，否则抛出 std::invalid_argument
+Dataset select_pivots(const Dataset& dataset, const PivotSelectionOptions& options);
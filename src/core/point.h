@@ -1,5 +1,26 @@
 #pragma once
+#include <cstddef>
 #include <vector>
 
-// 使用类型别名来表示一个高维点
-using Point = std::vector<double>;
\ No newline at end of file
+// 使用类型别名来表示一个高维点 (拥有自己的内存，用于 pivots 等少量点)
+using Point = std::vector<double>;
+
+// 非拥有的点视图：指向 Dataset 连续缓冲区中的一行（或一个 Point）
+// 只包含指针和维度，按值传递即可，不发生任何拷贝
+class PointView {
+public:
+    PointView() = default;
+    PointView(const double* data, size_t dim) : data_(data), dim_(dim) {}
+    // 允许从 Point 隐式构造，使 pivots 等 std::vector 也能直接传给距离函数
+    PointView(const Point& p) : data_(p.data()), dim_(p.size()) {} // NOLINT(google-explicit-constructor)
+
+    [[nodiscard]] const double* data() const { return data_; }
+    [[nodiscard]] size_t size() const { return dim_; }
+    [[nodiscard]] const double& operator[](size_t i) const { return data_[i]; }
+    [[nodiscard]] const double* begin() const { return data_; }
+    [[nodiscard]] const double* end() const { return data_ + dim_; }
+
+private:
+    const double* data_ = nullptr;
+    size_t dim_ = 0;
+};
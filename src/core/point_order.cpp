@@ -0,0 +1,114 @@
+#include "point_order.h"
+#include "dimension_transform.h"
+#include "work_stealing.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr size_t kMaxMortonDims = 8;
+
+int resolve_threads(int num_threads) {
+    return num_threads > 0 ? num_threads : hardware_thread_count();
+}
+
+// 把 dims 个 bits 位的坐标按位交错：第 b 位平面中维度 0 在最高位
+uint64_t interleave(const uint32_t* coords, size_t dims, unsigned bits) {
+    uint64_t key = 0;
+    for (int b = static_cast<int>(bits) - 1; b >= 0; --b) {
+        for (size_t j = 0; j < dims; ++j) key = (key << 1) | ((coords[j] >> b) & 1u);
+    }
+    return key;
+}
+
+} // namespace
+
+const char* point_order_name(PointOrder order) {
+    switch (order) {
+        case PointOrder::None: return "none";
+        case PointOrder::Cluster: return "cluster";
+        case PointOrder::Morton: return "morton";
+    }
+    return "unknown";
+}
+
+bool parse_point_order(const std::string& name, PointOrder& order) {
+    for (PointOrder o : {PointOrder::None, PointOrder::Cluster, PointOrder::Morton}) {
+        if (name == point_order_name(o)) {
+            order = o;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<int> cluster_order(const KMeansResult& kmeans) {
+    std::vector<int> order(kmeans.assignments.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        if (kmeans.assignments[a] != kmeans.assignments[b]) return kmeans.assignments[a] < kmeans.assignments[b];
+        if (kmeans.distances[a] != kmeans.distances[b]) return kmeans.distances[a] < kmeans.distances[b];
+        return a < b;
+    });
+    return order;
+}
+
+std::vector<int> morton_order(const Dataset& dataset, size_t leading_dims, int num_threads) {
+    num_threads = resolve_threads(num_threads);
+    const size_t n = dataset.size();
+    const size_t m = std::max<size_t>(1, std::min({leading_dims, kMaxMortonDims, dataset.dimensions()}));
+    const unsigned bits = static_cast<unsigned>(std::min<size_t>(32, 64 / m));
+
+    const DimensionTransform pca = DimensionTransform::fit(dataset, DimensionTransformKind::PCA, num_threads);
+    std::vector<double> coords(n * m);
+    parallel_for_work_stealing(n, num_threads, 256, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; ++i) pca.project(dataset.get_point(static_cast<int>(i)), m, coords.data() + i * m);
+    });
+    std::vector<double> lo(m, std::numeric_limits<double>::max());
+    std::vector<double> hi(m, std::numeric_limits<double>::lowest());
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < m; ++j) {
+            lo[j] = std::min(lo[j], coords[i * m + j]);
+            hi[j] = std::max(hi[j], coords[i * m + j]);
+        }
+    }
+
+    const double levels = static_cast<double>((uint64_t{1} << bits) - 1);
+    std::vector<std::pair<uint64_t, int>> keys(n);
+    parallel_for_work_stealing(n, num_threads, 1024, [&](size_t begin, size_t end, int) {
+        uint32_t q[kMaxMortonDims];
+        for (size_t i = begin; i < end; ++i) {
+            for (size_t j = 0; j < m; ++j) {
+                const double span = hi[j] - lo[j];
+                const double t = span > 0.0 ? (coords[i * m + j] - lo[j]) / span : 0.0;
+                q[j] = static_cast<uint32_t>(std::min(levels, std::max(0.0, t * levels)));
+            }
+            keys[i] = {interleave(q, m, bits), static_cast<int>(i)};
+        }
+    });
+    std::sort(keys.begin(), keys.end());
+    std::vector<int> order(n);
+    for (size_t i = 0; i < n; ++i) order[i] = keys[i].second;
+    return order;
+}
+
+Dataset permute_points(const Dataset& dataset, const std::vector<int>& order, int num_threads) {
+    Dataset out;
+    out.reset(dataset.dimensions());
+    out.resize(order.size());
+    double* dst = out.mutable_data();
+    const size_t stride = out.stride();
+    parallel_for_work_stealing(order.size(), resolve_threads(num_threads), 1024, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; ++i) {
+            const PointView src = dataset.get_point(order[i]);
+            std::memcpy(dst + i * stride, src.data(), src.size() * sizeof(double));
+        }
+    });
+    if (dataset.erased_count() > 0) {
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (dataset.is_erased(order[i])) out.erase(static_cast<int>(i));
+        }
+    }
+    return out;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "dataset.h"
+#include "kmeans.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 点的物理排列顺序：把空间上相近的点放到相邻的内存中，提高范围查询、连接和批量查询的缓存/TLB 命中率。
+// 所有函数返回的 order 都满足：重排后第 i 个点是原数据集的第 order[i] 个点
+enum class PointOrder : uint32_t {
+    None = 0,    // 保持原顺序
+    Cluster = 1, // 按 k-means 簇排列，簇内按到中心的距离升序
+    Morton = 2,  // 按前几个 PCA 主成分坐标的 Morton (Z 序) 编码排列
+};
+
+const char* point_order_name(PointOrder order);
+bool parse_point_order(const std::string& name, PointOrder& order);
+
+// 簇顺序：与 KMeansTrianglePruning 的簇内成员表顺序一致 (簇号、到中心的距离、原下标)
+std::vector<int> cluster_order(const KMeansResult& kmeans);
+
+// Morton 顺序：把每个点投影到前 leading_dims 个主成分上 (最多 8 个)，各坐标按全体点的范围
+// 量化后交错拼成 64 位键再排序
+std::vector<int> morton_order(const Dataset& dataset, size_t leading_dims = 4, int num_threads = 0);
+
+// 按 order 复制出重排后的数据集 (删除标记随点复制)；不需要保留原数据集时用 Dataset::permute 原地重排
+Dataset permute_points(const Dataset& dataset, const std::vector<int>& order, int num_threads = 0);
@@ -0,0 +1,25 @@
+#pragma once
+#include "point.h"
+#include <algorithm>
+
+// 软件预取 [data, data + bytes) 的前若干个缓存行，
+// 后续的缓存行由硬件的顺序预取器接手。
+inline void prefetch_bytes(const void* data, size_t bytes) {
+#if defined(__GNUC__) || defined(__clang__)
+    constexpr size_t kCacheLine = 64;
+    constexpr size_t kMaxPrefetchBytes = 256;
+    const char* base = static_cast<const char*>(data);
+    bytes = std::min(bytes, kMaxPrefetchBytes);
+    for (size_t offset = 0; offset < bytes; offset += kCacheLine) {
+        __builtin_prefetch(base + offset, 0, 3);
+    }
+#else
+    (void)data;
+    (void)bytes;
+#endif
+}
+
+// 软件预取一个点的坐标数据
+inline void prefetch_point(PointView p) {
+    prefetch_bytes(p.data(), p.size() * sizeof(double));
+}
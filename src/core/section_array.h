@@ -0,0 +1,103 @@
+#pragma once
+#include "mapped_file.h"
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// 持久化索引中的一节定长数组：要么直接指向内存映射的索引文件 (IndexFileReader::view_vector，零拷贝，
+// 映射的页在多个进程之间共享)，要么是自有的 vector (build 的结果)。两者的只读访问完全相同；
+// 任何修改都先把映射的内容拷贝到自有内存中，与 Dataset 对 nodes.bin 的处理方式一致。
+template <typename T, typename Alloc = std::allocator<T>>
+class SectionArray {
+public:
+    SectionArray() = default;
+    SectionArray(std::vector<T, Alloc> values) : owned_(std::move(values)) { sync(); }
+    SectionArray(const SectionArray& other) { *this = other; }
+    SectionArray(SectionArray&& other) noexcept { *this = std::move(other); }
+    SectionArray& operator=(const SectionArray& other) {
+        if (this != &other) {
+            owned_ = other.owned_;
+            mapping_ = other.mapping_;
+            base_ = mapping_ != nullptr ? other.base_ : owned_.data();
+            size_ = other.size_;
+        }
+        return *this;
+    }
+    SectionArray& operator=(SectionArray&& other) noexcept {
+        if (this != &other) {
+            owned_ = std::move(other.owned_);
+            mapping_ = std::move(other.mapping_);
+            base_ = mapping_ != nullptr ? other.base_ : owned_.data();
+            size_ = other.size_;
+            other.clear();
+        }
+        return *this;
+    }
+    SectionArray& operator=(std::vector<T, Alloc> values) {
+        mapping_.reset();
+        owned_ = std::move(values);
+        sync();
+        return *this;
+    }
+
+    [[nodiscard]] const T* data() const { return base_; }
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+    [[nodiscard]] const T& operator[](size_t i) const { return base_[i]; }
+    [[nodiscard]] const T* begin() const { return base_; }
+    [[nodiscard]] const T* end() const { return base_ + size_; }
+    // 数据是否直接位于内存映射的索引文件中
+    [[nodiscard]] bool is_mapped() const { return mapping_ != nullptr; }
+
+    // 可写的缓冲区 (若数据来自内存映射，会先拷贝到自有内存中)。自有内存上只读取成员，可以被多个线程同时调用
+    [[nodiscard]] T* mutable_data() {
+        materialize();
+        return owned_.data();
+    }
+    void assign(size_t count, const T& value) {
+        mapping_.reset();
+        owned_.assign(count, value);
+        sync();
+    }
+    void resize(size_t count, const T& value = T()) {
+        materialize();
+        owned_.resize(count, value);
+        sync();
+    }
+    void push_back(const T& value) {
+        materialize();
+        owned_.push_back(value);
+        sync();
+    }
+    void clear() {
+        mapping_.reset();
+        owned_.clear();
+        sync();
+    }
+
+    // 指向映射文件中的 count 个元素 (data 必须按 T 对齐)，mapping 保证映射在本对象使用期间有效
+    void map(std::shared_ptr<const MappedFile> mapping, const T* data, size_t count) {
+        owned_ = std::vector<T, Alloc>();
+        mapping_ = std::move(mapping);
+        base_ = data;
+        size_ = count;
+    }
+
+private:
+    void materialize() {
+        if (mapping_ == nullptr) return;
+        owned_.assign(base_, base_ + size_);
+        mapping_.reset();
+        sync();
+    }
+    void sync() {
+        base_ = owned_.data();
+        size_ = owned_.size();
+    }
+
+    std::vector<T, Alloc> owned_;
+    std::shared_ptr<const MappedFile> mapping_; // 非空时 base_ 指向映射内存
+    const T* base_ = nullptr;
+    size_t size_ = 0;
+};
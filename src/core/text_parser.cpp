@@ -0,0 +1,174 @@
+#include "text_parser.h"
+#include "work_stealing.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace {
+
+// 目标块大小：足够大以摊薄调度开销，又足够小以便在线程间平衡负载
+constexpr size_t kTargetChunkBytes = size_t{4} << 20;
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+enum class LineStatus { Empty, Ok, BadNumber, WrongDimension };
+
+// 解析 [begin, end) 中的一行，最多写入 max_values 个值到 out。
+// count 返回该行实际包含的数值个数 (超过 max_values 时继续计数但不再写入)。
+LineStatus parse_line(const char* begin, const char* end, double* out, size_t max_values, size_t& count) {
+    count = 0;
+    const char* p = begin;
+    while (true) {
+        while (p < end && is_space(*p)) ++p;
+        if (p == end) break;
+        // std::from_chars 不接受前导 '+'
+        if (*p == '+') ++p;
+        double value;
+        auto [next, ec] = std::from_chars(p, end, value);
+        if (ec != std::errc() || (next < end && !is_space(*next))) {
+            return LineStatus::BadNumber;
+        }
+        if (count < max_values) out[count] = value;
+        ++count;
+        p = next;
+    }
+    return count == 0 ? LineStatus::Empty : LineStatus::Ok;
+}
+
+struct Chunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    size_t num_lines = 0;        // 块内的行数 (含空行)，用于计算全局行号
+    size_t num_rows = 0;         // 块内解析出的点数
+    std::vector<double> values;  // num_rows * stride，行尾填充为 0
+    size_t error_line = 0;       // 块内出错的行 (从 0 开始)；无错误时为 SIZE_MAX
+    LineStatus error = LineStatus::Ok;
+    size_t error_count = 0;      // 出错行的数值个数 (维度错误时使用)
+};
+
+void parse_chunk(Chunk& chunk, size_t dims, size_t stride) {
+    chunk.error_line = std::numeric_limits<size_t>::max();
+    std::vector<double> row(dims);
+    const char* p = chunk.begin;
+    size_t line = 0;
+    while (p < chunk.end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(chunk.end - p)));
+        const char* line_end = newline ? newline : chunk.end;
+        size_t count = 0;
+        LineStatus status = parse_line(p, line_end, row.data(), dims, count);
+        if (status == LineStatus::Ok && count != dims) status = LineStatus::WrongDimension;
+        if (status == LineStatus::BadNumber || status == LineStatus::WrongDimension) {
+            chunk.error = status;
+            chunk.error_line = line;
+            chunk.error_count = count;
+            return;
+        }
+        if (status == LineStatus::Ok) {
+            size_t offset = chunk.values.size();
+            chunk.values.resize(offset + stride, 0.0);
+            std::copy(row.begin(), row.end(), chunk.values.begin() + static_cast<std::ptrdiff_t>(offset));
+            chunk.num_rows++;
+        }
+        ++line;
+        p = newline ? newline + 1 : chunk.end;
+    }
+    chunk.num_lines = line;
+}
+
+} // namespace
+
+bool parse_nodes_text(const char* text, size_t size, Dataset& dataset, int num_threads,
+                      const std::string& source_name) {
+    if (num_threads <= 0) num_threads = hardware_thread_count();
+    const char* const text_end = text + size;
+
+    // 第一个非空行决定维度
+    size_t dims = 0;
+    size_t first_line_no = 0;
+    {
+        const char* p = text;
+        while (p < text_end && dims == 0) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(text_end - p)));
+            const char* line_end = newline ? newline : text_end;
+            size_t count = 0;
+            // 第一遍只计数，不写入
+            LineStatus status = parse_line(p, line_end, nullptr, 0, count);
+            if (status == LineStatus::BadNumber) {
+                std::cerr << "Error: " << source_name << ":" << first_line_no + 1 << ": invalid number." << std::endl;
+                dataset.reset(0);
+                return false;
+            }
+            dims = count;
+            ++first_line_no;
+            p = newline ? newline + 1 : text_end;
+        }
+    }
+    dataset.reset(dims);
+    if (dims == 0) {
+        return true; // 文件中没有任何点
+    }
+    const size_t stride = dataset.stride();
+
+    // 按行边界切块
+    std::vector<Chunk> chunks;
+    const size_t target = std::max(kTargetChunkBytes, size / (static_cast<size_t>(num_threads) * 8) + 1);
+    for (const char* p = text; p < text_end;) {
+        const char* end = p + std::min(target, static_cast<size_t>(text_end - p));
+        if (end < text_end) {
+            const char* newline = static_cast<const char*>(std::memchr(end, '\n', static_cast<size_t>(text_end - end)));
+            end = newline ? newline + 1 : text_end;
+        }
+        Chunk chunk;
+        chunk.begin = p;
+        chunk.end = end;
+        chunks.push_back(std::move(chunk));
+        p = end;
+    }
+
+    parallel_for_work_stealing(chunks.size(), num_threads, 1, [&](size_t begin, size_t end, int) {
+        for (size_t c = begin; c < end; ++c) {
+            Chunk& chunk = chunks[c];
+            // 按每个数值至少 4 个字节粗略预估容量，减少扩容次数
+            chunk.values.reserve(static_cast<size_t>(chunk.end - chunk.begin) / (dims * 4 + 1) * stride);
+            parse_chunk(chunk, dims, stride);
+        }
+    });
+
+    // 按文件顺序找到第一个出错的块，报告全局行号
+    size_t line_base = 0;
+    size_t total_rows = 0;
+    for (const Chunk& chunk : chunks) {
+        if (chunk.error_line != std::numeric_limits<size_t>::max()) {
+            std::cerr << "Error: " << source_name << ":" << line_base + chunk.error_line + 1 << ": ";
+            if (chunk.error == LineStatus::BadNumber) {
+                std::cerr << "invalid number." << std::endl;
+            } else {
+                std::cerr << "inconsistent dimension (expected " << dims << ", found " << chunk.error_count << ")." << std::endl;
+            }
+            dataset.reset(0);
+            return false;
+        }
+        line_base += chunk.num_lines;
+        total_rows += chunk.num_rows;
+    }
+
+    // 把各块结果拷贝进连续缓冲区
+    dataset.resize(total_rows);
+    std::vector<size_t> row_offsets(chunks.size(), 0);
+    for (size_t c = 1; c < chunks.size(); ++c) {
+        row_offsets[c] = row_offsets[c - 1] + chunks[c - 1].num_rows;
+    }
+    double* out = dataset.mutable_data();
+    parallel_for_work_stealing(chunks.size(), num_threads, 1, [&](size_t begin, size_t end, int) {
+        for (size_t c = begin; c < end; ++c) {
+            std::copy(chunks[c].values.begin(), chunks[c].values.end(), out + row_offsets[c] * stride);
+            std::vector<double>().swap(chunks[c].values);
+        }
+    });
+    return true;
+}
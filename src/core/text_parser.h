@@ -0,0 +1,13 @@
+#pragma once
+#include "dataset.h"
+#include <cstddef>
+#include <string>
+
+// 并行解析 nodes.txt 格式的文本 (每行一个点，坐标以空白分隔，空行被忽略)：
+//  1. 把整段文本按行边界切成若干块；
+//  2. 各线程用 std::from_chars 独立解析自己的块，写入块内缓冲区；
+//  3. 按块的前缀和把结果并行拷贝进 dataset 的连续缓冲区。
+// 出现维度不一致或无法解析的数值时返回 false，并在 stderr 中报告文件名与出错行号。
+// num_threads <= 0 表示使用全部硬件线程。
+bool parse_nodes_text(const char* text, size_t size, Dataset& dataset, int num_threads,
+                      const std::string& source_name);
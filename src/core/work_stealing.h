@@ -0,0 +1,59 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// 返回可用的硬件线程数 (至少为 1)
+inline int hardware_thread_count() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : static_cast<int>(n);
+}
+
+// 把 [0, n) 分给 num_threads 个线程并行处理，带工作窃取：
+// 每个线程先按 chunk 大小消费自己那一段，做完后再去其它线程的剩余部分里“偷”块。
+// body(begin, end, thread_id) 处理区间 [begin, end)；调用线程本身作为 0 号线程参与工作。
+template <typename Body>
+void parallel_for_work_stealing(size_t n, int num_threads, size_t chunk, Body&& body) {
+    num_threads = std::max(1, num_threads);
+    chunk = std::max<size_t>(1, chunk);
+    if (num_threads == 1 || n <= chunk) {
+        if (n > 0) body(size_t{0}, n, 0);
+        return;
+    }
+
+    // 每个线程的区间各占一个缓存行，避免不同线程的游标互相伪共享
+    struct alignas(64) Range {
+        std::atomic<size_t> next{0};
+        size_t end = 0;
+    };
+    std::unique_ptr<Range[]> ranges(new Range[num_threads]);
+    for (int t = 0; t < num_threads; ++t) {
+        ranges[t].next.store(n * t / num_threads, std::memory_order_relaxed);
+        ranges[t].end = n * (t + 1) / num_threads;
+    }
+
+    auto worker = [&](int thread_id) {
+        // 先处理自己的区间，再按顺序轮询其它线程的区间
+        for (int k = 0; k < num_threads; ++k) {
+            Range& range = ranges[(thread_id + k) % num_threads];
+            while (true) {
+                size_t begin = range.next.fetch_add(chunk, std::memory_order_relaxed);
+                if (begin >= range.end) break;
+                body(begin, std::min(begin + chunk, range.end), thread_id);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (int t = 1; t < num_threads; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& th : threads) {
+        th.join();
+    }
+}
@@ -4,15 +4,24 @@
 #include <memory>
 #include <random>
 #include <iomanip>
+#include <sstream>
 #include <sys/stat.h>
 #include <fstream>
+#include <algorithm>
+#include <vector>
 
 #include "core/dataset.h"
+#include "core/dimension_transform.h"
 #include "core/distance.h"
 #include "algorithms/pruning_algorithm.h"
 #include "algorithms/brute_force_algorithm.h" // 引入基线算法
+#include "algorithms/cascade_pruning.h"
 #include "algorithms/kmeans_triangle_pruning.h"
 #include "algorithms/multi_pivot_triangle_pruning.h"
+#include "algorithms/parallel_query_driver.h"
+#include "core/perf_counters.h"
+#include "core/work_stealing.h"
+#include "bench/benchmark_runner.h"
 
 #if defined(_WIN32)
 #include <direct.h> // for _mkdir
@@ -47,31 +56,74 @@ void generate_random_data(const std::string& dir_path, int num_points, int dimen
 }
 
 // 新功能：分析数据集的真实距离分布
-void analyze_ground_truth(const Dataset& dataset, int num_samples, double r) {
+// 用多半径查询一次得到每个点对落在 r 附近哪一档 (r/4, r/2, r, 2r, 4r)，超过最大一档时提前退出
+void analyze_ground_truth(const Dataset& dataset, int num_samples, double r, uint64_t seed) {
     std::cout << "\n--- Ground Truth Analysis ---" << std::endl;
     std::cout << "Analyzing " << num_samples << " random pairs to check distance distribution against r = " << r << std::endl;
 
-    long long exceeds_count = 0;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, dataset.size() - 1);
-
-    for (int i = 0; i < num_samples; ++i) {
-        int p_idx = distrib(gen);
-        int q_idx = distrib(gen);
-        if (p_idx == q_idx) continue;
-
-        // 这里我们用最原始的距离计算，确保结果准确
-        if (euclidean_distance(dataset.get_point(p_idx), dataset.get_point(q_idx)) > r) {
-            exceeds_count++;
-        }
-    }
+    const std::vector<double> radii = {r / 4, r / 2, r, 2 * r, 4 * r};
+    const size_t r_bucket = 2; // radii[2] == r
+    const std::vector<long long> bucket_counts =
+        count_radius_buckets(dataset, generate_query_pairs(dataset.size(), num_samples, seed), radii);
 
+    long long exceeds_count = 0;
+    for (size_t b = r_bucket + 1; b < bucket_counts.size(); ++b) exceeds_count += bucket_counts[b];
     double exceeds_percentage = (num_samples > 0) ? (double)exceeds_count / num_samples * 100.0 : 0.0;
     std::cout << "Result: " << exceeds_count << " / " << num_samples
               << " (" << std::fixed << std::setprecision(2) << exceeds_percentage << "%)"
               << " of pairs have a distance > r." << std::endl;
     std::cout << "This represents the theoretical maximum pruning potential for lower-bound checks." << std::endl;
+    for (size_t b = 0; b < bucket_counts.size(); ++b) {
+        std::ostringstream range;
+        if (b == 0) {
+            range << "<= " << radii[0];
+        } else if (b == radii.size()) {
+            range << "> " << radii.back();
+        } else {
+            range << "in (" << radii[b - 1] << ", " << radii[b] << "]";
+        }
+        std::cout << "  d " << std::left << std::setw(16) << range.str() << std::right << ": " << bucket_counts[b] << " ("
+                  << (num_samples > 0 ? 100.0 * bucket_counts[b] / num_samples : 0.0) << "%)" << std::endl;
+    }
+}
+
+// 按判定规则拆分的查询统计，以及完整计算累加维度数的直方图 (需要以 PRUNING_INSTRUMENTATION 构建)
+void print_pruning_breakdown(const PruningBreakdown& breakdown, long long total_queries) {
+    std::cout << "\n--- Pruning Breakdown ---" << std::endl;
+    auto share = [&](long long n) { return total_queries > 0 ? 100.0 * static_cast<double>(n) / total_queries : 0.0; };
+    if (!PruningAlgorithm::kInstrumentationEnabled) {
+        std::cout << "Per-rule counters compiled out (configure with -DPRUNING_INSTRUMENTATION=ON)" << std::endl;
+    } else {
+        std::cout << "Lower-bound rule (d > r):  " << breakdown.lower_bound << " (" << share(breakdown.lower_bound) << "%)" << std::endl;
+        std::cout << "Upper-bound rule (d <= r): " << breakdown.upper_bound << " (" << share(breakdown.upper_bound) << "%)" << std::endl;
+    }
+    std::cout << "Quantized prefilter:       " << breakdown.prefilter << " (" << share(breakdown.prefilter) << "%)" << std::endl;
+    std::cout << "Full calculation:          " << breakdown.full_calculations << " (" << share(breakdown.full_calculations) << "%)" << std::endl;
+    if (!PruningAlgorithm::kInstrumentationEnabled || breakdown.full_calculations == 0) return;
+    std::cout << "Dimensions touched per full calculation:" << std::endl;
+    for (size_t i = 0; i < breakdown.dims_touched.size(); ++i) {
+        if (breakdown.dims_touched[i] == 0) continue;
+        const bool last = i + 1 == breakdown.dims_touched.size();
+        const std::string range = std::to_string(i * breakdown.bucket_dims + 1) +
+                                  (last ? "+" : " - " + std::to_string((i + 1) * breakdown.bucket_dims));
+        std::cout << "  " << std::setw(13) << range << ": " << std::setw(10) << breakdown.dims_touched[i] << " ("
+                  << 100.0 * static_cast<double>(breakdown.dims_touched[i]) / breakdown.full_calculations << "%)" << std::endl;
+    }
+}
+
+// 级联剪枝各阶段的执行次数、命中率和每个点对的耗时，以及当前选用的阶段顺序
+void print_cascade_stages(const CascadePruning& cascade) {
+    std::cout << "\n--- Cascade Stages ---" << std::endl;
+    for (const CascadeStageStats& stage : cascade.stage_stats()) {
+        const double hit_rate = stage.attempts > 0 ? 100.0 * static_cast<double>(stage.decisions) / stage.attempts : 0.0;
+        std::cout << std::left << std::setw(12) << cascade_stage_name(stage.stage) << std::right
+                  << " | runs: " << std::setw(10) << stage.attempts << " | hit rate: " << std::setw(6) << hit_rate << "%"
+                  << " | sampled hit rate: " << std::setw(6) << 100.0 * stage.sampled_hit_rate << "%"
+                  << " | cost: " << std::setw(8) << stage.mean_ns << " ns/pair" << std::endl;
+    }
+    std::cout << "Stage order:";
+    for (CascadeStage stage : cascade.stage_order()) std::cout << " " << cascade_stage_name(stage);
+    std::cout << std::endl;
 }
 
 // 封装实验运行和报告的函数
@@ -79,44 +131,145 @@ void run_experiment(const std::string& algorithm_name,
                     std::unique_ptr<PruningAlgorithm> algorithm,
                     const Dataset& dataset,
                     int num_queries,
-                    double query_radius)
+                    double query_radius,
+                    uint64_t seed,
+                    const std::string& index_path = "")
 {
     // ... (此函数代码不变，为简洁省略) ...
     std::cout << "\n=====================================================" << std::endl;
     std::cout << "Running Experiment for: " << algorithm_name << std::endl;
     std::cout << "=====================================================" << std::endl;
+    // 硬件计数器按阶段 (构建、逐条查询、批量查询) 统计；没有权限时只打印 n/a
+    PerfCounters perf;
+    perf.open();
+    // 指定了 index_path 时优先加载持久化的索引；文件不存在或已过期则重新构建并保存
+    perf.start();
     auto start_build = std::chrono::high_resolution_clock::now();
-    algorithm->build(dataset);
+    bool loaded = false;
+    if (!index_path.empty() && std::ifstream(index_path).good()) {
+        loaded = algorithm->load(index_path, dataset);
+    }
+    if (!loaded) {
+        algorithm->build(dataset);
+    }
     auto end_build = std::chrono::high_resolution_clock::now();
+    const PerfCounters::Sample build_perf = perf.stop();
     std::chrono::duration<double, std::milli> build_time = end_build - start_build;
+    if (!loaded && !index_path.empty()) {
+        if (algorithm->save(index_path)) {
+            std::cout << "Index saved to " << index_path << std::endl;
+        }
+    }
     std::cout << "\n--- Build Phase ---" << std::endl;
-    std::cout << "Build time: " << build_time.count() << " ms" << std::endl;
+    std::cout << (loaded ? "Index loaded from " + index_path + " in " : std::string("Build time: "))
+              << build_time.count() << " ms" << std::endl;
     std::cout << "\n--- Query Phase ---" << std::endl;
     std::cout << "Running " << num_queries << " queries with radius r = " << query_radius << std::endl;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> distrib(0, dataset.size() - 1);
+    // 预先生成全部点对 (p != q，由 seed 决定)，逐个查询与批量查询使用同一份工作负载
+    const std::vector<QueryPair> pairs = generate_query_pairs(dataset.size(), num_queries, seed);
+    std::vector<uint8_t> single_results(pairs.size());
     algorithm->reset_stats();
+    perf.start();
     auto start_query = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < num_queries; ++i) {
-        int p_idx = distrib(gen);
-        int q_idx = distrib(gen);
-        if (p_idx == q_idx) continue;
-        algorithm->query_distance_exceeds(p_idx, q_idx, query_radius);
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        single_results[i] = algorithm->query_distance_exceeds(pairs[i].p_idx, pairs[i].q_idx, query_radius) ? 1 : 0;
     }
     auto end_query = std::chrono::high_resolution_clock::now();
+    const PerfCounters::Sample query_perf = perf.stop();
+    const PruningBreakdown breakdown = algorithm->get_pruning_breakdown();
     std::chrono::duration<double, std::milli> query_time = end_query - start_query;
     long long full_calcs = algorithm->get_full_calculations_count();
-    long long total_valid_queries = num_queries;
+    long long prefilter_decisions = algorithm->get_prefilter_decisions_count();
+    long long total_valid_queries = static_cast<long long>(pairs.size());
     long long pruned_calcs = total_valid_queries - full_calcs;
     double pruning_rate = (total_valid_queries > 0) ? (double)pruned_calcs / total_valid_queries * 100.0 : 0.0;
+
+    // 批量查询：按 BATCH_SIZE 分批调用 query_distance_exceeds_batch
+    const size_t BATCH_SIZE = 4096;
+    std::vector<uint8_t> batch_results(pairs.size());
+    perf.start();
+    auto start_batch = std::chrono::high_resolution_clock::now();
+    for (size_t offset = 0; offset < pairs.size(); offset += BATCH_SIZE) {
+        size_t count = std::min(BATCH_SIZE, pairs.size() - offset);
+        algorithm->query_distance_exceeds_batch(pairs.data() + offset, count, query_radius, batch_results.data() + offset);
+    }
+    auto end_batch = std::chrono::high_resolution_clock::now();
+    const PerfCounters::Sample batch_perf = perf.stop();
+    std::chrono::duration<double, std::milli> batch_time = end_batch - start_batch;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        if (single_results[i] != batch_results[i]) mismatches++;
+    }
+
     std::cout << "\n--- Results for " << algorithm_name << " ---" << std::endl;
     std::cout << "Total query time: " << query_time.count() << " ms" << std::endl;
     std::cout << "Average query time: " << (total_valid_queries > 0 ? query_time.count() / total_valid_queries : 0) << " ms" << std::endl;
+    std::cout << "Batched query time: " << batch_time.count() << " ms (batch size " << BATCH_SIZE
+              << ", " << mismatches << " mismatches vs. single queries)" << std::endl;
     std::cout << "Total queries: " << total_valid_queries << std::endl;
     std::cout << "Full distance calculations: " << full_calcs << std::endl;
+    if (prefilter_decisions > 0) {
+        std::cout << "Decided by quantized prefilter: " << prefilter_decisions << std::endl;
+    }
     std::cout << "Pruned queries: " << pruned_calcs << std::endl;
     std::cout << "Pruning Rate: " << std::fixed << std::setprecision(2) << pruning_rate << "%" << std::endl;
+    print_pruning_breakdown(breakdown, total_valid_queries);
+    if (const auto* cascade = dynamic_cast<const CascadePruning*>(algorithm.get())) print_cascade_stages(*cascade);
+
+    std::cout << "\n--- Hardware Counters" << (perf.available() ? "" : " (perf_event_open unavailable)") << " ---" << std::endl;
+    std::cout << "Build:          " << format_perf_sample(build_perf) << std::endl;
+    std::cout << "Single queries: " << format_perf_sample(query_perf, total_valid_queries) << std::endl;
+    std::cout << "Batched:        " << format_perf_sample(batch_perf, total_valid_queries) << std::endl;
+
+    // 多线程扩展性：线程数从 1 倍增到硬件线程数
+    const int max_threads = hardware_thread_count();
+    std::cout << "\n--- Multi-threaded Scaling (1.." << max_threads << " threads) ---" << std::endl;
+    std::vector<uint8_t> parallel_results;
+    double single_thread_qps = 0.0;
+    for (int threads = 1;; threads = std::min(threads * 2, max_threads)) {
+        ParallelQueryDriver driver(threads);
+        auto run = driver.run(*algorithm, pairs, query_radius, parallel_results);
+        if (threads == 1) single_thread_qps = run.queries_per_second;
+        bool consistent = parallel_results == single_results;
+        std::cout << "Threads: " << std::setw(3) << threads
+                  << " | time: " << std::setw(9) << run.elapsed_ms << " ms"
+                  << " | throughput: " << std::setw(12) << run.queries_per_second << " queries/s"
+                  << " | speedup: " << (single_thread_qps > 0 ? run.queries_per_second / single_thread_qps : 0.0) << "x"
+                  << (consistent ? "" : " | RESULTS DIFFER") << std::endl;
+        if (threads == max_threads) break;
+    }
+    // 范围查询：对若干随机点求半径 r 内的全部邻居，并与线性扫描的结果核对
+    const int RANGE_QUERIES = 200;
+    std::cout << "\n--- Range Queries (" << RANGE_QUERIES << " random centers, r = " << query_radius << ") ---" << std::endl;
+    std::vector<int> neighbors;
+    std::vector<int> expected;
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<int> distrib(0, static_cast<int>(dataset.size()) - 1);
+    long long total_neighbors = 0;
+    size_t range_mismatches = 0;
+    double range_time_ms = 0.0;
+    algorithm->reset_stats();
+    for (int i = 0; i < RANGE_QUERIES; ++i) {
+        const int p_idx = distrib(gen);
+        auto start_range = std::chrono::high_resolution_clock::now();
+        algorithm->range_query(p_idx, query_radius, neighbors);
+        range_time_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_range).count();
+        total_neighbors += static_cast<long long>(neighbors.size());
+
+        expected.clear();
+        for (int x = 0; x < static_cast<int>(dataset.size()); ++x) {
+            if (x != p_idx && !is_distance_exceeding_early_exit(dataset.get_point(p_idx), dataset.get_point(x), query_radius)) {
+                expected.push_back(x);
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        if (neighbors != expected) range_mismatches++;
+    }
+    std::cout << "Average range query time: " << range_time_ms / RANGE_QUERIES << " ms"
+              << " | avg neighbors: " << static_cast<double>(total_neighbors) / RANGE_QUERIES
+              << " | full calculations per query: " << static_cast<double>(algorithm->get_full_calculations_count()) / RANGE_QUERIES
+              << " (of " << dataset.size() << " points)"
+              << " | " << range_mismatches << " mismatches vs. linear scan" << std::endl;
 }
 
 
@@ -130,10 +283,18 @@ int main() {
     const int NUM_POINTS = 10000;
     const int DIMENSIONS = 128;
 
+    // k 和半径按数据集调整：tools/auto_tune 在样本上比较各个算法和 k，并写出 benchmark 的配置文件
     const int K_MEANS_K = 500;
     const int K_MEANS_ITERATIONS = 20;
     const double QUERY_RADIUS = 0.5;
     const int NUM_QUERIES = 100000;
+    // 点对生成的随机种子：固定后每次运行的工作负载相同 (参数网格扫描和结果导出见 tools/benchmark.cpp)
+    const uint64_t QUERY_SEED = 42;
+    // 为 true 时，构建好的索引会保存在数据集目录下，之后的运行直接加载
+    const bool USE_INDEX_CACHE = true;
+    // 可选的维度预处理 (见 core/dimension_transform.h)：按方差重排或 PCA 旋转后，提前退出的距离判断
+    // 通常在更少的维度内结束。距离保持不变，但数据指纹会变化，缓存的索引会自动重建
+    const DimensionTransformKind DIMENSION_TRANSFORM = DimensionTransformKind::None;
 
     // --- 准备数据 ---
     Dataset dataset;
@@ -146,22 +307,60 @@ int main() {
             return 1;
         }
     }
+    specialize_distance_kernels(dataset.dimensions());
+
+    std::cout << "Distance kernels: " << g_distance_kernels.name;
+    if (g_distance_kernels.fixed_dimensions != 0) {
+        std::cout << " (unrolled for " << g_distance_kernels.fixed_dimensions << " dims)";
+    }
+    std::cout << std::endl;
+
+    if (DIMENSION_TRANSFORM != DimensionTransformKind::None) {
+        const DimensionTransform transform = DimensionTransform::fit(dataset, DIMENSION_TRANSFORM);
+        transform.apply(dataset);
+        std::cout << "Applied dimension transform: " << dimension_transform_name(DIMENSION_TRANSFORM) << " (90% of variance in first "
+                  << transform.dimensions_for_variance(0.9) << " of " << dataset.dimensions() << " dimensions)" << std::endl;
+    }
 
     // --- 运行地面实况分析 ---
-    analyze_ground_truth(dataset, NUM_QUERIES, QUERY_RADIUS);
+    analyze_ground_truth(dataset, NUM_QUERIES, QUERY_RADIUS, QUERY_SEED);
 
     // --- 运行实验对比 ---
     // 实验1：基线 - 暴力计算（带提前退出优化）
     auto algo_bf = std::make_unique<BruteForceAlgorithm>();
-    run_experiment("Brute-Force (with Early-Exit)", std::move(algo_bf), dataset, NUM_QUERIES, QUERY_RADIUS);
+    run_experiment("Brute-Force (with Early-Exit)", std::move(algo_bf), dataset, NUM_QUERIES, QUERY_RADIUS, QUERY_SEED);
 
     // 实验2：原始的单Pivot算法
     auto algo_single = std::make_unique<KMeansTrianglePruning>(K_MEANS_K, K_MEANS_ITERATIONS);
-    run_experiment("Single-Pivot Pruning", std::move(algo_single), dataset, NUM_QUERIES, QUERY_RADIUS);
+    const std::string k_suffix = "_k" + std::to_string(K_MEANS_K) + ".idx";
+    run_experiment("Single-Pivot Pruning", std::move(algo_single), dataset, NUM_QUERIES, QUERY_RADIUS, QUERY_SEED,
+                   USE_INDEX_CACHE ? dataset_dir + "/single_pivot" + k_suffix : "");
 
     // 实验3：新的 A-La-Carte 多Pivot算法
     auto algo_multi = std::make_unique<MultiPivotTrianglePruning>(K_MEANS_K, K_MEANS_ITERATIONS);
-    run_experiment("Multi-Pivot (A-La-Carte) Pruning", std::move(algo_multi), dataset, NUM_QUERIES, QUERY_RADIUS);
+    run_experiment("Multi-Pivot (A-La-Carte) Pruning", std::move(algo_multi), dataset, NUM_QUERIES, QUERY_RADIUS, QUERY_SEED,
+                   USE_INDEX_CACHE ? dataset_dir + "/multi_pivot" + k_suffix : "");
+
+    // 实验4：多Pivot + 8 位量化距离表 (内存约为 float64 表的 1/8，带误差界，结果不变)
+    auto algo_multi_u8 = std::make_unique<MultiPivotTrianglePruning>(K_MEANS_K, K_MEANS_ITERATIONS, 42,
+                                                                     PivotTableEncoding::UInt8);
+    run_experiment("Multi-Pivot Pruning (uint8 table)", std::move(algo_multi_u8), dataset, NUM_QUERIES, QUERY_RADIUS, QUERY_SEED,
+                   USE_INDEX_CACHE ? dataset_dir + "/multi_pivot_u8" + k_suffix : "");
+
+    // 实验5：单Pivot + int8 量化预过滤 (上下界判定不了的点对先用量化距离的可证明上下界判定)
+    QuantizedPrefilter prefilter;
+    prefilter.build(dataset);
+    std::cout << "\nQuantized prefilter: " << prefilter.memory_bytes() / (1024.0 * 1024.0) << " MB (dataset: "
+              << dataset.size() * dataset.stride() * sizeof(double) / (1024.0 * 1024.0) << " MB)" << std::endl;
+    auto algo_single_q = std::make_unique<KMeansTrianglePruning>(K_MEANS_K, K_MEANS_ITERATIONS);
+    algo_single_q->set_prefilter(&prefilter);
+    run_experiment("Single-Pivot Pruning + int8 prefilter", std::move(algo_single_q), dataset, NUM_QUERIES, QUERY_RADIUS, QUERY_SEED,
+                   USE_INDEX_CACHE ? dataset_dir + "/single_pivot" + k_suffix : "");
+
+    // 实验6：级联剪枝 (单中心界 -> 最近 pivot 的界 -> 全部 pivot 的界 -> 完整计算，顺序随负载自适应)
+    auto algo_cascade = std::make_unique<CascadePruning>(K_MEANS_K, K_MEANS_ITERATIONS);
+    run_experiment("Cascade Pruning", std::move(algo_cascade), dataset, NUM_QUERIES, QUERY_RADIUS, QUERY_SEED,
+                   USE_INDEX_CACHE ? dataset_dir + "/cascade" + k_suffix : "");
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "query_client.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+QueryClient::~QueryClient() {
+    close();
+}
+
+bool QueryClient::connect(const std::string& socket_path) {
+    close();
+#if defined(_WIN32)
+    std::cerr << "Error: The query client is not supported on this platform" << std::endl;
+    return false;
+#else
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path is too long: " << socket_path << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0 || ::connect(fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Error: Could not connect to query server (" << std::strerror(errno) << "): " << socket_path
+                  << std::endl;
+        close();
+        return false;
+    }
+    if (!read_all(&hello_, sizeof(hello_)) || std::memcmp(hello_.magic, kQueryServerMagic, sizeof(hello_.magic)) != 0 ||
+        hello_.version != kQueryProtocolVersion) {
+        std::cerr << "Error: Unexpected handshake from query server: " << socket_path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+#endif
+}
+
+void QueryClient::close() {
+#if !defined(_WIN32)
+    if (fd_ >= 0) ::close(fd_);
+#endif
+    fd_ = -1;
+}
+
+bool QueryClient::send_request(uint64_t request_id, const WireQuery* queries, size_t count) {
+    RequestHeader header{};
+    header.request_id = request_id;
+    header.count = static_cast<uint32_t>(count);
+    if (!write_all(&header, sizeof(header)) || !write_all(queries, count * sizeof(WireQuery))) {
+        std::cerr << "Error: Failed sending request " << request_id << " to query server" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool QueryClient::receive_response(ResponseHeader& header, std::vector<uint8_t>& results) {
+    if (!read_all(&header, sizeof(header))) return false;
+    results.resize(header.count);
+    return read_all(results.data(), results.size());
+}
+
+bool QueryClient::write_all(const void* data, size_t size) {
+#if defined(_WIN32)
+    (void)data;
+    (void)size;
+    return false;
+#else
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+#if defined(MSG_NOSIGNAL)
+        const ssize_t n = ::send(fd_, bytes, size, MSG_NOSIGNAL);
+#else
+        const ssize_t n = ::send(fd_, bytes, size, 0);
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+#endif
+}
+
+bool QueryClient::read_all(void* data, size_t size) {
+#if defined(_WIN32)
+    (void)data;
+    (void)size;
+    return false;
+#else
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        const ssize_t n = ::recv(fd_, bytes, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+#endif
+}
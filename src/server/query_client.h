@@ -0,0 +1,36 @@
+#pragma once
+#include "query_protocol.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// QueryServer 的阻塞式客户端 (协议见 query_protocol.h)。发送与接收相互独立，
+// 调用方可以先连续发送多个请求再依次接收应答 (流水线)；应答的顺序不一定与请求相同。
+// 未接收的应答积压过多时服务端会暂停读取该连接，因此流水线中未完成的点对数应远小于
+// 服务端的 max_output_bytes。不是线程安全的：每个线程使用自己的连接
+class QueryClient {
+public:
+    QueryClient() = default;
+    ~QueryClient();
+    QueryClient(const QueryClient&) = delete;
+    QueryClient& operator=(const QueryClient&) = delete;
+
+    // 连接并读取 ServerHello；失败或协议不匹配时打印错误并返回 false
+    bool connect(const std::string& socket_path);
+    void close();
+
+    [[nodiscard]] const ServerHello& server() const { return hello_; }
+
+    // 发送一个请求；连接出错时打印错误并返回 false
+    bool send_request(uint64_t request_id, const WireQuery* queries, size_t count);
+    // 接收下一个应答，results 调整为 header.count 个结果字节；连接关闭或出错时返回 false
+    bool receive_response(ResponseHeader& header, std::vector<uint8_t>& results);
+
+private:
+    bool write_all(const void* data, size_t size);
+    bool read_all(void* data, size_t size);
+
+    int fd_ = -1;
+    ServerHello hello_{};
+};
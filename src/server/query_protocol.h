@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+
+// 本机查询服务 (query_server.h) 的 Unix 域套接字协议，字节序为主机字节序 (只在同一台机器上使用)。
+//
+// 连接建立后服务端先发送一个 ServerHello。之后客户端可以连续发送任意多个请求而不必等待应答：
+//   请求 = RequestHeader + count 个 WireQuery
+//   应答 = ResponseHeader + count 个结果字节 (status 为 Ok 时；否则没有结果字节，count 为 0)
+// 结果字节为 1 表示该点对的距离 > r。应答按完成顺序返回，可能与请求顺序不同，用 request_id 对应。
+// 请求的点对数超过 ServerHello::max_request_pairs 时服务端回复 TooLarge 并在发送完应答后关闭连接
+
+constexpr char kQueryServerMagic[8] = {'P', 'R', 'U', 'N', 'E', 'S', 'R', 'V'};
+constexpr uint32_t kQueryProtocolVersion = 1;
+
+struct ServerHello {
+    char magic[8];
+    uint32_t version;
+    uint32_t max_request_pairs;
+    uint64_t num_points;
+    uint64_t dimensions;
+};
+static_assert(sizeof(ServerHello) == 32, "ServerHello layout must stay fixed");
+
+struct RequestHeader {
+    uint64_t request_id;
+    uint32_t count;
+    uint32_t reserved;
+};
+static_assert(sizeof(RequestHeader) == 16, "RequestHeader layout must stay fixed");
+
+// 一个点对查询：d(p, q) > r ？
+struct WireQuery {
+    int32_t p_idx;
+    int32_t q_idx;
+    double r;
+};
+static_assert(sizeof(WireQuery) == 16, "WireQuery layout must stay fixed");
+
+enum class ResponseStatus : uint32_t {
+    Ok = 0,
+    InvalidQuery = 1, // 下标越界，或 r 为负数 / 非有限值
+    TooLarge = 2,     // 点对数超过 max_request_pairs
+};
+
+struct ResponseHeader {
+    uint64_t request_id;
+    uint32_t count;
+    uint32_t status;
+};
+static_assert(sizeof(ResponseHeader) == 16, "ResponseHeader layout must stay fixed");
@@ -0,0 +1,522 @@
+#include "query_server.h"
+#include "../core/cycle_clock.h"
+#include "../core/work_stealing.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t kMaxLatencySamples = size_t{1} << 20;
+// 一次 read_input 最多读取的字节数，避免一个发送很快的连接独占 I/O 线程
+constexpr size_t kMaxReadBytes = size_t{1} << 20;
+constexpr auto kStopTimeout = std::chrono::seconds(2);
+
+#if defined(MSG_NOSIGNAL)
+constexpr int kSendFlags = MSG_NOSIGNAL; // 对端已关闭时返回 EPIPE 而不是触发 SIGPIPE
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+void append_bytes(std::vector<char>& out, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+#if !defined(_WIN32)
+bool set_nonblocking(int fd) {
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+#endif
+
+} // namespace
+
+QueryServer::QueryServer(PruningAlgorithm& algorithm, size_t num_points, size_t dimensions, QueryServerOptions options)
+    : algorithm_(algorithm), num_points_(num_points), dimensions_(dimensions), options_(std::move(options)) {
+    if (options_.socket_path.empty()) {
+        throw std::invalid_argument("QueryServer: socket path must not be empty");
+    }
+    if (options_.max_batch_pairs == 0 || options_.max_inflight_pairs == 0 || options_.max_request_pairs == 0 ||
+        options_.max_output_bytes == 0) {
+        throw std::invalid_argument("QueryServer: batch, in-flight, request and output limits must be positive");
+    }
+    if (options_.max_request_pairs > UINT32_MAX) {
+        throw std::invalid_argument("QueryServer: max_request_pairs must fit in 32 bits");
+    }
+    if (options_.max_batch_delay_us < 0) {
+        throw std::invalid_argument("QueryServer: max_batch_delay_us must be non-negative");
+    }
+    num_threads_ = options_.threads > 0 ? options_.threads : hardware_thread_count();
+}
+
+QueryServer::~QueryServer() {
+    stop();
+}
+
+bool QueryServer::start() {
+    if (running_) return true;
+#if defined(_WIN32)
+    std::cerr << "Error: The query server is not supported on this platform" << std::endl;
+    return false;
+#else
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (options_.socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path is too long: " << options_.socket_path << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, options_.socket_path.c_str(), options_.socket_path.size() + 1);
+
+    const auto fail = [&](const char* what) {
+        std::cerr << "Error: " << what << " (" << std::strerror(errno) << "): " << options_.socket_path << std::endl;
+        for (int* fd : {&listen_fd_, &wake_fds_[0], &wake_fds_[1]}) {
+            if (*fd >= 0) ::close(*fd);
+            *fd = -1;
+        }
+        return false;
+    };
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) return fail("Could not create socket");
+    ::unlink(options_.socket_path.c_str());
+    if (::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        return fail("Could not bind socket");
+    }
+    if (::listen(listen_fd_, 128) != 0 || !set_nonblocking(listen_fd_)) return fail("Could not listen on socket");
+    if (::pipe(wake_fds_) != 0 || !set_nonblocking(wake_fds_[0]) || !set_nonblocking(wake_fds_[1])) {
+        ::unlink(options_.socket_path.c_str());
+        return fail("Could not create wake-up pipe");
+    }
+
+    stopping_ = false;
+    draining_ = false;
+    metrics_start_ = std::chrono::steady_clock::now();
+    running_ = true;
+    io_thread_ = std::thread(&QueryServer::io_loop, this);
+    workers_.reserve(num_threads_);
+    for (int t = 0; t < num_threads_; ++t) {
+        workers_.emplace_back(&QueryServer::worker_loop, this);
+    }
+    return true;
+#endif
+}
+
+void QueryServer::stop() {
+    if (!running_) return;
+#if !defined(_WIN32)
+    // I/O 线程先停止接收，等已接收的请求全部应答并发出后退出；之后工作线程在队列空时退出
+    stopping_ = true;
+    queue_cv_.notify_all();
+    wake_io();
+    io_thread_.join();
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        draining_ = true;
+    }
+    queue_cv_.notify_all();
+    for (auto& worker : workers_) worker.join();
+    workers_.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        for (auto& [id, connection] : connections_) {
+            ::close(connection->fd);
+            connection->fd = -1;
+        }
+        connections_.clear();
+    }
+    ::close(listen_fd_);
+    ::unlink(options_.socket_path.c_str());
+    ::close(wake_fds_[0]);
+    ::close(wake_fds_[1]);
+    listen_fd_ = -1;
+    wake_fds_[0] = wake_fds_[1] = -1;
+#endif
+    running_ = false;
+}
+
+QueryServerMetrics QueryServer::take_metrics() {
+    QueryServerMetrics metrics;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        metrics.connections = connections_.size();
+    }
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    const SteadyTime now = std::chrono::steady_clock::now();
+    metrics.elapsed_s = std::chrono::duration<double>(now - metrics_start_).count();
+    metrics.requests = requests_;
+    metrics.pairs = pairs_;
+    metrics.rejected = rejected_;
+    metrics.batches = batches_;
+    if (metrics.elapsed_s > 0.0) {
+        metrics.requests_per_second = static_cast<double>(requests_) / metrics.elapsed_s;
+        metrics.pairs_per_second = static_cast<double>(pairs_) / metrics.elapsed_s;
+    }
+    metrics.mean_batch_pairs = batches_ > 0 ? static_cast<double>(batched_pairs_) / static_cast<double>(batches_) : 0.0;
+    metrics.latency = summarize_latencies(latency_ticks_);
+    metrics.peak_inflight_pairs = peak_inflight_pairs_;
+    metrics.backpressure_pauses = backpressure_pauses_;
+
+    metrics_start_ = now;
+    requests_ = pairs_ = rejected_ = batches_ = batched_pairs_ = backpressure_pauses_ = 0;
+    peak_inflight_pairs_ = inflight_pairs_.load();
+    latency_ticks_.clear();
+    return metrics;
+}
+
+#if !defined(_WIN32)
+
+void QueryServer::wake_io() {
+    // 已有未处理的唤醒时不必再写
+    if (wake_pending_.exchange(true)) return;
+    const char byte = 1;
+    while (::write(wake_fds_[1], &byte, 1) < 0 && errno == EINTR) {
+    }
+}
+
+void QueryServer::io_loop() {
+    std::vector<pollfd> fds;
+    std::vector<std::shared_ptr<Connection>> polled;
+    std::vector<std::shared_ptr<Connection>> snapshot;
+    bool paused = false;
+    SteadyTime stop_deadline{};
+
+    while (true) {
+        const bool stopping = stopping_.load();
+        if (stopping && stop_deadline == SteadyTime{}) stop_deadline = std::chrono::steady_clock::now() + kStopTimeout;
+
+        snapshot.clear();
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            for (auto& [id, connection] : connections_) snapshot.push_back(connection);
+        }
+        // 先处理因背压留在缓冲区中的请求，再发送已生成的应答
+        bool output_pending = false;
+        for (auto& connection : snapshot) {
+            if (!stopping && !connection->closing) admit_requests(*connection);
+            if (!flush_output(*connection)) {
+                close_connection(connection->id);
+                connection.reset();
+                continue;
+            }
+            if (pending_output(*connection) > 0) {
+                output_pending = true;
+            } else if (connection->closing) {
+                close_connection(connection->id);
+                connection.reset();
+            }
+        }
+        if (stopping && ((inflight_pairs_.load() == 0 && !output_pending) ||
+                         std::chrono::steady_clock::now() >= stop_deadline)) {
+            break;
+        }
+
+        const bool over_limit = inflight_pairs_.load() >= options_.max_inflight_pairs;
+        if (over_limit && !paused) {
+            std::lock_guard<std::mutex> lock(metrics_mutex_);
+            ++backpressure_pauses_;
+        }
+        paused = over_limit;
+
+        fds.clear();
+        polled.clear();
+        fds.push_back({wake_fds_[0], POLLIN, 0});
+        if (!stopping) fds.push_back({listen_fd_, POLLIN, 0});
+        for (auto& connection : snapshot) {
+            if (connection == nullptr) continue;
+            const size_t pending = pending_output(*connection);
+            short events = 0;
+            if (!stopping && !connection->closing && !over_limit && pending < options_.max_output_bytes) events |= POLLIN;
+            if (pending > 0) events |= POLLOUT;
+            fds.push_back({connection->fd, events, 0});
+            polled.push_back(connection);
+        }
+
+        // 停止时定期醒来检查超时；平时由新连接、请求或工作线程的唤醒驱动
+        const int timeout_ms = stopping ? 10 : -1;
+        if (::poll(fds.data(), fds.size(), timeout_ms) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error: poll failed in query server: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        size_t next = 0;
+        if (fds[next++].revents != 0) {
+            // 先排空再清除标志：清除之后到来的唤醒一定会重新写入字节；排空期间到来的唤醒不写字节，
+            // 但它们的应答在本轮循环开头的 flush_output 中发出
+            char buffer[256];
+            while (::read(wake_fds_[0], buffer, sizeof(buffer)) > 0) {
+            }
+            wake_pending_ = false;
+        }
+        if (!stopping && (fds[next++].revents & POLLIN) != 0) accept_connections();
+        for (size_t i = 0; i < polled.size(); ++i) {
+            const short revents = fds[next + i].revents;
+            if ((revents & (POLLIN | POLLHUP | POLLERR)) == 0) continue;
+            if (!read_input(*polled[i])) close_connection(polled[i]->id);
+        }
+    }
+}
+
+void QueryServer::accept_connections() {
+    while (true) {
+        const int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "Error: accept failed in query server: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        if (!set_nonblocking(fd)) {
+            ::close(fd);
+            continue;
+        }
+        auto connection = std::make_shared<Connection>();
+        connection->fd = fd;
+        ServerHello hello{};
+        std::memcpy(hello.magic, kQueryServerMagic, sizeof(hello.magic));
+        hello.version = kQueryProtocolVersion;
+        hello.max_request_pairs = static_cast<uint32_t>(options_.max_request_pairs);
+        hello.num_points = num_points_;
+        hello.dimensions = dimensions_;
+        append_bytes(connection->output, &hello, sizeof(hello));
+
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connection->id = next_connection_id_++;
+        connections_.emplace(connection->id, std::move(connection));
+    }
+}
+
+bool QueryServer::read_input(Connection& connection) {
+    if (connection.closing) return true;
+    char buffer[65536];
+    size_t total = 0;
+    while (total < kMaxReadBytes) {
+        const ssize_t n = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            append_bytes(connection.input, buffer, static_cast<size_t>(n));
+            total += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        return false; // 对端关闭或出错
+    }
+    return true;
+}
+
+void QueryServer::admit_requests(Connection& connection) {
+    size_t offset = 0;
+    const std::vector<char>& input = connection.input;
+    while (input.size() - offset >= sizeof(RequestHeader) && inflight_pairs_.load() < options_.max_inflight_pairs) {
+        RequestHeader header;
+        std::memcpy(&header, input.data() + offset, sizeof(header));
+        if (header.count > options_.max_request_pairs) {
+            // 无法跳过过大的请求体：回复后关闭连接
+            send_response(connection.id, header.request_id, ResponseStatus::TooLarge, nullptr, 0);
+            connection.closing = true;
+            offset = input.size();
+            std::lock_guard<std::mutex> lock(metrics_mutex_);
+            ++rejected_;
+            break;
+        }
+        const size_t body_bytes = static_cast<size_t>(header.count) * sizeof(WireQuery);
+        if (input.size() - offset < sizeof(header) + body_bytes) break;
+
+        Request request;
+        request.connection = connection.id;
+        request.id = header.request_id;
+        request.queries.resize(header.count);
+        std::memcpy(request.queries.data(), input.data() + offset + sizeof(header), body_bytes);
+        offset += sizeof(header) + body_bytes;
+
+        const bool valid = std::all_of(request.queries.begin(), request.queries.end(), [&](const WireQuery& query) {
+            return query.p_idx >= 0 && static_cast<size_t>(query.p_idx) < num_points_ && query.q_idx >= 0 &&
+                   static_cast<size_t>(query.q_idx) < num_points_ && std::isfinite(query.r) && query.r >= 0.0;
+        });
+        if (!valid || header.count == 0) {
+            send_response(connection.id, header.request_id, valid ? ResponseStatus::Ok : ResponseStatus::InvalidQuery,
+                          nullptr, 0);
+            std::lock_guard<std::mutex> lock(metrics_mutex_);
+            ++(valid ? requests_ : rejected_);
+            continue;
+        }
+
+        request.received = std::chrono::steady_clock::now();
+        request.received_ticks = CycleClock::now();
+        const size_t inflight = inflight_pairs_.fetch_add(header.count) + header.count;
+        {
+            std::lock_guard<std::mutex> lock(metrics_mutex_);
+            peak_inflight_pairs_ = std::max(peak_inflight_pairs_, inflight);
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            queued_pairs_ += header.count;
+            queue_.push_back(std::move(request));
+        }
+        queue_cv_.notify_one();
+    }
+    connection.input.erase(connection.input.begin(), connection.input.begin() + static_cast<std::ptrdiff_t>(offset));
+}
+
+bool QueryServer::flush_output(Connection& connection) {
+    std::lock_guard<std::mutex> lock(connection.output_mutex);
+    while (connection.output_sent < connection.output.size()) {
+        const ssize_t n = ::send(connection.fd, connection.output.data() + connection.output_sent,
+                                 connection.output.size() - connection.output_sent, kSendFlags);
+        if (n > 0) {
+            connection.output_sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return false;
+    }
+    // 已发出的部分超过一半时才搬移剩余数据
+    if (connection.output_sent * 2 >= connection.output.size()) {
+        connection.output.erase(connection.output.begin(),
+                                connection.output.begin() + static_cast<std::ptrdiff_t>(connection.output_sent));
+        connection.output_sent = 0;
+    }
+    return true;
+}
+
+size_t QueryServer::pending_output(Connection& connection) {
+    std::lock_guard<std::mutex> lock(connection.output_mutex);
+    return connection.output.size() - connection.output_sent;
+}
+
+void QueryServer::close_connection(uint64_t id) {
+    // 仍在执行的请求照常完成，应答在 send_response 中被丢弃
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    auto it = connections_.find(id);
+    if (it == connections_.end()) return;
+    ::close(it->second->fd);
+    it->second->fd = -1;
+    connections_.erase(it);
+}
+
+void QueryServer::send_response(uint64_t connection, uint64_t request_id, ResponseStatus status,
+                                const uint8_t* results, uint32_t count) {
+    std::shared_ptr<Connection> target;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        auto it = connections_.find(connection);
+        if (it == connections_.end()) return;
+        target = it->second;
+    }
+    ResponseHeader header{};
+    header.request_id = request_id;
+    header.count = status == ResponseStatus::Ok ? count : 0;
+    header.status = static_cast<uint32_t>(status);
+    std::lock_guard<std::mutex> lock(target->output_mutex);
+    append_bytes(target->output, &header, sizeof(header));
+    if (header.count > 0) append_bytes(target->output, results, header.count);
+}
+
+void QueryServer::worker_loop() {
+    std::vector<Request> batch;
+    BatchScratch scratch;
+    while (true) {
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            while (true) {
+                if (queue_.empty()) {
+                    if (draining_) return;
+                    queue_cv_.wait(lock);
+                    continue;
+                }
+                if (draining_ || stopping_ || queued_pairs_ >= options_.max_batch_pairs) break;
+                const SteadyTime deadline =
+                    queue_.front().received + std::chrono::microseconds(options_.max_batch_delay_us);
+                if (std::chrono::steady_clock::now() >= deadline) break;
+                queue_cv_.wait_until(lock, deadline);
+            }
+            // 按到达顺序取整个请求，直到再取就超过 max_batch_pairs
+            size_t taken = 0;
+            while (!queue_.empty() && (taken == 0 || taken + queue_.front().queries.size() <= options_.max_batch_pairs)) {
+                const size_t count = queue_.front().queries.size();
+                taken += count;
+                queued_pairs_ -= count;
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+            // 剩下的请求交给其它工作线程
+            if (!queue_.empty()) queue_cv_.notify_one();
+        }
+        run_batch(batch, scratch);
+    }
+}
+
+void QueryServer::run_batch(std::vector<Request>& batch, BatchScratch& scratch) {
+    scratch.queries.clear();
+    for (const Request& request : batch) {
+        scratch.queries.insert(scratch.queries.end(), request.queries.begin(), request.queries.end());
+    }
+    const size_t total = scratch.queries.size();
+
+    // 相同的 r 排在一起，各调用一次批量查询；同一 r 内按 (p, q) 排序，相同源点的点对连续访问
+    scratch.order.resize(total);
+    for (size_t i = 0; i < total; ++i) scratch.order[i] = static_cast<uint32_t>(i);
+    const std::vector<WireQuery>& queries = scratch.queries;
+    std::sort(scratch.order.begin(), scratch.order.end(), [&](uint32_t a, uint32_t b) {
+        const WireQuery& x = queries[a];
+        const WireQuery& y = queries[b];
+        if (x.r != y.r) return x.r < y.r;
+        if (x.p_idx != y.p_idx) return x.p_idx < y.p_idx;
+        return x.q_idx < y.q_idx;
+    });
+    scratch.pairs.resize(total);
+    for (size_t i = 0; i < total; ++i) {
+        const WireQuery& query = queries[scratch.order[i]];
+        scratch.pairs[i] = {query.p_idx, query.q_idx};
+    }
+    scratch.sorted_results.resize(total);
+    size_t begin = 0;
+    while (begin < total) {
+        const double r = queries[scratch.order[begin]].r;
+        size_t end = begin + 1;
+        while (end < total && queries[scratch.order[end]].r == r) ++end;
+        algorithm_.query_distance_exceeds_batch(scratch.pairs.data() + begin, end - begin, r,
+                                                scratch.sorted_results.data() + begin);
+        begin = end;
+    }
+    scratch.results.resize(total);
+    for (size_t i = 0; i < total; ++i) scratch.results[scratch.order[i]] = scratch.sorted_results[i];
+
+    // 拆回各请求并生成应答
+    const uint64_t done_ticks = CycleClock::now();
+    size_t offset = 0;
+    for (const Request& request : batch) {
+        const auto count = static_cast<uint32_t>(request.queries.size());
+        send_response(request.connection, request.id, ResponseStatus::Ok, scratch.results.data() + offset, count);
+        offset += count;
+    }
+    inflight_pairs_.fetch_sub(total);
+    wake_io();
+
+    std::lock_guard<std::mutex> lock(metrics_mutex_);
+    requests_ += static_cast<long long>(batch.size());
+    pairs_ += static_cast<long long>(total);
+    ++batches_;
+    batched_pairs_ += static_cast<long long>(total);
+    for (const Request& request : batch) {
+        if (latency_ticks_.size() >= kMaxLatencySamples) break;
+        latency_ticks_.push_back(done_ticks - request.received_ticks);
+    }
+}
+
+#endif
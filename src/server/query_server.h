@@ -0,0 +1,154 @@
+#pragma once
+#include "../algorithms/pruning_algorithm.h"
+#include "../bench/benchmark_runner.h"
+#include "query_protocol.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct QueryServerOptions {
+    std::string socket_path = "/tmp/pruning_query.sock";
+    int threads = 0;                      // 执行查询的线程数，0 表示全部硬件线程
+    size_t max_batch_pairs = 16384;       // 合并后的一批最多多少个点对 (单个更大的请求自成一批)
+    int max_batch_delay_us = 200;         // 批未攒满时，最早的请求最多等待多久就开始执行
+    size_t max_inflight_pairs = 1u << 20; // 已接收未应答的点对上限，达到后暂停读取所有连接
+    size_t max_request_pairs = 1u << 16;  // 单个请求的点对上限
+    size_t max_output_bytes = 4u << 20;   // 单个连接未发出的应答字节上限，达到后暂停读取该连接
+};
+
+// 一段时间内 (上一次 take_metrics 以来) 的服务统计
+struct QueryServerMetrics {
+    double elapsed_s = 0.0;
+    long long requests = 0;
+    long long pairs = 0;
+    long long rejected = 0; // 状态不为 Ok 的应答
+    long long batches = 0;
+    double requests_per_second = 0.0;
+    double pairs_per_second = 0.0;
+    double mean_batch_pairs = 0.0;
+    // 请求从完整接收到应答生成 (交给发送队列) 的延迟，含排队、攒批和执行时间
+    LatencySummary latency;
+    size_t peak_inflight_pairs = 0;
+    long long backpressure_pauses = 0; // 因达到 max_inflight_pairs 而暂停读取的次数
+    size_t connections = 0;            // 当前连接数
+};
+
+// 本机批量查询服务：在 Unix 域套接字上接受多个进程的 (p, q, r) 请求 (协议见 query_protocol.h)，
+// 让它们共享同一份已加载的数据集和索引。
+//  - 一个 I/O 线程用非阻塞套接字和 poll 处理全部连接：接收、校验请求后放入队列，并发送生成好的应答
+//  - threads 个工作线程从队列中把多个请求合并成一批 (攒够 max_batch_pairs 个点对，或最早的请求
+//    已等待 max_batch_delay_us)，按 (r, p) 排序后对每个 r 调用一次 query_distance_exceeds_batch，
+//    再把结果拆回各请求；各批在不同线程上并发执行
+//  - 应答异步返回，同一连接上可以有任意多个未完成的请求
+//  - 背压：未应答的点对达到 max_inflight_pairs，或某个连接积压的应答达到 max_output_bytes 时，
+//    暂停读取 (全部或该) 连接，客户端的发送随之在套接字缓冲区满后阻塞
+// algorithm 必须已经 build / load，且在服务运行期间保持有效、不被修改
+class QueryServer {
+public:
+    // 选项无效 (批大小、点对上限为 0 等) 时抛出 std::invalid_argument
+    QueryServer(PruningAlgorithm& algorithm, size_t num_points, size_t dimensions, QueryServerOptions options);
+    ~QueryServer();
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    // 绑定套接字 (同名的旧套接字文件会被替换) 并启动各线程；失败时打印错误并返回 false
+    bool start();
+    // 停止接收新请求，把已接收的请求执行完、应答尽量发出 (最多等待约 2 秒) 后关闭所有连接
+    void stop();
+
+    [[nodiscard]] const QueryServerOptions& options() const { return options_; }
+    // 返回上一次调用以来的统计并重新开始计数
+    QueryServerMetrics take_metrics();
+
+private:
+    using SteadyTime = std::chrono::steady_clock::time_point;
+
+    struct Connection {
+        int fd = -1;
+        uint64_t id = 0;
+        bool closing = false;    // 不再读取，应答发完后关闭 (I/O 线程独占)
+        std::vector<char> input; // 尚未解析的输入 (I/O 线程独占)
+        std::mutex output_mutex;
+        std::vector<char> output; // 待发送的应答
+        size_t output_sent = 0;   // output 中已发出的字节数
+    };
+    struct Request {
+        uint64_t connection = 0;
+        uint64_t id = 0;
+        SteadyTime received;
+        uint64_t received_ticks = 0; // CycleClock 计数，用于延迟统计
+        std::vector<WireQuery> queries;
+    };
+    // 工作线程执行一批请求用的缓冲区 (每线程一份，复用容量)
+    struct BatchScratch {
+        std::vector<WireQuery> queries; // 整批展平后的点对
+        std::vector<uint32_t> order;    // 按 (r, p, q) 排序后的下标
+        std::vector<QueryPair> pairs;
+        std::vector<uint8_t> sorted_results;
+        std::vector<uint8_t> results;
+    };
+
+    void io_loop();
+    void worker_loop();
+    void accept_connections();
+    // 读取连接上的数据，返回 false 表示连接已关闭或出错
+    bool read_input(Connection& connection);
+    // 解析缓冲区中完整的请求并放入队列 (达到背压上限时停下，剩余的留待之后解析)
+    void admit_requests(Connection& connection);
+    // 尽量发送积压的应答，返回 false 表示连接出错
+    bool flush_output(Connection& connection);
+    void close_connection(uint64_t id);
+
+    // 执行一批请求并生成应答
+    void run_batch(std::vector<Request>& batch, BatchScratch& scratch);
+    // 把应答追加到连接的发送队列 (连接已关闭时丢弃)；调用方负责唤醒 I/O 线程
+    void send_response(uint64_t connection, uint64_t request_id, ResponseStatus status, const uint8_t* results,
+                       uint32_t count);
+    [[nodiscard]] size_t pending_output(Connection& connection);
+    void wake_io();
+
+    PruningAlgorithm& algorithm_;
+    size_t num_points_;
+    size_t dimensions_;
+    QueryServerOptions options_;
+    int num_threads_ = 1;
+
+    int listen_fd_ = -1;
+    int wake_fds_[2] = {-1, -1}; // 工作线程生成应答后写入一个字节唤醒 I/O 线程
+    std::atomic<bool> wake_pending_{false};
+    std::atomic<bool> stopping_{false};
+    bool running_ = false;
+    std::thread io_thread_;
+    std::vector<std::thread> workers_;
+
+    std::mutex connections_mutex_;
+    std::unordered_map<uint64_t, std::shared_ptr<Connection>> connections_;
+    uint64_t next_connection_id_ = 1;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::deque<Request> queue_;
+    size_t queued_pairs_ = 0;
+    bool draining_ = false; // 停止时不再等待攒批，队列空即退出
+    std::atomic<size_t> inflight_pairs_{0};
+
+    std::mutex metrics_mutex_;
+    SteadyTime metrics_start_;
+    long long requests_ = 0;
+    long long pairs_ = 0;
+    long long rejected_ = 0;
+    long long batches_ = 0;
+    long long batched_pairs_ = 0;
+    size_t peak_inflight_pairs_ = 0;
+    long long backpressure_pauses_ = 0;
+    std::vector<uint64_t> latency_ticks_; // 每个统计周期最多保留 2^20 个样本
+};
@@ -0,0 +1,150 @@
+// 自动调参：在数据集的随机样本上为每个 (算法, k) 构建候选索引，按给定的半径分布计时批量查询，
+// 在内存预算内选出加权 ns/query 最低的算法和 k (pivot 选取策略和距离表编码体现在算法名称中，
+// 如 multipivot-ff / multipivot-u8)，写成 benchmark 可以直接使用的配置文件。
+//
+// 用法: auto_tune --dataset DIR --radius 0.5:3,1.0:1 [--memory_mb N] [--output FILE] [--key value ...]
+// 之后: benchmark --config FILE 在完整数据集上验证选出的配置
+#include "algorithms/algorithm_factory.h"
+#include "bench/auto_tuner.h"
+#include "core/dataset.h"
+#include "core/distance_kernels.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* usage() {
+    return "  --dataset DIR          dataset directory (required)\n"
+           "  --radius R[:W],...     query radii with optional weights (required), e.g. 0.5:3,1.0:1\n"
+           "  --memory_mb N          index memory budget on the full dataset, 0 = unlimited (default 0)\n"
+           "  --sample_points N      points the candidate indexes are built on (default 20000)\n"
+           "  --queries N            timed pairs per radius (default 20000)\n"
+           "  --algorithms A,B       candidates (default brute,kmeans,multipivot,multipivot-u8,multipivot-ff,cascade)\n"
+           "  --k 16,32,...          candidate pivot / cluster counts (default 16,32,64,128,256)\n"
+           "  --trials N             timed repetitions per radius (default 3)\n"
+           "  --iterations N         k-means iterations (default 20)\n"
+           "  --batch_size N         batch size of the timed queries (default 4096)\n"
+           "  --seed S               RNG seed (default 42)\n"
+           "  --output FILE          benchmark config to write (default tuned.conf)\n";
+}
+
+std::vector<std::string> split_list(const std::string& value) {
+    std::vector<std::string> items;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+bool apply_option(const std::string& key, const std::string& value, TuningOptions& options, std::string& dataset_dir,
+                  std::string& output) {
+    try {
+        if (key == "dataset") {
+            dataset_dir = value;
+        } else if (key == "radius") {
+            return parse_radius_distribution(value, options.radii);
+        } else if (key == "memory_mb") {
+            const double mb = std::stod(value);
+            if (!std::isfinite(mb) || mb < 0.0) return false;
+            options.memory_budget_bytes = static_cast<size_t>(mb * 1024.0 * 1024.0);
+        } else if (key == "sample_points") {
+            options.sample_points = std::stoul(value);
+        } else if (key == "queries") {
+            options.sample_queries = std::stoul(value);
+        } else if (key == "algorithms") {
+            options.algorithms = split_list(value);
+            for (const std::string& name : options.algorithms) {
+                if (make_algorithm(name, 1) == nullptr) return false;
+            }
+        } else if (key == "k") {
+            options.ks.clear();
+            for (const std::string& item : split_list(value)) {
+                const int k = std::stoi(item);
+                if (k <= 0) return false;
+                options.ks.push_back(k);
+            }
+            if (options.ks.empty()) return false;
+        } else if (key == "trials") {
+            options.trials = std::stoi(value);
+        } else if (key == "iterations") {
+            options.iterations = std::stoi(value);
+        } else if (key == "batch_size") {
+            options.batch_size = std::stoi(value);
+        } else if (key == "seed") {
+            options.seed = std::stoull(value);
+        } else if (key == "output") {
+            output = value;
+        } else {
+            return false;
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TuningOptions options;
+    std::string dataset_dir;
+    std::string output = "tuned.conf";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: " << argv[0] << " [options]\n" << usage();
+            return 0;
+        }
+        if (arg.rfind("--", 0) != 0) {
+            std::cerr << "Error: Unexpected argument: " << arg << std::endl;
+            return 1;
+        }
+        arg = arg.substr(2);
+        std::string value;
+        const size_t eq = arg.find('=');
+        if (eq != std::string::npos) {
+            value = arg.substr(eq + 1);
+            arg = arg.substr(0, eq);
+        } else if (i + 1 < argc) {
+            value = argv[++i];
+        } else {
+            std::cerr << "Error: Missing value for --" << arg << std::endl;
+            return 1;
+        }
+        if (!apply_option(arg, value, options, dataset_dir, output)) {
+            std::cerr << "Error: Invalid option --" << arg << " " << value << std::endl;
+            return 1;
+        }
+    }
+    if (dataset_dir.empty() || options.radii.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [options]\n" << usage();
+        return 1;
+    }
+    if (options.trials <= 0 || options.batch_size <= 0 || options.sample_queries == 0) {
+        std::cerr << "Error: queries, trials and batch_size must be positive" << std::endl;
+        return 1;
+    }
+
+    Dataset dataset;
+    if (!dataset.load_from_directory(dataset_dir)) return 1;
+    specialize_distance_kernels(dataset.dimensions());
+    if (dataset.size() < 2) {
+        std::cerr << "Error: Cannot sample pairs from a dataset with less than 2 points." << std::endl;
+        return 1;
+    }
+
+    const TuningResult result = auto_tune(dataset, options, std::cout);
+    if (!write_tuned_config(output, dataset_dir, options, result)) return 1;
+    const TuningCandidate& best = result.candidates[static_cast<size_t>(result.best)];
+    std::cout << "Chosen: " << best.algorithm;
+    if (best.k > 0) std::cout << " k=" << best.k;
+    std::cout << " (" << best.ns_per_query << " ns/query, " << best.pruning_rate * 100.0 << "% pruned)" << std::endl;
+    std::cout << "Config written to " << output << " (run: benchmark --config " << output << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,71 @@
+// 对比 nodes.txt 的两种解析路径的吞吐量 (MB/s)：
+//   - stream:   原有的 std::getline + stringstream 逐行解析 (Dataset::load_text_stream)
+//   - parallel: 内存映射 + 分块并行 std::from_chars 解析 (Dataset::load_text)
+//
+// 用法: bench_text_parser <dataset_dir> [threads] [repeats]
+#include "core/dataset.h"
+#include "core/work_stealing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+template <typename Load>
+double best_time_ms(int repeats, Load&& load) {
+    double best = 0.0;
+    for (int i = 0; i < repeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        if (!load()) return -1.0;
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = (i == 0) ? elapsed.count() : std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <dataset_dir> [threads] [repeats]" << std::endl;
+        return 1;
+    }
+    const std::string path = std::string(argv[1]) + "/nodes.txt";
+    const int threads = argc > 2 ? std::stoi(argv[2]) : hardware_thread_count();
+    const int repeats = argc > 3 ? std::max(1, std::stoi(argv[3])) : 3;
+
+    std::ifstream probe(path, std::ios::binary | std::ios::ate);
+    if (!probe.is_open()) {
+        std::cerr << "Error: Could not open nodes file: " << path << std::endl;
+        return 1;
+    }
+    const double megabytes = static_cast<double>(probe.tellg()) / (1024.0 * 1024.0);
+
+    Dataset stream_dataset;
+    Dataset parallel_dataset;
+    double stream_ms = best_time_ms(repeats, [&] { return stream_dataset.load_text_stream(path); });
+    double parallel_ms = best_time_ms(repeats, [&] { return parallel_dataset.load_text(path, threads); });
+    if (stream_ms < 0.0 || parallel_ms < 0.0) {
+        return 1;
+    }
+
+    // 两种解析器都应得到逐位相同的结果
+    bool identical = stream_dataset.size() == parallel_dataset.size() &&
+                     stream_dataset.dimensions() == parallel_dataset.dimensions() &&
+                     std::memcmp(stream_dataset.data(), parallel_dataset.data(),
+                                 stream_dataset.size() * stream_dataset.stride() * sizeof(double)) == 0;
+
+    std::cout << "File: " << path << " (" << std::fixed << std::setprecision(1) << megabytes << " MB, "
+              << parallel_dataset.size() << " points x " << parallel_dataset.dimensions() << " dimensions)" << std::endl;
+    std::cout << "stream parser:   " << std::setw(10) << stream_ms << " ms  " << std::setw(8)
+              << megabytes / (stream_ms / 1000.0) << " MB/s" << std::endl;
+    std::cout << "parallel parser: " << std::setw(10) << parallel_ms << " ms  " << std::setw(8)
+              << megabytes / (parallel_ms / 1000.0) << " MB/s  (" << threads << " threads, "
+              << stream_ms / parallel_ms << "x)" << std::endl;
+    std::cout << "Results identical: " << (identical ? "yes" : "NO") << std::endl;
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+// 可配置的基准测试：在 数据集 x 算法 x k x r 的参数网格上运行预热 + 多轮计时，
+// 报告剪枝率、逐条查询延迟的 p50/p99/p999、批量与多线程吞吐量，并可输出 JSON / CSV。
+// 点对由固定种子生成，相同配置的两次运行使用完全相同的工作负载。
+//
+// 用法: benchmark [--config FILE] [--key value ...]   (参数见 --help)
+// 例如: benchmark --datasets PubMed,SinaNet --algorithms brute,kmeans,multipivot
+//                 --k 100,500 --radius 0.5,1.0 --trials 5 --json results.json --csv results.csv
+#include "bench/benchmark_config.h"
+#include "bench/benchmark_runner.h"
+#include "bench/result_writer.h"
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+            std::cout << "Usage: " << argv[0] << " [options]\n" << benchmark_usage();
+            return 0;
+        }
+    }
+    BenchmarkConfig config;
+    if (!parse_benchmark_args(argc, argv, config)) {
+        std::cerr << "Usage: " << argv[0] << " [options]\n" << benchmark_usage();
+        return 1;
+    }
+
+    std::vector<BenchmarkResult> results;
+    if (!run_benchmark(config, results, std::cout)) return 1;
+
+    bool ok = true;
+    if (!config.json_path.empty()) {
+        ok = write_results_json(config.json_path, config, results) && ok;
+        if (ok) std::cout << "Results written to " << config.json_path << std::endl;
+    }
+    if (!config.csv_path.empty()) {
+        ok = write_results_csv(config.csv_path, results) && ok;
+        if (ok) std::cout << "Results written to " << config.csv_path << std::endl;
+    }
+    size_t mismatches = 0;
+    for (const BenchmarkResult& r : results) mismatches += r.mismatches;
+    if (mismatches > 0) {
+        std::cerr << "Error: " << mismatches << " batched/parallel results differ from single queries" << std::endl;
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+// 把数据集目录下的 nodes.txt 转换为可内存映射的二进制格式 nodes.bin
+//
+// 用法: convert_nodes <dataset_dir> [output_path]
+//   output_path 默认为 <dataset_dir>/nodes.bin
+#include "core/dataset.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " <dataset_dir> [output_path]" << std::endl;
+        return 1;
+    }
+    const std::string dir_path = argv[1];
+    const std::string output_path = argc == 3 ? argv[2] : dir_path + "/nodes.bin";
+
+    auto start = std::chrono::steady_clock::now();
+    // 在解析之前取得源文件的大小与修改时间：解析期间文本被改写时，记录的是旧的时间，下次加载会发现
+    const std::string nodes_path = dir_path + "/nodes.txt";
+    SourceStamp source;
+    if (!stat_source_file(nodes_path, source)) {
+        std::cerr << "Error: Could not open nodes file: " << nodes_path << std::endl;
+        return 1;
+    }
+    Dataset dataset;
+    if (!dataset.load_text(nodes_path)) {
+        return 1;
+    }
+    auto parsed = std::chrono::steady_clock::now();
+    if (!dataset.save_binary(output_path, source)) {
+        return 1;
+    }
+    auto written = std::chrono::steady_clock::now();
+
+    // 重新映射一次，确认写出的文件可以被正确加载
+    Dataset check;
+    if (!check.load_binary(output_path) || check.size() != dataset.size() || check.dimensions() != dataset.dimensions()) {
+        std::cerr << "Error: Verification of " << output_path << " failed." << std::endl;
+        return 1;
+    }
+
+    std::chrono::duration<double, std::milli> parse_time = parsed - start;
+    std::chrono::duration<double, std::milli> write_time = written - parsed;
+    std::cout << "Converted " << dataset.size() << " points x " << dataset.dimensions() << " dimensions to "
+              << output_path << " (parse " << parse_time.count() << " ms, write " << write_time.count() << " ms)"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,97 @@
+// 对比维度预处理 (none / variance / pca) 对分块提前退出的影响：
+// 每次完整距离判断平均累加了多少个维度、判断耗时，以及累计方差集中在多少个前缀维度中。
+//
+// 用法: dimension_order_report <dataset_dir> <radius> [pairs]
+#include "core/dataset.h"
+#include "core/dimension_transform.h"
+#include "core/distance.h"
+#include "core/distance_kernels.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <dataset_dir> <radius> [pairs]" << std::endl;
+        return 1;
+    }
+    const std::string dataset_dir = argv[1];
+    const double radius = std::stod(argv[2]);
+    const size_t num_pairs = argc > 3 ? std::stoul(argv[3]) : 200000;
+
+    Dataset original;
+    if (!original.load_from_directory(dataset_dir)) {
+        return 1;
+    }
+    specialize_distance_kernels(original.dimensions());
+    if (original.size() < 2) {
+        std::cerr << "Error: Dataset needs at least two points." << std::endl;
+        return 1;
+    }
+
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<int> distrib(0, static_cast<int>(original.size()) - 1);
+    std::vector<std::pair<int, int>> pairs;
+    pairs.reserve(num_pairs);
+    while (pairs.size() < num_pairs) {
+        int p = distrib(gen);
+        int q = distrib(gen);
+        if (p != q) pairs.emplace_back(p, q);
+    }
+    std::vector<uint8_t> reference(pairs.size());
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        reference[i] = is_distance_exceeding_early_exit(original.get_point(pairs[i].first),
+                                                        original.get_point(pairs[i].second), radius) ? 1 : 0;
+    }
+
+    std::cout << "Dataset: " << dataset_dir << " (" << original.size() << " points x " << original.dimensions()
+              << " dimensions), r = " << radius << ", " << num_pairs << " pairs, early-exit block "
+              << g_distance_kernels.exit_block << std::endl;
+    std::cout << std::left << std::setw(10) << "transform" << std::right << std::setw(12) << "fit_ms"
+              << std::setw(14) << "avg_dims" << std::setw(16) << "avg_dims(>r)" << std::setw(12) << "check_ms"
+              << std::setw(9) << "50%var" << std::setw(9) << "90%var" << std::setw(9) << "99%var" << std::setw(12)
+              << "mismatches" << std::endl;
+
+    for (DimensionTransformKind kind : {DimensionTransformKind::None, DimensionTransformKind::VarianceOrder,
+                                        DimensionTransformKind::PCA}) {
+        Dataset dataset = original;
+        auto start = std::chrono::steady_clock::now();
+        const DimensionTransform transform = DimensionTransform::fit(dataset, kind);
+        transform.apply(dataset);
+        std::chrono::duration<double, std::milli> fit_ms = std::chrono::steady_clock::now() - start;
+
+        unsigned long long touched = 0;
+        unsigned long long touched_exceeding = 0;
+        size_t exceeding = 0;
+        for (const auto& [p, q] : pairs) {
+            const size_t dims = early_exit_dimensions_touched(dataset.get_point(p), dataset.get_point(q), radius);
+            touched += dims;
+            if (euclidean_distance(dataset.get_point(p), dataset.get_point(q)) > radius) {
+                touched_exceeding += dims;
+                exceeding++;
+            }
+        }
+
+        std::vector<uint8_t> results(pairs.size());
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            results[i] = is_distance_exceeding_early_exit(dataset.get_point(pairs[i].first),
+                                                          dataset.get_point(pairs[i].second), radius) ? 1 : 0;
+        }
+        std::chrono::duration<double, std::milli> check_ms = std::chrono::steady_clock::now() - start;
+        size_t mismatches = 0;
+        for (size_t i = 0; i < pairs.size(); ++i) mismatches += results[i] != reference[i];
+
+        std::cout << std::left << std::setw(10) << dimension_transform_name(kind) << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(12) << fit_ms.count() << std::setw(14)
+                  << static_cast<double>(touched) / pairs.size() << std::setw(16)
+                  << (exceeding > 0 ? static_cast<double>(touched_exceeding) / exceeding : 0.0) << std::setw(12)
+                  << check_ms.count() << std::setw(9) << transform.dimensions_for_variance(0.5) << std::setw(9)
+                  << transform.dimensions_for_variance(0.9) << std::setw(9) << transform.dimensions_for_variance(0.99)
+                  << std::setw(12) << mismatches << std::endl;
+    }
+    return 0;
+}
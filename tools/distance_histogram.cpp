@@ -0,0 +1,139 @@
+// 随机点对距离分布的直方图 (dis_cal.py 中抽样部分的原生版本)。
+// 每个点对调用一次多半径查询 query_radius_bucket：各个分箱的右边界构成半径序列，
+// pivot 上下界落在同一个分箱内的点对不做距离计算，超过最大半径的点对提前退出。
+// 结果写成 CSV (bin_lower,bin_upper,count,density)，可用 dis_cal.py --histogram-csv 绘图。
+//
+// 用法: distance_histogram <dataset_dir> [samples] [bins] [max_distance|auto] [algorithm] [k] [output_csv]
+//   max_distance 为 auto 时取 1000 个随机点对中的最大距离；更大的距离计入最后一个溢出分箱
+#include "algorithms/algorithm_factory.h"
+#include "bench/benchmark_runner.h"
+#include "core/dataset.h"
+#include "core/distance.h"
+#include "core/distance_kernels.h"
+#include "core/work_stealing.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <dataset_dir> [samples] [bins] [max_distance|auto] [algorithm] [k] [output_csv]" << std::endl;
+        return 1;
+    }
+    const std::string dataset_dir = argv[1];
+    const int samples = argc > 2 ? std::stoi(argv[2]) : 100000;
+    const int bins = argc > 3 ? std::max(1, std::stoi(argv[3])) : 50;
+    const std::string max_arg = argc > 4 ? argv[4] : "auto";
+    const std::string algorithm_name = argc > 5 ? argv[5] : "kmeans";
+    const int k = argc > 6 ? std::stoi(argv[6]) : 100;
+    const std::string output = argc > 7 ? argv[7] : "distance_histogram.csv";
+    const uint64_t seed = 42;
+    if (samples <= 0) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <dataset_dir> [samples] [bins] [max_distance|auto] [algorithm] [k] [output_csv]" << std::endl;
+        std::cerr << "Error: samples must be positive" << std::endl;
+        return 1;
+    }
+
+    Dataset dataset;
+    if (!dataset.load_from_directory(dataset_dir)) return 1;
+    specialize_distance_kernels(dataset.dimensions());
+    if (dataset.size() < 2) {
+        std::cerr << "Error: Cannot sample pairs from a dataset with less than 2 points." << std::endl;
+        return 1;
+    }
+
+    double max_distance = 0.0;
+    if (max_arg == "auto") {
+        for (const QueryPair& pair : generate_query_pairs(dataset.size(), 1000, seed + 1)) {
+            max_distance = std::max(max_distance, euclidean_distance(dataset.get_point(pair.p_idx), dataset.get_point(pair.q_idx)));
+        }
+    } else {
+        max_distance = std::stod(max_arg);
+    }
+    if (!(max_distance > 0.0)) {
+        std::cerr << "Error: max_distance must be positive" << std::endl;
+        return 1;
+    }
+
+    auto algorithm = make_algorithm(algorithm_name, k, 20, seed);
+    if (algorithm == nullptr) {
+        std::cerr << "Error: Unknown algorithm: " << algorithm_name << std::endl;
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    algorithm->build(dataset);
+    const double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // 分箱 b 为 (radii[b-1], radii[b]]，分箱 bins 为溢出 (> max_distance)
+    std::vector<double> radii(static_cast<size_t>(bins));
+    for (int b = 0; b < bins; ++b) radii[b] = max_distance * (b + 1) / bins;
+    const std::vector<QueryPair> pairs = generate_query_pairs(dataset.size(), static_cast<size_t>(samples), seed);
+
+    const int threads = hardware_thread_count();
+    std::vector<std::vector<long long>> partial(static_cast<size_t>(threads), std::vector<long long>(radii.size() + 1, 0));
+    algorithm->reset_stats();
+    start = std::chrono::steady_clock::now();
+    parallel_for_work_stealing(pairs.size(), threads, 1024, [&](size_t begin, size_t end, int thread_id) {
+        std::vector<long long>& counts = partial[thread_id];
+        for (size_t i = begin; i < end; ++i) {
+            counts[algorithm->query_radius_bucket(pairs[i].p_idx, pairs[i].q_idx, radii)]++;
+        }
+    });
+    const double query_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::vector<long long> counts(radii.size() + 1, 0);
+    for (const auto& part : partial) {
+        for (size_t b = 0; b < counts.size(); ++b) counts[b] += part[b];
+    }
+
+    std::ofstream out(output);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open file for writing: " << output << std::endl;
+        return 1;
+    }
+    out << "bin_lower,bin_upper,count,density\n" << std::setprecision(10);
+    const double width = max_distance / bins;
+    for (size_t b = 0; b < counts.size(); ++b) {
+        const double lower = b == 0 ? 0.0 : radii[b - 1];
+        const double density = b < radii.size() ? static_cast<double>(counts[b]) / (static_cast<double>(pairs.size()) * width) : 0.0;
+        out << lower << ',';
+        if (b < radii.size()) {
+            out << radii[b];
+        } else {
+            out << "inf";
+        }
+        out << ',' << counts[b] << ',' << density << '\n';
+    }
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Failed writing histogram: " << output << std::endl;
+        return 1;
+    }
+
+    const long long peak = *std::max_element(counts.begin(), counts.end());
+    std::cout << std::fixed << std::setprecision(4);
+    for (size_t b = 0; b < counts.size(); ++b) {
+        const int bar = peak > 0 ? static_cast<int>(60.0 * static_cast<double>(counts[b]) / static_cast<double>(peak)) : 0;
+        if (b < radii.size()) {
+            std::cout << std::setw(10) << (b == 0 ? 0.0 : radii[b - 1]) << " - " << std::setw(10) << radii[b];
+        } else {
+            std::cout << std::setw(10) << max_distance << " +           ";
+        }
+        std::cout << " | " << std::setw(9) << counts[b] << " " << std::string(static_cast<size_t>(bar), '#') << std::endl;
+    }
+    const long long full_calcs = algorithm->get_full_calculations_count();
+    std::cout << std::setprecision(2) << "\nSamples: " << pairs.size() << " | bins: " << bins << " | max distance: "
+              << max_distance << "\n"
+              << algorithm_name << " build: " << build_ms << " ms | histogram: " << query_ms << " ms (" << threads
+              << " threads, " << static_cast<double>(pairs.size()) / std::max(query_ms, 1e-9) * 1e3 << " pairs/s)\n"
+              << "Distance computations: " << full_calcs << " ("
+              << 100.0 * static_cast<double>(full_calcs) / static_cast<double>(pairs.size()) << "% of pairs)" << std::endl;
+    std::cout << "Histogram written to " << output << std::endl;
+    return 0;
+}
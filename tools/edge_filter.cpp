@@ -0,0 +1,85 @@
+// 图数据集的边过滤：对数据集目录下 edges.txt 的每条边 (u, v) 判断 d(u, v) > r，
+// 结果按文件中的边序写成位图 (第 i 条边的距离 > r 时第 i 位为 1，见 edge_workload.h)。
+// 边按源点分组后经由批量、多线程的查询路径执行；同时计时文件原序的一遍作为对比，并核对两遍的结果。
+//
+// 用法: edge_filter <dataset_dir> <r> [algorithm] [k] [threads] [output_bitmap]
+//   threads 为 0 表示全部硬件线程；output_bitmap 为 - 时不写文件
+#include "algorithms/algorithm_factory.h"
+#include "bench/edge_workload.h"
+#include "core/dataset.h"
+#include "core/distance_kernels.h"
+#include "core/work_stealing.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <dataset_dir> <r> [algorithm] [k] [threads] [output_bitmap]" << std::endl;
+        return 1;
+    }
+    const std::string dataset_dir = argv[1];
+    const double r = std::stod(argv[2]);
+    const std::string algorithm_name = argc > 3 ? argv[3] : "multipivot";
+    const int k = argc > 4 ? std::stoi(argv[4]) : 100;
+    const int threads_arg = argc > 5 ? std::stoi(argv[5]) : 0;
+    const int threads = threads_arg > 0 ? threads_arg : hardware_thread_count();
+    const std::string output = argc > 6 ? argv[6] : "edge_results.bin";
+
+    Dataset dataset;
+    if (!dataset.load_from_directory(dataset_dir)) return 1;
+    specialize_distance_kernels(dataset.dimensions());
+    std::vector<QueryPair> edges;
+    if (!load_edge_list(dataset_dir + "/edges.txt", dataset.size(), edges)) return 1;
+    const EdgeWorkload grouped = group_edges_by_source(edges, dataset.size());
+    std::cout << "Edges: " << edges.size() << " from " << grouped.num_sources << " source nodes" << std::endl;
+
+    auto algorithm = make_algorithm(algorithm_name, k, 20, 42);
+    if (algorithm == nullptr) {
+        std::cerr << "Error: Unknown algorithm: " << algorithm_name << std::endl;
+        return 1;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    algorithm->build(dataset);
+    const double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // 文件原序：同样的边，不分组
+    EdgeWorkload file_order;
+    file_order.pairs = edges;
+    file_order.order.resize(edges.size());
+    std::iota(file_order.order.begin(), file_order.order.end(), 0u);
+
+    // 两种顺序各预热一遍，再各计时一遍
+    std::vector<uint8_t> bits;
+    std::vector<uint8_t> file_order_bits;
+    run_edge_workload(*algorithm, grouped, r, threads, bits);
+    run_edge_workload(*algorithm, file_order, r, threads, file_order_bits);
+    algorithm->reset_stats();
+    const EdgeRunStats stats = run_edge_workload(*algorithm, grouped, r, threads, bits);
+    const long long full_calculations = algorithm->get_full_calculations_count();
+    const EdgeRunStats file_order_stats = run_edge_workload(*algorithm, file_order, r, threads, file_order_bits);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Algorithm: " << algorithm_name << " (k=" << k << "), build " << build_ms << " ms, " << threads
+              << " threads, r = " << r << std::endl;
+    std::cout << "Edges with d > r: " << stats.exceeding << " ("
+              << (stats.edges > 0 ? 100.0 * static_cast<double>(stats.exceeding) / static_cast<double>(stats.edges) : 0.0)
+              << "%), full calculations: " << full_calculations << std::endl;
+    std::cout << "Grouped by source: " << std::setw(10) << stats.elapsed_ms << " ms | " << std::setw(14)
+              << stats.edges_per_second << " edges/s" << std::endl;
+    std::cout << "File order:        " << std::setw(10) << file_order_stats.elapsed_ms << " ms | " << std::setw(14)
+              << file_order_stats.edges_per_second << " edges/s" << std::endl;
+    if (bits != file_order_bits) {
+        std::cerr << "Error: Grouped and file-order results differ" << std::endl;
+        return 1;
+    }
+
+    if (output != "-") {
+        if (!write_edge_bitmap(output, bits)) return 1;
+        std::cout << "Bitmap written to " << output << " (" << bits.size() << " bytes)" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+// 增量维护 (IndexMaintainer) 的演示与校验：先用数据集的前一部分构建索引，再把其余的点逐个插入，
+// 同时随机删除已有的点；漂移超过阈值时在后台重建。插入期间另一个线程持续做批量查询，
+// 所有查询结果都与精确距离核对。点按原下标的顺序插入，因此点的编号就是它在数据集中的下标。
+//
+// 用法: incremental_update <dataset_dir> [algorithm] [k] [initial_fraction] [erase_fraction] [drift_threshold] [radius]
+#include "algorithms/algorithm_factory.h"
+#include "algorithms/index_maintainer.h"
+#include "bench/benchmark_runner.h"
+#include "core/dataset.h"
+#include "core/distance.h"
+#include "core/distance_kernels.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <dataset_dir> [algorithm] [k] [initial_fraction] [erase_fraction] [drift_threshold] [radius]"
+                  << std::endl;
+        return 1;
+    }
+    const std::string dataset_dir = argv[1];
+    const std::string algorithm_name = argc > 2 ? argv[2] : "kmeans";
+    const int k = argc > 3 ? std::stoi(argv[3]) : 100;
+    const double initial_fraction = argc > 4 ? std::stod(argv[4]) : 0.5;
+    const double erase_fraction = argc > 5 ? std::stod(argv[5]) : 0.1;
+    IndexMaintainerOptions options;
+    options.drift_threshold = argc > 6 ? std::stod(argv[6]) : 0.25;
+    const uint64_t seed = 42;
+
+    Dataset dataset;
+    if (!dataset.load_from_directory(dataset_dir)) return 1;
+    specialize_distance_kernels(dataset.dimensions());
+    const size_t initial_size = std::max<size_t>(k, static_cast<size_t>(static_cast<double>(dataset.size()) * initial_fraction));
+    if (initial_size >= dataset.size() || make_algorithm(algorithm_name, k) == nullptr) {
+        std::cerr << "Error: Need a known algorithm and an initial fraction that leaves points to insert." << std::endl;
+        return 1;
+    }
+    double radius = 0.0;
+    if (argc > 7) {
+        radius = std::stod(argv[7]);
+    } else {
+        // 默认取随机点对距离的中位数，使一半左右的查询超过半径
+        std::vector<double> sample;
+        for (const QueryPair& pair : generate_query_pairs(dataset.size(), 1001, seed)) {
+            sample.push_back(euclidean_distance(dataset.get_point(pair.p_idx), dataset.get_point(pair.q_idx)));
+        }
+        std::nth_element(sample.begin(), sample.begin() + 500, sample.end());
+        radius = sample[500];
+    }
+
+    Dataset initial;
+    initial.reset(dataset.dimensions());
+    initial.reserve(initial_size);
+    for (size_t i = 0; i < initial_size; ++i) initial.add_point(dataset.get_point(static_cast<int>(i)));
+
+    auto start = std::chrono::steady_clock::now();
+    IndexMaintainer maintainer([&] { return make_algorithm(algorithm_name, k, 20, seed); }, std::move(initial), options);
+    const double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // 查询线程：只查询已插入且未删除的点 (live 中的编号)，结果与精确距离核对
+    std::vector<std::atomic<uint8_t>> live(dataset.size());
+    for (size_t i = 0; i < initial_size; ++i) live[i].store(1, std::memory_order_relaxed);
+    std::atomic<size_t> inserted_up_to{initial_size};
+    std::atomic<bool> done{false};
+    std::atomic<long long> queries{0};
+    std::atomic<long long> mismatches{0};
+    std::thread reader([&] {
+        std::mt19937_64 gen(seed + 1);
+        std::vector<QueryPair> pairs;
+        std::vector<uint8_t> results;
+        while (!done.load(std::memory_order_relaxed)) {
+            const size_t upper = inserted_up_to.load(std::memory_order_acquire);
+            std::uniform_int_distribution<int> distrib(0, static_cast<int>(upper) - 1);
+            pairs.clear();
+            // 拒绝采样的尝试次数有上限：写线程删掉了大部分点时少取一些点对，而不是在这里空转
+            for (size_t attempt = 0; attempt < 64 * 1024 && pairs.size() < 1024; ++attempt) {
+                const int p = distrib(gen);
+                const int q = distrib(gen);
+                if (p != q && live[p].load(std::memory_order_relaxed) && live[q].load(std::memory_order_relaxed)) {
+                    pairs.push_back({p, q});
+                }
+            }
+            if (pairs.empty()) {
+                std::this_thread::yield();
+                continue;
+            }
+            results.resize(pairs.size());
+            try {
+                maintainer.query_distance_exceeds_batch(pairs.data(), pairs.size(), radius, results.data());
+            } catch (const std::invalid_argument&) {
+                continue; // 选出点对之后该点被删除
+            }
+            for (size_t i = 0; i < pairs.size(); ++i) {
+                const bool exact = euclidean_distance(dataset.get_point(pairs[i].p_idx), dataset.get_point(pairs[i].q_idx)) > radius;
+                if ((results[i] != 0) != exact) mismatches.fetch_add(1, std::memory_order_relaxed);
+            }
+            queries.fetch_add(static_cast<long long>(pairs.size()), std::memory_order_relaxed);
+        }
+    });
+
+    std::mt19937_64 gen(seed + 2);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    size_t erased = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = initial_size; i < dataset.size(); ++i) {
+        const int id = maintainer.insert(dataset.get_point(static_cast<int>(i)));
+        if (static_cast<size_t>(id) != i) {
+            std::cerr << "Error: Unexpected point id " << id << " for point " << i << std::endl;
+            return 1;
+        }
+        live[i].store(1, std::memory_order_relaxed);
+        inserted_up_to.store(i + 1, std::memory_order_release);
+        if (coin(gen) < erase_fraction) {
+            const int victim = std::uniform_int_distribution<int>(0, static_cast<int>(i))(gen);
+            if (live[victim].exchange(0)) {
+                maintainer.erase(victim);
+                ++erased;
+            }
+        }
+    }
+    const double update_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    done.store(true);
+    reader.join();
+    maintainer.wait_for_rebuild();
+
+    // 范围查询：与对全部存活点的暴力扫描对比
+    long long range_mismatches = 0;
+    std::vector<int> results;
+    for (const QueryPair& pair : generate_query_pairs(dataset.size(), 50, seed + 3)) {
+        const int center = pair.p_idx;
+        if (!live[center].load()) continue;
+        maintainer.range_query(center, radius * 0.5, results);
+        std::sort(results.begin(), results.end());
+        std::vector<int> expected;
+        for (int x = 0; x < static_cast<int>(dataset.size()); ++x) {
+            if (x != center && live[x].load() &&
+                euclidean_distance(dataset.get_point(center), dataset.get_point(x)) <= radius * 0.5) {
+                expected.push_back(x);
+            }
+        }
+        range_mismatches += results != expected ? 1 : 0;
+    }
+
+    const size_t inserted = dataset.size() - initial_size;
+    std::cout << std::fixed << std::setprecision(2) << "\nAlgorithm: " << algorithm_name << " k=" << k
+              << " | radius: " << radius << " | drift threshold: " << options.drift_threshold << "\n"
+              << "Initial build: " << initial_size << " points in " << build_ms << " ms\n"
+              << "Updates: " << inserted << " inserts, " << erased << " erases in " << update_ms << " ms ("
+              << static_cast<double>(inserted + erased) / std::max(update_ms, 1e-9) * 1e3 << " updates/s)\n"
+              << "Background rebuilds: " << maintainer.rebuild_count() << " | live points: " << maintainer.size()
+              << " | drift now: " << maintainer.drift() << "\n"
+              << "Concurrent queries: " << queries.load() << " | mismatches: " << mismatches.load()
+              << " | range query mismatches: " << range_mismatches << std::endl;
+    // 更新停止并等待重建完成后，索引不应停留在漂移阈值之上
+    const bool drift_ok = maintainer.drift() <= options.drift_threshold;
+    if (!drift_ok) {
+        std::cerr << "Error: Drift " << maintainer.drift() << " is still above the threshold "
+                  << options.drift_threshold << " after the rebuilds finished" << std::endl;
+    }
+    return mismatches.load() == 0 && range_mismatches == 0 && drift_ok ? 0 : 1;
+}
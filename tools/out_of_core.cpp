@@ -0,0 +1,129 @@
+// 磁盘分块执行：数据集 (nodes.bin) 与距离表都留在磁盘上，只有 pivot 和两个有界的 LRU 块缓存常驻内存。
+// 首次运行时在 <dataset_dir>/out_of_core_k<k>_b<block_points>.tbl 构建分块距离表，之后直接打开。
+// 对随机点对 (以及 edges.txt 存在时按源点分组的全部边) 分别运行逐个查询和批量查询，
+// 报告吞吐量、剪枝率、每个查询读取的字节数和两个缓存的命中率。
+//
+// 用法: out_of_core <dataset_dir> <r> [k] [queries] [table_cache_mb] [coord_cache_mb] [block_points] [verify]
+//   nodes.bin 由 convert_nodes 生成；verify 为 1 时把数据集载入内存，用暴力计算核对全部结果
+#include "algorithms/out_of_core_index.h"
+#include "bench/benchmark_runner.h"
+#include "bench/edge_workload.h"
+#include "core/distance.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+void print_run(const std::string& label, const OutOfCoreStats& stats, double elapsed_ms) {
+    std::cout << std::fixed << std::setprecision(2) << std::left << std::setw(16) << label << std::right
+              << " | " << std::setw(12) << (elapsed_ms > 0.0 ? stats.queries / (elapsed_ms / 1000.0) : 0.0) << " q/s"
+              << " | prune " << std::setw(6)
+              << (stats.queries > 0 ? 100.0 * static_cast<double>(stats.queries - stats.full_calculations) / stats.queries : 0.0)
+              << "% | " << std::setw(10) << stats.bytes_per_query() << " bytes/query"
+              << " | table hit " << std::setw(6) << 100.0 * stats.table_hit_rate() << "%"
+              << " | coord hit " << std::setw(6) << 100.0 * stats.coord_hit_rate() << "%"
+              << " | read " << static_cast<double>(stats.table_bytes_read + stats.coord_bytes_read) / (1024.0 * 1024.0)
+              << " MB" << std::endl;
+}
+
+// 逐个查询与批量查询各运行一遍，results 返回批量查询的结果；两者不一致时返回 false
+bool run_workload(OutOfCoreIndex& index, const std::string& label, const std::vector<QueryPair>& pairs, double r,
+                  std::vector<uint8_t>& results) {
+    std::vector<uint8_t> single(pairs.size());
+    index.reset_stats();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        single[i] = index.query_distance_exceeds(pairs[i].p_idx, pairs[i].q_idx, r) ? 1 : 0;
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    print_run(label + " single", index.stats(), elapsed_ms);
+
+    const size_t batch_size = 4096;
+    std::vector<uint8_t> batch(pairs.size());
+    index.reset_stats();
+    start = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset < pairs.size(); offset += batch_size) {
+        const size_t count = std::min(batch_size, pairs.size() - offset);
+        index.query_distance_exceeds_batch(pairs.data() + offset, count, r, batch.data() + offset);
+    }
+    elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    print_run(label + " batch", index.stats(), elapsed_ms);
+    results = std::move(batch);
+    if (single != results) {
+        std::cerr << "Error: Batched results differ from single queries (" << label << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <dataset_dir> <r> [k] [queries] [table_cache_mb] [coord_cache_mb] [block_points] [verify]"
+                  << std::endl;
+        return 1;
+    }
+    const std::string dataset_dir = argv[1];
+    const double r = std::stod(argv[2]);
+    OutOfCoreOptions options;
+    options.k = argc > 3 ? std::stoi(argv[3]) : 64;
+    const size_t num_queries = argc > 4 ? std::stoul(argv[4]) : 100000;
+    const double table_cache_mb = argc > 5 ? std::stod(argv[5]) : 256.0;
+    const double coord_cache_mb = argc > 6 ? std::stod(argv[6]) : 64.0;
+    options.block_points = argc > 7 ? std::stoul(argv[7]) : 4096;
+    const bool verify = argc > 8 && std::stoi(argv[8]) != 0;
+
+    const std::string nodes_path = dataset_dir + "/nodes.bin";
+    const std::string table_path = dataset_dir + "/out_of_core_k" + std::to_string(options.k) + "_b" +
+                                   std::to_string(options.block_points) + ".tbl";
+    const auto to_bytes = [](double mb) { return static_cast<size_t>(mb * 1024.0 * 1024.0); };
+    OutOfCoreIndex index;
+    if (!std::ifstream(table_path).good() ||
+        !index.open(nodes_path, table_path, to_bytes(table_cache_mb), to_bytes(coord_cache_mb))) {
+        const auto start = std::chrono::steady_clock::now();
+        if (!OutOfCoreIndex::build(nodes_path, table_path, options)) return 1;
+        std::cout << "Build time: "
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms"
+                  << std::endl;
+        if (!index.open(nodes_path, table_path, to_bytes(table_cache_mb), to_bytes(coord_cache_mb))) return 1;
+    }
+    specialize_distance_kernels(index.dimensions());
+    std::cout << "Out-of-core index: " << index.size() << " points x " << index.dimensions() << " dims, k=" << index.k()
+              << " (" << pivot_table_encoding_name(index.encoding()) << "), blocks of " << index.block_points()
+              << " points, caches: table " << table_cache_mb << " MB, coordinates " << coord_cache_mb << " MB"
+              << std::endl;
+
+    const std::vector<QueryPair> pairs = generate_query_pairs(index.size(), num_queries, 42);
+    std::vector<std::pair<std::string, std::vector<QueryPair>>> workloads = {{"random", pairs}};
+    const std::string edges_path = dataset_dir + "/edges.txt";
+    if (std::ifstream(edges_path).good()) {
+        std::vector<QueryPair> edges;
+        if (!load_edge_list(edges_path, index.size(), edges)) return 1;
+        workloads.emplace_back("edges", group_edges_by_source(edges, index.size()).pairs);
+    }
+
+    Dataset dataset;
+    if (verify && !dataset.load_binary(nodes_path)) return 1;
+    bool ok = true;
+    for (const auto& [label, workload] : workloads) {
+        std::vector<uint8_t> results;
+        ok = run_workload(index, label, workload, r, results) && ok;
+        if (!verify) continue;
+        size_t mismatches = 0;
+        for (size_t i = 0; i < workload.size(); ++i) {
+            const bool expected = euclidean_distance(dataset.get_point(workload[i].p_idx),
+                                                     dataset.get_point(workload[i].q_idx)) > r;
+            mismatches += (results[i] != 0) != expected ? 1 : 0;
+        }
+        std::cout << "Verified " << label << ": " << mismatches << " mismatches vs. in-memory exact distances" << std::endl;
+        ok = ok && mismatches == 0;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+// 对比多 pivot 剪枝在不同 pivot 选取策略与 pivot 数 k 下的表现：
+// 构建时间、距离表内存、剪枝率 (无需完整距离计算的查询比例) 与单线程批量查询耗时。
+//
+// 用法: pivot_selection_report <dataset_dir> <radius> [k_list] [queries] [strategies]
+//   k_list     逗号分隔的 pivot 数，默认 8,16,32,64,128
+//   queries    随机点对数，默认 100000
+//   strategies 逗号分隔的策略名 (kmeans,farthest,maxvar,incremental,random)，默认全部
+#include "algorithms/multi_pivot_triangle_pruning.h"
+#include "core/dataset.h"
+#include "core/distance_kernels.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> split_list(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <dataset_dir> <radius> [k_list] [queries] [strategies]" << std::endl;
+        return 1;
+    }
+    const std::string dataset_dir = argv[1];
+    const double radius = std::stod(argv[2]);
+    std::vector<int> ks;
+    for (const std::string& k : split_list(argc > 3 ? argv[3] : "8,16,32,64,128")) ks.push_back(std::stoi(k));
+    const size_t num_queries = argc > 4 ? std::stoul(argv[4]) : 100000;
+    std::vector<PivotSelection> strategies;
+    for (const std::string& name : split_list(argc > 5 ? argv[5] : "kmeans,farthest,maxvar,incremental,random")) {
+        PivotSelection selection;
+        if (!parse_pivot_selection(name, selection)) {
+            std::cerr << "Error: Unknown pivot selection strategy: " << name << std::endl;
+            return 1;
+        }
+        strategies.push_back(selection);
+    }
+
+    Dataset dataset;
+    if (!dataset.load_from_directory(dataset_dir)) {
+        return 1;
+    }
+    specialize_distance_kernels(dataset.dimensions());
+    if (dataset.size() < 2) {
+        std::cerr << "Error: Dataset needs at least two points." << std::endl;
+        return 1;
+    }
+
+    std::mt19937_64 gen(42);
+    std::uniform_int_distribution<int> distrib(0, static_cast<int>(dataset.size()) - 1);
+    std::vector<QueryPair> pairs;
+    pairs.reserve(num_queries);
+    while (pairs.size() < num_queries) {
+        int p = distrib(gen);
+        int q = distrib(gen);
+        if (p != q) pairs.push_back({p, q});
+    }
+    std::vector<uint8_t> results(pairs.size());
+
+    std::cout << "Dataset: " << dataset_dir << " (" << dataset.size() << " points x " << dataset.dimensions()
+              << " dimensions), r = " << radius << ", " << num_queries << " queries" << std::endl;
+    std::cout << std::left << std::setw(12) << "strategy" << std::right << std::setw(6) << "k" << std::setw(12)
+              << "build_ms" << std::setw(12) << "table_MB" << std::setw(11) << "pruned_%" << std::setw(12)
+              << "query_ms" << std::endl;
+
+    for (PivotSelection selection : strategies) {
+        for (int k : ks) {
+            if (k <= 0 || static_cast<size_t>(k) > dataset.size()) continue;
+            MultiPivotTrianglePruning algorithm(k, 20, 42, PivotTableEncoding::Float64, selection);
+
+            // 构建过程的进度输出会打乱表格，暂时屏蔽
+            std::streambuf* saved = std::cout.rdbuf(nullptr);
+            auto start = std::chrono::steady_clock::now();
+            algorithm.build(dataset);
+            std::chrono::duration<double, std::milli> build_ms = std::chrono::steady_clock::now() - start;
+            std::cout.rdbuf(saved);
+
+            algorithm.reset_stats();
+            start = std::chrono::steady_clock::now();
+            algorithm.query_distance_exceeds_batch(pairs.data(), pairs.size(), radius, results.data());
+            std::chrono::duration<double, std::milli> query_ms = std::chrono::steady_clock::now() - start;
+
+            double pruned = 100.0 * (1.0 - static_cast<double>(algorithm.get_full_calculations_count()) / pairs.size());
+            std::cout << std::left << std::setw(12) << pivot_selection_name(selection) << std::right << std::setw(6) << k
+                      << std::fixed << std::setprecision(1) << std::setw(12) << build_ms.count() << std::setprecision(3)
+                      << std::setw(12) << algorithm.pivot_table().memory_bytes() / (1024.0 * 1024.0)
+                      << std::setprecision(2) << std::setw(11) << pruned << std::setprecision(1) << std::setw(12)
+                      << query_ms.count() << std::endl;
+        }
+    }
+    return 0;
+}
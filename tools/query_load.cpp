@@ -0,0 +1,131 @@
+// query_server 的压测客户端：clients 个线程各建一个连接，每个连接保持 pipeline_depth 个未完成的请求，
+// 每个请求包含 pairs_per_request 个均匀随机的点对。给出多个半径 (逗号分隔) 时各请求轮流使用。
+// 报告总吞吐量和逐请求往返延迟 (从发送到收到应答) 的分布。
+//
+// 用法: query_load <socket_path> <r[,r2,...]> [clients] [requests_per_client] [pairs_per_request] [pipeline_depth] [seed]
+#include "bench/benchmark_runner.h"
+#include "core/cycle_clock.h"
+#include "server/query_client.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct ClientResult {
+    bool ok = true;
+    long long pairs = 0;
+    long long exceeding = 0;
+    long long rejected = 0;
+    std::vector<uint64_t> latency_ticks;
+};
+
+void run_client(const std::string& socket_path, const std::vector<double>& radii, size_t requests,
+                size_t pairs_per_request, size_t depth, uint64_t seed, ClientResult& result) {
+    QueryClient client;
+    if (!client.connect(socket_path)) {
+        result.ok = false;
+        return;
+    }
+    const std::vector<QueryPair> pairs =
+        generate_query_pairs(static_cast<size_t>(client.server().num_points), requests * pairs_per_request, seed);
+    std::vector<WireQuery> queries(pairs_per_request);
+    std::vector<uint64_t> sent_ticks(requests);
+    std::vector<uint8_t> results;
+    result.latency_ticks.reserve(requests);
+
+    size_t sent = 0;
+    size_t received = 0;
+    while (received < requests) {
+        // 补满流水线
+        while (sent < requests && sent - received < depth) {
+            const double r = radii[sent % radii.size()];
+            for (size_t i = 0; i < pairs_per_request; ++i) {
+                const QueryPair& pair = pairs[sent * pairs_per_request + i];
+                queries[i] = {pair.p_idx, pair.q_idx, r};
+            }
+            sent_ticks[sent] = CycleClock::now();
+            if (!client.send_request(sent, queries.data(), queries.size())) {
+                result.ok = false;
+                return;
+            }
+            ++sent;
+        }
+        ResponseHeader header;
+        if (!client.receive_response(header, results) || header.request_id >= requests) {
+            std::cerr << "Error: Connection to query server lost" << std::endl;
+            result.ok = false;
+            return;
+        }
+        result.latency_ticks.push_back(CycleClock::now() - sent_ticks[header.request_id]);
+        if (header.status != static_cast<uint32_t>(ResponseStatus::Ok)) {
+            ++result.rejected;
+        } else {
+            result.pairs += static_cast<long long>(results.size());
+            for (uint8_t bit : results) result.exceeding += bit;
+        }
+        ++received;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <socket_path> <r[,r2,...]> [clients] [requests_per_client] [pairs_per_request] [pipeline_depth]"
+                     " [seed]"
+                  << std::endl;
+        return 1;
+    }
+    const std::string socket_path = argv[1];
+    std::vector<double> radii;
+    std::stringstream radius_list(argv[2]);
+    for (std::string item; std::getline(radius_list, item, ',');) radii.push_back(std::stod(item));
+    const int clients = argc > 3 ? std::max(1, std::stoi(argv[3])) : 4;
+    const size_t requests = argc > 4 ? std::stoul(argv[4]) : 10000;
+    const size_t pairs_per_request = argc > 5 ? std::max<size_t>(1, std::stoul(argv[5])) : 64;
+    const size_t depth = argc > 6 ? std::max<size_t>(1, std::stoul(argv[6])) : 8;
+    const uint64_t seed = argc > 7 ? std::stoull(argv[7]) : 42;
+    if (radii.empty()) {
+        std::cerr << "Error: No radius given" << std::endl;
+        return 1;
+    }
+
+    std::vector<ClientResult> results(clients);
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back(run_client, std::cref(socket_path), std::cref(radii), requests, pairs_per_request, depth,
+                             seed + static_cast<uint64_t>(c), std::ref(results[c]));
+    }
+    for (auto& thread : threads) thread.join();
+    const double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    ClientResult total;
+    for (ClientResult& result : results) {
+        total.ok = total.ok && result.ok;
+        total.pairs += result.pairs;
+        total.exceeding += result.exceeding;
+        total.rejected += result.rejected;
+        total.latency_ticks.insert(total.latency_ticks.end(), result.latency_ticks.begin(), result.latency_ticks.end());
+    }
+    const size_t completed = total.latency_ticks.size();
+    const LatencySummary latency = summarize_latencies(total.latency_ticks);
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Clients: " << clients << ", pipeline depth " << depth << ", " << pairs_per_request
+              << " pairs/request, " << completed << " requests in " << elapsed_s << " s" << std::endl;
+    std::cout << "Throughput: " << completed / elapsed_s << " req/s, " << total.pairs / elapsed_s << " pairs/s"
+              << std::endl;
+    std::cout << "Round trip: mean " << latency.mean_ns / 1000.0 << " us, p50 " << latency.p50_ns / 1000.0
+              << " us, p99 " << latency.p99_ns / 1000.0 << " us, p999 " << latency.p999_ns / 1000.0 << " us, max "
+              << latency.max_ns / 1000.0 << " us" << std::endl;
+    std::cout << "Pairs with d > r: " << total.exceeding << " of " << total.pairs << ", rejected requests: "
+              << total.rejected << std::endl;
+    return total.ok ? 0 : 1;
+}
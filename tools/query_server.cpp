@@ -0,0 +1,104 @@
+// 本机查询服务：加载数据集和索引一次，在 Unix 域套接字上为其它进程批量执行 (p, q, r) 查询
+// (协议见 src/server/query_protocol.h，压测客户端见 query_load)。
+// 索引按 pruning_experiment 的命名缓存在数据集目录下，存在时直接加载。
+// 每隔 report_interval 秒打印一次吞吐量、攒批和延迟统计；收到 SIGINT / SIGTERM 后执行完已接收的请求再退出。
+//
+// 用法: query_server <dataset_dir> [algorithm] [k] [socket_path] [threads] [max_batch_pairs] [max_batch_delay_us]
+//                    [max_inflight_pairs] [report_interval_s]
+//   threads 为 0 表示全部硬件线程
+#include "algorithms/algorithm_factory.h"
+#include "core/dataset.h"
+#include "core/distance_kernels.h"
+#include "server/query_server.h"
+#include <chrono>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace {
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void handle_signal(int) {
+    g_stop = 1;
+}
+
+void print_metrics(const QueryServerMetrics& metrics) {
+    std::cout << std::fixed << std::setprecision(1) << std::setw(10) << metrics.requests_per_second << " req/s | "
+              << std::setw(12) << metrics.pairs_per_second << " pairs/s | batches " << metrics.batches << " (avg "
+              << metrics.mean_batch_pairs << " pairs) | latency p50 " << metrics.latency.p50_ns / 1000.0 << " us, p99 "
+              << metrics.latency.p99_ns / 1000.0 << " us, p999 " << metrics.latency.p999_ns / 1000.0
+              << " us | peak in-flight " << metrics.peak_inflight_pairs << " pairs, paused "
+              << metrics.backpressure_pauses << "x | rejected " << metrics.rejected << " | connections "
+              << metrics.connections << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <dataset_dir> [algorithm] [k] [socket_path] [threads] [max_batch_pairs] [max_batch_delay_us]"
+                     " [max_inflight_pairs] [report_interval_s]"
+                  << std::endl;
+        return 1;
+    }
+    const std::string dataset_dir = argv[1];
+    const std::string algorithm_name = argc > 2 ? argv[2] : "multipivot";
+    const int k = argc > 3 ? std::stoi(argv[3]) : 100;
+    QueryServerOptions options;
+    if (argc > 4) options.socket_path = argv[4];
+    if (argc > 5) options.threads = std::stoi(argv[5]);
+    if (argc > 6) options.max_batch_pairs = std::stoul(argv[6]);
+    if (argc > 7) options.max_batch_delay_us = std::stoi(argv[7]);
+    if (argc > 8) options.max_inflight_pairs = std::stoul(argv[8]);
+    const double report_interval_s = argc > 9 ? std::stod(argv[9]) : 5.0;
+
+    Dataset dataset;
+    if (!dataset.load_from_directory(dataset_dir)) return 1;
+    specialize_distance_kernels(dataset.dimensions());
+    auto algorithm = make_algorithm(algorithm_name, k, 20, 42);
+    if (algorithm == nullptr) {
+        std::cerr << "Error: Unknown algorithm: " << algorithm_name << std::endl;
+        return 1;
+    }
+    const std::string index_file = algorithm_index_file(algorithm_name, k);
+    const std::string index_path = index_file.empty() ? "" : dataset_dir + "/" + index_file;
+    const auto start = std::chrono::steady_clock::now();
+    bool loaded = false;
+    if (!index_path.empty() && std::ifstream(index_path).good()) loaded = algorithm->load(index_path, dataset);
+    if (!loaded) {
+        algorithm->build(dataset);
+        if (!index_path.empty()) algorithm->save(index_path);
+    }
+    std::cout << "Index " << (loaded ? "loaded" : "built") << " in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms"
+              << std::endl;
+
+    QueryServer server(*algorithm, dataset.size(), dataset.dimensions(), options);
+    if (!server.start()) return 1;
+    std::signal(SIGINT, handle_signal);
+    std::signal(SIGTERM, handle_signal);
+    std::cout << "Serving " << dataset.size() << " points x " << dataset.dimensions() << " dims with " << algorithm_name
+              << " (k=" << k << ") on " << options.socket_path << " (max batch " << options.max_batch_pairs
+              << " pairs, max delay " << options.max_batch_delay_us << " us, max in-flight "
+              << options.max_inflight_pairs << " pairs)" << std::endl;
+
+    auto next_report = std::chrono::steady_clock::now() + std::chrono::duration<double>(report_interval_s);
+    while (g_stop == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (std::chrono::steady_clock::now() < next_report) continue;
+        next_report += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(report_interval_s));
+        const QueryServerMetrics metrics = server.take_metrics();
+        if (metrics.requests > 0 || metrics.rejected > 0) print_metrics(metrics);
+    }
+    server.stop();
+    const QueryServerMetrics metrics = server.take_metrics();
+    if (metrics.requests > 0 || metrics.rejected > 0) print_metrics(metrics);
+    std::cout << "Query server stopped" << std::endl;
+    return 0;
+}
@@ -0,0 +1,134 @@
+// 点重排 (PointOrder) 对局部性敏感负载的影响：同一算法分别在 none / cluster / morton 顺序下构建，
+// 对比构建时间、范围查询、随机点对批量查询以及“近邻点对”批量查询 (查询中心 × 其范围查询结果，
+// 模拟连接 / 图边这类相邻点成批出现的负载)。各顺序的结果与 none 逐条核对。
+//
+// 用法: reorder_benchmark <dataset_dir> [algorithm] [k] [radius] [range_queries] [pair_queries]
+#include "algorithms/algorithm_factory.h"
+#include "algorithms/reordered_algorithm.h"
+#include "bench/benchmark_runner.h"
+#include "core/dataset.h"
+#include "core/distance_kernels.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct OrderRun {
+    double build_ms = 0.0;
+    double range_ms = 0.0;
+    double random_ms = 0.0;
+    double near_ms = 0.0;
+    long long range_results = 0;
+    std::vector<std::vector<int>> range;
+    std::vector<uint8_t> random;
+    std::vector<uint8_t> near;
+};
+
+void run_batches(PruningAlgorithm& algorithm, const std::vector<QueryPair>& pairs, double r, std::vector<uint8_t>& out) {
+    constexpr size_t kBatch = 4096;
+    out.assign(pairs.size(), 0);
+    for (size_t offset = 0; offset < pairs.size(); offset += kBatch) {
+        const size_t count = std::min(kBatch, pairs.size() - offset);
+        algorithm.query_distance_exceeds_batch(pairs.data() + offset, count, r, out.data() + offset);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <dataset_dir> [algorithm] [k] [radius] [range_queries] [pair_queries]" << std::endl;
+        return 1;
+    }
+    const std::string dataset_dir = argv[1];
+    const std::string base = argc > 2 ? argv[2] : "kmeans";
+    const int k = argc > 3 ? std::stoi(argv[3]) : 100;
+    const double r = argc > 4 ? std::stod(argv[4]) : 0.5;
+    const int range_queries = argc > 5 ? std::stoi(argv[5]) : 200;
+    const int pair_queries = argc > 6 ? std::stoi(argv[6]) : 200000;
+    const uint64_t seed = 42;
+
+    Dataset dataset;
+    if (!dataset.load_from_directory(dataset_dir)) return 1;
+    specialize_distance_kernels(dataset.dimensions());
+    if (dataset.size() < 2) {
+        std::cerr << "Error: Dataset needs at least 2 points." << std::endl;
+        return 1;
+    }
+    if (base.find('@') != std::string::npos || make_algorithm(base, k) == nullptr) {
+        std::cerr << "Error: Unknown base algorithm: " << base << std::endl;
+        return 1;
+    }
+
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<int> distrib(0, static_cast<int>(dataset.size()) - 1);
+    std::vector<int> centers(static_cast<size_t>(range_queries));
+    for (int& c : centers) c = distrib(gen);
+    const std::vector<QueryPair> random_pairs =
+        generate_query_pairs(dataset.size(), static_cast<size_t>(pair_queries), seed + 1);
+
+    const std::vector<PointOrder> orders = {PointOrder::None, PointOrder::Cluster, PointOrder::Morton};
+    std::vector<OrderRun> runs(orders.size());
+    std::vector<QueryPair> near_pairs;
+    for (size_t o = 0; o < orders.size(); ++o) {
+        OrderRun& run = runs[o];
+        ReorderedAlgorithm algorithm(make_algorithm(base, k, 20, seed), orders[o], k, seed);
+        auto start = std::chrono::steady_clock::now();
+        algorithm.build(dataset);
+        run.build_ms = elapsed_ms(start);
+
+        run.range.resize(centers.size());
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < centers.size(); ++i) algorithm.range_query(centers[i], r, run.range[i]);
+        run.range_ms = elapsed_ms(start);
+        for (auto& result : run.range) {
+            run.range_results += static_cast<long long>(result.size());
+            std::sort(result.begin(), result.end());
+        }
+
+        // 近邻点对由 none 顺序的范围查询结果生成，三种顺序使用同一份负载
+        if (o == 0) {
+            for (size_t i = 0; i < centers.size() && near_pairs.size() < static_cast<size_t>(pair_queries); ++i) {
+                for (int id : run.range[i]) {
+                    if (id != centers[i]) near_pairs.push_back({centers[i], id});
+                }
+            }
+        }
+
+        start = std::chrono::steady_clock::now();
+        run_batches(algorithm, random_pairs, r, run.random);
+        run.random_ms = elapsed_ms(start);
+        start = std::chrono::steady_clock::now();
+        run_batches(algorithm, near_pairs, r, run.near);
+        run.near_ms = elapsed_ms(start);
+    }
+
+    std::cout << "\nDataset: " << dataset.size() << " points x " << dataset.dimensions() << " dims | algorithm: " << base
+              << " k=" << k << " r=" << r << "\n"
+              << "Range queries: " << centers.size() << " | random pairs: " << random_pairs.size()
+              << " | near pairs: " << near_pairs.size() << "\n\n";
+    std::cout << std::left << std::setw(10) << "order" << std::right << std::setw(12) << "build ms" << std::setw(12)
+              << "range ms" << std::setw(14) << "random ms" << std::setw(12) << "near ms" << std::setw(10)
+              << "results" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    bool all_match = true;
+    for (size_t o = 0; o < orders.size(); ++o) {
+        const OrderRun& run = runs[o];
+        const bool match = run.range == runs[0].range && run.random == runs[0].random && run.near == runs[0].near;
+        all_match = all_match && match;
+        std::cout << std::left << std::setw(10) << point_order_name(orders[o]) << std::right << std::setw(12)
+                  << run.build_ms << std::setw(12) << run.range_ms << std::setw(14) << run.random_ms << std::setw(12)
+                  << run.near_ms << std::setw(10) << run.range_results << (match ? "" : "  RESULTS DIFFER") << std::endl;
+    }
+    return all_match ? 0 : 1;
+}